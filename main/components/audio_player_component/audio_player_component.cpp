@@ -10,6 +10,10 @@
 
 static const char *TAG = "AUDIO_PLAYER_COMP";
 
+// Holding LEFT/RIGHT rewinds/fast-forwards by this step, at most once per repeat period.
+#define SEEK_STEP_S 5
+#define SEEK_REPEAT_MS 250
+
 // Component state data structure
 typedef struct {
     char current_song_path[256];
@@ -18,6 +22,7 @@ typedef struct {
     bool is_exiting;
     bool is_playing_active;
     bool viz_data_received;
+    uint32_t last_seek_tick;
 
     // UI Widgets
     lv_obj_t *play_pause_btn_label;
@@ -75,6 +80,16 @@ static void handle_volume_down(void* user_data) {
     update_volume_label(data);
 }
 
+static void handle_seek(audio_player_data_t* data, bool forward) {
+    if (lv_tick_elaps(data->last_seek_tick) < SEEK_REPEAT_MS) return;
+    data->last_seek_tick = lv_tick_get();
+    if (forward) audio_manager_fast_forward(SEEK_STEP_S);
+    else audio_manager_rewind(SEEK_STEP_S);
+}
+
+static void handle_rewind(void* user_data) { handle_seek((audio_player_data_t*)user_data, false); }
+static void handle_fast_forward(void* user_data) { handle_seek((audio_player_data_t*)user_data, true); }
+
 // --- UI Helper ---
 static void update_volume_label(audio_player_data_t* data) {
     if (!data || !data->volume_label_widget) return;
@@ -165,6 +180,8 @@ lv_obj_t* audio_player_component_create(lv_obj_t* parent, const char* file_path,
     button_manager_register_handler(BUTTON_CANCEL, BUTTON_EVENT_TAP, handle_cancel_press, true, data);
     button_manager_register_handler(BUTTON_LEFT,   BUTTON_EVENT_TAP, handle_volume_down, true, data);
     button_manager_register_handler(BUTTON_RIGHT,  BUTTON_EVENT_TAP, handle_volume_up, true, data);
+    button_manager_register_handler(BUTTON_LEFT,   BUTTON_EVENT_LONG_PRESS_HOLD, handle_rewind, true, data);
+    button_manager_register_handler(BUTTON_RIGHT,  BUTTON_EVENT_LONG_PRESS_HOLD, handle_fast_forward, true, data);
     
     if (audio_manager_play(data->current_song_path)) {
         data->is_playing_active = true;
@@ -1,6 +1,8 @@
 #include "memory_monitor_component.h"
+#include "controllers/audio_manager/audio_manager.h"
 #include "esp_heap_caps.h"
 #include "esp_log.h"
+#include <stdio.h>
 
 static const char* TAG = "MEM_MONITOR";
 static const uint32_t UPDATE_INTERVAL_MS = 1000; // Update every second
@@ -32,9 +34,19 @@ static void update_timer_cb(lv_timer_t* timer) {
     size_t psram_total_kb = (psram_info.total_free_bytes + psram_info.total_allocated_bytes) / 1024;
 
     // Update the label text to show USED/TOTAL memory
-    lv_label_set_text_fmt(monitor->label, "RAM: %zu/%zu KB\nPSRAM: %zu/%zu KB",
-                          internal_used_kb, internal_total_kb,
-                          psram_used_kb, psram_total_kb);
+    char text[96];
+    int len = snprintf(text, sizeof(text), "RAM: %zu/%zu KB\nPSRAM: %zu/%zu KB",
+                       internal_used_kb, internal_total_kb,
+                       psram_used_kb, psram_total_kb);
+
+    // Once audio has played, add the playback health: underruns, read stalls and peak mixer CPU load
+    audio_health_t health;
+    audio_manager_get_health(&health);
+    if (health.blocks > 0 && len > 0 && (size_t)len < sizeof(text)) {
+        snprintf(text + len, sizeof(text) - len, "\nAudio: %lu xrun %lu stall %lu%%",
+                 health.underruns, health.read_stalls, (health.peak_cpu_load_permille + 5) / 10);
+    }
+    lv_label_set_text(monitor->label, text);
 }
 
 // Cleanup event callback to delete the timer and allocated data
@@ -15,11 +15,91 @@
 // Sets a safety limit on the physical volume (0-100) to protect the speaker.
 // The UI will still show 0-100%, but it will be mapped to this physical range.
 #define MAX_VOLUME_PERCENTAGE 50 // For a small speaker, 25 is a good value
+// Fixed rate of the I2S output and the mixer bus. Files and effects at other
+// rates are resampled to it, so the I2S clock never changes.
+#define AUDIO_OUTPUT_SAMPLE_RATE 48000
+// Look-ahead limiter at the end of the output chain: peaks above the threshold
+// (dBFS) are turned down smoothly ~1.3 ms in advance instead of being clipped,
+// and the gain recovers with the release time constant.
+#define AUDIO_LIMITER_THRESHOLD_DBFS (-1.0f)
+#define AUDIO_LIMITER_RELEASE_MS 60
+
+// --- PLAYBACK BUFFERING ---
+// PSRAM ring buffer between the SD reader task and the I2S writer. It holds audio
+// already converted to the bus format, so 128 KB is ~680 ms at 48 kHz 16-bit
+// stereo whatever the file format, enough to ride out SD stalls.
+#define AUDIO_PLAYBACK_RINGBUF_SIZE   (128 * 1024)
+// Fill level (bytes) required before output starts, and again after an underrun.
+#define AUDIO_PLAYBACK_HIGH_WATERMARK (32 * 1024)
+// Fill level (bytes) below which a low-watermark event is counted in the playback stats.
+#define AUDIO_PLAYBACK_LOW_WATERMARK  (16 * 1024)
+// Files that can wait in the playback queue behind the current track.
+#define AUDIO_PLAYBACK_QUEUE_LENGTH   8
+
+// --- MIXER ---
+// Voices mixed onto the output bus: one background track (file playback) plus
+// AUDIO_MIXER_VOICES - 1 simultaneous sound effects.
+#define AUDIO_MIXER_VOICES 4
+// Level (percent) the background track is ducked to while a sound effect plays.
+#define AUDIO_MIXER_DUCK_PERCENT 30
+
+// --- SOUND BANK ---
+// Largest effect (bytes once decoded to the 48 kHz 16-bit stereo bus format,
+// ~2.7 s) that will be preloaded into PSRAM.
+// Bigger files are left on the SD card and replaced by the synthesized fallback chime.
+#define AUDIO_SOUND_BANK_MAX_CLIP_SIZE (512 * 1024)
 
 // --- RECORDING CONFIGURATION ---
 #define REC_SAMPLE_RATE 16000
 #define REC_BITS_PER_SAMPLE 16
 #define REC_NUM_CHANNELS 1
+// PSRAM ring between the microphone capture task and the SD writer task. It holds
+// 16-bit samples, so 128 KB is ~4 s at 16 kHz mono, enough to ride out slow FAT
+// writes (cluster allocation, wear levelling) without losing microphone samples.
+#define REC_RINGBUF_SIZE (128 * 1024)
+// Bytes per SD write: 32 KB, the largest FAT cluster size SD cards are
+// formatted with (4-32 KB; 32 KB on most SDHC cards). Being a multiple of
+// every cluster size, with the WAV header at the head of the first write,
+// every write covers whole clusters at a cluster-aligned offset. The writer
+// task started out with 16 KB batches; at 32 KB a card with 32 KB clusters
+// takes one write per cluster instead of two, and a batch (~1 s of 16 kHz
+// mono) still fits four times in the ring.
+#define REC_WRITE_CHUNK_SIZE (32 * 1024)
+// Recordings are grown in extents of this size ahead of the audio (~16 s at
+// 16 kHz mono), so FAT links clusters in bulk instead of on every write. The
+// unused tail is truncated when the recording is saved.
+#define REC_PREALLOC_EXTENT_SIZE (512 * 1024)
+// How often the WAV header of a recording is updated and the file synced, so
+// a reset or brownout loses at most this much audio plus one write batch.
+// Checkpoints follow batch writes, so IMA-ADPCM (~4 s per batch) gets one at
+// most every batch. Each costs a header rewrite and a FAT sync, about 7 ms of
+// card time; 0 disables them.
+#define REC_CHECKPOINT_INTERVAL_MS 5000
+// Encoded block size of IMA-ADPCM recordings: 505 frames (~32 ms at 16 kHz)
+// per channel, the usual size for speech rates.
+#define REC_ADPCM_BLOCK_ALIGN (256 * REC_NUM_CHANNELS)
+
+// --- MICROPHONE AGC ---
+// Automatic gain control of the INMP441, shared by the recorder and the WiFi
+// streamer. Levels are peak levels relative to full scale of the 16-bit output.
+// Speech peaks of the mic at arm's length are around -50 dBFS before gain.
+#define MIC_AGC_TARGET_DBFS (-9.0f)       // Envelope level the output is brought to.
+#define MIC_AGC_MAX_GAIN_DB (40.0f)       // Highest gain (100x).
+#define MIC_AGC_INITIAL_GAIN_DB (31.0f)   // Starting gain: the former fixed 35x.
+#define MIC_AGC_NOISE_FLOOR_DBFS (-60.0f) // Input peak below which a block leaves the gain alone.
+#define MIC_AGC_ATTACK_MS 20              // Envelope rise: one doubling (+6 dB) per attack time.
+#define MIC_AGC_RELEASE_MS 500            // Envelope decay time constant.
+
+// --- VOICE ACTIVITY DETECTION ---
+// Used by recordings started with trim_silence or an auto-stop (journal, voice notes).
+#define REC_VAD_THRESHOLD_DB 6.0f   // Block energy above the noise floor that counts as speech.
+#define REC_VAD_HANGOVER_MS 300     // Speech lasts this long after the last active block.
+#define REC_VAD_PREROLL_MS 300      // Audio kept ahead of each word when trimming.
+#define REC_VAD_MAX_PAUSE_MS 1000   // Longer pauses are shortened to this when trimming.
+#define REC_AUTO_STOP_SILENCE_S 10  // Silence after which journal and voice note recordings stop.
+// Audio from before the record press kept by the journal and voice note
+// views, which arm the recorder while open.
+#define REC_ARM_PREROLL_MS 500
 
 // --- BUTTON CONFIGURATION ---
 // Time in milliseconds to wait for a second click. If exceeded, a SINGLE_CLICK is registered.
@@ -31,4 +111,47 @@
 #define WEATHER_API_URL "https://api.open-meteo.com/v1/forecast?latitude=41.39&longitude=2.16&hourly=weather_code&forecast_days=2&timezone=Europe%2FBerlin"
 #define WEATHER_FETCH_INTERVAL_MS (30 * 60 * 1000) // 30 minutes
 
+// --- HTTPS CONNECTIONS ---
+// How long an idle HTTPS connection is kept for the next request to the same
+// host. Each one holds its mbedTLS buffers (about 20 KB of internal RAM).
+#define HTTPS_KEEP_ALIVE_MS 20000
+// Idle connections kept per host.
+#define HTTPS_MAX_IDLE_PER_HOST 1
+
+// --- SPEECH-TO-TEXT STREAMING ---
+// Transcribe voice notes while they are recorded, when WiFi is up (every note is uploaded).
+#define STT_STREAM_VOICE_NOTES 1
+// Audio waiting to be uploaded while a recording streams to the STT API (PSRAM).
+// Covers the TLS handshake at the start (4 s of 16 kHz PCM); if it fills, the
+// file is uploaded once the recording ends instead.
+#define STT_STREAM_BUFFER_SIZE (128 * 1024)
+// Audio per HTTP chunk: with the chunk framing it fills one outgoing TLS record
+// (CONFIG_MBEDTLS_SSL_OUT_CONTENT_LEN).
+#define STT_STREAM_CHUNK_SIZE (4096 - 16)
+// Longest wait for WiFi and time sync once a streamed recording has started.
+#define STT_STREAM_CONNECT_TIMEOUT_MS 10000
+
+// --- SPEECH-TO-TEXT UPLOADS ---
+// Recordings are sent to the STT API as FLAC, mono, at no more than this rate
+// (Whisper works at 16 kHz), instead of as the WAV file (see stt_upload_audio.h).
+// 0 uploads the file as it is.
+#define STT_UPLOAD_COMPRESS 1
+#define STT_UPLOAD_SAMPLE_RATE 16000
+// Leave out leading and trailing silence and shorten long pauses (REC_VAD_*) before uploading.
+#define STT_UPLOAD_TRIM_SILENCE 1
+// Frames per FLAC frame (256 ms at 16 kHz); each is one piece of the HTTP body.
+#define STT_UPLOAD_FLAC_BLOCK_FRAMES 4096
+
+// --- SPEECH-TO-TEXT QUEUE ---
+// Voice notes kept waiting for a transcription (in LittleFS) when offline or after a failure.
+#define STT_QUEUE_MAX_JOBS 32
+// Uploads at once. Each one holds a TLS connection (its mbedTLS buffers in internal RAM).
+#define STT_QUEUE_MAX_CONCURRENT 2
+// Wait before retrying a failed upload, doubled on every failure up to the maximum.
+// Failures while offline do not count, and a new connection retries every job at once.
+#define STT_QUEUE_RETRY_BASE_MS 30000
+#define STT_QUEUE_RETRY_MAX_MS (30 * 60 * 1000)
+// Failed uploads after which a note is dropped from the queue (it can still be transcribed by hand).
+#define STT_QUEUE_MAX_ATTEMPTS 8
+
 #endif // APP_CONFIG_H
\ No newline at end of file
@@ -0,0 +1,308 @@
+#include "audio_decoder.h"
+#include "audio_mixer.h"
+#include "audio_ima_adpcm.h"
+#include "audio_qoa.h"
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+#include <string.h>
+
+static const char *TAG = "AUDIO_DECODER";
+
+#define WAV_FORMAT_PCM 1
+#define PCM_BLOCK_FRAMES 512    // Frames per fread() for uncompressed files.
+#define MAX_BLOCK_BYTES 8192    // Largest encoded block accepted (WAV block_align or QOA frame).
+
+// Duplicates a mono block into both channels, in place. `pcm` must have room for `frames` stereo frames.
+static void upmix_in_place(int16_t* pcm, size_t frames) {
+    for (size_t i = frames; i-- > 0;) {
+        pcm[2 * i + 1] = pcm[i];
+        pcm[2 * i] = pcm[i];
+    }
+}
+
+// fread() that adds the time it took to `dec->read_us`, for the playback health counters.
+static size_t timed_fread(audio_decoder_t* dec, void* dst, size_t bytes) {
+    const int64_t start = esp_timer_get_time();
+    const size_t n = fread(dst, 1, bytes, dec->fp);
+    dec->read_us += (uint32_t)(esp_timer_get_time() - start);
+    return n;
+}
+
+// Reads up to one WAV block from the 'data' chunk. Returns the bytes read.
+static size_t read_wav_block(audio_decoder_t* dec, size_t max_bytes) {
+    size_t to_read = (dec->bytes_remaining < max_bytes) ? dec->bytes_remaining : max_bytes;
+    if (to_read == 0) return 0;
+    size_t n = timed_fread(dec, dec->block, to_read);
+    if (n < to_read) {
+        if (ferror(dec->fp)) {
+            ESP_LOGE(TAG, "File read error.");
+            dec->error = true;
+        } else {
+            ESP_LOGW(TAG, "File ends %lu bytes before the end of its 'data' chunk.", (uint32_t)(dec->bytes_remaining - n));
+        }
+        dec->bytes_remaining = 0;
+        return n;
+    }
+    dec->bytes_remaining -= n;
+    return n;
+}
+
+// Positions a WAV stream `offset` bytes into its 'data' chunk, of which the first `data_end` bytes are played.
+static bool seek_wav_data(audio_decoder_t* dec, uint64_t offset, uint32_t data_end) {
+    if (offset > data_end) offset = data_end;
+    dec->bytes_remaining = data_end - (uint32_t)offset;
+    return fseek(dec->fp, (long)(dec->wav.data_offset + offset), SEEK_SET) == 0;
+}
+
+// --- PCM WAV ---
+static bool pcm_open(audio_decoder_t* dec) {
+    if (!audio_mixer_format_supported(&dec->wav)) {
+        ESP_LOGE(TAG, "Unsupported PCM format: BPS=%u, CH=%u, block_align=%u",
+                 dec->wav.bits_per_sample, dec->wav.num_channels, dec->wav.block_align);
+        return false;
+    }
+    dec->bytes_remaining = dec->wav.data_size - (dec->wav.data_size % dec->wav.block_align);
+    dec->total_frames = dec->wav.data_size / dec->wav.block_align;
+    return true;
+}
+
+static void pcm_block_sizes(const audio_decoder_t* dec, size_t* block_bytes, size_t* block_frames) {
+    *block_bytes = PCM_BLOCK_FRAMES * dec->wav.block_align;
+    *block_frames = PCM_BLOCK_FRAMES;
+}
+
+static size_t pcm_decode_block(audio_decoder_t* dec) {
+    const size_t frames = read_wav_block(dec, dec->block_capacity) / dec->wav.block_align;
+    audio_mixer_convert_to_stereo16(dec->block, &dec->wav, dec->pcm, frames);
+    return frames;
+}
+
+static bool pcm_seek(audio_decoder_t* dec, uint32_t frame, uint32_t* block_start) {
+    *block_start = frame;
+    const uint32_t align = dec->wav.block_align;
+    return seek_wav_data(dec, (uint64_t)frame * align, dec->wav.data_size - (dec->wav.data_size % align));
+}
+
+// --- IMA-ADPCM WAV ---
+static bool ima_open(audio_decoder_t* dec) {
+    const audio_wav_info_t* wav = &dec->wav;
+    if (wav->bits_per_sample != 4 || !audio_ima_adpcm_layout_valid(wav->block_align, wav->num_channels) ||
+        wav->block_align > MAX_BLOCK_BYTES) {
+        ESP_LOGE(TAG, "Unsupported IMA-ADPCM layout: BPS=%u, CH=%u, block_align=%u",
+                 wav->bits_per_sample, wav->num_channels, wav->block_align);
+        return false;
+    }
+    dec->bytes_remaining = wav->data_size;
+    dec->total_frames = (wav->data_size / wav->block_align) * audio_ima_adpcm_frames_per_block(wav->block_align, wav->num_channels) +
+                        audio_ima_adpcm_frames_in(wav->data_size % wav->block_align, wav->num_channels);
+    return true;
+}
+
+static void ima_block_sizes(const audio_decoder_t* dec, size_t* block_bytes, size_t* block_frames) {
+    *block_bytes = dec->wav.block_align;
+    *block_frames = audio_ima_adpcm_frames_per_block(dec->wav.block_align, dec->wav.num_channels);
+}
+
+static size_t ima_decode_block(audio_decoder_t* dec) {
+    const size_t bytes = read_wav_block(dec, dec->wav.block_align);
+    const size_t frames = audio_ima_adpcm_decode_block(dec->block, bytes, dec->num_channels, dec->pcm);
+    if (dec->num_channels == 1) upmix_in_place(dec->pcm, frames);
+    return frames;
+}
+
+// Every block restarts the predictor from its header, so any block is a valid entry point.
+static bool ima_seek(audio_decoder_t* dec, uint32_t frame, uint32_t* block_start) {
+    const uint32_t block_frames = audio_ima_adpcm_frames_per_block(dec->wav.block_align, dec->num_channels);
+    const uint32_t index = frame / block_frames;
+    *block_start = index * block_frames;
+    return seek_wav_data(dec, (uint64_t)index * dec->wav.block_align, dec->wav.data_size);
+}
+
+// --- QOA ---
+static bool qoa_open(audio_decoder_t* dec) {
+    uint32_t total_samples = 0;
+    audio_qoa_frame_header_t first;
+    if (!audio_qoa_read_header(dec->fp, &total_samples, &first)) return false;
+    if (first.num_channels > 2) {
+        ESP_LOGE(TAG, "Unsupported QOA stream with %u channels.", first.num_channels);
+        return false;
+    }
+    dec->sample_rate = first.sample_rate;
+    dec->num_channels = first.num_channels;
+    dec->total_frames = total_samples;
+    dec->frames_remaining = total_samples;
+    return true;
+}
+
+static void qoa_block_sizes(const audio_decoder_t* dec, size_t* block_bytes, size_t* block_frames) {
+    *block_bytes = audio_qoa_frame_size(dec->num_channels, AUDIO_QOA_FRAME_LEN);
+    *block_frames = AUDIO_QOA_FRAME_LEN;
+}
+
+static size_t qoa_decode_block(audio_decoder_t* dec) {
+    if (dec->total_frames > 0 && dec->frames_remaining == 0) return 0;
+
+    size_t n = timed_fread(dec, dec->block, AUDIO_QOA_FRAME_HEADER_SIZE);
+    if (n == 0 && !ferror(dec->fp)) return 0; // Clean end of a stream of unknown length.
+
+    audio_qoa_frame_header_t header;
+    bool complete = (n == AUDIO_QOA_FRAME_HEADER_SIZE);
+    if (complete) {
+        if (!audio_qoa_parse_frame_header(dec->block, &header) ||
+            header.num_channels != dec->num_channels || header.sample_rate != dec->sample_rate ||
+            header.frame_size > dec->block_capacity) {
+            ESP_LOGE(TAG, "Invalid QOA frame header.");
+            dec->error = true;
+            return 0;
+        }
+        const size_t body = header.frame_size - AUDIO_QOA_FRAME_HEADER_SIZE;
+        complete = (timed_fread(dec, dec->block + AUDIO_QOA_FRAME_HEADER_SIZE, body) == body);
+    }
+    if (!complete) {
+        // Like a short WAV 'data' chunk, a cut-off last frame just ends the stream.
+        if (ferror(dec->fp)) {
+            ESP_LOGE(TAG, "File read error.");
+            dec->error = true;
+        } else {
+            ESP_LOGW(TAG, "File ends in the middle of a QOA frame.");
+        }
+        return 0;
+    }
+
+    size_t frames = audio_qoa_decode_frame(dec->block, &header, dec->pcm);
+    if (dec->total_frames > 0) {
+        if (frames > dec->frames_remaining) frames = dec->frames_remaining;
+        dec->frames_remaining -= frames;
+    }
+    if (dec->num_channels == 1) upmix_in_place(dec->pcm, frames);
+    return frames;
+}
+
+// QOA frames are independent and all but the last one are full, so they have a fixed size.
+static bool qoa_seek(audio_decoder_t* dec, uint32_t frame, uint32_t* block_start) {
+    const uint32_t index = frame / AUDIO_QOA_FRAME_LEN;
+    *block_start = index * AUDIO_QOA_FRAME_LEN;
+    if (dec->total_frames > 0) dec->frames_remaining = dec->total_frames - *block_start;
+    const uint64_t offset = AUDIO_QOA_FILE_HEADER_SIZE + (uint64_t)index * audio_qoa_frame_size(dec->num_channels, AUDIO_QOA_FRAME_LEN);
+    return fseek(dec->fp, (long)offset, SEEK_SET) == 0;
+}
+
+static const audio_decoder_ops_t s_pcm_ops = { "PCM", pcm_open, pcm_block_sizes, pcm_decode_block, pcm_seek };
+static const audio_decoder_ops_t s_ima_ops = { "IMA-ADPCM", ima_open, ima_block_sizes, ima_decode_block, ima_seek };
+static const audio_decoder_ops_t s_qoa_ops = { "QOA", qoa_open, qoa_block_sizes, qoa_decode_block, qoa_seek };
+
+// Codecs carried in a WAV container, by 'fmt ' format tag.
+static const struct {
+    uint16_t format_tag;
+    const audio_decoder_ops_t* ops;
+} s_wav_codecs[] = {
+    { WAV_FORMAT_PCM, &s_pcm_ops },
+    { AUDIO_IMA_ADPCM_WAV_FORMAT, &s_ima_ops },
+};
+
+static void* alloc_buffer(size_t bytes) {
+    void* p = heap_caps_malloc(bytes, MALLOC_CAP_SPIRAM);
+    if (!p) p = heap_caps_malloc(bytes, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    return p;
+}
+
+bool audio_decoder_open(audio_decoder_t* dec, FILE* fp) {
+    if (!dec || !fp) return false;
+    memset(dec, 0, sizeof(audio_decoder_t));
+    dec->fp = fp;
+
+    char magic[4];
+    if (fread(magic, 1, sizeof(magic), fp) != sizeof(magic)) {
+        ESP_LOGE(TAG, "File is too short.");
+        return false;
+    }
+    fseek(fp, 0, SEEK_SET);
+
+    if (memcmp(magic, "RIFF", 4) == 0) {
+        if (!audio_wav_read_header(fp, &dec->wav)) return false;
+        for (size_t i = 0; i < sizeof(s_wav_codecs) / sizeof(s_wav_codecs[0]); i++) {
+            if (s_wav_codecs[i].format_tag == dec->wav.audio_format) dec->ops = s_wav_codecs[i].ops;
+        }
+        if (!dec->ops) {
+            ESP_LOGE(TAG, "Unsupported WAV format tag 0x%04x.", dec->wav.audio_format);
+            return false;
+        }
+        dec->sample_rate = dec->wav.sample_rate;
+        dec->num_channels = dec->wav.num_channels;
+    } else if (memcmp(magic, AUDIO_QOA_MAGIC, 4) == 0) {
+        dec->ops = &s_qoa_ops;
+    } else {
+        ESP_LOGE(TAG, "Unknown file format.");
+        return false;
+    }
+
+    if (!dec->ops->open(dec)) {
+        dec->ops = NULL;
+        return false;
+    }
+
+    size_t block_bytes = 0, block_frames = 0;
+    dec->ops->block_sizes(dec, &block_bytes, &block_frames);
+    dec->block = (uint8_t*)alloc_buffer(block_bytes);
+    dec->pcm = (int16_t*)alloc_buffer(block_frames * 2 * sizeof(int16_t));
+    if (!dec->block || !dec->pcm) {
+        ESP_LOGE(TAG, "Failed to allocate %u + %u bytes of decoder buffers.", block_bytes, block_frames * 2 * sizeof(int16_t));
+        audio_decoder_close(dec);
+        return false;
+    }
+    dec->block_capacity = block_bytes;
+    dec->pcm_capacity = block_frames;
+    ESP_LOGI(TAG, "%s stream: %lu Hz, %u ch, %lu frames.", dec->ops->name, dec->sample_rate, dec->num_channels, dec->total_frames);
+    return true;
+}
+
+size_t audio_decoder_read(audio_decoder_t* dec, int16_t* out, size_t max_frames) {
+    if (!dec || !dec->ops || !dec->pcm) return 0;
+    size_t produced = 0;
+    while (produced < max_frames) {
+        if (dec->pcm_pos == dec->pcm_frames) {
+            dec->pcm_pos = 0;
+            dec->pcm_frames = dec->ops->decode_block(dec);
+            if (dec->pcm_frames == 0) break;
+        }
+        size_t n = dec->pcm_frames - dec->pcm_pos;
+        if (n > max_frames - produced) n = max_frames - produced;
+        memcpy(out + produced * 2, dec->pcm + dec->pcm_pos * 2, n * 2 * sizeof(int16_t));
+        dec->pcm_pos += n;
+        produced += n;
+    }
+    return produced;
+}
+
+bool audio_decoder_seek(audio_decoder_t* dec, uint32_t frame) {
+    if (!dec || !dec->ops || !dec->pcm) return false;
+    if (dec->total_frames > 0 && frame > dec->total_frames) frame = dec->total_frames;
+
+    uint32_t block_start = 0;
+    dec->pcm_frames = 0;
+    dec->pcm_pos = 0;
+    if (!dec->ops->seek(dec, frame, &block_start)) {
+        ESP_LOGE(TAG, "Seek to frame %lu failed.", frame);
+        dec->error = true;
+        dec->bytes_remaining = 0;
+        dec->frames_remaining = 0;
+        return false;
+    }
+    // Drop the head of the block so playback resumes on the exact frame.
+    if (frame > block_start) {
+        dec->pcm_frames = dec->ops->decode_block(dec);
+        dec->pcm_pos = (frame - block_start < dec->pcm_frames) ? frame - block_start : dec->pcm_frames;
+    }
+    return !dec->error;
+}
+
+void audio_decoder_close(audio_decoder_t* dec) {
+    if (!dec) return;
+    if (dec->block) heap_caps_free(dec->block);
+    if (dec->pcm) heap_caps_free(dec->pcm);
+    dec->block = NULL;
+    dec->pcm = NULL;
+    dec->ops = NULL;
+    dec->fp = NULL;
+}
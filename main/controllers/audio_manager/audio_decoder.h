@@ -0,0 +1,105 @@
+/**
+ * @file audio_decoder.h
+ * @brief Streaming, block-based decoders for the audio file formats the player accepts.
+ *
+ * A decoder is opened on a file, detects its container and codec, and then
+ * hands out 16-bit stereo frames at the file's own sample rate, one codec
+ * block at a time. Supported formats:
+ * - WAV, PCM (8/16/24/32-bit, mono or stereo)
+ * - WAV, IMA-ADPCM (format 0x11, 4-bit, mono or stereo)
+ * - QOA (mono or stereo)
+ *
+ * New codecs plug in as another audio_decoder_ops_t.
+ */
+#ifndef AUDIO_DECODER_H
+#define AUDIO_DECODER_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "audio_wav.h"
+
+typedef struct audio_decoder_s audio_decoder_t;
+
+/**
+ * @brief The codec-specific part of a decoder.
+ */
+typedef struct {
+    const char* name;
+    /** Validates the stream format and fills in the stream info. The file is positioned at the first block. */
+    bool (*open)(audio_decoder_t* dec);
+    /** Largest encoded block (bytes) and decoded block (frames) of the opened stream. */
+    void (*block_sizes)(const audio_decoder_t* dec, size_t* block_bytes, size_t* block_frames);
+    /** Reads and decodes the next block into `dec->pcm`. Returns frames decoded, 0 at the end or on error. */
+    size_t (*decode_block)(audio_decoder_t* dec);
+    /** Moves the file to the block holding `frame` (at most `total_frames`) and sets `*block_start` to its first frame. */
+    bool (*seek)(audio_decoder_t* dec, uint32_t frame, uint32_t* block_start);
+} audio_decoder_ops_t;
+
+/**
+ * @brief State of an open decoder. Only the stream info fields are meant to be read by callers.
+ */
+struct audio_decoder_s {
+    const audio_decoder_ops_t* ops;
+    FILE* fp;
+
+    // Stream info, valid after audio_decoder_open().
+    uint32_t sample_rate;     //!< Sample rate of the decoded audio, in Hz.
+    uint16_t num_channels;    //!< Channels in the file (the output is always stereo).
+    uint32_t total_frames;    //!< Frames in the whole stream, or 0 if unknown.
+    bool error;               //!< Set if a read or format error ended the stream early.
+
+    // Container state.
+    audio_wav_info_t wav;     //!< Format of WAV streams.
+    uint32_t bytes_remaining; //!< Encoded bytes left in a WAV 'data' chunk.
+    uint32_t frames_remaining; //!< Frames left in a QOA stream of known length.
+    uint32_t read_us;         //!< Time spent in fread() since the caller last cleared it.
+
+    // Block buffers, allocated by audio_decoder_open().
+    uint8_t* block;           //!< Encoded block.
+    size_t block_capacity;    //!< Bytes in `block`.
+    int16_t* pcm;             //!< Decoded block, as 16-bit stereo.
+    size_t pcm_capacity;      //!< Frames in `pcm`.
+    size_t pcm_frames;        //!< Valid frames in `pcm`.
+    size_t pcm_pos;           //!< Next frame of `pcm` to hand out.
+};
+
+/**
+ * @brief Detects the format of an open file and prepares a decoder for it.
+ *
+ * @param dec The decoder to set up. It must have been zero-initialized or closed.
+ * @param fp An open file, positioned at its start. It stays owned by the caller.
+ * @return true if the format is supported and the buffers were allocated.
+ */
+bool audio_decoder_open(audio_decoder_t* dec, FILE* fp);
+
+/**
+ * @brief Decodes the next frames of the stream as interleaved 16-bit stereo.
+ *
+ * @param dec An open decoder.
+ * @param out Output buffer.
+ * @param max_frames Capacity of `out` in frames.
+ * @return Frames written. Less than `max_frames` only at the end of the stream
+ *         (check `dec->error` to tell a clean end from a failure).
+ */
+size_t audio_decoder_read(audio_decoder_t* dec, int16_t* out, size_t max_frames);
+
+/**
+ * @brief Moves the stream to an exact frame.
+ *
+ * The file offset of the enclosing codec block is computed from the position
+ * of the audio data recorded at open and the block size, so no chunk or frame
+ * is scanned. The frames of that block before `frame` are decoded and dropped.
+ *
+ * @param dec An open decoder.
+ * @param frame Frame to continue from. Past the end, the stream ends.
+ * @return false if the file could not be repositioned (`dec->error` is set).
+ */
+bool audio_decoder_seek(audio_decoder_t* dec, uint32_t frame);
+
+/**
+ * @brief Frees the decoder's buffers. The file is not closed.
+ */
+void audio_decoder_close(audio_decoder_t* dec);
+
+#endif // AUDIO_DECODER_H
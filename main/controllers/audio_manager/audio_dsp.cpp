@@ -0,0 +1,312 @@
+#include "audio_dsp.h"
+#include "esp_log.h"
+#include <string.h>
+#include <math.h>
+
+static const char *TAG = "AUDIO_DSP";
+
+// --- FIXED-POINT FORMAT ---
+// Coefficients are Q2.30 (range [-2, 2), enough for a1 of a low-cutoff biquad).
+// Signals carry 12 fractional bits below the 16-bit LSB: a full-scale input uses
+// 28 bits, which leaves headroom for the unclipped stage-1 overshoot while the
+// 64-bit accumulator of five products stays well below 2^63.
+#define COEFF_FRAC_BITS 30
+#define STATE_FRAC_BITS 12
+
+#define LR4_Q1 0.541196
+#define LR4_Q2 1.306563
+
+static inline int32_t to_q30(double value) {
+    return (int32_t)lrint(value * (double)(1 << COEFF_FRAC_BITS));
+}
+
+static inline int32_t round_from_state(int32_t value) {
+    return (value + (1 << (STATE_FRAC_BITS - 1))) >> STATE_FRAC_BITS;
+}
+
+static inline int16_t saturate_to_int16(int32_t value) {
+    value = (value + (1 << (STATE_FRAC_BITS - 1))) >> STATE_FRAC_BITS;
+    if (value > 32767) return 32767;
+    if (value < -32768) return -32768;
+    return (int16_t)value;
+}
+
+// One Direct Form I step. The remainder dropped by the final shift is fed back
+// into the next accumulation, so truncation noise is shaped away from DC where
+// the poles of a low-cutoff high-pass would otherwise amplify it.
+static inline int32_t biquad_step(const audio_dsp_biquad_coeffs_t& c, audio_dsp_biquad_state_t& s, int32_t x0) {
+    int64_t acc = s.err;
+    acc += (int64_t)c.b0 * x0;
+    acc += (int64_t)c.b1 * s.x1;
+    acc += (int64_t)c.b2 * s.x2;
+    acc -= (int64_t)c.a1 * s.y1;
+    acc -= (int64_t)c.a2 * s.y2;
+
+    const int32_t y0 = (int32_t)(acc >> COEFF_FRAC_BITS);
+    s.err = (int32_t)(acc - ((int64_t)y0 << COEFF_FRAC_BITS));
+    s.x2 = s.x1; s.x1 = x0;
+    s.y2 = s.y1; s.y1 = y0;
+    return y0;
+}
+
+void audio_dsp_lr4_hpf_set_cutoff(audio_dsp_lr4_hpf_t* hpf, float cutoff_hz, float sample_rate_hz) {
+    if (!hpf || sample_rate_hz <= 0.0f) return;
+    const double q_values[AUDIO_DSP_LR4_STAGES] = { LR4_Q1, LR4_Q2 };
+
+    // Designed in double: this only runs when the cutoff changes, and the extra
+    // precision matters for the poles of a low cutoff that sit close to z = 1.
+    for (int i = 0; i < AUDIO_DSP_LR4_STAGES; i++) {
+        const double omega = 2.0 * M_PI * cutoff_hz / sample_rate_hz;
+        const double cos_omega = cos(omega);
+        const double alpha = sin(omega) / (2.0 * q_values[i]);
+        const double a0_inv = 1.0 / (1.0 + alpha);
+
+        hpf->coeffs[i].b0 = to_q30(((1.0 + cos_omega) / 2.0) * a0_inv);
+        hpf->coeffs[i].b1 = to_q30((-(1.0 + cos_omega)) * a0_inv);
+        hpf->coeffs[i].b2 = to_q30(((1.0 + cos_omega) / 2.0) * a0_inv);
+        hpf->coeffs[i].a1 = to_q30((-2.0 * cos_omega) * a0_inv);
+        hpf->coeffs[i].a2 = to_q30((1.0 - alpha) * a0_inv);
+    }
+    ESP_LOGD(TAG, "LR4 HPF Q30 coeffs calculated for %.1f Hz @ %.0f Hz.", cutoff_hz, sample_rate_hz);
+}
+
+void audio_dsp_lr4_hpf_reset(audio_dsp_lr4_hpf_t* hpf) {
+    if (!hpf) return;
+    memset(hpf->state, 0, sizeof(hpf->state));
+}
+
+void audio_dsp_lr4_hpf_process(audio_dsp_lr4_hpf_t* hpf, int16_t* samples, size_t frames, uint8_t channels) {
+    if (!hpf || !samples || frames == 0) return;
+
+    // Work on local copies so the whole block runs out of registers, and write
+    // the state back once at the end.
+    const audio_dsp_biquad_coeffs_t c0 = hpf->coeffs[0];
+    const audio_dsp_biquad_coeffs_t c1 = hpf->coeffs[1];
+
+    if (channels == 1) {
+        audio_dsp_biquad_state_t s0 = hpf->state[0][0];
+        audio_dsp_biquad_state_t s1 = hpf->state[0][1];
+        for (size_t i = 0; i < frames; i++) {
+            const int32_t x = (int32_t)samples[i] << STATE_FRAC_BITS;
+            samples[i] = saturate_to_int16(biquad_step(c1, s1, biquad_step(c0, s0, x)));
+        }
+        hpf->state[0][0] = s0;
+        hpf->state[0][1] = s1;
+    } else if (channels == 2) {
+        audio_dsp_biquad_state_t l0 = hpf->state[0][0];
+        audio_dsp_biquad_state_t l1 = hpf->state[0][1];
+        audio_dsp_biquad_state_t r0 = hpf->state[1][0];
+        audio_dsp_biquad_state_t r1 = hpf->state[1][1];
+        int16_t* p = samples;
+        for (size_t i = 0; i < frames; i++, p += 2) {
+            const int32_t xl = (int32_t)p[0] << STATE_FRAC_BITS;
+            const int32_t xr = (int32_t)p[1] << STATE_FRAC_BITS;
+            p[0] = saturate_to_int16(biquad_step(c1, l1, biquad_step(c0, l0, xl)));
+            p[1] = saturate_to_int16(biquad_step(c1, r1, biquad_step(c0, r0, xr)));
+        }
+        hpf->state[0][0] = l0;
+        hpf->state[0][1] = l1;
+        hpf->state[1][0] = r0;
+        hpf->state[1][1] = r1;
+    } else {
+        ESP_LOGW(TAG, "LR4 HPF: unsupported channel count %u", channels);
+    }
+}
+
+// --- FUSED OUTPUT CHAIN ---
+// Gain ramps are interpolated with this many extra fractional bits (Q23).
+#define GAIN_RAMP_FRAC_BITS 8
+// Samples between the input and the limiter are clamped to +-2x full scale:
+// enough for a loud mix, and small enough that a Q15 gain product fits in 32 bits.
+#define HEADROOM_MAX 65535
+#define LIMITER_MASK (AUDIO_DSP_LIMITER_LOOKAHEAD - 1)
+#define HOLD_MASK (AUDIO_DSP_LIMITER_HOLD - 1)
+static_assert((AUDIO_DSP_LIMITER_HOLD & HOLD_MASK) == 0 && AUDIO_DSP_LIMITER_HOLD >= AUDIO_DSP_LIMITER_LOOKAHEAD,
+              "hold must be a power of two covering the look-ahead");
+#define LIMITER_LOOKAHEAD_BITS 6
+static_assert((1 << LIMITER_LOOKAHEAD_BITS) == AUDIO_DSP_LIMITER_LOOKAHEAD, "look-ahead must match its bit count");
+
+#define DEFAULT_LIMITER_RELEASE_MS 50
+
+static inline int32_t clamp_int16(int32_t value) {
+    if (value > 32767) return 32767;
+    if (value < -32768) return -32768;
+    return value;
+}
+
+static inline int32_t clamp_headroom(int32_t value) {
+    if (value > HEADROOM_MAX) return HEADROOM_MAX;
+    if (value < -HEADROOM_MAX) return -HEADROOM_MAX;
+    return value;
+}
+
+static void limiter_reset(audio_dsp_limiter_t* lim) {
+    memset(lim, 0, sizeof(audio_dsp_limiter_t));
+    lim->envelope_q30 = 1 << 30;
+    for (int i = 0; i < AUDIO_DSP_LIMITER_LOOKAHEAD; i++) lim->average[i] = AUDIO_DSP_UNITY_GAIN;
+    lim->average_sum = AUDIO_DSP_UNITY_GAIN * AUDIO_DSP_LIMITER_LOOKAHEAD;
+}
+
+// Pushes one frame into the limiter and returns the frame that leaves the
+// delay line, with the gain applied.
+static inline void limiter_step(audio_dsp_limiter_t& lim, int32_t threshold, int32_t release_q30,
+                                int32_t l, int32_t r, int16_t* out) {
+    const uint32_t t = lim.time++;
+
+    // Gain needed by this frame. The division only runs on frames above the threshold.
+    const int32_t al = (l < 0) ? -l : l;
+    const int32_t ar = (r < 0) ? -r : r;
+    const int32_t peak = (al > ar) ? al : ar;
+    const int32_t required = (peak > threshold) ? (threshold << 15) / peak : AUDIO_DSP_UNITY_GAIN;
+
+    // Sliding minimum over the hold window (monotonic queue, amortized O(1)).
+    if (lim.min_count && lim.min_time[lim.min_head] == t - AUDIO_DSP_LIMITER_HOLD) {
+        lim.min_head = (lim.min_head + 1) & HOLD_MASK;
+        lim.min_count--;
+    }
+    while (lim.min_count && lim.min_gain[(lim.min_head + lim.min_count - 1) & HOLD_MASK] >= required) {
+        lim.min_count--;
+    }
+    const uint32_t tail = (lim.min_head + lim.min_count) & HOLD_MASK;
+    lim.min_gain[tail] = required;
+    lim.min_time[tail] = t;
+    lim.min_count++;
+    const int32_t held_q30 = lim.min_gain[lim.min_head] << 15;
+
+    // Instant attack, exponential release towards the held gain.
+    if (held_q30 <= lim.envelope_q30) {
+        lim.envelope_q30 = held_q30;
+    } else {
+        lim.envelope_q30 += (int32_t)(((int64_t)(held_q30 - lim.envelope_q30) * release_q30) >> 30);
+    }
+
+    // A moving average as long as the window turns the attack into a ramp that
+    // ends exactly when the frame that caused it leaves the delay line.
+    const uint32_t slot = t & LIMITER_MASK;
+    const int32_t gain_q15 = lim.envelope_q30 >> 15;
+    lim.average_sum += gain_q15 - lim.average[slot];
+    lim.average[slot] = gain_q15;
+    const int32_t gain = lim.average_sum >> LIMITER_LOOKAHEAD_BITS;
+
+    lim.delay[2 * slot] = l;
+    lim.delay[2 * slot + 1] = r;
+    const uint32_t oldest = (t + 1) & LIMITER_MASK;
+    out[0] = (int16_t)clamp_int16((lim.delay[2 * oldest] * gain) >> 15);
+    out[1] = (int16_t)clamp_int16((lim.delay[2 * oldest + 1] * gain) >> 15);
+}
+
+void audio_dsp_chain_init(audio_dsp_chain_t* chain, uint32_t sample_rate_hz) {
+    if (!chain) return;
+    chain->target_gain_q15.store(AUDIO_DSP_UNITY_GAIN);
+    chain->hpf_cutoff_hz.store(0);
+    chain->sample_rate = sample_rate_hz;
+    chain->applied_cutoff_hz = 0;
+    chain->gain_q15 = AUDIO_DSP_UNITY_GAIN;
+    memset(&chain->hpf, 0, sizeof(chain->hpf));
+    limiter_reset(&chain->limiter);
+    audio_dsp_chain_set_limiter(chain, 0.0f, DEFAULT_LIMITER_RELEASE_MS);
+}
+
+void audio_dsp_chain_reset(audio_dsp_chain_t* chain) {
+    if (!chain) return;
+    audio_dsp_lr4_hpf_reset(&chain->hpf);
+    limiter_reset(&chain->limiter);
+}
+
+void audio_dsp_chain_set_gain(audio_dsp_chain_t* chain, int32_t gain_q15) {
+    if (!chain) return;
+    if (gain_q15 < 0) gain_q15 = 0;
+    if (gain_q15 > 2 * AUDIO_DSP_UNITY_GAIN) gain_q15 = 2 * AUDIO_DSP_UNITY_GAIN;
+    chain->target_gain_q15.store(gain_q15, std::memory_order_relaxed);
+}
+
+void audio_dsp_chain_set_hpf_cutoff(audio_dsp_chain_t* chain, uint32_t cutoff_hz) {
+    if (!chain) return;
+    chain->hpf_cutoff_hz.store(cutoff_hz, std::memory_order_relaxed);
+}
+
+void audio_dsp_chain_set_limiter(audio_dsp_chain_t* chain, float threshold_dbfs, uint32_t release_ms) {
+    if (!chain || chain->sample_rate == 0) return;
+    if (threshold_dbfs > 0.0f) threshold_dbfs = 0.0f;
+    int32_t threshold = (int32_t)lrintf(32767.0f * powf(10.0f, threshold_dbfs / 20.0f));
+    if (threshold < 1) threshold = 1;
+
+    // One-pole coefficient for a time constant of release_ms.
+    const double frames = (release_ms > 0 ? release_ms : 1) * (double)chain->sample_rate / 1000.0;
+    const int32_t release_q30 = (int32_t)lrint((1.0 - exp(-1.0 / frames)) * (double)(1 << 30));
+
+    chain->limiter_threshold.store(threshold, std::memory_order_relaxed);
+    chain->limiter_release_q30.store(release_q30 > 0 ? release_q30 : 1, std::memory_order_relaxed);
+    ESP_LOGD(TAG, "Limiter: threshold %ld (%.1f dBFS), release %lu ms.", threshold, threshold_dbfs, release_ms);
+}
+
+// The per-sample loop, instantiated per combination of stages so that a stage
+// that is off costs neither code nor a per-sample branch.
+template <bool kHpf, bool kTap>
+static void chain_block(audio_dsp_chain_t* chain, const int32_t* __restrict acc, int16_t* __restrict out,
+                        int16_t* __restrict tap, size_t frames, int32_t gain_from, int32_t gain_to) {
+    const audio_dsp_biquad_coeffs_t c0 = chain->hpf.coeffs[0];
+    const audio_dsp_biquad_coeffs_t c1 = chain->hpf.coeffs[1];
+    audio_dsp_biquad_state_t l0 = chain->hpf.state[0][0];
+    audio_dsp_biquad_state_t l1 = chain->hpf.state[0][1];
+    audio_dsp_biquad_state_t r0 = chain->hpf.state[1][0];
+    audio_dsp_biquad_state_t r1 = chain->hpf.state[1][1];
+
+    audio_dsp_limiter_t& lim = chain->limiter;
+    const int32_t threshold = chain->limiter_threshold.load(std::memory_order_relaxed);
+    const int32_t release_q30 = chain->limiter_release_q30.load(std::memory_order_relaxed);
+
+    int32_t gain = gain_from << GAIN_RAMP_FRAC_BITS;
+    const int32_t gain_step = ((gain_to - gain_from) << GAIN_RAMP_FRAC_BITS) / (int32_t)frames;
+
+    for (size_t i = 0; i < frames; i++) {
+        int32_t l = clamp_headroom(acc[2 * i]);
+        int32_t r = clamp_headroom(acc[2 * i + 1]);
+        if (kHpf) {
+            l = clamp_headroom(round_from_state(biquad_step(c1, l1, biquad_step(c0, l0, l << STATE_FRAC_BITS))));
+            r = clamp_headroom(round_from_state(biquad_step(c1, r1, biquad_step(c0, r0, r << STATE_FRAC_BITS))));
+        }
+        if (kTap) tap[i] = (int16_t)clamp_int16((l + r) >> 1);
+
+        // Applied in Q14 so that gains up to 2.0 keep the product within 32 bits.
+        const int32_t g = gain >> (GAIN_RAMP_FRAC_BITS + 1);
+        gain += gain_step;
+        l = (l * g) >> 14;
+        r = (r * g) >> 14;
+        limiter_step(lim, threshold, release_q30, l, r, &out[2 * i]);
+    }
+
+    if (kHpf) {
+        chain->hpf.state[0][0] = l0;
+        chain->hpf.state[0][1] = l1;
+        chain->hpf.state[1][0] = r0;
+        chain->hpf.state[1][1] = r1;
+    }
+}
+
+void audio_dsp_chain_process(audio_dsp_chain_t* chain, const int32_t* acc, int16_t* out, int16_t* tap, size_t frames) {
+    if (!chain || !acc || !out || frames == 0) return;
+
+    // Parameters are sampled once per block.
+    const uint32_t cutoff = chain->hpf_cutoff_hz.load(std::memory_order_relaxed);
+    const int32_t gain_to = chain->target_gain_q15.load(std::memory_order_relaxed);
+
+    if (cutoff != chain->applied_cutoff_hz) {
+        if (cutoff > 0) {
+            // A filter switched back on starts from silence instead of a stale history.
+            if (chain->applied_cutoff_hz == 0) audio_dsp_lr4_hpf_reset(&chain->hpf);
+            audio_dsp_lr4_hpf_set_cutoff(&chain->hpf, (float)cutoff, (float)chain->sample_rate);
+        }
+        chain->applied_cutoff_hz = cutoff;
+    }
+
+    const int32_t gain_from = chain->gain_q15;
+    if (cutoff > 0) {
+        if (tap) chain_block<true, true>(chain, acc, out, tap, frames, gain_from, gain_to);
+        else chain_block<true, false>(chain, acc, out, tap, frames, gain_from, gain_to);
+    } else {
+        if (tap) chain_block<false, true>(chain, acc, out, tap, frames, gain_from, gain_to);
+        else chain_block<false, false>(chain, acc, out, tap, frames, gain_from, gain_to);
+    }
+    chain->gain_q15 = gain_to;
+}
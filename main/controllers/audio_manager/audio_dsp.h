@@ -0,0 +1,185 @@
+/**
+ * @file audio_dsp.h
+ * @brief Fixed-point DSP kernels used by the audio playback path.
+ *
+ * The kernels work on blocks of interleaved 16-bit PCM and keep all
+ * per-sample arithmetic in integers, so a whole stereo block is processed in a
+ * single pass without float conversions or per-sample function calls.
+ */
+#ifndef AUDIO_DSP_H
+#define AUDIO_DSP_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+/** @brief Number of cascaded biquads in a 4th-order Linkwitz-Riley filter. */
+#define AUDIO_DSP_LR4_STAGES 2
+
+/** @brief Maximum number of interleaved channels supported by the kernels. */
+#define AUDIO_DSP_MAX_CHANNELS 2
+
+/**
+ * @brief Biquad coefficients in Q2.30 format, already normalized by a0.
+ * The feedback coefficients are stored with the sign used in the difference
+ * equation: y = b0*x0 + b1*x1 + b2*x2 - a1*y1 - a2*y2.
+ */
+typedef struct {
+    int32_t b0, b1, b2, a1, a2;
+} audio_dsp_biquad_coeffs_t;
+
+/**
+ * @brief Direct Form I state for one biquad on one channel.
+ * Signals are kept with extra fractional bits below the 16-bit LSB, and `err`
+ * carries the truncation remainder of the last output (first-order error
+ * feedback), which keeps low-cutoff filters quiet in fixed point.
+ */
+typedef struct {
+    int32_t x1, x2, y1, y2;
+    int32_t err;
+} audio_dsp_biquad_state_t;
+
+/**
+ * @brief A 4th-order Linkwitz-Riley high-pass filter (two cascaded Butterworth
+ * biquads) for up to AUDIO_DSP_MAX_CHANNELS interleaved channels.
+ */
+typedef struct {
+    audio_dsp_biquad_coeffs_t coeffs[AUDIO_DSP_LR4_STAGES];
+    audio_dsp_biquad_state_t state[AUDIO_DSP_MAX_CHANNELS][AUDIO_DSP_LR4_STAGES];
+} audio_dsp_lr4_hpf_t;
+
+/**
+ * @brief Computes the fixed-point coefficients for a given cutoff frequency.
+ *
+ * Coefficients are designed in double (this only runs when the cutoff changes,
+ * and low cutoffs put the poles close to z = 1) and then quantized to Q2.30. The filter state is preserved, so the cutoff can
+ * be moved while audio is flowing.
+ *
+ * @param hpf The filter instance.
+ * @param cutoff_hz The -6 dB cutoff frequency in Hz.
+ * @param sample_rate_hz The sample rate of the audio stream in Hz.
+ */
+void audio_dsp_lr4_hpf_set_cutoff(audio_dsp_lr4_hpf_t* hpf, float cutoff_hz, float sample_rate_hz);
+
+/**
+ * @brief Clears the filter history of all channels. Call this between tracks.
+ * @param hpf The filter instance.
+ */
+void audio_dsp_lr4_hpf_reset(audio_dsp_lr4_hpf_t* hpf);
+
+/**
+ * @brief Filters a block of interleaved 16-bit samples in place.
+ *
+ * Both stages are applied in one pass. The intermediate signal between the two
+ * stages is not clipped; saturation to the int16 range happens once, on the
+ * final output.
+ *
+ * @param hpf The filter instance.
+ * @param samples Pointer to the interleaved samples.
+ * @param frames Number of frames (samples per channel) in the block.
+ * @param channels Number of interleaved channels (1 or 2).
+ */
+void audio_dsp_lr4_hpf_process(audio_dsp_lr4_hpf_t* hpf, int16_t* samples, size_t frames, uint8_t channels);
+
+/** @brief Unity gain of the output chain (Q15). */
+#define AUDIO_DSP_UNITY_GAIN 32768
+
+/** @brief Look-ahead of the output limiter in frames (a power of two; 64 is ~1.3 ms at 48 kHz). */
+#define AUDIO_DSP_LIMITER_LOOKAHEAD 64
+/**
+ * @brief Frames the limiter holds its gain for after a peak before releasing
+ * (a power of two; 256 is ~5.3 ms at 48 kHz). Holding through the half period
+ * of a low note keeps the gain from pumping, and distorting, within one cycle.
+ */
+#define AUDIO_DSP_LIMITER_HOLD 256
+
+/**
+ * @brief State of the stereo-linked look-ahead peak limiter at the end of the chain.
+ *
+ * For every frame the limiter computes the gain that would bring its peak down
+ * to the threshold, holds the minimum of that gain for AUDIO_DSP_LIMITER_HOLD
+ * frames, lets it recover with an exponential release, and smooths it with a moving
+ * average as long as the window. The audio is delayed by the window, so the
+ * gain has fully ramped down by the time a peak leaves the delay line: peaks
+ * are caught without clipping and without the harmonics of a hard clip.
+ */
+typedef struct {
+    int32_t delay[AUDIO_DSP_LIMITER_LOOKAHEAD * 2];  //!< Delayed stereo frames.
+    int32_t min_gain[AUDIO_DSP_LIMITER_HOLD];        //!< Sliding-minimum queue of required gains (Q15)...
+    uint32_t min_time[AUDIO_DSP_LIMITER_HOLD];       //!< ...and the frame each one was computed for.
+    uint32_t min_head;                               //!< Oldest queue entry.
+    uint32_t min_count;                              //!< Queue entries in use.
+    int32_t envelope_q30;                            //!< Held gain with release applied (Q30).
+    int32_t average[AUDIO_DSP_LIMITER_LOOKAHEAD];    //!< Window of the moving average (Q15).
+    int32_t average_sum;
+    uint32_t time;                                   //!< Frames processed, wraps.
+} audio_dsp_limiter_t;
+
+/**
+ * @brief The output stage of the mixer bus, fused into a single pass over a
+ * block of 16-bit stereo frames:
+ *
+ *   mix accumulator -> LR4 high-pass -> visualizer tap -> gain -> limiter -> output
+ *
+ * The signal keeps 6 dB of headroom above 16-bit full scale until the limiter,
+ * so a loud mix, filter overshoot or a gain above unity are brought down
+ * smoothly instead of being clipped. Parameters can be changed from any task without locks: setters only store
+ * atomics, and the chain picks them up once at the start of each block. Gain
+ * changes are ramped linearly across a block so they cause no zipper noise.
+ */
+typedef struct {
+    // Parameters, written by any task.
+    std::atomic<int32_t> target_gain_q15;  //!< Output gain (Q15, AUDIO_DSP_UNITY_GAIN = 1.0).
+    std::atomic<uint32_t> hpf_cutoff_hz;   //!< High-pass cutoff, 0 to bypass the filter.
+    std::atomic<int32_t> limiter_threshold; //!< Limiter threshold as a 16-bit sample amplitude.
+    std::atomic<int32_t> limiter_release_q30; //!< Per-frame release coefficient (Q30).
+
+    // State, owned by the task that calls audio_dsp_chain_process().
+    uint32_t sample_rate;
+    uint32_t applied_cutoff_hz;            //!< Cutoff the HPF coefficients were designed for.
+    int32_t gain_q15;                      //!< Gain reached at the end of the last block.
+    audio_dsp_lr4_hpf_t hpf;
+    audio_dsp_limiter_t limiter;
+} audio_dsp_chain_t;
+
+/**
+ * @brief Initializes the chain with unity gain, the filter bypassed and the
+ * limiter at 0 dBFS with a 50 ms release.
+ * @param chain The chain instance.
+ * @param sample_rate_hz Sample rate of the bus in Hz.
+ */
+void audio_dsp_chain_init(audio_dsp_chain_t* chain, uint32_t sample_rate_hz);
+
+/**
+ * @brief Clears the filter history (e.g. between tracks). Parameters are kept.
+ */
+void audio_dsp_chain_reset(audio_dsp_chain_t* chain);
+
+/** @brief Sets the output gain (Q15). Lock-free; takes effect, ramped, on the next block. */
+void audio_dsp_chain_set_gain(audio_dsp_chain_t* chain, int32_t gain_q15);
+
+/** @brief Sets the high-pass cutoff in Hz, or 0 to bypass it. Lock-free; takes effect on the next block. */
+void audio_dsp_chain_set_hpf_cutoff(audio_dsp_chain_t* chain, uint32_t cutoff_hz);
+
+/**
+ * @brief Configures the output limiter. Lock-free; takes effect on the next block.
+ * @param chain The chain instance.
+ * @param threshold_dbfs Highest output peak, in dB relative to 16-bit full scale (<= 0).
+ * @param release_ms Time constant of the gain recovery after a peak.
+ */
+void audio_dsp_chain_set_limiter(audio_dsp_chain_t* chain, float threshold_dbfs, uint32_t release_ms);
+
+/**
+ * @brief Runs the chain on one block.
+ *
+ * @param chain The chain instance.
+ * @param acc Mixed stereo block as 32-bit accumulators (2 * frames values).
+ * @param out Output for 2 * frames 16-bit samples.
+ * @param tap If not NULL, receives `frames` mono samples taken after the filter
+ *            and before the gain (so it does not follow the volume).
+ *            The output lags the tap by AUDIO_DSP_LIMITER_LOOKAHEAD - 1 frames.
+ * @param frames Number of stereo frames.
+ */
+void audio_dsp_chain_process(audio_dsp_chain_t* chain, const int32_t* acc, int16_t* out, int16_t* tap, size_t frames);
+
+#endif // AUDIO_DSP_H
@@ -0,0 +1,368 @@
+#include "audio_flac.h"
+#include "esp_heap_caps.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define SUBFRAME_CONSTANT 0x00
+#define SUBFRAME_VERBATIM 0x01
+#define SUBFRAME_FIXED 0x08         // | order
+#define MAX_FIXED_ORDER 4
+#define MAX_PARTITION_ORDER 6         // As libFLAC at its highest levels; keeps the plan small on the stack.
+#define MAX_RICE_PARAM 14
+#define RICE_ESCAPE 15
+#define BITS_PER_SAMPLE 16
+#define MAX_FRAME_HEADER_BYTES 16   // Sync to CRC-8, with the longest frame number and block size.
+
+// --- Bit writer (MSB first) ---
+
+typedef struct {
+    uint8_t* buf;
+    size_t pos;
+    uint64_t acc;
+    uint32_t bits;      // Pending bits in `acc`, fewer than 8 between calls.
+} bit_writer_t;
+
+static inline void put_bits(bit_writer_t* bw, uint32_t value, uint32_t n) {
+    if (n == 0) return;
+    bw->acc = (bw->acc << n) | (n < 32 ? value & ((1u << n) - 1) : value);
+    bw->bits += n;
+    while (bw->bits >= 8) {
+        bw->bits -= 8;
+        bw->buf[bw->pos++] = (uint8_t)(bw->acc >> bw->bits);
+    }
+}
+
+static inline void put_zeros(bit_writer_t* bw, uint32_t n) {
+    for (; n > 24; n -= 24) put_bits(bw, 0, 24);
+    put_bits(bw, 0, n);
+}
+
+static void align_to_byte(bit_writer_t* bw) {
+    if (bw->bits) put_bits(bw, 0, 8 - bw->bits);
+}
+
+// --- Checksums of the frame header (CRC-8, x^8+x^2+x+1) and the frame (CRC-16, x^16+x^15+x^2+1) ---
+
+static uint8_t crc8(const uint8_t* data, size_t len) {
+    uint8_t crc = 0;
+    for (size_t i = 0; i < len; i++) {
+        crc ^= data[i];
+        for (int b = 0; b < 8; b++) crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x07) : (uint8_t)(crc << 1);
+    }
+    return crc;
+}
+
+static uint16_t crc16(const uint8_t* data, size_t len) {
+    uint16_t crc = 0;
+    for (size_t i = 0; i < len; i++) {
+        crc ^= (uint16_t)data[i] << 8;
+        for (int b = 0; b < 8; b++) crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x8005) : (uint16_t)(crc << 1);
+    }
+    return crc;
+}
+
+// --- Residual coding ---
+
+static inline uint32_t fold(int32_t r) { return ((uint32_t)r << 1) ^ (uint32_t)(r >> 31); }
+
+// Rice parameter for a partition from the sum of its folded residuals (the
+// one whose 2^k is closest to the mean), and the bits it would take.
+static uint32_t estimate_rice_param(uint64_t sum, uint32_t count, uint64_t* bits) {
+    uint32_t k = 0;
+    while (k < MAX_RICE_PARAM && ((uint64_t)count << (k + 1)) < sum) k++;
+    *bits = (uint64_t)count * (k + 1) + (sum >> k);
+    return k;
+}
+
+// Two's complement width that holds every residual (escaped partitions): the
+// bits of r (of ~r when negative) plus a sign bit, so -1 needs 1 bit. Width 0
+// is only for an all-zero partition.
+static uint32_t signed_width(const int32_t* r, uint32_t count) {
+    uint32_t width = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        if (r[i] == 0) continue;
+        const uint32_t magnitude = r[i] < 0 ? ~(uint32_t)r[i] : (uint32_t)r[i];
+        uint32_t w = 1;
+        while (w < 32 && (magnitude >> (w - 1)) != 0) w++;
+        if (w > width) width = w;
+    }
+    return width;
+}
+
+// Plan for coding one residual: the partition order and, per partition, the
+// Rice parameter (or RICE_ESCAPE with `escape_width`).
+typedef struct {
+    uint32_t partition_order;
+    uint8_t param[1 << MAX_PARTITION_ORDER];
+    uint8_t escape_width[1 << MAX_PARTITION_ORDER];
+    uint64_t bits;      // Exact size of the residual section.
+} residual_plan_t;
+
+// `residual` holds the `frames - order` residuals after the warm-up samples.
+static void plan_residual(const int32_t* residual, uint32_t frames, uint32_t order, residual_plan_t* plan) {
+    // Deepest usable partition order: partitions must divide the block and the
+    // first one must still hold a residual after the warm-up.
+    uint32_t max_order = 0;
+    while (max_order < MAX_PARTITION_ORDER && (frames % (2u << max_order)) == 0 &&
+           (frames >> (max_order + 1)) > order) {
+        max_order++;
+    }
+
+    // Sums of the folded residuals per partition at the deepest order, merged pairwise for the others.
+    uint64_t sums[1 << MAX_PARTITION_ORDER];
+    const uint32_t partitions = 1u << max_order;
+    const uint32_t partition_len = frames >> max_order;
+    const int32_t* r = residual;
+    for (uint32_t p = 0; p < partitions; p++) {
+        const uint32_t count = partition_len - (p == 0 ? order : 0);
+        uint64_t sum = 0;
+        for (uint32_t i = 0; i < count; i++) sum += fold(r[i]);
+        sums[p] = sum;
+        r += count;
+    }
+
+    uint64_t best_bits = UINT64_MAX;
+    plan->partition_order = 0;
+    for (int32_t po = (int32_t)max_order; po >= 0; po--) {
+        const uint32_t n = 1u << po;
+        const uint32_t len = frames >> po;
+        uint64_t bits = 0;
+        for (uint32_t p = 0; p < n; p++) {
+            uint64_t partition_bits;
+            estimate_rice_param(sums[p], len - (p == 0 ? order : 0), &partition_bits);
+            bits += 4 + partition_bits;
+        }
+        if (bits < best_bits) {
+            best_bits = bits;
+            plan->partition_order = (uint32_t)po;
+        }
+        for (uint32_t p = 0; po > 0 && p < n / 2; p++) sums[p] = sums[2 * p] + sums[2 * p + 1];
+    }
+
+    // Exact sizes at the chosen order, escaping partitions that Rice codes badly.
+    const uint32_t n = 1u << plan->partition_order;
+    const uint32_t len = frames >> plan->partition_order;
+    plan->bits = 0;
+    r = residual;
+    for (uint32_t p = 0; p < n; p++) {
+        const uint32_t count = len - (p == 0 ? order : 0);
+        uint64_t sum = 0;
+        for (uint32_t i = 0; i < count; i++) sum += fold(r[i]);
+        uint64_t estimate;
+        const uint32_t k = estimate_rice_param(sum, count, &estimate);
+        uint64_t rice_bits = (uint64_t)count * (k + 1);
+        for (uint32_t i = 0; i < count; i++) rice_bits += fold(r[i]) >> k;
+        const uint32_t width = signed_width(r, count);
+        const uint64_t escape_bits = 5 + (uint64_t)count * width;
+        if (escape_bits < rice_bits) {
+            plan->param[p] = RICE_ESCAPE;
+            plan->escape_width[p] = (uint8_t)width;
+            plan->bits += 4 + escape_bits;
+        } else {
+            plan->param[p] = (uint8_t)k;
+            plan->bits += 4 + rice_bits;
+        }
+        r += count;
+    }
+    plan->bits += 2 + 4; // Coding method and partition order.
+}
+
+static void write_residual(bit_writer_t* bw, const int32_t* residual, uint32_t frames, uint32_t order, const residual_plan_t* plan) {
+    put_bits(bw, 0, 2); // 4-bit Rice parameters.
+    put_bits(bw, plan->partition_order, 4);
+    const uint32_t n = 1u << plan->partition_order;
+    const uint32_t len = frames >> plan->partition_order;
+    const int32_t* r = residual;
+    for (uint32_t p = 0; p < n; p++) {
+        const uint32_t count = len - (p == 0 ? order : 0);
+        const uint32_t k = plan->param[p];
+        put_bits(bw, k, 4);
+        if (k == RICE_ESCAPE) {
+            const uint32_t width = plan->escape_width[p];
+            put_bits(bw, width, 5);
+            for (uint32_t i = 0; i < count; i++) put_bits(bw, (uint32_t)r[i], width);
+        } else {
+            for (uint32_t i = 0; i < count; i++) {
+                const uint32_t u = fold(r[i]);
+                put_zeros(bw, u >> k);
+                put_bits(bw, 1, 1);
+                put_bits(bw, u, k);
+            }
+        }
+        r += count;
+    }
+}
+
+// --- Subframes ---
+
+static inline int32_t sample(const int16_t* in, uint16_t channels, uint16_t ch, uint32_t i) {
+    return in[(size_t)i * channels + ch];
+}
+
+static void fixed_residual(const int16_t* in, uint16_t channels, uint16_t ch, uint32_t frames, uint32_t order, int32_t* out) {
+    for (uint32_t i = order; i < frames; i++) {
+        const int32_t x0 = sample(in, channels, ch, i);
+        int32_t r;
+        switch (order) {
+            case 0: r = x0; break;
+            case 1: r = x0 - sample(in, channels, ch, i - 1); break;
+            case 2: r = x0 - 2 * sample(in, channels, ch, i - 1) + sample(in, channels, ch, i - 2); break;
+            case 3: r = x0 - 3 * sample(in, channels, ch, i - 1) + 3 * sample(in, channels, ch, i - 2) - sample(in, channels, ch, i - 3); break;
+            default: r = x0 - 4 * sample(in, channels, ch, i - 1) + 6 * sample(in, channels, ch, i - 2)
+                          - 4 * sample(in, channels, ch, i - 3) + sample(in, channels, ch, i - 4); break;
+        }
+        out[i - order] = r;
+    }
+}
+
+// The fixed predictor order with the smallest total absolute residual.
+static uint32_t best_fixed_order(const int16_t* in, uint16_t channels, uint16_t ch, uint32_t frames) {
+    uint64_t total[MAX_FIXED_ORDER + 1] = {0};
+    for (uint32_t i = MAX_FIXED_ORDER; i < frames; i++) {
+        const int32_t e0 = sample(in, channels, ch, i);
+        const int32_t e1 = e0 - sample(in, channels, ch, i - 1);
+        const int32_t e2 = e1 - (sample(in, channels, ch, i - 1) - sample(in, channels, ch, i - 2));
+        const int32_t e3 = e2 - (sample(in, channels, ch, i - 1) - 2 * sample(in, channels, ch, i - 2) + sample(in, channels, ch, i - 3));
+        const int32_t e4 = e3 - (sample(in, channels, ch, i - 1) - 3 * sample(in, channels, ch, i - 2) + 3 * sample(in, channels, ch, i - 3)
+                                 - sample(in, channels, ch, i - 4));
+        total[0] += (uint32_t)abs(e0);
+        total[1] += (uint32_t)abs(e1);
+        total[2] += (uint32_t)abs(e2);
+        total[3] += (uint32_t)abs(e3);
+        total[4] += (uint32_t)abs(e4);
+    }
+    uint32_t best = 0;
+    for (uint32_t order = 1; order <= MAX_FIXED_ORDER; order++) {
+        if (total[order] < total[best]) best = order;
+    }
+    return best;
+}
+
+static void encode_subframe(audio_flac_encoder_t* encoder, bit_writer_t* bw, const int16_t* in, uint32_t frames, uint16_t ch) {
+    const uint16_t channels = encoder->channels;
+
+    bool constant = true;
+    for (uint32_t i = 1; i < frames && constant; i++) constant = sample(in, channels, ch, i) == sample(in, channels, ch, 0);
+    if (constant) {
+        put_bits(bw, SUBFRAME_CONSTANT << 1, 8);
+        put_bits(bw, (uint32_t)sample(in, channels, ch, 0), BITS_PER_SAMPLE);
+        return;
+    }
+
+    const uint64_t verbatim_bits = (uint64_t)frames * BITS_PER_SAMPLE;
+    if (frames > MAX_FIXED_ORDER) {
+        const uint32_t order = best_fixed_order(in, channels, ch, frames);
+        fixed_residual(in, channels, ch, frames, order, encoder->residual);
+        residual_plan_t plan;
+        plan_residual(encoder->residual, frames, order, &plan);
+        if ((uint64_t)order * BITS_PER_SAMPLE + plan.bits < verbatim_bits) {
+            put_bits(bw, (SUBFRAME_FIXED | order) << 1, 8);
+            for (uint32_t i = 0; i < order; i++) put_bits(bw, (uint32_t)sample(in, channels, ch, i), BITS_PER_SAMPLE);
+            write_residual(bw, encoder->residual, frames, order, &plan);
+            return;
+        }
+    }
+
+    put_bits(bw, SUBFRAME_VERBATIM << 1, 8);
+    for (uint32_t i = 0; i < frames; i++) put_bits(bw, (uint32_t)sample(in, channels, ch, i), BITS_PER_SAMPLE);
+}
+
+// --- Frame header ---
+
+// 4-bit code of a block size, 0x6/0x7 for one stored after the frame number.
+static uint32_t block_size_code(uint32_t frames) {
+    if (frames == 192) return 0x1;
+    for (uint32_t n = 0; n < 4; n++) if (frames == 576u << n) return 0x2 + n;
+    for (uint32_t n = 0; n < 8; n++) if (frames == 256u << n) return 0x8 + n;
+    return frames <= 256 ? 0x6 : 0x7;
+}
+
+static void put_utf8(bit_writer_t* bw, uint32_t v) {
+    if (v < 0x80) {
+        put_bits(bw, v, 8);
+        return;
+    }
+    uint32_t extra = 1; // Continuation bytes, 6 bits each; the first byte keeps 6 - extra.
+    while (extra < 5 && v >= (1u << (6 + 5 * extra))) extra++;
+    const uint32_t lead_mark = (0xFF00u >> (extra + 1)) & 0xFF; // extra + 1 leading ones.
+    put_bits(bw, lead_mark | (v >> (6 * extra)), 8);
+    for (int32_t i = (int32_t)extra - 1; i >= 0; i--) put_bits(bw, 0x80 | ((v >> (6 * i)) & 0x3F), 8);
+}
+
+// --- Public API ---
+
+bool audio_flac_encoder_init(audio_flac_encoder_t* encoder, uint32_t sample_rate_hz, uint16_t channels, uint32_t block_frames) {
+    if (!encoder || sample_rate_hz == 0 || sample_rate_hz >= (1u << 20) || channels == 0 || channels > 8 ||
+        block_frames < 16 || block_frames > 65535) {
+        return false;
+    }
+    if (!encoder->residual || encoder->block_frames != block_frames) {
+        audio_flac_encoder_deinit(encoder);
+        // Read several times per sample, so prefer internal RAM.
+        const size_t bytes = block_frames * sizeof(int32_t);
+        encoder->residual = (int32_t*)heap_caps_malloc(bytes, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+        if (!encoder->residual) encoder->residual = (int32_t*)heap_caps_malloc(bytes, MALLOC_CAP_SPIRAM);
+        if (!encoder->residual) return false;
+    }
+    encoder->sample_rate = sample_rate_hz;
+    encoder->channels = channels;
+    encoder->block_frames = block_frames;
+    encoder->frame_number = 0;
+    return true;
+}
+
+void audio_flac_encoder_deinit(audio_flac_encoder_t* encoder) {
+    if (!encoder) return;
+    if (encoder->residual) heap_caps_free(encoder->residual);
+    encoder->residual = NULL;
+}
+
+size_t audio_flac_stream_header(const audio_flac_encoder_t* encoder, uint8_t* out) {
+    bit_writer_t bw = { out, 0, 0, 0 };
+    memcpy(out, "fLaC", 4);
+    bw.pos = 4;
+    put_bits(&bw, 0x80, 8);         // Last metadata block, STREAMINFO.
+    put_bits(&bw, 34, 24);
+    put_bits(&bw, encoder->block_frames, 16);
+    put_bits(&bw, encoder->block_frames, 16);
+    put_bits(&bw, 0, 24);           // Frame sizes: unknown.
+    put_bits(&bw, 0, 24);
+    put_bits(&bw, encoder->sample_rate, 20);
+    put_bits(&bw, encoder->channels - 1, 3);
+    put_bits(&bw, BITS_PER_SAMPLE - 1, 5);
+    put_bits(&bw, 0, 4);            // Total frames (36 bits): unknown.
+    put_bits(&bw, 0, 32);
+    for (int i = 0; i < 4; i++) put_bits(&bw, 0, 32); // MD5: not computed.
+    return bw.pos;
+}
+
+size_t audio_flac_max_frame_bytes(const audio_flac_encoder_t* encoder, uint32_t frames) {
+    return MAX_FRAME_HEADER_BYTES + (size_t)encoder->channels * (1 + (size_t)frames * BITS_PER_SAMPLE / 8) + 1 + 2;
+}
+
+size_t audio_flac_encode_frame(audio_flac_encoder_t* encoder, const int16_t* in, uint32_t frames, uint8_t* out) {
+    if (!encoder || !encoder->residual || !in || !out || frames == 0 || frames > encoder->block_frames) return 0;
+
+    bit_writer_t bw = { out, 0, 0, 0 };
+    const uint32_t size_code = block_size_code(frames);
+    put_bits(&bw, 0xFFF8, 16);      // Sync code, fixed block size.
+    put_bits(&bw, size_code, 4);
+    put_bits(&bw, 0x0, 4);          // Sample rate: from STREAMINFO.
+    put_bits(&bw, encoder->channels - 1, 4); // Independent channels.
+    put_bits(&bw, 0x4, 3);          // 16 bits per sample.
+    put_bits(&bw, 0, 1);
+    put_utf8(&bw, encoder->frame_number);
+    if (size_code == 0x6) put_bits(&bw, frames - 1, 8);
+    if (size_code == 0x7) put_bits(&bw, frames - 1, 16);
+    put_bits(&bw, crc8(out, bw.pos), 8);
+
+    for (uint16_t ch = 0; ch < encoder->channels; ch++) {
+        encode_subframe(encoder, &bw, in, frames, ch);
+    }
+    align_to_byte(&bw);
+    const uint16_t crc = crc16(out, bw.pos);
+    put_bits(&bw, crc, 16);
+
+    encoder->frame_number++;
+    return bw.pos;
+}
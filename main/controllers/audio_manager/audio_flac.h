@@ -0,0 +1,74 @@
+/**
+ * @file audio_flac.h
+ * @brief Streaming FLAC encoder for 16-bit audio.
+ *
+ * Each frame is coded on its own: every channel as a constant, verbatim or
+ * fixed-predictor (order 0 to 4) subframe, whichever is smallest, with the
+ * residual in partitioned Rice codes. That is the part of FLAC that needs no
+ * floating point and no look-ahead, and it already brings speech to around
+ * 60% of its 16-bit PCM size, losslessly.
+ *
+ * The stream header leaves the total length and the MD5 signature unset
+ * (both allowed by the format), so a stream can be sent while it is encoded.
+ */
+#ifndef AUDIO_FLAC_H
+#define AUDIO_FLAC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/** @brief Bytes of the stream header ("fLaC" and the STREAMINFO block). */
+#define AUDIO_FLAC_STREAM_HEADER_SIZE 42
+
+/**
+ * @brief Encoder state.
+ */
+typedef struct {
+    uint32_t sample_rate;
+    uint16_t channels;
+    uint32_t block_frames;      //!< Frames in every frame but the last.
+    uint32_t frame_number;      //!< Next frame to encode.
+    int32_t* residual;          //!< Scratch for the residual of one channel (block_frames samples).
+} audio_flac_encoder_t;
+
+/**
+ * @brief Prepares an encoder for a new stream.
+ *
+ * @param encoder The encoder (zero-initialize it before the first call).
+ * @param sample_rate_hz Sample rate, 1 Hz to 655 kHz.
+ * @param channels 1 to 8, coded independently.
+ * @param block_frames Frames per frame, 16 to 65535 (4096 suits 16 kHz speech).
+ * @return false on invalid arguments or if the scratch buffer could not be allocated.
+ */
+bool audio_flac_encoder_init(audio_flac_encoder_t* encoder, uint32_t sample_rate_hz, uint16_t channels, uint32_t block_frames);
+
+/**
+ * @brief Frees the scratch buffer.
+ */
+void audio_flac_encoder_deinit(audio_flac_encoder_t* encoder);
+
+/**
+ * @brief Writes the stream header, which goes before the first frame.
+ * @param encoder An initialized encoder.
+ * @param out Output buffer of AUDIO_FLAC_STREAM_HEADER_SIZE bytes.
+ * @return Number of bytes written.
+ */
+size_t audio_flac_stream_header(const audio_flac_encoder_t* encoder, uint8_t* out);
+
+/**
+ * @brief Largest frame the encoder writes for `frames` frames (verbatim coding plus headers).
+ */
+size_t audio_flac_max_frame_bytes(const audio_flac_encoder_t* encoder, uint32_t frames);
+
+/**
+ * @brief Encodes one frame.
+ *
+ * @param encoder An initialized encoder.
+ * @param in Interleaved 16-bit samples.
+ * @param frames Frames in `in`: block_frames, or fewer for the last frame of the stream.
+ * @param out Output buffer of audio_flac_max_frame_bytes(encoder, frames) bytes.
+ * @return Number of bytes written, 0 on invalid arguments.
+ */
+size_t audio_flac_encode_frame(audio_flac_encoder_t* encoder, const int16_t* in, uint32_t frames, uint8_t* out);
+
+#endif // AUDIO_FLAC_H
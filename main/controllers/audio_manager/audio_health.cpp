@@ -0,0 +1,60 @@
+#include "audio_health.h"
+#include <stdio.h>
+#include <string.h>
+
+static int bucket_of(uint32_t us) {
+    if (us < 2) return 0;
+    const int msb = 31 - __builtin_clz(us);
+    return (msb < AUDIO_HEALTH_BUCKETS) ? msb : AUDIO_HEALTH_BUCKETS - 1;
+}
+
+// First duration above bucket `i`; the open-ended last bucket has none.
+static uint32_t bucket_upper_us(int i) {
+    return (i < AUDIO_HEALTH_BUCKETS - 1) ? (2u << i) : UINT32_MAX;
+}
+
+void audio_histogram_reset(audio_histogram_t* hist) {
+    memset(hist, 0, sizeof(audio_histogram_t));
+}
+
+void audio_histogram_record(audio_histogram_t* hist, uint32_t us) {
+    hist->buckets[bucket_of(us)]++;
+    hist->count++;
+    hist->total_us += us;
+    if (us > hist->max_us) hist->max_us = us;
+}
+
+uint32_t audio_histogram_percentile(const audio_histogram_t* hist, uint32_t percent) {
+    if (hist->count == 0) return 0;
+    if (percent > 100) percent = 100;
+    const uint64_t rank = ((uint64_t)hist->count * percent + 99) / 100;
+    uint64_t seen = 0;
+    for (int i = 0; i < AUDIO_HEALTH_BUCKETS; i++) {
+        seen += hist->buckets[i];
+        if (seen >= rank) {
+            const uint32_t upper = bucket_upper_us(i);
+            return (upper < hist->max_us) ? upper : hist->max_us;
+        }
+    }
+    return hist->max_us;
+}
+
+uint32_t audio_histogram_mean(const audio_histogram_t* hist) {
+    return hist->count ? (uint32_t)(hist->total_us / hist->count) : 0;
+}
+
+size_t audio_histogram_format_buckets(const audio_histogram_t* hist, char* buf, size_t len) {
+    if (len == 0) return 0;
+    buf[0] = '\0';
+    size_t used = 0;
+    for (int i = 0; i < AUDIO_HEALTH_BUCKETS && used + 1 < len; i++) {
+        if (hist->buckets[i] == 0) continue;
+        int n = (i < AUDIO_HEALTH_BUCKETS - 1)
+                    ? snprintf(buf + used, len - used, "%s<%lu:%lu", used ? " " : "", (unsigned long)bucket_upper_us(i), (unsigned long)hist->buckets[i])
+                    : snprintf(buf + used, len - used, "%s>=%lu:%lu", used ? " " : "", (unsigned long)(1u << i), (unsigned long)hist->buckets[i]);
+        if (n < 0) break;
+        used += (size_t)n;
+        if (used >= len) used = len - 1;
+    }
+    return used;
+}
@@ -0,0 +1,54 @@
+/**
+ * @file audio_health.h
+ * @brief Timing histograms for the playback health counters.
+ *
+ * Durations are binned on a log2 scale of microseconds, so one histogram spans
+ * from a few microseconds to tens of milliseconds in AUDIO_HEALTH_BUCKETS
+ * counters and recording a sample is a count-leading-zeros and an increment.
+ * Percentiles are reported as the upper edge of their bucket, i.e. at most a
+ * factor of two above the true value.
+ */
+#ifndef AUDIO_HEALTH_H
+#define AUDIO_HEALTH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define AUDIO_HEALTH_BUCKETS 16
+
+/**
+ * @brief A histogram of durations.
+ * buckets[0] counts samples below 2 us and buckets[i] those in [2^i, 2^(i+1)) us;
+ * the last bucket also takes everything longer (32.8 ms and up).
+ */
+typedef struct {
+    uint32_t buckets[AUDIO_HEALTH_BUCKETS];
+    uint32_t count;    //!< Samples recorded.
+    uint32_t max_us;   //!< Longest sample.
+    uint64_t total_us; //!< Sum of all samples, for the mean.
+} audio_histogram_t;
+
+/** @brief Clears a histogram. */
+void audio_histogram_reset(audio_histogram_t* hist);
+
+/** @brief Adds one duration to a histogram. */
+void audio_histogram_record(audio_histogram_t* hist, uint32_t us);
+
+/**
+ * @brief Gets an upper bound of a percentile.
+ * @param hist The histogram.
+ * @param percent Percentile (1-100).
+ * @return Upper edge of the bucket holding it, capped at `max_us`; 0 if the histogram is empty.
+ */
+uint32_t audio_histogram_percentile(const audio_histogram_t* hist, uint32_t percent);
+
+/** @brief Mean of the recorded samples in us, 0 if the histogram is empty. */
+uint32_t audio_histogram_mean(const audio_histogram_t* hist);
+
+/**
+ * @brief Formats the non-empty buckets as "<edge_us>:<count>" pairs, for logs.
+ * @return Characters written, excluding the terminator (the text is truncated to `len`).
+ */
+size_t audio_histogram_format_buckets(const audio_histogram_t* hist, char* buf, size_t len);
+
+#endif // AUDIO_HEALTH_H
@@ -0,0 +1,165 @@
+#include "audio_ima_adpcm.h"
+
+// Bytes of codes per channel in one interleaving group (8 samples).
+#define GROUP_BYTES 4
+#define GROUP_FRAMES 8
+#define HEADER_BYTES_PER_CHANNEL 4
+
+static const int16_t s_step_table[89] = {
+    7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31,
+    34, 37, 41, 45, 50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143,
+    157, 173, 190, 209, 230, 253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658,
+    724, 796, 876, 963, 1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024,
+    3327, 3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899,
+    15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767
+};
+
+static const int8_t s_index_table[16] = {
+    -1, -1, -1, -1, 2, 4, 6, 8,
+    -1, -1, -1, -1, 2, 4, 6, 8
+};
+
+typedef struct {
+    int32_t predictor;
+    int32_t index;
+} channel_state_t;
+
+static inline int16_t decode_nibble(channel_state_t* st, uint8_t code) {
+    const int32_t step = s_step_table[st->index];
+    int32_t diff = step >> 3;
+    if (code & 1) diff += step >> 2;
+    if (code & 2) diff += step >> 1;
+    if (code & 4) diff += step;
+    int32_t p = (code & 8) ? st->predictor - diff : st->predictor + diff;
+    if (p > INT16_MAX) p = INT16_MAX;
+    if (p < INT16_MIN) p = INT16_MIN;
+    st->predictor = p;
+
+    int32_t index = st->index + s_index_table[code];
+    if (index < 0) index = 0;
+    if (index > 88) index = 88;
+    st->index = index;
+    return (int16_t)p;
+}
+
+bool audio_ima_adpcm_layout_valid(uint16_t block_align, uint16_t channels) {
+    if (channels != 1 && channels != 2) return false;
+    const uint32_t header = HEADER_BYTES_PER_CHANNEL * channels;
+    return block_align > header && (block_align - header) % (GROUP_BYTES * channels) == 0;
+}
+
+uint32_t audio_ima_adpcm_frames_per_block(uint16_t block_align, uint16_t channels) {
+    return audio_ima_adpcm_frames_in(block_align, channels);
+}
+
+uint32_t audio_ima_adpcm_frames_in(size_t block_bytes, uint16_t channels) {
+    const size_t header = HEADER_BYTES_PER_CHANNEL * channels;
+    if (channels == 0 || block_bytes < header) return 0;
+    return 1 + ((block_bytes - header) / (GROUP_BYTES * channels)) * GROUP_FRAMES;
+}
+
+size_t audio_ima_adpcm_decode_block(const uint8_t* block, size_t block_bytes, uint16_t channels, int16_t* out) {
+    const size_t frames = audio_ima_adpcm_frames_in(block_bytes, channels);
+    if (frames == 0) return 0;
+
+    channel_state_t state[2];
+    for (uint16_t c = 0; c < channels; c++) {
+        const uint8_t* h = block + c * HEADER_BYTES_PER_CHANNEL;
+        state[c].predictor = (int16_t)(h[0] | (h[1] << 8));
+        state[c].index = (h[2] > 88) ? 88 : h[2];
+        out[c] = (int16_t)state[c].predictor; // The header sample is the first output frame.
+    }
+
+    const uint8_t* codes = block + HEADER_BYTES_PER_CHANNEL * channels;
+    const size_t groups = (frames - 1) / GROUP_FRAMES;
+    if (channels == 1) {
+        int16_t* dst = out + 1;
+        for (size_t i = 0; i < groups * GROUP_BYTES; i++) {
+            const uint8_t byte = codes[i];
+            *dst++ = decode_nibble(&state[0], byte & 0x0F);
+            *dst++ = decode_nibble(&state[0], byte >> 4);
+        }
+    } else {
+        for (size_t g = 0; g < groups; g++) {
+            int16_t* dst = out + (1 + g * GROUP_FRAMES) * 2;
+            for (uint16_t c = 0; c < 2; c++) {
+                const uint8_t* src = codes + (g * 2 + c) * GROUP_BYTES;
+                for (int k = 0; k < GROUP_BYTES; k++) {
+                    dst[(2 * k) * 2 + c] = decode_nibble(&state[c], src[k] & 0x0F);
+                    dst[(2 * k + 1) * 2 + c] = decode_nibble(&state[c], src[k] >> 4);
+                }
+            }
+        }
+    }
+    return frames;
+}
+
+// Picks the code whose reconstruction is closest below the difference, the
+// same successive approximation the decoder's diff sums, then steps the state
+// exactly as the decoder will.
+static inline uint8_t encode_nibble(channel_state_t* st, int32_t sample) {
+    int32_t step = s_step_table[st->index];
+    int32_t diff = sample - st->predictor;
+    uint8_t code = 0;
+    if (diff < 0) {
+        code = 8;
+        diff = -diff;
+    }
+    if (diff >= step) { code |= 4; diff -= step; }
+    step >>= 1;
+    if (diff >= step) { code |= 2; diff -= step; }
+    step >>= 1;
+    if (diff >= step) { code |= 1; }
+    decode_nibble(st, code);
+    return code;
+}
+
+void audio_ima_adpcm_encoder_init(audio_ima_adpcm_encoder_t* encoder) {
+    encoder->index[0] = 0;
+    encoder->index[1] = 0;
+}
+
+size_t audio_ima_adpcm_block_bytes(uint32_t frames, uint16_t channels) {
+    if (frames == 0) return 0;
+    const size_t groups = (frames - 1 + GROUP_FRAMES - 1) / GROUP_FRAMES;
+    return (HEADER_BYTES_PER_CHANNEL + groups * GROUP_BYTES) * channels;
+}
+
+size_t audio_ima_adpcm_encode_block(audio_ima_adpcm_encoder_t* encoder, const int16_t* in, size_t frames,
+                                    uint16_t channels, uint8_t* block) {
+    if (frames == 0 || (channels != 1 && channels != 2)) return 0;
+
+    // The first frame goes into the header verbatim; the step index carries
+    // over from the previous block, so the encoder never restarts cold.
+    channel_state_t state[2];
+    for (uint16_t c = 0; c < channels; c++) {
+        uint8_t* h = block + c * HEADER_BYTES_PER_CHANNEL;
+        state[c].predictor = in[c];
+        state[c].index = encoder->index[c];
+        h[0] = (uint8_t)(in[c] & 0xFF);
+        h[1] = (uint8_t)((uint16_t)in[c] >> 8);
+        h[2] = (uint8_t)state[c].index;
+        h[3] = 0;
+    }
+
+    uint8_t* codes = block + HEADER_BYTES_PER_CHANNEL * channels;
+    const size_t groups = (frames - 1 + GROUP_FRAMES - 1) / GROUP_FRAMES;
+    for (size_t g = 0; g < groups; g++) {
+        for (uint16_t c = 0; c < channels; c++) {
+            uint8_t* dst = codes + (g * channels + c) * GROUP_BYTES;
+            for (int k = 0; k < GROUP_BYTES; k++) {
+                // Frames past the end of a short block repeat the last one.
+                size_t f0 = 1 + g * GROUP_FRAMES + 2 * k;
+                size_t f1 = f0 + 1;
+                if (f0 >= frames) f0 = frames - 1;
+                if (f1 >= frames) f1 = frames - 1;
+                const uint8_t lo = encode_nibble(&state[c], in[f0 * channels + c]);
+                const uint8_t hi = encode_nibble(&state[c], in[f1 * channels + c]);
+                dst[k] = (uint8_t)(lo | (hi << 4));
+            }
+        }
+    }
+
+    for (uint16_t c = 0; c < channels; c++) encoder->index[c] = (uint8_t)state[c].index;
+    return (HEADER_BYTES_PER_CHANNEL + groups * GROUP_BYTES) * channels;
+}
@@ -0,0 +1,84 @@
+/**
+ * @file audio_ima_adpcm.h
+ * @brief IMA-ADPCM (WAV format 0x11) block codec.
+ *
+ * Each block starts with a 4-byte header per channel (initial sample and step
+ * index) followed by 4-bit codes. Mono blocks store the codes sequentially;
+ * stereo blocks interleave them in groups of 4 bytes (8 samples) per channel.
+ * A block is self-contained, so decoding can start at any block boundary.
+ *
+ * The encoder works one block at a time with no memory beyond its state, so a
+ * recording can be compressed 4:1 as it is written.
+ */
+#ifndef AUDIO_IMA_ADPCM_H
+#define AUDIO_IMA_ADPCM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/** @brief WAV 'fmt ' format tag of IMA-ADPCM. */
+#define AUDIO_IMA_ADPCM_WAV_FORMAT 0x11
+
+/**
+ * @brief Checks if a block layout is valid for this codec.
+ * @param block_align Bytes per block (the WAV 'fmt ' block_align).
+ * @param channels Number of channels (1 or 2).
+ */
+bool audio_ima_adpcm_layout_valid(uint16_t block_align, uint16_t channels);
+
+/**
+ * @brief Number of frames a full block decodes to.
+ */
+uint32_t audio_ima_adpcm_frames_per_block(uint16_t block_align, uint16_t channels);
+
+/**
+ * @brief Number of frames a block of `block_bytes` decodes to (the last block of a file may be short).
+ */
+uint32_t audio_ima_adpcm_frames_in(size_t block_bytes, uint16_t channels);
+
+/**
+ * @brief Decodes one block to interleaved 16-bit samples.
+ *
+ * @param block The encoded block.
+ * @param block_bytes Bytes in `block`; a short (truncated) block is decoded up to its last whole group.
+ * @param channels Number of channels (1 or 2).
+ * @param out Output buffer for audio_ima_adpcm_frames_in(block_bytes, channels) frames.
+ * @return Number of frames written.
+ */
+size_t audio_ima_adpcm_decode_block(const uint8_t* block, size_t block_bytes, uint16_t channels, int16_t* out);
+
+/**
+ * @brief Encoder state carried from one block to the next.
+ */
+typedef struct {
+    uint8_t index[2];           //!< Step index of each channel at the end of the last block.
+} audio_ima_adpcm_encoder_t;
+
+/**
+ * @brief Resets the encoder for a new stream.
+ */
+void audio_ima_adpcm_encoder_init(audio_ima_adpcm_encoder_t* encoder);
+
+/**
+ * @brief Number of bytes a block of `frames` frames encodes to.
+ *
+ * Frames after the first are stored in whole groups of 8, so a block of any
+ * other length (the last one of a stream) is padded.
+ */
+size_t audio_ima_adpcm_block_bytes(uint32_t frames, uint16_t channels);
+
+/**
+ * @brief Encodes one block of interleaved 16-bit samples.
+ *
+ * @param encoder The encoder state.
+ * @param in `frames` interleaved frames.
+ * @param frames Number of frames, at least 1. A full block is audio_ima_adpcm_frames_per_block()
+ *               frames; fewer make a short block, padded with the last frame.
+ * @param channels Number of channels (1 or 2).
+ * @param block Output buffer for audio_ima_adpcm_block_bytes(frames, channels) bytes.
+ * @return Number of bytes written.
+ */
+size_t audio_ima_adpcm_encode_block(audio_ima_adpcm_encoder_t* encoder, const int16_t* in, size_t frames,
+                                    uint16_t channels, uint8_t* block);
+
+#endif // AUDIO_IMA_ADPCM_H
@@ -1,4 +1,9 @@
 #include "audio_manager.h"
+#include "audio_dsp.h"
+#include "audio_decoder.h"
+#include "audio_mixer.h"
+#include "audio_resampler.h"
+#include "audio_spectrum.h"
 #include "config/board_config.h"
 #include "config/app_config.h"
 #include "esp_log.h"
@@ -12,120 +17,230 @@
 #include "freertos/queue.h"
 #include <math.h> 
 #include "freertos/semphr.h"
+#include "freertos/ringbuf.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+#include <atomic>
 
 static const char *TAG = "AUDIO_MGR";
 
+// --- PLAYBACK PIPELINE ---
+// The reader task opens the background files from the playback queue one after
+// another, decodes them (PCM, IMA-ADPCM or QOA, see audio_decoder.h), resamples
+// them to the 16-bit stereo bus format at AUDIO_OUTPUT_SAMPLE_RATE and streams
+// them back to back into a PSRAM ring buffer. The mixer task drains it in blocks,
+// mixes in any sound effects from the sound bank, runs the DSP on the bus and
+// feeds I2S, which is clocked at AUDIO_OUTPUT_SAMPLE_RATE for the whole
+// application run. Track boundaries travel next to the ring as byte offsets
+// (track_mark_t), so the next track starts on the frame after the last one.
+// A seek restarts the stream: the reader repositions the file and sends a new
+// mark, and the mixer drops everything buffered before that mark.
+#define MIXER_BLOCK_FRAMES 512         // Bus frames mixed per iteration (~10.7 ms at 48 kHz).
+#define MIXER_BLOCK_SAMPLES (MIXER_BLOCK_FRAMES * AUDIO_MIXER_CHANNELS)
+#define MIXER_BLOCK_US ((uint32_t)((uint64_t)MIXER_BLOCK_FRAMES * 1000000 / AUDIO_OUTPUT_SAMPLE_RATE))
+#define BUS_FRAME_BYTES (AUDIO_MIXER_CHANNELS * sizeof(int16_t))
+#define READER_CHUNK_FRAMES 512        // Decoded frames resampled at a time in the reader task.
+#define READER_OUT_FRAMES 512          // Resampled frames pushed to the ring at a time.
+#define RINGBUF_WAIT_MS 20             // Max wait for ring data/space before re-checking state.
+#define EFFECT_VOICES (AUDIO_MIXER_VOICES - 1)
+#define EFFECT_QUEUE_LENGTH 4
+#define TRACK_MARK_QUEUE_LENGTH 4      // Track starts the reader may run ahead of the mixer.
+#define TRACK_PATH_MAX 256
+// Tracks the reader keeps after sending them, so a seek back into one it has
+// already finished can replay it and the ones after it: the marks in flight,
+// the mixer's next mark, the playing track and the one being read.
+#define READER_HISTORY_LENGTH (TRACK_MARK_QUEUE_LENGTH + 3)
+// Cancelled tracks are tracked by id modulo 32, so every id that may still be
+// queued, buffered or playing must fit in that window.
+static_assert(AUDIO_PLAYBACK_QUEUE_LENGTH + TRACK_MARK_QUEUE_LENGTH + 3 < 32, "playback queue too long");
+
+// Ducking: the background gain drops to the duck level within one block when an
+// effect starts, and recovers by this much per block (~190 ms to full level).
+#define DUCK_GAIN_Q15 ((AUDIO_MIXER_UNITY_GAIN * AUDIO_MIXER_DUCK_PERCENT) / 100)
+#define DUCK_RELEASE_STEP_Q15 (AUDIO_MIXER_UNITY_GAIN / 16)
+
 // --- HIGH-PASS FILTER (HPF) CONFIGURATION - 4TH ORDER LINKWITZ-RILEY ---
+// The filter runs inside the output chain (audio_dsp.h); its cutoff follows the volume.
 #define HIGH_PASS_FILTER_THRESHOLD 50 
 #define HPF_MIN_CUTOFF_FREQ 60.0f   
 #define HPF_MAX_CUTOFF_FREQ 350.0f 
 
-#define HPF_LR4_Q1 0.541196f
-#define HPF_LR4_Q2 1.306563f
-
-typedef struct { float b0, b1, b2, a1, a2; } biquad_coeffs_t;
-typedef struct { float x1, x2, y1, y2; } biquad_state_t;
+// A request to start a sound effect, handed from the caller to the mixer task.
+typedef struct {
+    audio_sound_clip_t clip;
+    int32_t gain_q15;
+    int64_t request_time_us;
+} effect_request_t;
 
-typedef struct { biquad_state_t left; biquad_state_t right; } stereo_biquad_stage_t;
+// A file waiting in the playback queue.
+typedef struct {
+    uint32_t id;
+    char path[TRACK_PATH_MAX];
+} playlist_entry_t;
 
-#define HPF_STAGES 2
-typedef struct { stereo_biquad_stage_t stages[HPF_STAGES]; } fourth_order_hpf_state_t;
-typedef struct { biquad_coeffs_t stage[HPF_STAGES]; } fourth_order_hpf_coeffs_t;
+// Start of a background track in the ring's byte stream. The reader sends it
+// before pushing the track's first frame.
+typedef struct {
+    uint32_t id;
+    uint64_t start_byte;  // Offset of the first frame since the session started.
+    uint32_t offset_bytes; // Position of that frame in the track, in bus bytes (non-zero after a seek).
+    uint32_t seek_gen;     // seek_generation the reader had adopted when sending it.
+    uint32_t duration_s;
+    char path[TRACK_PATH_MAX];
+} track_mark_t;
 
-// Partial structure for the WAV header. We fill this in parts.
+// Scratch buffers of the mixer task, allocated once in internal RAM.
 typedef struct {
-    uint16_t audio_format;
-    uint16_t num_channels;
-    uint32_t sample_rate;
-    uint32_t byte_rate;
-    uint16_t block_align;
-    uint16_t bits_per_sample;
-    uint32_t data_size;
-} wav_format_info_t;
-
-// Player state variables
-static TaskHandle_t playback_task_handle = NULL;
+    int32_t acc[MIXER_BLOCK_SAMPLES];
+    int16_t out[MIXER_BLOCK_SAMPLES];
+    int16_t voice[MIXER_BLOCK_SAMPLES];
+    int16_t tap[MIXER_BLOCK_FRAMES]; // Mono visualizer tap of the output chain.
+} mixer_buffers_t;
+
+// Player state variables (these describe the background track)
 static volatile audio_player_state_t player_state = AUDIO_STATE_STOPPED;
-static char current_filepath[256] = {0};
-static i2s_chan_handle_t tx_chan;
-static wav_format_info_t wav_file_info;
+static char current_filepath[TRACK_PATH_MAX] = {0};
 static volatile uint32_t total_bytes_played = 0;
 static volatile uint32_t song_duration_s = 0;
 static QueueHandle_t visualizer_queue = NULL;
+static audio_spectrum_t *spectrum = NULL; // Mixer-owned: feeds visualizer_queue.
+
+// I2S output, always clocked at AUDIO_OUTPUT_SAMPLE_RATE.
+static i2s_chan_handle_t tx_chan = NULL;
+static bool tx_enabled = false;
 
 // Volume control variables
 #define VOLUME_STEP 5
 static volatile uint8_t current_volume_percentage = 5;
-static volatile float volume_factor = 0.1f;
-static SemaphoreHandle_t volume_mutex = NULL; 
+static SemaphoreHandle_t volume_mutex = NULL; // Guards the percentage only; the mixer reads the chain's atomics.
+
+// Mixer task. It sleeps on a task notification while nothing is playing.
+static TaskHandle_t mixer_task_handle = NULL;
+static mixer_buffers_t *mixer_buffers = NULL;
+static SemaphoreHandle_t background_idle_sem = NULL; // Given back when the background track has ended.
+static volatile bool background_start_requested = false;
+static bool background_active = false;     // Mixer-owned: the background voice is streaming.
+static bool background_rebuffering = false; // Mixer-owned: waiting for the ring to refill.
+static bool background_first_write_done = false;
+static bool background_below_low_watermark = false;
+static int32_t background_gain_q15 = AUDIO_MIXER_UNITY_GAIN;
+static int64_t play_request_time_us = 0;
 
-// Task synchronization
-static SemaphoreHandle_t playback_task_terminated_sem = NULL;
+// Sound effect voices (mixer-owned) and the queue feeding them.
+static QueueHandle_t effect_queue = NULL;
+static audio_mixer_voice_t effect_voices[EFFECT_VOICES];
+static std::atomic<uint32_t> effects_in_flight(0); // Queued plus playing effects.
+
+// Playback queue. A session runs from audio_manager_play() (or a queue_add()
+// on an idle player) until the last queued track has drained.
+static SemaphoreHandle_t playlist_mutex = NULL; // Guards the playlist and session_active; never taken per block.
+static playlist_entry_t playlist[AUDIO_PLAYBACK_QUEUE_LENGTH];
+static uint32_t playlist_head = 0;
+static uint32_t playlist_count = 0;
+static uint32_t next_track_id = 1;
+static bool session_active = false;                  // The reader still accepts queued tracks.
+static std::atomic<uint32_t> cancelled_tracks(0);    // Bit (id % 32): drop the rest of that track.
+static std::atomic<uint32_t> playing_track_id(0);    // Track the mixer is playing, 0 if none.
+static std::atomic<uint32_t> reader_track_id(0);     // Last track the reader opened.
+static QueueHandle_t track_mark_queue = NULL;        // Reader -> mixer track boundaries.
+
+// Seeking. A request bumps seek_generation after storing its target; each task
+// compares it with the generation it last handled.
+static std::atomic<uint32_t> seek_generation(0);
+static std::atomic<uint32_t> seek_track_id(0);
+static std::atomic<uint32_t> seek_target_ms(0);
+static int64_t seek_request_time_us = 0;
+
+// Reader (producer) task and read-ahead ring buffer
+static RingbufHandle_t playback_ringbuf = NULL;
+static TaskHandle_t reader_task_handle = NULL;
+static SemaphoreHandle_t reader_idle_sem = NULL;
+static volatile bool reader_start_requested = false;
+static volatile bool reader_stop_requested = false;
+static volatile bool reader_finished = false;     // Set while the reader has nothing more to push.
+static volatile bool reader_done = false;         // Set once the reader has left the session.
+static audio_decoder_t reader_decoder;             // Reader-owned: decoder of the current file.
+static audio_resampler_t reader_resampler;         // Reader-owned: file rate -> bus rate.
+static uint64_t reader_pushed_bytes = 0;           // Reader-owned: bytes pushed in this session.
+static uint32_t reader_active_id = 0;              // Reader-owned: track whose frames are being pushed.
+static track_mark_t next_reader_mark;              // Reader-owned: scratch for the mark being sent.
+static uint32_t reader_seek_gen = 0;               // Reader-owned: last seek_generation handled.
+static playlist_entry_t reader_history[READER_HISTORY_LENGTH]; // Reader-owned: tracks sent in this session, oldest first.
+static uint32_t reader_history_count = 0;
+static uint32_t reader_replay_pos = 0;             // History entries from here on are (re)played before the playlist.
+static uint32_t reader_replay_start_ms = 0;        // Start position of the next replayed entry.
+static int16_t reader_chunk[READER_CHUNK_FRAMES * AUDIO_MIXER_CHANNELS];
+static audio_playback_stats_t playback_stats;
+
+// Mixer-owned position in the background stream.
+static uint64_t stream_consumed_bytes = 0;   // Bytes taken from the ring in this session.
+static uint64_t track_start_byte = 0;        // Stream offset of the current track.
+static track_mark_t next_mark;               // Start of the next track, once announced.
+static bool next_mark_loaded = false;
+static uint32_t track_offset_bytes = 0;      // Position in the track of the frame at track_start_byte.
+static uint32_t stream_seek_gen = 0;         // seek_generation the buffered stream belongs to.
+static bool background_seek_landed = false;  // The first block after a seek is still to be written.
+static uint32_t background_silent_frames = 0; // Frames without background audio since it last played.
+static bool background_expect_dry = false;   // The ring is expected to run dry (nothing queued yet, or a seek).
+
+// Output stage of the bus: HPF, visualizer tap, volume and limiter in one pass.
+static audio_dsp_chain_t output_chain;
+
+// Playback health (audio_manager_get_health()). Each half is written by one
+// task only. A reset bumps health_generation; each task clears its half when
+// it sees the new generation, and until then a snapshot reports that half as empty.
+typedef struct {
+    uint32_t generation;
+    audio_histogram_t dsp_us;
+    audio_histogram_t i2s_write_us;
+    uint32_t blocks;
+    uint32_t underruns;
+    uint32_t short_writes;
+    uint32_t peak_busy_us;
+    uint64_t busy_total_us;
+    uint32_t block_ring_us; // Time spent in ring reads during the block in progress.
+} mixer_health_t;
+
+typedef struct {
+    uint32_t generation;
+    audio_histogram_t read_us;
+    uint32_t read_stalls;
+} reader_health_t;
 
-// --- GLOBAL VARIABLES FOR 4th ORDER FILTER ---
-static fourth_order_hpf_state_t hpf_state;
-static fourth_order_hpf_coeffs_t hpf_coeffs;
-static volatile bool hpf_active = false;
-static uint8_t last_known_volume_for_hpf = 0;
+static std::atomic<uint32_t> health_generation(0);
+static mixer_health_t mixer_health;   // Mixer-owned.
+static reader_health_t reader_health; // Reader-owned.
 
 // Function Prototypes
-static void audio_playback_task(void *arg);
+static void audio_mixer_task(void *arg);
+static void audio_reader_task(void *arg);
+static esp_err_t create_tx_channel(void);
 static void audio_manager_set_volume_internal(uint8_t percentage, bool apply_cap);
-static void calculate_lr4_hpf_coeffs(float cutoff_freq, float sample_rate);
-static void reset_hpf_state();
-static int16_t apply_biquad_filter(biquad_state_t* state, const biquad_coeffs_t* coeffs, int16_t input);
 static inline float map_range(float value, float from_low, float from_high, float to_low, float to_high);
 
-// --- BIQUAD FILTER FUNCTIONS ---
+// --- HPF HELPERS ---
 static inline float map_range(float value, float from_low, float from_high, float to_low, float to_high) {
     if (value <= from_low) return to_low;
     if (value >= from_high) return to_high;
     return to_low + (to_high - to_low) * ((value - from_low) / (from_high - from_low));
 }
 
-static void calculate_lr4_hpf_coeffs(float cutoff_freq, float sample_rate) {
-    const float q_values[HPF_STAGES] = { HPF_LR4_Q1, HPF_LR4_Q2 };
-    
-    for (int i = 0; i < HPF_STAGES; i++) {
-        const float q = q_values[i];
-        const float omega = 2.0f * M_PI * cutoff_freq / sample_rate;
-        const float cos_omega = cosf(omega);
-        const float alpha = sinf(omega) / (2.0f * q);
-        const float a0_inv = 1.0f / (1.0f + alpha); 
-
-        hpf_coeffs.stage[i].b0 = ((1.0f + cos_omega) / 2.0f) * a0_inv;
-        hpf_coeffs.stage[i].b1 = (-(1.0f + cos_omega)) * a0_inv;
-        hpf_coeffs.stage[i].b2 = ((1.0f + cos_omega) / 2.0f) * a0_inv;
-        hpf_coeffs.stage[i].a1 = (-2.0f * cos_omega) * a0_inv;
-        hpf_coeffs.stage[i].a2 = (1.0f - alpha) * a0_inv;
-    }
-    ESP_LOGD(TAG, "LR4 HPF coeffs calculated for %.1f Hz.", cutoff_freq);
-}
-
-static void reset_hpf_state() {
-    memset(&hpf_state, 0, sizeof(fourth_order_hpf_state_t));
-}
-
-static int16_t apply_biquad_filter(biquad_state_t* state, const biquad_coeffs_t* coeffs, int16_t input) {
-    float result = coeffs->b0 * input + coeffs->b1 * state->x1 + coeffs->b2 * state->x2 - coeffs->a1 * state->y1 - coeffs->a2 * state->y2;
-    state->x2 = state->x1; state->x1 = input;
-    state->y2 = state->y1; state->y1 = result;
-    
-    if (result > 32767.0f) result = 32767.0f;
-    if (result < -32768.0f) result = -32768.0f;
-    
-    return (int16_t)result;
-}
-
-
 // --- Internal Volume Control ---
 static void audio_manager_set_volume_internal(uint8_t percentage, bool apply_cap) {
     if (volume_mutex && xSemaphoreTake(volume_mutex, portMAX_DELAY) == pdTRUE) {
         if (apply_cap && percentage > MAX_VOLUME_PERCENTAGE) percentage = MAX_VOLUME_PERCENTAGE;
         else if (percentage > 100) percentage = 100;
         current_volume_percentage = percentage;
-        volume_factor = (float)current_volume_percentage / 100.0f; 
-        ESP_LOGI(TAG, "Volume set to %u%% (physical), factor: %.2f", current_volume_percentage, volume_factor);
+
+        // The HPF protects the speaker at high volume, with a cutoff rising with the volume.
+        uint32_t cutoff_hz = 0;
+        if (percentage >= HIGH_PASS_FILTER_THRESHOLD) {
+            cutoff_hz = (uint32_t)lrintf(map_range(percentage, HIGH_PASS_FILTER_THRESHOLD, MAX_VOLUME_PERCENTAGE, HPF_MIN_CUTOFF_FREQ, HPF_MAX_CUTOFF_FREQ));
+        }
+        const int32_t gain_q15 = ((int32_t)percentage * AUDIO_DSP_UNITY_GAIN) / 100;
+        audio_dsp_chain_set_hpf_cutoff(&output_chain, cutoff_hz);
+        audio_dsp_chain_set_gain(&output_chain, gain_q15);
+        ESP_LOGI(TAG, "Volume set to %u%% (physical), gain: %ld/32768, HPF: %lu Hz", percentage, gain_q15, cutoff_hz);
         xSemaphoreGive(volume_mutex);
     }
 }
@@ -133,52 +248,287 @@ static void audio_manager_set_volume_internal(uint8_t percentage, bool apply_cap
 // --- Public Functions ---
 void audio_manager_init(void) {
     volume_mutex = xSemaphoreCreateMutex();
-    playback_task_terminated_sem = xSemaphoreCreateBinary();
-    xSemaphoreGive(playback_task_terminated_sem);
+    audio_dsp_chain_init(&output_chain, AUDIO_OUTPUT_SAMPLE_RATE);
+    audio_dsp_chain_set_limiter(&output_chain, AUDIO_LIMITER_THRESHOLD_DBFS, AUDIO_LIMITER_RELEASE_MS);
+    background_idle_sem = xSemaphoreCreateBinary();
+    xSemaphoreGive(background_idle_sem);
+    reader_idle_sem = xSemaphoreCreateBinary();
+    xSemaphoreGive(reader_idle_sem);
+    effect_queue = xQueueCreate(EFFECT_QUEUE_LENGTH, sizeof(effect_request_t));
+    playlist_mutex = xSemaphoreCreateMutex();
+    track_mark_queue = xQueueCreate(TRACK_MARK_QUEUE_LENGTH, sizeof(track_mark_t));
+    playback_ringbuf = xRingbufferCreateWithCaps(AUDIO_PLAYBACK_RINGBUF_SIZE, RINGBUF_TYPE_BYTEBUF, MALLOC_CAP_SPIRAM);
+    if (!playback_ringbuf) {
+        ESP_LOGE(TAG, "Failed to allocate %d byte playback ring buffer in PSRAM.", AUDIO_PLAYBACK_RINGBUF_SIZE);
+    }
+    mixer_buffers = (mixer_buffers_t *)heap_caps_malloc(sizeof(mixer_buffers_t), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    if (!mixer_buffers) {
+        ESP_LOGE(TAG, "Failed to allocate mixer buffers.");
+    }
     audio_manager_set_volume_internal(5, true);
     visualizer_queue = xQueueCreate(1, sizeof(visualizer_data_t));
+    spectrum = (audio_spectrum_t *)heap_caps_malloc(sizeof(audio_spectrum_t), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    if (spectrum) {
+        audio_spectrum_init(spectrum, AUDIO_OUTPUT_SAMPLE_RATE, VISUALIZER_BAR_COUNT);
+    } else {
+        ESP_LOGE(TAG, "Failed to allocate the spectrum analyzer, the visualizer will stay idle.");
+    }
+
+    // The TX channel and both tasks live for the whole application run, so starting
+    // a sound only costs a task notification.
+    if (create_tx_channel() != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to create the I2S TX channel.");
+    }
+    if (xTaskCreate(audio_mixer_task, "audio_mixer", 4096, NULL, 6, &mixer_task_handle) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create audio mixer task");
+        mixer_task_handle = NULL;
+    }
+    if (xTaskCreate(audio_reader_task, "audio_reader", 3072, NULL, 5, &reader_task_handle) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create audio reader task");
+        reader_task_handle = NULL;
+    }
+    audio_sound_bank_load();
     ESP_LOGI(TAG, "Audio Manager Initialized.");
 }
 
+static bool pipeline_ready(void) {
+    return playback_ringbuf && mixer_buffers && tx_chan && effect_queue && playlist_mutex && track_mark_queue &&
+           mixer_task_handle && reader_task_handle;
+}
+
+// --- Playback Queue ---
+static inline uint32_t track_bit(uint32_t id) { return 1u << (id & 31); }
+static bool track_cancelled(uint32_t id) { return (cancelled_tracks.load() & track_bit(id)) != 0; }
+
+// The playlist helpers must be called with playlist_mutex held.
+static bool playlist_push_locked(const char *filepath) {
+    if (playlist_count >= AUDIO_PLAYBACK_QUEUE_LENGTH) return false;
+    playlist_entry_t *entry = &playlist[(playlist_head + playlist_count) % AUDIO_PLAYBACK_QUEUE_LENGTH];
+    strncpy(entry->path, filepath, sizeof(entry->path) - 1);
+    entry->path[sizeof(entry->path) - 1] = '\0';
+    entry->id = next_track_id++;
+    if (next_track_id == 0) next_track_id = 1;
+    cancelled_tracks.fetch_and(~track_bit(entry->id));
+    playlist_count++;
+    return true;
+}
+
+static bool playlist_pop_locked(playlist_entry_t *entry) {
+    if (playlist_count == 0) return false;
+    *entry = playlist[playlist_head];
+    playlist_head = (playlist_head + 1) % AUDIO_PLAYBACK_QUEUE_LENGTH;
+    playlist_count--;
+    return true;
+}
+
+// Starts a session on the queue: the reader begins with its first entry and
+// the mixer starts the background voice once the first track is announced.
+// The caller holds playlist_mutex and background_idle_sem, so the previous
+// session has fully ended, the reader is idle and the ring is empty.
+static void start_session_locked(void) {
+    strncpy(current_filepath, playlist[playlist_head].path, sizeof(current_filepath) - 1);
+    current_filepath[sizeof(current_filepath) - 1] = '\0';
+    session_active = true;
+
+    xSemaphoreTake(reader_idle_sem, 0);
+    reader_stop_requested = false;
+    reader_finished = false;
+    reader_done = false;
+    reader_start_requested = true;
+    player_state = AUDIO_STATE_PLAYING; // Must be visible before the start request (see update_background()).
+    background_start_requested = true;
+    xTaskNotifyGive(reader_task_handle);
+    xTaskNotifyGive(mixer_task_handle);
+}
+
 bool audio_manager_play(const char *filepath) {
+    if (!pipeline_ready()) {
+        ESP_LOGE(TAG, "Audio pipeline not available.");
+        return false;
+    }
+    play_request_time_us = esp_timer_get_time();
     if (player_state != AUDIO_STATE_STOPPED) audio_manager_stop();
-    if (xSemaphoreTake(playback_task_terminated_sem, pdMS_TO_TICKS(100)) == pdFALSE) {
-        ESP_LOGE(TAG, "Could not start new playback, previous task has not terminated yet.");
+    if (xSemaphoreTake(background_idle_sem, pdMS_TO_TICKS(100)) == pdFALSE) {
+        ESP_LOGE(TAG, "Could not start new playback, previous track has not finished yet.");
         return false;
     }
-    strncpy(current_filepath, filepath, sizeof(current_filepath) - 1);
-    current_filepath[sizeof(current_filepath) - 1] = '\0';
-    player_state = AUDIO_STATE_PLAYING;
-    if (xTaskCreate(audio_playback_task, "audio_playback", 4096, NULL, 5, &playback_task_handle) != pdPASS) {
-        ESP_LOGE(TAG, "Failed to create audio playback task");
-        player_state = AUDIO_STATE_STOPPED;
-        current_filepath[0] = '\0';
-        xSemaphoreGive(playback_task_terminated_sem);
+    xSemaphoreTake(playlist_mutex, portMAX_DELAY);
+    playlist_count = 0;
+    playlist_push_locked(filepath);
+    start_session_locked();
+    xSemaphoreGive(playlist_mutex);
+    return true;
+}
+
+bool audio_manager_queue_add(const char *filepath) {
+    if (!pipeline_ready()) {
+        ESP_LOGE(TAG, "Audio pipeline not available.");
         return false;
     }
+    if (!filepath || filepath[0] == '\0') return false;
+
+    xSemaphoreTake(playlist_mutex, portMAX_DELAY);
+    if (session_active) {
+        const bool queued = playlist_push_locked(filepath);
+        xSemaphoreGive(playlist_mutex);
+        if (!queued) {
+            ESP_LOGW(TAG, "Playback queue full, dropping '%s'.", filepath);
+            return false;
+        }
+        xTaskNotifyGive(reader_task_handle); // It may be waiting for more tracks.
+        return true;
+    }
+    xSemaphoreGive(playlist_mutex);
+
+    // Nothing queued is left to play (at most the last block is still draining): start over.
+    play_request_time_us = esp_timer_get_time();
+    if (xSemaphoreTake(background_idle_sem, pdMS_TO_TICKS(1000)) == pdFALSE) {
+        ESP_LOGE(TAG, "Could not start queued playback, previous track has not finished yet.");
+        return false;
+    }
+    xSemaphoreTake(playlist_mutex, portMAX_DELAY);
+    playlist_count = 0;
+    playlist_push_locked(filepath);
+    start_session_locked();
+    xSemaphoreGive(playlist_mutex);
+    return true;
+}
+
+bool audio_manager_queue_skip(void) {
+    const uint32_t id = playing_track_id.load();
+    if (id == 0) return false;
+    // The reader stops decoding it and the mixer drops what is already buffered,
+    // up to the first frame of the next track.
+    cancelled_tracks.fetch_or(track_bit(id));
+    if (mixer_task_handle) xTaskNotifyGive(mixer_task_handle); // It may be asleep while paused.
     return true;
 }
 
+void audio_manager_queue_clear(void) {
+    if (!playlist_mutex) return;
+    xSemaphoreTake(playlist_mutex, portMAX_DELAY);
+    playlist_count = 0;
+    // Tracks the reader has already opened ahead of the current one are buffered
+    // behind it in the ring: cancel them too.
+    const uint32_t playing = playing_track_id.load();
+    if (playing != 0) {
+        for (uint32_t id = reader_track_id.load(), n = 0; id != playing && id != 0 && n < 32; id--, n++) {
+            cancelled_tracks.fetch_or(track_bit(id));
+        }
+    }
+    xSemaphoreGive(playlist_mutex);
+}
+
+uint32_t audio_manager_queue_length(void) {
+    if (!playlist_mutex) return 0;
+    xSemaphoreTake(playlist_mutex, portMAX_DELAY);
+    uint32_t length = playlist_count;
+    const uint32_t playing = playing_track_id.load();
+    if (playing != 0) {
+        for (uint32_t id = reader_track_id.load(), n = 0; id != playing && id != 0 && n < 32; id--, n++) {
+            if (!track_cancelled(id)) length++;
+        }
+    }
+    xSemaphoreGive(playlist_mutex);
+    return length;
+}
+
+// --- Seeking ---
+#define BUS_BYTES_PER_MS ((AUDIO_OUTPUT_SAMPLE_RATE / 1000) * BUS_FRAME_BYTES)
+
+static uint32_t progress_ms(void) { return total_bytes_played / BUS_BYTES_PER_MS; }
+
+// Asks the reader to restart the playing track at `position_ms`. The mixer
+// keeps going and drops the stale part of the ring until the restart arrives.
+static bool seek_to_ms(uint32_t position_ms) {
+    const uint32_t id = playing_track_id.load();
+    if (id == 0 || track_cancelled(id)) return false;
+    const uint32_t duration_ms = song_duration_s * 1000;
+    if (duration_ms > 0 && position_ms > duration_ms) position_ms = duration_ms;
+
+    seek_request_time_us = esp_timer_get_time();
+    seek_track_id = id;
+    seek_target_ms = position_ms;
+    seek_generation++;
+    total_bytes_played = position_ms * BUS_BYTES_PER_MS; // Shown right away, even while paused.
+    xTaskNotifyGive(reader_task_handle);
+    xTaskNotifyGive(mixer_task_handle);
+    return true;
+}
+
+bool audio_manager_seek(uint32_t seconds) {
+    return seek_to_ms(seconds * 1000);
+}
+
+bool audio_manager_fast_forward(uint32_t seconds) {
+    return seek_to_ms(progress_ms() + seconds * 1000);
+}
+
+bool audio_manager_rewind(uint32_t seconds) {
+    const uint32_t now_ms = progress_ms();
+    return seek_to_ms(now_ms > seconds * 1000 ? now_ms - seconds * 1000 : 0);
+}
+
+bool audio_manager_play_sound(audio_sound_id_t id) {
+    return audio_manager_play_sound_with_gain(id, 100);
+}
+
+bool audio_manager_play_sound_with_gain(audio_sound_id_t id, uint8_t gain_percent) {
+    if (!pipeline_ready()) {
+        ESP_LOGE(TAG, "Audio pipeline not available.");
+        return false;
+    }
+    effect_request_t request;
+    if (!audio_sound_bank_get(id, &request.clip)) {
+        ESP_LOGW(TAG, "Sound %d is not available in the sound bank.", (int)id);
+        return false;
+    }
+    if (gain_percent > 100) gain_percent = 100;
+    request.gain_q15 = (AUDIO_MIXER_UNITY_GAIN * gain_percent) / 100;
+    request.request_time_us = esp_timer_get_time();
+
+    effects_in_flight++;
+    if (xQueueSend(effect_queue, &request, 0) != pdTRUE) {
+        effects_in_flight--;
+        ESP_LOGW(TAG, "Effect queue full, dropping sound %d.", (int)id);
+        return false;
+    }
+    xTaskNotifyGive(mixer_task_handle);
+    return true;
+}
+
+bool audio_manager_is_sound_playing(void) {
+    return effects_in_flight.load() > 0;
+}
+
 void audio_manager_stop(void) {
+    if (playlist_mutex) {
+        xSemaphoreTake(playlist_mutex, portMAX_DELAY);
+        playlist_count = 0;
+        xSemaphoreGive(playlist_mutex);
+    }
     if (player_state != AUDIO_STATE_STOPPED) {
-        audio_player_state_t prev_state = player_state;
         player_state = AUDIO_STATE_STOPPED;
-        if (prev_state == AUDIO_STATE_PAUSED && tx_chan) i2s_channel_enable(tx_chan);
-        if (playback_task_handle) {
-            if (xSemaphoreTake(playback_task_terminated_sem, pdMS_TO_TICKS(1000)) == pdFALSE) {
-                 ESP_LOGW(TAG, "Timed out waiting for playback task to terminate!");
-            }
-            xSemaphoreGive(playback_task_terminated_sem);
-            playback_task_handle = NULL;
+        if (mixer_task_handle) xTaskNotifyGive(mixer_task_handle); // It may be asleep while paused.
+        if (xSemaphoreTake(background_idle_sem, pdMS_TO_TICKS(1000)) == pdFALSE) {
+             ESP_LOGW(TAG, "Timed out waiting for the background track to end!");
         }
+        xSemaphoreGive(background_idle_sem);
         total_bytes_played = 0; 
         song_duration_s = 0; 
         current_filepath[0] = '\0';
     }
 }
 
-void audio_manager_pause(void) { if (player_state == AUDIO_STATE_PLAYING && tx_chan) { i2s_channel_disable(tx_chan); player_state = AUDIO_STATE_PAUSED; } }
-void audio_manager_resume(void) { if (player_state == AUDIO_STATE_PAUSED && tx_chan) { i2s_channel_enable(tx_chan); player_state = AUDIO_STATE_PLAYING; } }
+// Pausing only silences the background voice; effects keep playing, and the
+// mixer switches the TX channel off by itself once nothing is left to play.
+void audio_manager_pause(void) { if (player_state == AUDIO_STATE_PLAYING) { player_state = AUDIO_STATE_PAUSED; } }
+void audio_manager_resume(void) {
+    if (player_state == AUDIO_STATE_PAUSED) {
+        player_state = AUDIO_STATE_PLAYING;
+        if (mixer_task_handle) xTaskNotifyGive(mixer_task_handle);
+    }
+}
 
 audio_player_state_t audio_manager_get_state(void) { return player_state; }
 bool audio_manager_is_playing() {
@@ -186,7 +536,7 @@ bool audio_manager_is_playing() {
     return (current_state == AUDIO_STATE_PLAYING || current_state == AUDIO_STATE_PAUSED);
 }
 uint32_t audio_manager_get_duration_s(void) { return song_duration_s; }
-uint32_t audio_manager_get_progress_s(void) { return (wav_file_info.byte_rate > 0) ? (total_bytes_played / wav_file_info.byte_rate) : 0; }
+uint32_t audio_manager_get_progress_s(void) { return progress_ms() / 1000; }
 
 const char* audio_manager_get_current_file(void) {
     return current_filepath;
@@ -219,228 +569,756 @@ uint8_t audio_manager_get_volume(void) {
 void audio_manager_set_volume_physical(uint8_t percentage) { audio_manager_set_volume_internal(percentage, false); }
 QueueHandle_t audio_manager_get_visualizer_queue(void) { return visualizer_queue; }
 
-// --- Audio Playback Task ---
-static void audio_playback_task(void *arg) {
-    ESP_LOGI(TAG, "Playback task started.");
+void audio_manager_get_playback_stats(audio_playback_stats_t *stats) {
+    if (stats) *stats = playback_stats;
+}
+
+void audio_manager_get_health(audio_health_t *health) {
+    if (!health) return;
+    memset(health, 0, sizeof(audio_health_t));
+    health->block_period_us = MIXER_BLOCK_US;
+    const uint32_t generation = health_generation.load();
+    if (reader_health.generation == generation) {
+        health->read_us = reader_health.read_us;
+        health->read_stalls = reader_health.read_stalls;
+    }
+    if (mixer_health.generation == generation) {
+        health->dsp_us = mixer_health.dsp_us;
+        health->i2s_write_us = mixer_health.i2s_write_us;
+        health->blocks = mixer_health.blocks;
+        health->underruns = mixer_health.underruns;
+        health->short_writes = mixer_health.short_writes;
+        health->peak_cpu_load_permille = (uint32_t)(((uint64_t)mixer_health.peak_busy_us * 1000) / MIXER_BLOCK_US);
+        if (health->blocks > 0) {
+            health->avg_cpu_load_permille = (uint32_t)((mixer_health.busy_total_us * 1000) / ((uint64_t)health->blocks * MIXER_BLOCK_US));
+        }
+    }
+}
+
+void audio_manager_reset_health(void) {
+    health_generation++;
+}
+
+static void log_histogram(const char *name, const audio_histogram_t *hist) {
+    char buckets[160];
+    audio_histogram_format_buckets(hist, buckets, sizeof(buckets));
+    ESP_LOGI(TAG, "  %-9s n=%lu mean=%lu p50<=%lu p99<=%lu max=%lu us | %s", name, hist->count,
+             audio_histogram_mean(hist), audio_histogram_percentile(hist, 50), audio_histogram_percentile(hist, 99),
+             hist->max_us, buckets);
+}
+
+void audio_manager_log_health(void) {
+    audio_health_t health;
+    audio_manager_get_health(&health);
+    ESP_LOGI(TAG, "Playback health: %lu blocks, %lu underruns, %lu read stalls, %lu short writes, CPU load avg %lu.%lu%% peak %lu.%lu%%",
+             health.blocks, health.underruns, health.read_stalls, health.short_writes,
+             health.avg_cpu_load_permille / 10, health.avg_cpu_load_permille % 10,
+             health.peak_cpu_load_permille / 10, health.peak_cpu_load_permille % 10);
+    log_histogram("fread", &health.read_us);
+    log_histogram("dsp", &health.dsp_us);
+    log_histogram("i2s write", &health.i2s_write_us);
+}
+
+// --- I2S TX Channel ---
+static void fill_tx_std_config(i2s_std_config_t *std_cfg, uint32_t sample_rate) {
+    const uint16_t bits_per_sample = 16;
+    *std_cfg = {};
+    std_cfg->clk_cfg.sample_rate_hz = sample_rate;
+    std_cfg->clk_cfg.clk_src = I2S_CLK_SRC_DEFAULT;
+    std_cfg->clk_cfg.mclk_multiple = I2S_MCLK_MULTIPLE_256;
+    
+    std_cfg->slot_cfg.data_bit_width = (i2s_data_bit_width_t)bits_per_sample;
+    std_cfg->slot_cfg.slot_bit_width = I2S_SLOT_BIT_WIDTH_AUTO;
+    std_cfg->slot_cfg.slot_mode = I2S_SLOT_MODE_STEREO; // The mixer bus is always 16-bit stereo.
+    std_cfg->slot_cfg.slot_mask = I2S_STD_SLOT_BOTH;
+    std_cfg->slot_cfg.ws_width = (i2s_data_bit_width_t)bits_per_sample;
+    std_cfg->slot_cfg.ws_pol = false; 
+    std_cfg->slot_cfg.bit_shift = false; 
+    std_cfg->slot_cfg.left_align = true;
+    std_cfg->slot_cfg.big_endian = false; 
+    std_cfg->slot_cfg.bit_order_lsb = false;
     
-    FILE *fp = NULL;
-    uint8_t *buffer = NULL;
-    i2s_chan_config_t chan_cfg;
+    std_cfg->gpio_cfg.mclk = I2S_GPIO_UNUSED; 
+    std_cfg->gpio_cfg.bclk = I2S_SPEAKER_BCLK_PIN; 
+    std_cfg->gpio_cfg.ws = I2S_SPEAKER_WS_PIN;
+    std_cfg->gpio_cfg.dout = I2S_SPEAKER_DOUT_PIN; 
+    std_cfg->gpio_cfg.din = I2S_GPIO_UNUSED;
+    std_cfg->gpio_cfg.invert_flags = {.mclk_inv = false, .bclk_inv = false, .ws_inv = false};
+}
+
+// Creates the long-lived TX channel. It stays disabled (no clocks) while idle.
+static esp_err_t create_tx_channel(void) {
+    i2s_chan_config_t chan_cfg = I2S_CHANNEL_DEFAULT_CONFIG(I2S_NUM_0, I2S_ROLE_MASTER);
+    chan_cfg.auto_clear = true; // Send silence instead of repeating stale DMA data if the mixer falls behind.
+    esp_err_t ret = i2s_new_channel(&chan_cfg, &tx_chan, NULL);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "i2s_new_channel failed: %s", esp_err_to_name(ret));
+        tx_chan = NULL;
+        return ret;
+    }
+
     i2s_std_config_t std_cfg;
-    const int buffer_size = 2048;
+    fill_tx_std_config(&std_cfg, AUDIO_OUTPUT_SAMPLE_RATE);
+    ret = i2s_channel_init_std_mode(tx_chan, &std_cfg);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "i2s_channel_init_std_mode failed: %s", esp_err_to_name(ret));
+        i2s_del_channel(tx_chan);
+        tx_chan = NULL;
+        return ret;
+    }
+    return ESP_OK;
+}
+
+static void tx_set_enabled(bool enable) {
+    if (enable == tx_enabled) return;
+    esp_err_t ret = enable ? i2s_channel_enable(tx_chan) : i2s_channel_disable(tx_chan);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to %s I2S TX channel: %s", enable ? "enable" : "disable", esp_err_to_name(ret));
+        return;
+    }
+    tx_enabled = enable;
+}
+
+// --- Read-Ahead Ring Buffer Helpers ---
+static size_t ringbuf_fill_level(void) {
+    return AUDIO_PLAYBACK_RINGBUF_SIZE - xRingbufferGetCurFreeSize(playback_ringbuf);
+}
+
+// Drops up to `limit` bytes that are already in the ring, without waiting.
+static size_t ringbuf_discard(size_t limit) {
+    size_t dropped = 0;
+    while (dropped < limit) {
+        size_t item_size = 0;
+        void *item = xRingbufferReceiveUpTo(playback_ringbuf, &item_size, 0, limit - dropped);
+        if (!item) break;
+        vRingbufferReturnItem(playback_ringbuf, item);
+        dropped += item_size;
+    }
+    return dropped;
+}
 
-    bool fmt_found = false;
-    bool data_found = false;
+// Discards anything left in the ring, e.g. after a stop.
+static void ringbuf_flush(void) {
+    ringbuf_discard(AUDIO_PLAYBACK_RINGBUF_SIZE);
+}
+
+// Copies up to `len` bytes out of the ring. A byte ring can hand back a split
+// frame at its wrap point, so a short read keeps waiting until the block ends
+// on a frame boundary. Returns fewer than `len` bytes only if the ring ran dry
+// (an underrun if the reader is still going, the end of the track otherwise).
+static size_t ringbuf_read_block(uint8_t *dst, size_t len) {
+    size_t filled = 0;
+    while (filled < len) {
+        size_t item_size = 0;
+        uint8_t *item = (uint8_t *)xRingbufferReceiveUpTo(playback_ringbuf, &item_size, pdMS_TO_TICKS(RINGBUF_WAIT_MS), len - filled);
+        if (!item) {
+            bool stopped = (player_state != AUDIO_STATE_PLAYING && player_state != AUDIO_STATE_PAUSED);
+            bool drained = reader_finished && ringbuf_fill_level() == 0;
+            bool whole_frames = (filled % BUS_FRAME_BYTES == 0);
+            if (stopped || drained || whole_frames) break;
+            continue;
+        }
+        memcpy(dst + filled, item, item_size);
+        vRingbufferReturnItem(playback_ringbuf, item);
+        filled += item_size;
+    }
+    return filled;
+}
+
+// --- Audio Reader Task (producer) ---
+static bool reader_seek_requested(void) { return seek_generation.load() != reader_seek_gen; }
+
+// Pushes bus-format frames into the ring, waiting for room but giving up on a
+// stop request, a seek or when the track is skipped. Returns false if it gave up.
+static bool reader_push(const int16_t *frames, size_t count) {
+    const uint8_t *data = (const uint8_t *)frames;
+    const size_t len = count * BUS_FRAME_BYTES;
+    while (xRingbufferSend(playback_ringbuf, data, len, pdMS_TO_TICKS(RINGBUF_WAIT_MS)) != pdTRUE) {
+        if (reader_stop_requested || reader_seek_requested() || track_cancelled(reader_active_id)) return false;
+    }
+    reader_pushed_bytes += len;
+    return true;
+}
+
+// Resamples a block of 16-bit stereo frames to the bus rate and pushes the result.
+static bool reader_resample_and_push(const int16_t *in, size_t in_frames) {
+    static int16_t out[READER_OUT_FRAMES * AUDIO_MIXER_CHANNELS];
+    while (in_frames > 0) {
+        size_t consumed = 0;
+        size_t produced = audio_resampler_process(&reader_resampler, in, in_frames, out, READER_OUT_FRAMES, &consumed);
+        if (produced > 0 && !reader_push(out, produced)) return false;
+        in += consumed * AUDIO_MIXER_CHANNELS;
+        in_frames -= consumed;
+    }
+    return true;
+}
+
+// Drains the resampler's delay line so the last few milliseconds of a track are not lost.
+static void reader_flush_tail(void) {
+    size_t tail = audio_resampler_flush(&reader_resampler, reader_chunk, READER_CHUNK_FRAMES);
+    if (tail > 0) reader_push(reader_chunk, tail);
+}
+
+// Adds the file read time of the chunk just decoded (`frames` at `rate`) to the health counters.
+static void reader_health_record(size_t frames, uint32_t rate) {
+    const uint32_t generation = health_generation.load();
+    if (reader_health.generation != generation) {
+        memset(&reader_health, 0, sizeof(reader_health));
+        reader_health.generation = generation;
+    }
+    const uint32_t read_us = reader_decoder.read_us;
+    reader_decoder.read_us = 0;
+    audio_histogram_record(&reader_health.read_us, read_us);
+    if ((uint64_t)read_us * rate > (uint64_t)frames * 1000000) reader_health.read_stalls++;
+}
+
+// Announces the start of `entry` to the mixer, before the frame at
+// `first_frame` (in file frames) is pushed.
+static bool reader_push_mark(const playlist_entry_t *entry, uint32_t first_frame) {
+    const uint32_t rate = reader_decoder.sample_rate;
+    track_mark_t *mark = &next_reader_mark;
+    mark->id = entry->id;
+    mark->start_byte = reader_pushed_bytes;
+    mark->offset_bytes = (uint32_t)(((uint64_t)first_frame * AUDIO_OUTPUT_SAMPLE_RATE / rate) * BUS_FRAME_BYTES);
+    mark->seek_gen = reader_seek_gen;
+    mark->duration_s = reader_decoder.total_frames / rate;
+    memcpy(mark->path, entry->path, sizeof(mark->path));
+    while (xQueueSend(track_mark_queue, mark, pdMS_TO_TICKS(RINGBUF_WAIT_MS)) != pdTRUE) {
+        if (reader_stop_requested || reader_seek_requested()) return false;
+    }
+    return true;
+}
+
+// Moves the open file to `position_ms`. Returns the frame it continues from.
+static uint32_t reader_seek_decoder(uint32_t position_ms) {
+    uint64_t frame = (uint64_t)position_ms * reader_decoder.sample_rate / 1000;
+    if (reader_decoder.total_frames > 0 && frame > reader_decoder.total_frames) frame = reader_decoder.total_frames;
+    audio_decoder_seek(&reader_decoder, (uint32_t)frame);
+    return (uint32_t)frame;
+}
+
+// Adopts the latest seek request. A track the reader has already left is
+// replayed from the history, followed by the tracks that came after it.
+static void reader_take_seek(bool *tail_pending) {
+    reader_seek_gen = seek_generation.load();
+    const uint32_t id = seek_track_id.load();
+    for (uint32_t i = 0; i < reader_history_count; i++) {
+        if (reader_history[i].id != id) continue;
+        reader_replay_pos = i;
+        reader_replay_start_ms = seek_target_ms.load();
+        *tail_pending = false; // The end of a later track, which is dropped.
+        return;
+    }
+    ESP_LOGW(TAG, "Seek target is no longer available, continuing with the queue.");
+}
+
+static void reader_history_add(const playlist_entry_t *entry) {
+    if (reader_history_count == READER_HISTORY_LENGTH) {
+        memmove(&reader_history[0], &reader_history[1], (READER_HISTORY_LENGTH - 1) * sizeof(playlist_entry_t));
+        reader_history_count--;
+    }
+    reader_history[reader_history_count++] = *entry;
+    reader_replay_pos = reader_history_count;
+}
+
+// Takes the next track: a replay after a seek, or the next one in the queue.
+// With the queue empty it flushes the tail of the last track and keeps waiting
+// for more tracks while the mixer still has buffered audio, so a track added
+// before the end still follows without a gap. Returns false when the session
+// is over: stopped, or drained with nothing queued.
+static bool reader_next_track(playlist_entry_t *entry, uint32_t *start_ms, bool *tail_pending) {
+    while (true) {
+        if (reader_stop_requested) return false;
+        if (reader_seek_requested()) reader_take_seek(tail_pending);
+        if (reader_replay_pos < reader_history_count) {
+            *entry = reader_history[reader_replay_pos++];
+            *start_ms = reader_replay_start_ms;
+            reader_replay_start_ms = 0;
+            reader_finished = false;
+            return true;
+        }
+
+        xSemaphoreTake(playlist_mutex, portMAX_DELAY);
+        if (playlist_pop_locked(entry)) {
+            reader_finished = false;
+            xSemaphoreGive(playlist_mutex);
+            reader_history_add(entry);
+            reader_track_id = entry->id;
+            *start_ms = 0;
+            return true;
+        }
+        const bool over = !*tail_pending && ringbuf_fill_level() == 0;
+        if (over) session_active = false; // Under the mutex, so a concurrent queue_add() starts a new session.
+        xSemaphoreGive(playlist_mutex);
+        if (over) return false;
 
-    fp = fopen(current_filepath, "rb");
+        if (*tail_pending) {
+            reader_flush_tail();
+            *tail_pending = false;
+        }
+        reader_finished = true;
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(RINGBUF_WAIT_MS));
+    }
+}
+
+// Opens one track and streams it into the ring from `start_ms`. `tail_pending`
+// says whether the resampler still holds the end of the previous track, and on
+// return whether it holds the end of this one. A seek within the track is
+// handled here on the open file; a seek to another track ends it early.
+// Returns false if the file could not be played.
+static bool reader_play_track(const playlist_entry_t *entry, uint32_t start_ms, bool *tail_pending) {
+    FILE *fp = fopen(entry->path, "rb");
     if (!fp) {
-        ESP_LOGE(TAG, "Failed to open file: %s", current_filepath);
-        player_state = AUDIO_STATE_ERROR;
-        goto cleanup;
+        ESP_LOGE(TAG, "Failed to open file: %s", entry->path);
+        return false;
+    }
+    if (!audio_decoder_open(&reader_decoder, fp)) {
+        fclose(fp);
+        return false;
     }
 
-    memset(&wav_file_info, 0, sizeof(wav_format_info_t));
+    // Back-to-back tracks at the same rate keep the resampler state, exactly as
+    // if they were one stream. Otherwise the previous tail is flushed first.
+    const uint32_t rate = reader_decoder.sample_rate;
+    const bool continuous = *tail_pending && start_ms == 0 && reader_resampler.in_rate == rate;
+    if (*tail_pending && !continuous) reader_flush_tail();
+    *tail_pending = false;
 
-    char riff_header[4];
-    uint32_t file_size;
-    char wave_header[4];
-    
-    if (fread(riff_header, 1, 4, fp) != 4 || strncmp(riff_header, "RIFF", 4) != 0 ||
-        fread(&file_size, 1, 4, fp) != 4 ||
-        fread(wave_header, 1, 4, fp) != 4 || strncmp(wave_header, "WAVE", 4) != 0) {
-        ESP_LOGE(TAG, "Invalid RIFF/WAVE header.");
-        player_state = AUDIO_STATE_ERROR;
-        goto cleanup;
+    bool ok = continuous || audio_resampler_configure(&reader_resampler, rate, AUDIO_OUTPUT_SAMPLE_RATE);
+    if (!ok) ESP_LOGE(TAG, "Unsupported sample rate: %lu Hz", rate);
+
+    reader_active_id = entry->id;
+    const uint32_t first_frame = (ok && start_ms > 0) ? reader_seek_decoder(start_ms) : 0;
+    bool completed = ok && reader_push_mark(entry, first_frame);
+    while (completed) {
+        if (reader_stop_requested || track_cancelled(entry->id)) { completed = false; break; }
+        if (reader_seek_requested()) {
+            if (seek_track_id.load() != entry->id) { completed = false; break; } // See reader_take_seek().
+            reader_seek_gen = seek_generation.load();
+            const uint32_t frame = reader_seek_decoder(seek_target_ms.load());
+            audio_resampler_reset(&reader_resampler);
+            reader_push_mark(entry, frame);
+            continue;
+        }
+        size_t frames = audio_decoder_read(&reader_decoder, reader_chunk, READER_CHUNK_FRAMES);
+        reader_health_record(frames, rate);
+        if (frames > 0 && !reader_resample_and_push(reader_chunk, frames)) continue; // Stopped, skipped or seeking: see above.
+        if (frames < READER_CHUNK_FRAMES) break; // End of the stream.
     }
-    
-    while (!data_found) {
-        char chunk_id[4];
-        uint32_t chunk_size;
-
-        if (fread(chunk_id, 1, 4, fp) != 4 || fread(&chunk_size, 1, 4, fp) != 4) {
-            ESP_LOGE(TAG, "Reached end of file or read error while searching for chunks.");
-            player_state = AUDIO_STATE_ERROR;
-            goto cleanup;
+    if (reader_decoder.error) {
+        ESP_LOGE(TAG, "Decoding '%s' failed.", entry->path);
+        completed = false;
+        ok = false;
+    }
+    *tail_pending = completed;
+
+    audio_decoder_close(&reader_decoder);
+    fclose(fp);
+    return ok;
+}
+
+// Long-lived task. For each session it takes the queued tracks one by one,
+// opens and parses them, then decodes them block by block into the ring buffer,
+// running ahead of the mixer so SD latency spikes never stall the output. The
+// next track is opened as soon as the previous one has been pushed, so its
+// first frames are already buffered when the mixer reaches the end of the
+// previous one. Decoding and sample-rate conversion happen here too, so the
+// mixer only ever sees bus frames. All SD access for playback happens here.
+static void audio_reader_task(void *arg) {
+    static playlist_entry_t entry;
+
+    while (true) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        if (!reader_start_requested) continue; // A stale wake-up from the queue API.
+        reader_start_requested = false;
+        reader_pushed_bytes = 0;
+        reader_seek_gen = seek_generation.load();
+        reader_history_count = 0;
+        reader_replay_pos = 0;
+
+        uint32_t played = 0, failed = 0;
+        uint32_t start_ms = 0;
+        bool tail_pending = false;
+        while (reader_next_track(&entry, &start_ms, &tail_pending)) {
+            if (track_cancelled(entry.id)) continue;
+            if (reader_play_track(&entry, start_ms, &tail_pending)) played++;
+            else failed++;
         }
+        if (played == 0 && failed > 0) player_state = AUDIO_STATE_ERROR;
 
-        if (strncmp(chunk_id, "fmt ", 4) == 0) {
-            ESP_LOGD(TAG, "Found 'fmt ' chunk, size: %lu", chunk_size);
-            if (chunk_size < 16) {
-                ESP_LOGE(TAG, "Invalid 'fmt ' chunk size: %lu", chunk_size);
-                player_state = AUDIO_STATE_ERROR;
-                goto cleanup;
-            }
-            fread(&wav_file_info, 1, 16, fp);
-            
-            if (chunk_size > 16) {
-                fseek(fp, chunk_size - 16, SEEK_CUR);
+        reader_finished = true;
+        reader_done = true;
+        xSemaphoreGive(reader_idle_sem);
+    }
+}
+
+// --- Mixer: Sound Effect Voices ---
+static bool any_effect_active(void) {
+    for (int i = 0; i < EFFECT_VOICES; i++) {
+        if (effect_voices[i].active) return true;
+    }
+    return false;
+}
+
+// Moves queued effect requests onto free voices. When all voices are busy the
+// one that has played the longest is cut to make room for the new sound.
+static void accept_effect_requests(void) {
+    effect_request_t request;
+    while (xQueueReceive(effect_queue, &request, 0) == pdTRUE) {
+        int slot = -1;
+        for (int i = 0; i < EFFECT_VOICES && slot < 0; i++) {
+            if (!effect_voices[i].active) slot = i;
+        }
+        if (slot < 0) {
+            slot = 0;
+            for (int i = 1; i < EFFECT_VOICES; i++) {
+                if (effect_voices[i].pos > effect_voices[slot].pos) slot = i;
             }
-            fmt_found = true;
-        } else if (strncmp(chunk_id, "data", 4) == 0) {
-            ESP_LOGD(TAG, "Found 'data' chunk, size: %lu", chunk_size);
-            wav_file_info.data_size = chunk_size;
-            data_found = true;
-        } else {
-            char id_str[5] = {0};
-            strncpy(id_str, chunk_id, 4);
-            ESP_LOGI(TAG, "Skipping unknown chunk '%s' of size %lu", id_str, chunk_size);
-            fseek(fp, chunk_size, SEEK_CUR);
+            ESP_LOGW(TAG, "All %d effect voices busy, replacing voice %d.", EFFECT_VOICES, slot);
+            effects_in_flight--;
         }
-    }
 
-    if (!fmt_found || !data_found) {
-        ESP_LOGE(TAG, "Could not find essential 'fmt ' and 'data' chunks.");
-        player_state = AUDIO_STATE_ERROR;
-        goto cleanup;
+        audio_mixer_voice_start(&effect_voices[slot], request.clip.data, &request.clip.format, request.gain_q15);
+        if (!effect_voices[slot].active) {
+            ESP_LOGE(TAG, "Effect '%s' has an unsupported format.", request.clip.name);
+            effects_in_flight--;
+            continue;
+        }
+        ESP_LOGD(TAG, "Effect '%s' on voice %d, %lld us after request.", request.clip.name, slot,
+                 esp_timer_get_time() - request.request_time_us);
     }
+}
+
+// --- Mixer: Background Voice ---
+// Makes `mark` the current background track. `gap_frames` is the silence that
+// was played since the previous track, if there was one.
+static void begin_track(const track_mark_t *mark, bool first, uint32_t gap_frames) {
+    playing_track_id = mark->id;
+    track_start_byte = mark->start_byte;
+    track_offset_bytes = mark->offset_bytes;
+    strncpy(current_filepath, mark->path, sizeof(current_filepath) - 1);
+    current_filepath[sizeof(current_filepath) - 1] = '\0';
+    song_duration_s = mark->duration_s;
+    total_bytes_played = mark->offset_bytes;
 
-    ESP_LOGI(TAG, "WAV Info: SR=%lu, BPS=%u, CH=%u, Data Size=%lu", 
-             wav_file_info.sample_rate, wav_file_info.bits_per_sample, 
-             wav_file_info.num_channels, wav_file_info.data_size);
-    if (wav_file_info.byte_rate > 0) {
-        song_duration_s = wav_file_info.data_size / wav_file_info.byte_rate;
+    memset(&playback_stats, 0, sizeof(playback_stats));
+    playback_stats.ring_size_bytes = AUDIO_PLAYBACK_RINGBUF_SIZE;
+    playback_stats.min_fill_bytes = AUDIO_PLAYBACK_RINGBUF_SIZE;
+    if (first) {
+        ESP_LOGI(TAG, "Starting playback of '%s'... Duration: %lu s", current_filepath, song_duration_s);
     } else {
-        ESP_LOGE(TAG, "Byte rate is zero, cannot calculate duration.");
-        player_state = AUDIO_STATE_ERROR;
-        goto cleanup;
+        playback_stats.transition_gap_us = (uint32_t)(((uint64_t)gap_frames * 1000000) / AUDIO_OUTPUT_SAMPLE_RATE);
+        ESP_LOGI(TAG, "Next track '%s'... Duration: %lu s, gap %lu us", current_filepath, song_duration_s,
+                 playback_stats.transition_gap_us);
     }
+}
 
-    chan_cfg = I2S_CHANNEL_DEFAULT_CONFIG(I2S_NUM_0, I2S_ROLE_MASTER);
-    ESP_ERROR_CHECK(i2s_new_channel(&chan_cfg, &tx_chan, NULL));
+static void start_background(void) {
+    background_start_requested = false;
+    background_active = true;
+    background_rebuffering = true; // Prefill the ring before the first block.
+    background_first_write_done = false;
+    background_below_low_watermark = false;
+    background_expect_dry = false;
+    background_seek_landed = false;
+    background_silent_frames = 0;
+    background_gain_q15 = any_effect_active() ? DUCK_GAIN_Q15 : AUDIO_MIXER_UNITY_GAIN;
+    stream_consumed_bytes = 0;
+    next_mark_loaded = false;
 
-    std_cfg = {};
-    std_cfg.clk_cfg.sample_rate_hz = wav_file_info.sample_rate;
-    std_cfg.clk_cfg.clk_src = I2S_CLK_SRC_DEFAULT;
-    std_cfg.clk_cfg.mclk_multiple = I2S_MCLK_MULTIPLE_256;
-    
-    std_cfg.slot_cfg.data_bit_width = (i2s_data_bit_width_t)wav_file_info.bits_per_sample;
-    std_cfg.slot_cfg.slot_bit_width = I2S_SLOT_BIT_WIDTH_AUTO;
-    std_cfg.slot_cfg.slot_mode = (wav_file_info.num_channels == 2) ? I2S_SLOT_MODE_STEREO : I2S_SLOT_MODE_MONO;
-    std_cfg.slot_cfg.slot_mask = I2S_STD_SLOT_BOTH;
-    std_cfg.slot_cfg.ws_width = (i2s_data_bit_width_t)wav_file_info.bits_per_sample;
-    std_cfg.slot_cfg.ws_pol = false; 
-    std_cfg.slot_cfg.bit_shift = false; 
-    std_cfg.slot_cfg.left_align = true;
-    std_cfg.slot_cfg.big_endian = false; 
-    std_cfg.slot_cfg.bit_order_lsb = false;
-    
-    std_cfg.gpio_cfg.mclk = I2S_GPIO_UNUSED; 
-    std_cfg.gpio_cfg.bclk = I2S_SPEAKER_BCLK_PIN; 
-    std_cfg.gpio_cfg.ws = I2S_SPEAKER_WS_PIN;
-    std_cfg.gpio_cfg.dout = I2S_SPEAKER_DOUT_PIN; 
-    std_cfg.gpio_cfg.din = I2S_GPIO_UNUSED;
-    std_cfg.gpio_cfg.invert_flags = {.mclk_inv = false, .bclk_inv = false, .ws_inv = false};
-
-    ESP_ERROR_CHECK(i2s_channel_init_std_mode(tx_chan, &std_cfg));
-    ESP_ERROR_CHECK(i2s_channel_enable(tx_chan));
-
-    buffer = (uint8_t*)malloc(buffer_size);
-    size_t bytes_read, bytes_written;
-    total_bytes_played = 0;
-
-    reset_hpf_state();
-    last_known_volume_for_hpf = 0;
-    
-    ESP_LOGI(TAG, "Starting playback... Duration: %lu s", song_duration_s);
-    
-    while (total_bytes_played < wav_file_info.data_size && player_state != AUDIO_STATE_STOPPED) {
-        if (player_state == AUDIO_STATE_PAUSED) { vTaskDelay(pdMS_TO_TICKS(100)); continue; }
-        
-        bytes_read = fread(buffer, 1, buffer_size, fp);
-        if (bytes_read == 0) {
-            if (ferror(fp)) {
-                ESP_LOGE(TAG, "File read error: %s", strerror(errno));
-                player_state = AUDIO_STATE_ERROR;
-            }
-            break;
+    audio_dsp_chain_reset(&output_chain);
+    if (spectrum) audio_spectrum_reset(spectrum);
+
+    track_mark_t first;
+    xQueueReceive(track_mark_queue, &first, 0); // update_background() has seen it.
+    stream_seek_gen = first.seek_gen;
+    begin_track(&first, true, 0);
+}
+
+static void end_background(void) {
+    // The reader owns the files until it signals idle, so this must not time out.
+    reader_stop_requested = true;
+    xSemaphoreTake(reader_idle_sem, portMAX_DELAY);
+    xSemaphoreGive(reader_idle_sem);
+    ringbuf_flush();
+    xQueueReset(track_mark_queue);
+    next_mark_loaded = false;
+    playing_track_id = 0;
+
+    if (background_active && (playback_stats.underruns > 0 || playback_stats.low_watermark_hits > 0)) {
+        ESP_LOGW(TAG, "Playback stats: %lu underruns, %lu low-watermark hits, min fill %lu/%lu bytes",
+                 playback_stats.underruns, playback_stats.low_watermark_hits,
+                 playback_stats.min_fill_bytes, playback_stats.ring_size_bytes);
+    }
+    background_active = false;
+    background_start_requested = false;
+
+    xSemaphoreTake(playlist_mutex, portMAX_DELAY);
+    session_active = false;
+    xSemaphoreGive(playlist_mutex);
+
+    if (player_state != AUDIO_STATE_ERROR) {
+        player_state = AUDIO_STATE_STOPPED;
+    }
+    current_filepath[0] = '\0'; // Always clear the path when a track ends.
+    xSemaphoreGive(background_idle_sem);
+}
+
+// Handles start and stop transitions of the background track between blocks.
+static void update_background(void) {
+    const bool start_requested = background_start_requested;
+    const bool wanted = (player_state == AUDIO_STATE_PLAYING || player_state == AUDIO_STATE_PAUSED);
+    if (start_requested) {
+        const bool announced = uxQueueMessagesWaiting(track_mark_queue) > 0;
+        if (!wanted || (reader_done && !announced)) {
+            end_background(); // Stopped before it started, or no file could be opened.
+        } else if (announced) {
+            start_background();
         }
+    } else if (background_active && !wanted) {
+        end_background();
+    }
+}
 
-        uint8_t current_physical_vol = audio_manager_get_volume();
-        hpf_active = (current_physical_vol >= HIGH_PASS_FILTER_THRESHOLD && wav_file_info.bits_per_sample == 16);
+// Whether the buffered stream is not to be played: the track was skipped or
+// cleared, or a seek was requested and its restart has not been reached yet.
+static bool background_stream_stale(void) {
+    return stream_seek_gen != seek_generation.load() || track_cancelled(playing_track_id.load());
+}
 
-        if (hpf_active) {
-            if (current_physical_vol != last_known_volume_for_hpf) {
-                float cutoff = map_range(current_physical_vol, HIGH_PASS_FILTER_THRESHOLD, MAX_VOLUME_PERCENTAGE, HPF_MIN_CUTOFF_FREQ, HPF_MAX_CUTOFF_FREQ);
-                calculate_lr4_hpf_coeffs(cutoff, (float)wav_file_info.sample_rate);
-                last_known_volume_for_hpf = current_physical_vol;
-            }
-            int16_t *samples = (int16_t *)buffer;
-            size_t num_samples = bytes_read / sizeof(int16_t);
-
-            if (wav_file_info.num_channels == 1) {
-                for (size_t i = 0; i < num_samples; i++) {
-                    int16_t stage1_out = apply_biquad_filter(&hpf_state.stages[0].left, &hpf_coeffs.stage[0], samples[i]);
-                    samples[i] = apply_biquad_filter(&hpf_state.stages[1].left, &hpf_coeffs.stage[1], stage1_out);
-                }
-            } else { 
-                for (size_t i = 0; i < num_samples; i += 2) {
-                    int16_t stage1_out_l = apply_biquad_filter(&hpf_state.stages[0].left, &hpf_coeffs.stage[0], samples[i]);
-                    samples[i] = apply_biquad_filter(&hpf_state.stages[1].left, &hpf_coeffs.stage[1], stage1_out_l);
-                    
-                    int16_t stage1_out_r = apply_biquad_filter(&hpf_state.stages[0].right, &hpf_coeffs.stage[0], samples[i+1]);
-                    samples[i+1] = apply_biquad_filter(&hpf_state.stages[1].right, &hpf_coeffs.stage[1], stage1_out_r);
-                }
+// Switches to the next track once the stream reaches its first byte, and drops
+// whatever is buffered of a track that was skipped or cleared, or that a seek
+// has made obsolete.
+static void advance_track(bool at_block_start) {
+    while (true) {
+        if (!next_mark_loaded) next_mark_loaded = (xQueueReceive(track_mark_queue, &next_mark, 0) == pdTRUE);
+        if (next_mark_loaded && stream_consumed_bytes >= next_mark.start_byte) {
+            const uint32_t generation = seek_generation.load();
+            if (next_mark.seek_gen != generation) {
+                // Sent before the latest seek: the reader sends the track again if it is still wanted.
+            } else if (track_cancelled(next_mark.id)) {
+                stream_seek_gen = generation;
+                playing_track_id = next_mark.id; // Cleared from the queue: dropped below, never announced.
+            } else if (stream_seek_gen != generation && next_mark.id == playing_track_id.load()) {
+                // The restart of a seek within the playing track.
+                stream_seek_gen = generation;
+                track_start_byte = next_mark.start_byte;
+                track_offset_bytes = next_mark.offset_bytes;
+                background_expect_dry = true;
+                background_below_low_watermark = true; // The refill is not a low-watermark hit.
+                background_seek_landed = true;
+            } else {
+                stream_seek_gen = generation;
+                begin_track(&next_mark, false, at_block_start ? background_silent_frames : 0);
             }
+            next_mark_loaded = false;
+            continue;
         }
-        
-        if (visualizer_queue != NULL && wav_file_info.bits_per_sample == 16) {
-            visualizer_data_t viz_data;
-            int16_t* samples = (int16_t*)buffer;
-            size_t num_samples = bytes_read / sizeof(int16_t);
-            size_t samples_per_bar = num_samples / VISUALIZER_BAR_COUNT;
-            if (samples_per_bar > 0) {
-                for (int i = 0; i < VISUALIZER_BAR_COUNT; i++) {
-                    int32_t peak = 0;
-                    for (size_t j = i * samples_per_bar; j < (i + 1) * samples_per_bar; j++) {
-                        int16_t val = abs(samples[j]);
-                        if (val > peak) peak = val;
-                    }
-                    float log_val = log10f((float)peak + 1.0f);
-                    float calculated_height = (log_val / 4.5f) * 255.0f;
-                    viz_data.bar_values[i] = (calculated_height > 255.0f) ? 255 : (uint8_t)calculated_height;
-                }
-                xQueueOverwrite(visualizer_queue, &viz_data);
-            }
+        if (!background_stream_stale()) return;
+
+        const size_t limit = next_mark_loaded ? (size_t)(next_mark.start_byte - stream_consumed_bytes) : AUDIO_PLAYBACK_RINGBUF_SIZE;
+        const size_t dropped = ringbuf_discard(limit);
+        stream_consumed_bytes += dropped;
+        if (dropped < limit) return; // The rest of it is not in the ring yet.
+    }
+}
+
+// Reads up to `len` bytes of the background stream. A block that spans the end
+// of one track and the start of the next gets both, so queued tracks join
+// without a gap.
+static size_t read_background_block(uint8_t *dst, size_t len) {
+    size_t filled = 0;
+    while (filled < len) {
+        advance_track(filled == 0);
+        if (background_stream_stale()) break; // Nothing to play until the next mark arrives.
+        size_t chunk = len - filled;
+        if (next_mark_loaded && next_mark.start_byte - stream_consumed_bytes < chunk) {
+            chunk = (size_t)(next_mark.start_byte - stream_consumed_bytes);
         }
-        
-        float local_volume_factor = 0.0f;
-        if (volume_mutex && xSemaphoreTake(volume_mutex, portMAX_DELAY) == pdTRUE) {
-            local_volume_factor = volume_factor;
-            xSemaphoreGive(volume_mutex);
+        const size_t n = ringbuf_read_block(dst + filled, chunk);
+        filled += n;
+        stream_consumed_bytes += n;
+        if (n < chunk) break;
+    }
+    return filled;
+}
+
+// Mixes the next block of the background track into the accumulator.
+// Returns true if any of its samples were mixed.
+static bool mix_background(int32_t *acc, bool effects_active) {
+    if (!background_active || player_state != AUDIO_STATE_PLAYING) return false;
+
+    if (background_rebuffering) {
+        // A stale stream is not waited for: it is dropped right away to make room for the restart.
+        if (!reader_finished && !background_stream_stale() && ringbuf_fill_level() < AUDIO_PLAYBACK_HIGH_WATERMARK) {
+            background_silent_frames += MIXER_BLOCK_FRAMES;
+            return false;
         }
+        background_rebuffering = false;
+    }
 
-        if (local_volume_factor < 0.999f) {
-            if (wav_file_info.bits_per_sample == 16) {
-                int16_t *samples = (int16_t *)buffer;
-                for (size_t i = 0; i < bytes_read / 2; i++) samples[i] = (int16_t)((float)samples[i] * local_volume_factor);
-            } else if (wav_file_info.bits_per_sample == 8) {
-                for (size_t i = 0; i < bytes_read; i++) buffer[i] = (uint8_t)((float)(buffer[i] - 128) * local_volume_factor) + 128;
-            }
+    const size_t wanted_bytes = MIXER_BLOCK_FRAMES * BUS_FRAME_BYTES;
+    const int64_t read_start = esp_timer_get_time();
+    size_t bytes_read = read_background_block((uint8_t *)mixer_buffers->voice, wanted_bytes);
+    mixer_health.block_ring_us = (uint32_t)(esp_timer_get_time() - read_start);
+    if (bytes_read < wanted_bytes && !reader_finished && player_state == AUDIO_STATE_PLAYING) {
+        // The ring ran dry while the reader is still working. Unless it was waiting
+        // for a track added late, skipping one or seeking, the SD card fell behind.
+        if (!background_expect_dry && !background_stream_stale()) {
+            playback_stats.underruns++;
+            mixer_health.underruns++;
+            ESP_LOGW(TAG, "Playback underrun #%lu (got %d of %d bytes). Rebuffering...",
+                     playback_stats.underruns, (int)bytes_read, (int)wanted_bytes);
         }
-        
-        i2s_channel_write(tx_chan, buffer, bytes_read, &bytes_written, portMAX_DELAY);
-        if (bytes_written < bytes_read) {
-             ESP_LOGW(TAG, "I2S buffer full. Wrote %d of %d bytes.", bytes_written, bytes_read);
+        background_rebuffering = true;
+    }
+    const size_t frames = bytes_read / BUS_FRAME_BYTES;
+    background_silent_frames = (frames > 0 ? 0 : background_silent_frames) + (MIXER_BLOCK_FRAMES - frames);
+    if (frames == 0) {
+        if (reader_finished) {
+            background_expect_dry = true;
+            if (reader_done) end_background(); // End of the last track (any trailing partial frame is dropped).
         }
-        total_bytes_played += bytes_written;
+        return false;
     }
+    background_expect_dry = false;
 
-cleanup:
-    ESP_LOGI(TAG, "Playback task entering cleanup.");
-    if (buffer) free(buffer);
-    if (fp) fclose(fp);
-    if (tx_chan) {
-        i2s_channel_disable(tx_chan);
-        i2s_del_channel(tx_chan);
-        tx_chan = NULL;
+    size_t fill = ringbuf_fill_level();
+    if (fill < playback_stats.min_fill_bytes && !reader_finished) playback_stats.min_fill_bytes = fill;
+    if (fill < AUDIO_PLAYBACK_LOW_WATERMARK && !reader_finished) {
+        if (!background_below_low_watermark) playback_stats.low_watermark_hits++;
+        background_below_low_watermark = true;
+    } else {
+        background_below_low_watermark = false;
     }
-    
-    if (player_state != AUDIO_STATE_ERROR) {
-        player_state = AUDIO_STATE_STOPPED;
+
+    // Duck under effects: fast attack within this block, slower release.
+    const int32_t target = effects_active ? DUCK_GAIN_Q15 : AUDIO_MIXER_UNITY_GAIN;
+    int32_t next_gain = target;
+    if (target > background_gain_q15 && target - background_gain_q15 > DUCK_RELEASE_STEP_Q15) {
+        next_gain = background_gain_q15 + DUCK_RELEASE_STEP_Q15;
+    }
+
+    audio_mixer_accumulate_ramp(acc, mixer_buffers->voice, frames, background_gain_q15, next_gain);
+    background_gain_q15 = next_gain;
+    total_bytes_played = (uint32_t)(stream_consumed_bytes - track_start_byte) + track_offset_bytes;
+    return true;
+}
+
+// --- Mixer: Health Counters ---
+static void mixer_health_begin_block(void) {
+    const uint32_t generation = health_generation.load();
+    if (mixer_health.generation != generation) {
+        memset(&mixer_health, 0, sizeof(mixer_health));
+        mixer_health.generation = generation;
+    }
+    mixer_health.block_ring_us = 0;
+}
+
+// Records one block. The mixer counts as busy from `block_start` to the I2S
+// write, except for ring reads: those only wait when the ring is empty, which
+// is counted as an underrun instead.
+static void mixer_health_end_block(int64_t block_start, int64_t dsp_start, int64_t write_start, int64_t write_end) {
+    audio_histogram_record(&mixer_health.dsp_us, (uint32_t)(write_start - dsp_start));
+    audio_histogram_record(&mixer_health.i2s_write_us, (uint32_t)(write_end - write_start));
+    int64_t busy = write_start - block_start - mixer_health.block_ring_us;
+    if (busy < 0) busy = 0;
+    if ((uint32_t)busy > mixer_health.peak_busy_us) mixer_health.peak_busy_us = (uint32_t)busy;
+    mixer_health.busy_total_us += (uint64_t)busy;
+    mixer_health.blocks++;
+}
+
+// --- Mixer: Output Stage ---
+// Runs the mixed block through the output chain (speaker-protection HPF,
+// visualizer tap, volume and peak limiter, in one pass) and hands it to I2S. Nothing here
+// takes a lock: volume changes reach the chain through its atomics.
+static void process_and_write_block(const int32_t *acc, int64_t block_start) {
+    const int64_t dsp_start = esp_timer_get_time();
+    int16_t *out = mixer_buffers->out;
+    int16_t *tap = (visualizer_queue != NULL && spectrum != NULL) ? mixer_buffers->tap : NULL;
+    audio_dsp_chain_process(&output_chain, acc, out, tap, MIXER_BLOCK_FRAMES);
+
+    // The analyzer decides when a new frame is due (AUDIO_SPECTRUM_RATE_HZ), not the block size.
+    if (tap) {
+        visualizer_data_t viz_data;
+        if (audio_spectrum_push(spectrum, tap, MIXER_BLOCK_FRAMES, viz_data.bar_values)) {
+            xQueueOverwrite(visualizer_queue, &viz_data);
+        }
+    }
+
+    size_t bytes_written = 0;
+    const int64_t write_start = esp_timer_get_time();
+    i2s_channel_write(tx_chan, out, MIXER_BLOCK_SAMPLES * sizeof(int16_t), &bytes_written, portMAX_DELAY);
+    mixer_health_end_block(block_start, dsp_start, write_start, esp_timer_get_time());
+    if (bytes_written < MIXER_BLOCK_SAMPLES * sizeof(int16_t)) {
+         mixer_health.short_writes++;
+         ESP_LOGW(TAG, "I2S buffer full. Wrote %d of %d bytes.", (int)bytes_written, (int)(MIXER_BLOCK_SAMPLES * sizeof(int16_t)));
+    }
+}
+
+// Plays out the last frames still held in the limiter's look-ahead by running
+// one look-ahead of silence through the chain, then clears the chain so
+// nothing of this sound is left to precede the next one.
+static void drain_output_chain(void) {
+    int32_t *acc = mixer_buffers->acc;
+    int16_t *out = mixer_buffers->out;
+    memset(acc, 0, AUDIO_DSP_LIMITER_LOOKAHEAD * AUDIO_MIXER_CHANNELS * sizeof(int32_t));
+    audio_dsp_chain_process(&output_chain, acc, out, NULL, AUDIO_DSP_LIMITER_LOOKAHEAD);
+
+    size_t bytes_written = 0;
+    i2s_channel_write(tx_chan, out, AUDIO_DSP_LIMITER_LOOKAHEAD * AUDIO_MIXER_CHANNELS * sizeof(int16_t),
+                      &bytes_written, portMAX_DELAY);
+    audio_dsp_chain_reset(&output_chain);
+}
+
+// --- Audio Mixer Task ---
+// Long-lived task: sleeps until there is something to play, then produces one
+// bus block per iteration for as long as the background track or any effect
+// is active. The TX channel is only enabled while blocks are being produced.
+static void audio_mixer_task(void *arg) {
+    while (true) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        bool blocks_written = false;
+        while (true) {
+            accept_effect_requests();
+            update_background();
+
+            const bool effects_active = any_effect_active();
+            const bool background_audible = background_active && player_state == AUDIO_STATE_PLAYING;
+            if (!effects_active && !background_audible && !background_start_requested) break;
+            tx_set_enabled(true);
+
+            mixer_health_begin_block();
+            const int64_t block_start = esp_timer_get_time();
+            int32_t *acc = mixer_buffers->acc;
+            memset(acc, 0, sizeof(mixer_buffers->acc));
+            const bool background_mixed = mix_background(acc, effects_active);
+
+            for (int i = 0; i < EFFECT_VOICES; i++) {
+                audio_mixer_voice_t *voice = &effect_voices[i];
+                if (!voice->active) continue;
+                size_t frames = audio_mixer_voice_render(voice, mixer_buffers->voice, MIXER_BLOCK_FRAMES);
+                audio_mixer_accumulate(acc, mixer_buffers->voice, frames * AUDIO_MIXER_CHANNELS, voice->gain_q15);
+                if (!voice->active) effects_in_flight--;
+            }
+
+            process_and_write_block(acc, block_start);
+            blocks_written = true;
+
+            if (background_mixed && !background_first_write_done) {
+                background_first_write_done = true;
+                playback_stats.time_to_first_sample_us = (uint32_t)(esp_timer_get_time() - play_request_time_us);
+                ESP_LOGI(TAG, "Time to first sample: %lu us", playback_stats.time_to_first_sample_us);
+            }
+            if (background_mixed && background_seek_landed) {
+                background_seek_landed = false;
+                playback_stats.seek_latency_us = (uint32_t)(esp_timer_get_time() - seek_request_time_us);
+                ESP_LOGI(TAG, "Seek to %lu ms, latency %lu us", seek_target_ms.load(), playback_stats.seek_latency_us);
+            }
+        }
+
+        if (blocks_written) drain_output_chain();
+        tx_set_enabled(false);
     }
-    current_filepath[0] = '\0'; // Always clear the path when task exits.
-    playback_task_handle = NULL;
-    xSemaphoreGive(playback_task_terminated_sem);
-    ESP_LOGI(TAG, "Playback task self-deleting.");
-    vTaskDelete(NULL);
-}
\ No newline at end of file
+}
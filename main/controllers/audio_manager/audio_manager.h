@@ -2,9 +2,17 @@
  * @file audio_manager.h
  * @brief Manages audio playback of WAV files using the I2S peripheral.
  *
- * This controller runs playback in a dedicated FreeRTOS task, providing non-blocking
- * control. It features safe volume limits, dynamic frequency filtering to reduce
- * distortion on small speakers, and provides data for a real-time visualizer.
+ * This controller runs playback in dedicated FreeRTOS tasks, providing non-blocking
+ * control: a reader task streams the file into a PSRAM ring buffer and a mixer task
+ * feeds I2S from it, so SD card stalls do not reach the speaker. The mixer plays one
+ * background track (music, voice notes) plus several short effects from a PSRAM sound
+ * bank at the same time, ducking the track while an effect plays. Both tasks and the
+ * I2S TX channel are created once at init and reused. The channel always runs at
+ * AUDIO_OUTPUT_SAMPLE_RATE: tracks of any other rate go through a polyphase
+ * resampler in the reader task, so it is never reclocked. Tracks can be queued for gapless
+ * playback and seeked to any frame. It features safe volume limits, dynamic
+ * frequency filtering and a look-ahead peak limiter to reduce distortion on small speakers, and provides a
+ * fixed-point FFT spectrum (~30 Hz) for a real-time visualizer.
  */
 #ifndef AUDIO_MANAGER_H
 #define AUDIO_MANAGER_H
@@ -13,6 +21,8 @@
 #include <stdint.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/queue.h"
+#include "audio_sound_bank.h"
+#include "audio_health.h"
 
 /**
  * @brief Maximum number of bars for the audio visualizer data.
@@ -32,11 +42,43 @@ typedef enum {
 
 /**
  * @brief Data structure for visualizer data sent via queue.
+ * Each bar is the level (0-255, log scale over ~72 dB) of one log-spaced
+ * frequency band, lowest band first.
  */
 typedef struct {
     uint8_t bar_values[VISUALIZER_BAR_COUNT];
 } visualizer_data_t;
 
+/**
+ * @brief Health counters of the read-ahead buffer for the current (or last) track.
+ */
+typedef struct {
+    uint32_t underruns;          //!< Times the I2S writer found the ring empty before the reader was done.
+    uint32_t low_watermark_hits; //!< Times the ring fill dropped below AUDIO_PLAYBACK_LOW_WATERMARK.
+    uint32_t min_fill_bytes;     //!< Lowest ring fill level seen while the reader was still running.
+    uint32_t ring_size_bytes;    //!< Configured ring size (AUDIO_PLAYBACK_RINGBUF_SIZE).
+    uint32_t time_to_first_sample_us; //!< Time from audio_manager_play() to the first I2S write (0 for a queued track).
+    uint32_t transition_gap_us;  //!< Silence between the previous queued track and this one (0 = gapless).
+    uint32_t seek_latency_us;    //!< Time from the last seek request to the first I2S write from the new position.
+} audio_playback_stats_t;
+
+/**
+ * @brief Health counters of the whole playback pipeline since init or the last
+ * audio_manager_reset_health(), across all tracks and sound effects.
+ */
+typedef struct {
+    audio_histogram_t read_us;       //!< Time the reader spent in fread() per decoded chunk.
+    audio_histogram_t dsp_us;        //!< Output chain and spectrum time per mixer block.
+    audio_histogram_t i2s_write_us;  //!< Time the mixer was blocked in the I2S write per block.
+    uint32_t blocks;                 //!< Mixer blocks written to I2S.
+    uint32_t underruns;              //!< Times the I2S writer found the ring empty before the reader was done.
+    uint32_t read_stalls;            //!< Chunks whose fread() took longer than the audio they hold.
+    uint32_t short_writes;           //!< I2S writes that took fewer bytes than offered.
+    uint32_t block_period_us;        //!< Audio duration of one mixer block.
+    uint32_t peak_cpu_load_permille; //!< Highest share of a block period the mixer task was busy (1000 = real time).
+    uint32_t avg_cpu_load_permille;  //!< Mean share of a block period the mixer task was busy.
+} audio_health_t;
+
 
 /**
  * @brief Initializes the audio manager. Must be called once at startup.
@@ -44,23 +86,95 @@ typedef struct {
 void audio_manager_init(void);
 
 /**
- * @brief Starts playback of a WAV file in a new FreeRTOS task.
- * If another track is playing, it will be stopped first.
+ * @brief Starts playback of a WAV file as the background track.
+ * If another track is playing, it will be stopped first and the playback queue
+ * is cleared. Sound effects that are playing are not affected.
  * @param filepath Full path to the .wav file on the filesystem.
- * @return true if the playback task was created, false on error.
+ * @return true if playback was started, false on error.
  */
 bool audio_manager_play(const char *filepath);
 
-/** @brief Pauses the current audio playback. */
+/**
+ * @brief Adds a file to the end of the playback queue.
+ *
+ * Queued tracks play back to back with no gap: as soon as one track has been
+ * read, the next file is opened and its first frames are buffered while the
+ * current one drains. If nothing is playing, playback starts with this file.
+ * A file that cannot be opened is skipped.
+ *
+ * @param filepath Full path to the audio file on the filesystem.
+ * @return true if the file was queued, false if the queue is full (AUDIO_PLAYBACK_QUEUE_LENGTH).
+ */
+bool audio_manager_queue_add(const char *filepath);
+
+/**
+ * @brief Ends the current track and moves on to the next queued one, or stops
+ * if the queue is empty.
+ * @return false if nothing is playing.
+ */
+bool audio_manager_queue_skip(void);
+
+/** @brief Removes all queued tracks. The current track keeps playing. */
+void audio_manager_queue_clear(void);
+
+/** @brief Gets the number of tracks queued after the current one. */
+uint32_t audio_manager_queue_length(void);
+
+/**
+ * @brief Plays a preloaded effect from the sound bank on top of the background track.
+ *
+ * No file I/O is involved, so this also works while the SD card is absent or
+ * unmounted. The background track keeps playing, ducked to AUDIO_MIXER_DUCK_PERCENT
+ * while the effect lasts. If all effect voices are busy, the oldest one is replaced.
+ *
+ * @param id The effect to play.
+ * @return true if the effect was queued, false if it or the pipeline is not available.
+ */
+bool audio_manager_play_sound(audio_sound_id_t id);
+
+/**
+ * @brief Same as audio_manager_play_sound(), with a gain for this voice.
+ * @param id The effect to play.
+ * @param gain_percent Voice gain (0-100), applied before the master volume.
+ * @return true if the effect was queued, false if it or the pipeline is not available.
+ */
+bool audio_manager_play_sound_with_gain(audio_sound_id_t id, uint8_t gain_percent);
+
+/**
+ * @brief Checks if any sound effect is queued or still playing.
+ * Unlike audio_manager_get_state(), which describes the background track.
+ */
+bool audio_manager_is_sound_playing(void);
+
+/** @brief Pauses the background track. Sound effects are not affected. */
 void audio_manager_pause(void);
 
-/** @brief Resumes audio playback if it was paused. */
+/** @brief Resumes the background track if it was paused. */
 void audio_manager_resume(void);
 
-/** @brief Stops audio playback and terminates the playback task. */
+/** @brief Stops the background track and clears the playback queue. Sound effects are not affected. */
 void audio_manager_stop(void);
 
-/** @brief Gets the current state of the audio player. */
+/**
+ * @brief Moves the current track to a new position.
+ *
+ * The file is repositioned from the offset of its audio data and its block
+ * size, so no chunks are scanned, and the read-ahead buffer is flushed and
+ * refilled from there. The queue is kept. While paused, the new position
+ * plays on resume.
+ *
+ * @param seconds Position from the start of the track. Past the end, the next queued track plays.
+ * @return false if nothing is playing.
+ */
+bool audio_manager_seek(uint32_t seconds);
+
+/** @brief Seeks forward from the current position. @return false if nothing is playing. */
+bool audio_manager_fast_forward(uint32_t seconds);
+
+/** @brief Seeks back from the current position, at most to the start of the track. @return false if nothing is playing. */
+bool audio_manager_rewind(uint32_t seconds);
+
+/** @brief Gets the current state of the background track. */
 audio_player_state_t audio_manager_get_state(void);
 
 /**
@@ -107,10 +221,34 @@ void audio_manager_set_volume_physical(uint8_t percentage);
  * @brief Gets the handle of the visualizer data queue.
  *
  * The UI can use this queue to receive audio spectrum data for rendering.
- * It is a size-1 overwrite queue, so only the latest data is available.
+ * It is a size-1 overwrite queue updated ~30 times per second while audio is
+ * playing, so only the latest data is available.
  *
  * @return Handle to the queue, or NULL if not initialized.
  */
 QueueHandle_t audio_manager_get_visualizer_queue(void);
 
+/**
+ * @brief Gets the read-ahead buffer health counters and start-up latency of the current or last track.
+ * The counters are reset when a new track starts.
+ * @param stats Pointer to the structure to fill.
+ */
+void audio_manager_get_playback_stats(audio_playback_stats_t *stats);
+
+/**
+ * @brief Gets the playback health counters.
+ *
+ * Each task updates its own counters without locks, so a snapshot taken while
+ * audio is playing may be off by the block in progress.
+ *
+ * @param health Pointer to the structure to fill.
+ */
+void audio_manager_get_health(audio_health_t *health);
+
+/** @brief Clears the playback health counters. */
+void audio_manager_reset_health(void);
+
+/** @brief Logs the playback health counters and histograms (INFO level). */
+void audio_manager_log_health(void);
+
 #endif // AUDIO_MANAGER_H
\ No newline at end of file
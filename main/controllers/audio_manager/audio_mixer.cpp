@@ -0,0 +1,90 @@
+#include "audio_mixer.h"
+#include <string.h>
+
+#define WAV_FORMAT_PCM 1
+
+// Reads one little-endian PCM sample of any supported width as 16 bits,
+// keeping the most significant bits (8-bit WAV samples are unsigned).
+static inline int16_t read_sample(const uint8_t* p, uint16_t bits_per_sample) {
+    switch (bits_per_sample) {
+        case 8:  return (int16_t)(((int32_t)p[0] - 128) << 8);
+        case 16: return (int16_t)(p[0] | (p[1] << 8));
+        case 24: return (int16_t)(p[1] | (p[2] << 8));
+        default: return (int16_t)(p[2] | (p[3] << 8));
+    }
+}
+
+bool audio_mixer_format_supported(const audio_wav_info_t* format) {
+    if (!format || format->audio_format != WAV_FORMAT_PCM) return false;
+    if (format->num_channels != 1 && format->num_channels != 2) return false;
+    switch (format->bits_per_sample) {
+        case 8: case 16: case 24: case 32: break;
+        default: return false;
+    }
+    return format->block_align == format->num_channels * (format->bits_per_sample / 8);
+}
+
+void audio_mixer_convert_to_stereo16(const uint8_t* src, const audio_wav_info_t* format, int16_t* dst, size_t frames) {
+    if (format->bits_per_sample == 16 && format->num_channels == 2) {
+        memcpy(dst, src, frames * 2 * sizeof(int16_t));
+    } else if (format->bits_per_sample == 16 && format->num_channels == 1) {
+        const int16_t* s = (const int16_t*)src;
+        for (size_t i = 0; i < frames; i++) {
+            dst[2 * i] = s[i];
+            dst[2 * i + 1] = s[i];
+        }
+    } else {
+        const uint16_t bits = format->bits_per_sample;
+        const size_t sample_bytes = bits / 8;
+        const size_t right_offset = (format->num_channels == 2) ? sample_bytes : 0;
+        for (size_t i = 0; i < frames; i++, src += format->block_align) {
+            dst[2 * i] = read_sample(src, bits);
+            dst[2 * i + 1] = read_sample(src + right_offset, bits);
+        }
+    }
+}
+
+void audio_mixer_voice_start(audio_mixer_voice_t* voice, const uint8_t* data, const audio_wav_info_t* format,
+                             int32_t gain_q15) {
+    if (!voice) return;
+    memset(voice, 0, sizeof(audio_mixer_voice_t));
+    if (!data || !audio_mixer_format_supported(format)) return;
+    voice->data = data;
+    voice->format = *format;
+    voice->total_frames = format->data_size / format->block_align;
+    voice->gain_q15 = gain_q15;
+    voice->active = (voice->total_frames > 0);
+}
+
+size_t audio_mixer_voice_render(audio_mixer_voice_t* voice, int16_t* dst, size_t frames) {
+    if (!voice || !voice->active) return 0;
+    const uint32_t available = voice->total_frames - voice->pos;
+    const size_t n = (frames < available) ? frames : available;
+    audio_mixer_convert_to_stereo16(voice->data + (size_t)voice->pos * voice->format.block_align, &voice->format, dst, n);
+    voice->pos += n;
+    if (voice->pos >= voice->total_frames) voice->active = false;
+    return n;
+}
+
+void audio_mixer_accumulate(int32_t* __restrict acc, const int16_t* __restrict src, size_t samples, int32_t gain_q15) {
+    for (size_t i = 0; i < samples; i++) {
+        acc[i] += ((int32_t)src[i] * gain_q15) >> 15;
+    }
+}
+
+void audio_mixer_accumulate_ramp(int32_t* __restrict acc, const int16_t* __restrict src, size_t frames,
+                                 int32_t gain_from_q15, int32_t gain_to_q15) {
+    if (gain_from_q15 == gain_to_q15 || frames == 0) {
+        audio_mixer_accumulate(acc, src, frames * AUDIO_MIXER_CHANNELS, gain_to_q15);
+        return;
+    }
+    // The gain is stepped with 8 extra fractional bits so short blocks still ramp smoothly.
+    int32_t gain_q23 = gain_from_q15 << 8;
+    const int32_t step_q23 = ((gain_to_q15 - gain_from_q15) << 8) / (int32_t)frames;
+    for (size_t i = 0; i < frames; i++) {
+        const int32_t gain = gain_q23 >> 8;
+        acc[2 * i] += ((int32_t)src[2 * i] * gain) >> 15;
+        acc[2 * i + 1] += ((int32_t)src[2 * i + 1] * gain) >> 15;
+        gain_q23 += step_q23;
+    }
+}
@@ -0,0 +1,94 @@
+/**
+ * @file audio_mixer.h
+ * @brief Fixed-point building blocks of the multi-voice output mixer.
+ *
+ * The output bus is always interleaved 16-bit stereo. Each voice is converted
+ * to that format, scaled by a Q15 gain and summed into a 32-bit accumulator,
+ * which is saturated to 16 bits once per block. All kernels work on whole
+ * blocks with simple, branch-free inner loops. Sample-rate conversion happens
+ * before the mixer (see audio_resampler.h), so every voice is at the bus rate.
+ */
+#ifndef AUDIO_MIXER_H
+#define AUDIO_MIXER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "audio_wav.h"
+
+/** @brief Number of interleaved channels on the output bus. */
+#define AUDIO_MIXER_CHANNELS 2
+
+/** @brief Gain of 1.0 in the Q15 format used by the mixer (one above INT16_MAX on purpose). */
+#define AUDIO_MIXER_UNITY_GAIN 32768
+
+/**
+ * @brief An in-memory voice (e.g. a sound bank clip) being played on the bus.
+ * The clip must already be at the bus sample rate.
+ */
+typedef struct {
+    const uint8_t* data;       //!< Raw samples of the clip.
+    audio_wav_info_t format;   //!< Format of `data`.
+    uint32_t total_frames;     //!< Number of frames in `data`.
+    uint32_t pos;              //!< Read position, in frames.
+    int32_t gain_q15;          //!< Voice gain (Q15, AUDIO_MIXER_UNITY_GAIN = 1.0).
+    bool active;               //!< True while the voice still has samples to render.
+} audio_mixer_voice_t;
+
+/**
+ * @brief Checks whether the mixer can convert a stream of the given format.
+ * @return true for uncompressed PCM with 8, 16, 24 or 32 bits and 1 or 2 channels.
+ */
+bool audio_mixer_format_supported(const audio_wav_info_t* format);
+
+/**
+ * @brief Converts a block of PCM frames of any supported format to 16-bit stereo.
+ * @param src Source frames, laid out as described by `format`.
+ * @param format Format of the source frames.
+ * @param dst Destination, room for `frames` * AUDIO_MIXER_CHANNELS samples.
+ * @param frames Number of frames to convert.
+ */
+void audio_mixer_convert_to_stereo16(const uint8_t* src, const audio_wav_info_t* format, int16_t* dst, size_t frames);
+
+/**
+ * @brief Prepares a voice to play a block of in-memory samples from the beginning.
+ * @param voice The voice to start.
+ * @param data Raw samples; must stay valid until the voice finishes.
+ * @param format Format of `data` (`data_size` gives its length).
+ * @param gain_q15 Voice gain in Q15.
+ */
+void audio_mixer_voice_start(audio_mixer_voice_t* voice, const uint8_t* data, const audio_wav_info_t* format,
+                             int32_t gain_q15);
+
+/**
+ * @brief Renders the next block of a voice as 16-bit stereo.
+ *
+ * The voice is deactivated once its last frame has been rendered.
+ *
+ * @param voice The voice to render.
+ * @param dst Destination, room for `frames` * AUDIO_MIXER_CHANNELS samples.
+ * @param frames Number of bus frames requested.
+ * @return Number of frames written; fewer than requested only at the end of the voice.
+ */
+size_t audio_mixer_voice_render(audio_mixer_voice_t* voice, int16_t* dst, size_t frames);
+
+/**
+ * @brief Adds a block scaled by a constant gain into the accumulator: acc += (src * gain) >> 15.
+ * @param acc The 32-bit accumulator.
+ * @param src The 16-bit samples to add.
+ * @param samples Number of samples (frames * channels).
+ * @param gain_q15 The gain in Q15.
+ */
+void audio_mixer_accumulate(int32_t* acc, const int16_t* src, size_t samples, int32_t gain_q15);
+
+/**
+ * @brief Like audio_mixer_accumulate(), with the gain ramped linearly across the
+ * block to avoid zipper noise when it changes (e.g. while ducking).
+ * @param acc The 32-bit accumulator.
+ * @param src The 16-bit stereo frames to add.
+ * @param frames Number of stereo frames.
+ * @param gain_from_q15 Gain applied to the first frame.
+ * @param gain_to_q15 Gain reached after the last frame.
+ */
+void audio_mixer_accumulate_ramp(int32_t* acc, const int16_t* src, size_t frames, int32_t gain_from_q15, int32_t gain_to_q15);
+
+#endif // AUDIO_MIXER_H
@@ -0,0 +1,134 @@
+#include "audio_qoa.h"
+#include "esp_log.h"
+#include <string.h>
+
+static const char *TAG = "AUDIO_QOA";
+
+#define LMS_LEN 4
+#define LMS_STATE_BYTES 16 // History and weights, 4 x int16 each, per channel.
+#define SLICE_BYTES 8
+#define MAX_CHANNELS 8
+
+// Scale factor s in 0..15 is round((s + 1)^2.75); each row holds it times
+// {0.75, -0.75, 2.5, -2.5, 4.5, -4.5, 7, -7}, rounded away from zero.
+static const int16_t s_dequant_tab[16][8] = {
+    {     1,     -1,      3,     -3,      5,     -5,      7,     -7},
+    {     5,     -5,     18,    -18,     32,    -32,     49,    -49},
+    {    16,    -16,     53,    -53,     95,    -95,    147,   -147},
+    {    34,    -34,    113,   -113,    203,   -203,    315,   -315},
+    {    63,    -63,    210,   -210,    378,   -378,    588,   -588},
+    {   104,   -104,    345,   -345,    621,   -621,    966,   -966},
+    {   158,   -158,    528,   -528,    950,   -950,   1477,  -1477},
+    {   228,   -228,    760,   -760,   1368,  -1368,   2128,  -2128},
+    {   316,   -316,   1053,  -1053,   1895,  -1895,   2947,  -2947},
+    {   422,   -422,   1405,  -1405,   2529,  -2529,   3934,  -3934},
+    {   548,   -548,   1828,  -1828,   3290,  -3290,   5117,  -5117},
+    {   696,   -696,   2320,  -2320,   4176,  -4176,   6496,  -6496},
+    {   868,   -868,   2893,  -2893,   5207,  -5207,   8099,  -8099},
+    {  1064,  -1064,   3548,  -3548,   6386,  -6386,   9933,  -9933},
+    {  1286,  -1286,   4288,  -4288,   7718,  -7718,  12005, -12005},
+    {  1536,  -1536,   5120,  -5120,   9216,  -9216,  14336, -14336},
+};
+
+typedef struct {
+    int32_t history[LMS_LEN];
+    int32_t weights[LMS_LEN];
+} lms_state_t;
+
+static inline uint64_t read_u64_be(const uint8_t* p) {
+    uint64_t v = 0;
+    for (int i = 0; i < 8; i++) v = (v << 8) | p[i];
+    return v;
+}
+
+static inline int16_t clamp_s16(int32_t v) {
+    if (v > INT16_MAX) return INT16_MAX;
+    if (v < INT16_MIN) return INT16_MIN;
+    return (int16_t)v;
+}
+
+size_t audio_qoa_frame_size(uint16_t channels, uint16_t frame_samples) {
+    const size_t slices = (frame_samples + AUDIO_QOA_SLICE_LEN - 1) / AUDIO_QOA_SLICE_LEN;
+    return AUDIO_QOA_FRAME_HEADER_SIZE + channels * (LMS_STATE_BYTES + slices * SLICE_BYTES);
+}
+
+bool audio_qoa_parse_frame_header(const uint8_t* data, audio_qoa_frame_header_t* header) {
+    header->num_channels = data[0];
+    header->sample_rate = ((uint32_t)data[1] << 16) | ((uint32_t)data[2] << 8) | data[3];
+    header->frame_samples = (uint16_t)((data[4] << 8) | data[5]);
+    header->frame_size = (uint16_t)((data[6] << 8) | data[7]);
+
+    if (header->num_channels == 0 || header->num_channels > MAX_CHANNELS || header->sample_rate == 0 ||
+        header->frame_samples == 0 || header->frame_samples > AUDIO_QOA_FRAME_LEN) {
+        return false;
+    }
+    return header->frame_size == audio_qoa_frame_size(header->num_channels, header->frame_samples);
+}
+
+bool audio_qoa_read_header(FILE* fp, uint32_t* total_samples, audio_qoa_frame_header_t* first_frame) {
+    uint8_t header[AUDIO_QOA_FILE_HEADER_SIZE + AUDIO_QOA_FRAME_HEADER_SIZE];
+    if (fread(header, 1, sizeof(header), fp) != sizeof(header) ||
+        memcmp(header, AUDIO_QOA_MAGIC, 4) != 0) {
+        ESP_LOGE(TAG, "Invalid QOA file header.");
+        return false;
+    }
+    *total_samples = ((uint32_t)header[4] << 24) | ((uint32_t)header[5] << 16) | ((uint32_t)header[6] << 8) | header[7];
+    if (!audio_qoa_parse_frame_header(header + AUDIO_QOA_FILE_HEADER_SIZE, first_frame)) {
+        ESP_LOGE(TAG, "Invalid first QOA frame header.");
+        return false;
+    }
+    fseek(fp, -AUDIO_QOA_FRAME_HEADER_SIZE, SEEK_CUR);
+    return true;
+}
+
+size_t audio_qoa_decode_frame(const uint8_t* frame, const audio_qoa_frame_header_t* header, int16_t* out) {
+    const uint32_t channels = header->num_channels;
+    const uint32_t samples = header->frame_samples;
+    const uint8_t* p = frame + AUDIO_QOA_FRAME_HEADER_SIZE;
+
+    lms_state_t lms[MAX_CHANNELS];
+    for (uint32_t c = 0; c < channels; c++) {
+        uint64_t history = read_u64_be(p);
+        uint64_t weights = read_u64_be(p + 8);
+        p += LMS_STATE_BYTES;
+        for (int i = 0; i < LMS_LEN; i++) {
+            lms[c].history[i] = (int16_t)(history >> 48);
+            lms[c].weights[i] = (int16_t)(weights >> 48);
+            history <<= 16;
+            weights <<= 16;
+        }
+    }
+
+    // Slices are interleaved by channel: 20 samples of channel 0, then of channel 1, ...
+    for (uint32_t start = 0; start < samples; start += AUDIO_QOA_SLICE_LEN) {
+        const uint32_t end = (start + AUDIO_QOA_SLICE_LEN < samples) ? start + AUDIO_QOA_SLICE_LEN : samples;
+        for (uint32_t c = 0; c < channels; c++) {
+            uint64_t slice = read_u64_be(p);
+            p += SLICE_BYTES;
+            const int16_t* dequant = s_dequant_tab[slice >> 60];
+            lms_state_t* st = &lms[c];
+            int16_t* dst = out + start * channels + c;
+
+            for (uint32_t i = start; i < end; i++) {
+                int32_t predicted = 0;
+                for (int k = 0; k < LMS_LEN; k++) predicted += st->weights[k] * st->history[k];
+                predicted >>= 13;
+
+                const int32_t residual = dequant[(slice >> 57) & 0x7];
+                const int16_t sample = clamp_s16(predicted + residual);
+                slice <<= 3;
+
+                const int32_t delta = residual >> 4;
+                for (int k = 0; k < LMS_LEN; k++) st->weights[k] += (st->history[k] < 0) ? -delta : delta;
+                st->history[0] = st->history[1];
+                st->history[1] = st->history[2];
+                st->history[2] = st->history[3];
+                st->history[3] = sample;
+
+                *dst = sample;
+                dst += channels;
+            }
+        }
+    }
+    return samples;
+}
@@ -0,0 +1,69 @@
+/**
+ * @file audio_qoa.h
+ * @brief Decoder for the "Quite OK Audio" (QOA) format.
+ *
+ * A QOA file is an 8-byte header ("qoaf" and the number of samples per
+ * channel) followed by independent frames of up to AUDIO_QOA_FRAME_LEN samples
+ * per channel. Each frame carries its own format, the LMS predictor state of
+ * every channel and 64-bit slices of 20 samples at ~3.2 bits per sample.
+ * All fields are big-endian.
+ */
+#ifndef AUDIO_QOA_H
+#define AUDIO_QOA_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define AUDIO_QOA_MAGIC "qoaf"
+#define AUDIO_QOA_FILE_HEADER_SIZE 8
+#define AUDIO_QOA_FRAME_HEADER_SIZE 8
+#define AUDIO_QOA_SLICE_LEN 20
+#define AUDIO_QOA_SLICES_PER_FRAME 256
+#define AUDIO_QOA_FRAME_LEN (AUDIO_QOA_SLICE_LEN * AUDIO_QOA_SLICES_PER_FRAME)
+
+/**
+ * @brief Header of one QOA frame.
+ */
+typedef struct {
+    uint8_t num_channels;
+    uint32_t sample_rate;
+    uint16_t frame_samples;   //!< Samples per channel in this frame.
+    uint16_t frame_size;      //!< Size of the whole frame in bytes, header included.
+} audio_qoa_frame_header_t;
+
+/**
+ * @brief Size in bytes of a frame with the given layout.
+ */
+size_t audio_qoa_frame_size(uint16_t channels, uint16_t frame_samples);
+
+/**
+ * @brief Parses and validates a frame header.
+ * @param data AUDIO_QOA_FRAME_HEADER_SIZE bytes.
+ * @param header Output structure.
+ * @return true if the header describes a well-formed frame.
+ */
+bool audio_qoa_parse_frame_header(const uint8_t* data, audio_qoa_frame_header_t* header);
+
+/**
+ * @brief Reads the file header and peeks at the first frame header.
+ *
+ * On success the file is left positioned at the first frame.
+ *
+ * @param fp An open file, positioned at the start of the file.
+ * @param total_samples Receives the samples per channel (0 for a stream of unknown length).
+ * @param first_frame Receives the header of the first frame (format of the stream).
+ * @return true if this is a valid QOA file.
+ */
+bool audio_qoa_read_header(FILE* fp, uint32_t* total_samples, audio_qoa_frame_header_t* first_frame);
+
+/**
+ * @brief Decodes one frame to interleaved 16-bit samples.
+ * @param frame The whole frame, header included (frame_size bytes).
+ * @param header The parsed header of `frame`.
+ * @param out Output buffer for `header->frame_samples` frames.
+ * @return Number of frames written.
+ */
+size_t audio_qoa_decode_frame(const uint8_t* frame, const audio_qoa_frame_header_t* header, int16_t* out);
+
+#endif // AUDIO_QOA_H
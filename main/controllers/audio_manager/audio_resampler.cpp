@@ -0,0 +1,214 @@
+#include "audio_resampler.h"
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include <string.h>
+#include <math.h>
+
+static const char *TAG = "AUDIO_RESAMPLER";
+
+// --- FILTER DESIGN ---
+// Kaiser window with beta = 8 gives ~80 dB of stopband attenuation. The cutoff
+// is placed so the whole transition band sits below the lower Nyquist rate,
+// which keeps images (up-sampling) and aliases (down-sampling) under -80 dB.
+#define KAISER_BETA 8.0
+#define KAISER_ATTENUATION_DB 80.0
+#define HALF_TAPS (AUDIO_RESAMPLER_TAPS / 2)
+
+static uint32_t gcd(uint32_t a, uint32_t b) {
+    while (b) { uint32_t t = a % b; a = b; b = t; }
+    return a;
+}
+
+// Zeroth-order modified Bessel function of the first kind (power series).
+static double bessel_i0(double x) {
+    double sum = 1.0, term = 1.0;
+    const double half_x = x / 2.0;
+    for (int k = 1; k < 50; k++) {
+        term *= (half_x / k) * (half_x / k);
+        sum += term;
+        if (term < sum * 1e-12) break;
+    }
+    return sum;
+}
+
+static inline int16_t saturate_q15(int32_t acc) {
+    acc = (acc + (1 << 14)) >> 15;
+    if (acc > INT16_MAX) return INT16_MAX;
+    if (acc < INT16_MIN) return INT16_MIN;
+    return (int16_t)acc;
+}
+
+// Designs the prototype low-pass at the up-sampled rate L * in_rate and splits
+// it into L subfilters. Each subfilter is normalized to unity DC gain before
+// quantization, so no phase adds a DC step or ripple.
+static void design_filter(audio_resampler_t* rs) {
+    const uint32_t L = rs->phases;
+    const uint32_t N = L * AUDIO_RESAMPLER_TAPS;
+    const double upsampled_rate = (double)L * rs->in_rate;
+    const double nyquist = 0.5 * (double)((rs->in_rate < rs->out_rate) ? rs->in_rate : rs->out_rate);
+
+    // Kaiser's estimate of the transition width for N taps, in cycles per sample.
+    const double transition = (KAISER_ATTENUATION_DB - 7.95) / (14.36 * (N - 1));
+    double fc = nyquist / upsampled_rate - transition / 2.0;
+    if (fc < 0.35 * nyquist / upsampled_rate) fc = 0.35 * nyquist / upsampled_rate;
+
+    const double i0_beta = bessel_i0(KAISER_BETA);
+    const double center = (N - 1) / 2.0;
+    double taps[AUDIO_RESAMPLER_TAPS];
+
+    for (uint32_t p = 0; p < L; p++) {
+        double sum = 0.0;
+        for (int k = 0; k < AUDIO_RESAMPLER_TAPS; k++) {
+            const uint32_t n = p + k * L;
+            const double t = n - center;
+            const double x = 2.0 * fc * t;
+            const double sinc = (fabs(x) < 1e-12) ? 1.0 : sin(M_PI * x) / (M_PI * x);
+            const double r = 2.0 * n / (N - 1) - 1.0;
+            const double window = bessel_i0(KAISER_BETA * sqrt(fmax(0.0, 1.0 - r * r))) / i0_beta;
+            taps[k] = 2.0 * fc * sinc * window;
+            sum += taps[k];
+        }
+
+        // Stored reversed (oldest input first) so the dot product walks both arrays forward.
+        int16_t* c = rs->coeffs + p * AUDIO_RESAMPLER_TAPS;
+        int32_t qsum = 0;
+        int largest = 0;
+        for (int k = 0; k < AUDIO_RESAMPLER_TAPS; k++) {
+            long q = lrint(taps[k] / sum * 32768.0);
+            if (q > INT16_MAX) q = INT16_MAX;
+            if (q < INT16_MIN) q = INT16_MIN;
+            c[AUDIO_RESAMPLER_TAPS - 1 - k] = (int16_t)q;
+            qsum += q;
+            if (taps[k] > taps[largest]) largest = k;
+        }
+        // Put the rounding residue on the largest tap so every phase sums to exactly 1.0.
+        c[AUDIO_RESAMPLER_TAPS - 1 - largest] += (int16_t)(32768 - qsum);
+    }
+}
+
+bool audio_resampler_configure(audio_resampler_t* rs, uint32_t in_rate, uint32_t out_rate) {
+    if (!rs || in_rate == 0 || out_rate == 0) return false;
+    if (in_rate > out_rate * (AUDIO_RESAMPLER_TAPS / 2)) {
+        ESP_LOGE(TAG, "Unsupported conversion %lu Hz -> %lu Hz.", in_rate, out_rate);
+        return false;
+    }
+    if (rs->in_rate == in_rate && rs->out_rate == out_rate && (rs->coeffs || in_rate == out_rate)) {
+        audio_resampler_reset(rs);
+        return true;
+    }
+
+    audio_resampler_deinit(rs);
+    rs->in_rate = in_rate;
+    rs->out_rate = out_rate;
+    if (in_rate == out_rate) {
+        rs->phases = 1;
+        rs->step = 1;
+        audio_resampler_reset(rs);
+        return true;
+    }
+
+    const uint32_t g = gcd(in_rate, out_rate);
+    rs->phases = out_rate / g;
+    rs->step = in_rate / g;
+    if (rs->phases > AUDIO_RESAMPLER_MAX_PHASES) {
+        // Unusual ratio: use the nearest ratio with a bounded table (pitch error < 0.1%).
+        rs->step = (uint32_t)lrint((double)in_rate * AUDIO_RESAMPLER_MAX_PHASES / out_rate);
+        rs->phases = AUDIO_RESAMPLER_MAX_PHASES;
+        ESP_LOGW(TAG, "Approximating %lu Hz -> %lu Hz as %lu/%lu.", in_rate, out_rate, rs->phases, rs->step);
+    }
+
+    // The table is read for every output sample, so prefer internal RAM.
+    const size_t table_bytes = rs->phases * AUDIO_RESAMPLER_TAPS * sizeof(int16_t);
+    rs->coeffs = (int16_t*)heap_caps_malloc(table_bytes, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    if (!rs->coeffs) rs->coeffs = (int16_t*)heap_caps_malloc(table_bytes, MALLOC_CAP_SPIRAM);
+    if (!rs->coeffs) {
+        ESP_LOGE(TAG, "Failed to allocate %u bytes of resampler coefficients.", table_bytes);
+        rs->in_rate = rs->out_rate = 0;
+        return false;
+    }
+    design_filter(rs);
+    audio_resampler_reset(rs);
+    ESP_LOGI(TAG, "Resampler %lu Hz -> %lu Hz: %lu phases x %d taps.", in_rate, out_rate, rs->phases, AUDIO_RESAMPLER_TAPS);
+    return true;
+}
+
+void audio_resampler_reset(audio_resampler_t* rs) {
+    if (!rs) return;
+    rs->phase = 0;
+    // Start with half a filter of silence so the first output frame lines up
+    // with the first input frame instead of dropping the filter delay.
+    memset(rs->window, 0, sizeof(rs->window));
+    rs->pending = (rs->coeffs) ? HALF_TAPS : 0;
+}
+
+void audio_resampler_deinit(audio_resampler_t* rs) {
+    if (!rs) return;
+    if (rs->coeffs) heap_caps_free(rs->coeffs);
+    rs->coeffs = NULL;
+    rs->in_rate = rs->out_rate = 0;
+}
+
+size_t audio_resampler_max_output(const audio_resampler_t* rs, size_t in_frames) {
+    if (!rs || !rs->coeffs) return in_frames;
+    return (size_t)(((uint64_t)(in_frames + AUDIO_RESAMPLER_TAPS) * rs->phases) / rs->step) + 1;
+}
+
+size_t audio_resampler_process(audio_resampler_t* rs, const int16_t* in, size_t in_frames,
+                               int16_t* out, size_t out_capacity, size_t* in_consumed) {
+    size_t consumed = 0;
+    size_t produced = 0;
+
+    if (!rs->coeffs) {
+        produced = (in_frames < out_capacity) ? in_frames : out_capacity;
+        memcpy(out, in, produced * 2 * sizeof(int16_t));
+        if (in_consumed) *in_consumed = produced;
+        return produced;
+    }
+
+    const uint32_t L = rs->phases;
+    const uint32_t M = rs->step;
+    uint32_t phase = rs->phase;
+    const size_t window_frames = AUDIO_RESAMPLER_TAPS + AUDIO_RESAMPLER_BLOCK_FRAMES;
+
+    while (true) {
+        size_t take = window_frames - rs->pending;
+        if (take > in_frames - consumed) take = in_frames - consumed;
+        memcpy(rs->window + rs->pending * 2, in + consumed * 2, take * 2 * sizeof(int16_t));
+        rs->pending += take;
+        consumed += take;
+
+        size_t base = 0;
+        while (base + AUDIO_RESAMPLER_TAPS <= rs->pending && produced < out_capacity) {
+            const int16_t* __restrict c = rs->coeffs + phase * AUDIO_RESAMPLER_TAPS;
+            const int16_t* __restrict w = rs->window + base * 2;
+            int32_t acc_l = 0, acc_r = 0;
+            for (int j = 0; j < AUDIO_RESAMPLER_TAPS; j++) {
+                acc_l += (int32_t)c[j] * w[2 * j];
+                acc_r += (int32_t)c[j] * w[2 * j + 1];
+            }
+            out[2 * produced] = saturate_q15(acc_l);
+            out[2 * produced + 1] = saturate_q15(acc_r);
+            produced++;
+
+            phase += M;
+            base += phase / L;
+            phase %= L;
+        }
+
+        rs->pending -= base;
+        memmove(rs->window, rs->window + base * 2, rs->pending * 2 * sizeof(int16_t));
+
+        if (consumed == in_frames || produced == out_capacity) break;
+    }
+
+    rs->phase = phase;
+    if (in_consumed) *in_consumed = consumed;
+    return produced;
+}
+
+size_t audio_resampler_flush(audio_resampler_t* rs, int16_t* out, size_t out_capacity) {
+    if (!rs || !rs->coeffs) return 0;
+    static const int16_t silence[HALF_TAPS * 2] = {0};
+    size_t consumed = 0;
+    return audio_resampler_process(rs, silence, HALF_TAPS, out, out_capacity, &consumed);
+}
@@ -0,0 +1,99 @@
+/**
+ * @file audio_resampler.h
+ * @brief Streaming fixed-point polyphase sample-rate converter for 16-bit stereo.
+ *
+ * Converts between any two rates whose ratio reduces to L/M with at most
+ * AUDIO_RESAMPLER_MAX_PHASES phases (e.g. 8, 11.025, 16, 22.05, 32, 44.1 kHz
+ * to 48 kHz). The windowed-sinc filter is designed once per rate pair and
+ * stored as Q15 coefficients, one AUDIO_RESAMPLER_TAPS-tap subfilter per
+ * phase; the per-sample work is a pair of short integer dot products.
+ */
+#ifndef AUDIO_RESAMPLER_H
+#define AUDIO_RESAMPLER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/** @brief Taps of each polyphase subfilter (input frames per output frame). */
+#define AUDIO_RESAMPLER_TAPS 32
+
+/**
+ * @brief Largest number of phases (the reduced L of the L/M ratio) that is
+ * handled exactly. Ratios needing more are approximated with this many phases.
+ */
+#define AUDIO_RESAMPLER_MAX_PHASES 640
+
+/** @brief Input frames buffered internally per call to audio_resampler_process(). */
+#define AUDIO_RESAMPLER_BLOCK_FRAMES 256
+
+/**
+ * @brief State of one resampler instance. Treat as opaque.
+ */
+typedef struct {
+    uint32_t in_rate;
+    uint32_t out_rate;
+    uint32_t phases;        //!< L: output-side interpolation factor.
+    uint32_t step;          //!< M: input-side decimation factor.
+    uint32_t phase;         //!< Current phase, 0..L-1.
+    int16_t* coeffs;        //!< L * AUDIO_RESAMPLER_TAPS coefficients (Q15), phase-major; NULL when passthrough.
+    uint32_t pending;       //!< Valid frames in `window`.
+    int16_t window[(AUDIO_RESAMPLER_TAPS + AUDIO_RESAMPLER_BLOCK_FRAMES) * 2]; //!< Interleaved stereo input history.
+} audio_resampler_t;
+
+/**
+ * @brief Designs the filter for a rate pair and resets the stream state.
+ *
+ * Calling it again with the same rates only resets the state; the existing
+ * coefficients are kept. Equal rates set up a passthrough without a filter.
+ *
+ * @param rs The resampler instance (zero-initialize it before the first call).
+ * @param in_rate Input sample rate in Hz.
+ * @param out_rate Output sample rate in Hz.
+ * @return true on success, false on invalid rates or if the coefficients could not be allocated.
+ */
+bool audio_resampler_configure(audio_resampler_t* rs, uint32_t in_rate, uint32_t out_rate);
+
+/**
+ * @brief Clears the input history (e.g. before a new stream at the same rate).
+ */
+void audio_resampler_reset(audio_resampler_t* rs);
+
+/**
+ * @brief Frees the coefficient table.
+ */
+void audio_resampler_deinit(audio_resampler_t* rs);
+
+/**
+ * @brief Upper bound of output frames produced for a given number of input frames.
+ */
+size_t audio_resampler_max_output(const audio_resampler_t* rs, size_t in_frames);
+
+/**
+ * @brief Converts a block of interleaved 16-bit stereo frames.
+ *
+ * Consumes input until either all of it has been taken or the output is full;
+ * call again with the remaining input in the latter case. The filter delay of
+ * AUDIO_RESAMPLER_TAPS / 2 input frames is held back until more input arrives
+ * or audio_resampler_flush() is called at the end of the stream.
+ *
+ * @param rs The resampler instance.
+ * @param in Input frames.
+ * @param in_frames Number of input frames available.
+ * @param out Output buffer.
+ * @param out_capacity Capacity of `out` in frames.
+ * @param in_consumed Receives the number of input frames consumed.
+ * @return Number of output frames written.
+ */
+size_t audio_resampler_process(audio_resampler_t* rs, const int16_t* in, size_t in_frames,
+                               int16_t* out, size_t out_capacity, size_t* in_consumed);
+
+/**
+ * @brief Emits the frames still held back by the filter delay at the end of a stream.
+ * @param rs The resampler instance.
+ * @param out Output buffer.
+ * @param out_capacity Capacity of `out` in frames (audio_resampler_max_output(rs, 0) is enough).
+ * @return Number of output frames written.
+ */
+size_t audio_resampler_flush(audio_resampler_t* rs, int16_t* out, size_t out_capacity);
+
+#endif // AUDIO_RESAMPLER_H
@@ -0,0 +1,226 @@
+#include "audio_sound_bank.h"
+#include "audio_decoder.h"
+#include "audio_resampler.h"
+#include "controllers/sd_card_manager/sd_card_manager.h"
+#include "models/asset_config.h"
+#include "config/app_config.h"
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include <string.h>
+#include <math.h>
+
+static const char *TAG = "SOUND_BANK";
+
+// Clips are stored in the mixer bus format: 16-bit stereo at AUDIO_OUTPUT_SAMPLE_RATE.
+#define BUS_CHANNELS 2
+#define BUS_FRAME_BYTES (BUS_CHANNELS * sizeof(int16_t))
+#define CONVERT_CHUNK_FRAMES 256
+
+// --- FALLBACK CHIME ---
+#define CHIME_SAMPLE_RATE AUDIO_OUTPUT_SAMPLE_RATE
+#define CHIME_CHANNELS BUS_CHANNELS
+#define CHIME_NOTE_MS 90
+#define CHIME_AMPLITUDE 12000.0f
+
+typedef struct {
+    const char* filename;
+    float chime_hz[2]; // Notes of the fallback chime; 0 skips the second note.
+} sound_bank_entry_t;
+
+// The declared set of preloaded effects, indexed by audio_sound_id_t.
+static const sound_bank_entry_t s_entries[AUDIO_SOUND_COUNT] = {
+    { UI_SOUND_NOTIFICATION, { 880.0f, 1320.0f } },
+    { UI_SOUND_SUCCESS,      { 1047.0f, 1568.0f } },
+    { UI_SOUND_ERROR,        { 440.0f, 330.0f } },
+    { UI_SOUND_CLICK,        { 2000.0f, 0.0f } },
+};
+
+static audio_sound_clip_t s_clips[AUDIO_SOUND_COUNT];
+static bool s_loaded[AUDIO_SOUND_COUNT];
+static SemaphoreHandle_t s_bank_mutex = NULL;
+
+static void set_bus_format(audio_wav_info_t* format, uint32_t data_size) {
+    format->audio_format = 1;
+    format->num_channels = BUS_CHANNELS;
+    format->sample_rate = AUDIO_OUTPUT_SAMPLE_RATE;
+    format->bits_per_sample = 16;
+    format->block_align = BUS_FRAME_BYTES;
+    format->byte_rate = AUDIO_OUTPUT_SAMPLE_RATE * BUS_FRAME_BYTES;
+    format->data_size = data_size;
+}
+
+// Decodes an open effect file straight into the bus format (PSRAM), so playing
+// it needs no decoding or conversion in the mixer. Returns false if the file is
+// not usable, leaving `clip` untouched.
+static bool decode_to_bus_format(FILE* fp, const char* filename, audio_sound_clip_t* clip) {
+    // Only used during loading, so they do not need to live on the caller's stack.
+    static audio_decoder_t decoder;
+    static audio_resampler_t resampler;
+    static int16_t stereo[CONVERT_CHUNK_FRAMES * BUS_CHANNELS];
+
+    if (!audio_decoder_open(&decoder, fp)) {
+        ESP_LOGE(TAG, "Unsupported or invalid effect file: %s", filename);
+        return false;
+    }
+
+    bool ok = false;
+    int16_t* out = NULL;
+    do {
+        if (decoder.total_frames == 0) {
+            ESP_LOGW(TAG, "Effect %s has no known length, not preloading it.", filename);
+            break;
+        }
+        if (!audio_resampler_configure(&resampler, decoder.sample_rate, AUDIO_OUTPUT_SAMPLE_RATE)) {
+            break;
+        }
+        const size_t capacity = audio_resampler_max_output(&resampler, decoder.total_frames);
+        if (capacity * BUS_FRAME_BYTES > AUDIO_SOUND_BANK_MAX_CLIP_SIZE) {
+            ESP_LOGW(TAG, "Effect %s is too long (%u bytes once decoded, max %d), not preloading it.",
+                     filename, capacity * BUS_FRAME_BYTES, AUDIO_SOUND_BANK_MAX_CLIP_SIZE);
+            break;
+        }
+        out = (int16_t*)heap_caps_malloc(capacity * BUS_FRAME_BYTES, MALLOC_CAP_SPIRAM);
+        if (!out) {
+            ESP_LOGE(TAG, "Failed to allocate %u bytes in PSRAM for %s", capacity * BUS_FRAME_BYTES, filename);
+            break;
+        }
+
+        size_t produced = 0;
+        size_t n;
+        do {
+            n = audio_decoder_read(&decoder, stereo, CONVERT_CHUNK_FRAMES);
+            for (size_t done = 0; done < n;) {
+                size_t consumed = 0;
+                produced += audio_resampler_process(&resampler, stereo + done * BUS_CHANNELS, n - done,
+                                                    out + produced * BUS_CHANNELS, capacity - produced, &consumed);
+                done += consumed;
+            }
+        } while (n == CONVERT_CHUNK_FRAMES);
+        produced += audio_resampler_flush(&resampler, out + produced * BUS_CHANNELS, capacity - produced);
+
+        // A truncated file is still playable up to the last decoded frame.
+        if (decoder.error || produced == 0) {
+            ESP_LOGE(TAG, "Failed to read audio data of %s", filename);
+            break;
+        }
+        clip->data = (const uint8_t*)out;
+        set_bus_format(&clip->format, produced * BUS_FRAME_BYTES);
+        clip->name = filename;
+        clip->synthesized = false;
+        ok = true;
+    } while (0);
+
+    if (!ok && out) heap_caps_free(out);
+    audio_resampler_deinit(&resampler);
+    audio_decoder_close(&decoder);
+    return ok;
+}
+
+// Reads one effect file into PSRAM. Returns false if the card or file is not
+// available or the file is not usable, leaving `clip` untouched.
+static bool load_clip_from_sd(const char* filename, audio_sound_clip_t* clip) {
+    char path[256];
+    snprintf(path, sizeof(path), "%s%s%s%s%s",
+             SD_CARD_ROOT_PATH, ASSETS_BASE_SUBPATH, ASSETS_SOUNDS_SUBPATH, SOUNDS_EFFECTS_SUBPATH, filename);
+
+    FILE* fp = fopen(path, "rb");
+    if (!fp) {
+        ESP_LOGW(TAG, "Effect not found at %s", path);
+        return false;
+    }
+    bool ok = decode_to_bus_format(fp, filename, clip);
+    fclose(fp);
+    return ok;
+}
+
+// Builds a short one- or two-note chime with a decaying envelope.
+static bool synthesize_chime(const sound_bank_entry_t* entry, audio_sound_clip_t* clip) {
+    const int notes = (entry->chime_hz[1] > 0.0f) ? 2 : 1;
+    const uint32_t note_frames = CHIME_SAMPLE_RATE * CHIME_NOTE_MS / 1000;
+    const uint32_t total_frames = note_frames * notes;
+    const uint32_t data_size = total_frames * CHIME_CHANNELS * sizeof(int16_t);
+
+    int16_t* samples = (int16_t*)heap_caps_malloc(data_size, MALLOC_CAP_SPIRAM);
+    if (!samples) {
+        ESP_LOGE(TAG, "Failed to allocate fallback chime for %s", entry->filename);
+        return false;
+    }
+
+    int16_t* p = samples;
+    for (int n = 0; n < notes; n++) {
+        const float phase_step = 2.0f * (float)M_PI * entry->chime_hz[n] / CHIME_SAMPLE_RATE;
+        for (uint32_t i = 0; i < note_frames; i++) {
+            // Short linear attack to avoid a click, then an exponential decay.
+            const float attack = (i < 64) ? (float)i / 64.0f : 1.0f;
+            const float envelope = attack * expf(-5.0f * (float)i / (float)note_frames);
+            const int16_t value = (int16_t)(CHIME_AMPLITUDE * envelope * sinf(phase_step * (float)i));
+            *p++ = value;
+            *p++ = value;
+        }
+    }
+
+    clip->data = (const uint8_t*)samples;
+    set_bus_format(&clip->format, data_size);
+    clip->name = entry->filename;
+    clip->synthesized = true;
+    return true;
+}
+
+void audio_sound_bank_load(void) {
+    if (!s_bank_mutex) {
+        s_bank_mutex = xSemaphoreCreateMutex();
+        if (!s_bank_mutex) {
+            ESP_LOGE(TAG, "Failed to create sound bank mutex.");
+            return;
+        }
+    }
+
+    const bool sd_available = sd_manager_is_mounted();
+    if (!sd_available) {
+        ESP_LOGW(TAG, "SD card not mounted, using fallback chimes for missing effects.");
+    }
+
+    size_t total_bytes = 0;
+    int from_sd = 0;
+    for (int id = 0; id < AUDIO_SOUND_COUNT; id++) {
+        // Effects already loaded from the card are final; only (re)try the others.
+        if (s_loaded[id] && !s_clips[id].synthesized) {
+            total_bytes += s_clips[id].format.data_size;
+            from_sd++;
+            continue;
+        }
+
+        audio_sound_clip_t clip = {};
+        bool ok = sd_available && load_clip_from_sd(s_entries[id].filename, &clip);
+        if (!ok && s_loaded[id]) continue; // Keep the chime synthesized on a previous load.
+        if (!ok) ok = synthesize_chime(&s_entries[id], &clip);
+        if (!ok) continue;
+
+        // Swap the clip in atomically with respect to audio_sound_bank_get(). A chime
+        // replaced here is intentionally leaked: it may still be playing, and it is small.
+        xSemaphoreTake(s_bank_mutex, portMAX_DELAY);
+        s_clips[id] = clip;
+        s_loaded[id] = true;
+        xSemaphoreGive(s_bank_mutex);
+
+        total_bytes += clip.format.data_size;
+        if (!clip.synthesized) from_sd++;
+        ESP_LOGI(TAG, "Effect %d '%s': %lu bytes%s", id, clip.name,
+                 clip.format.data_size, clip.synthesized ? " (synthesized)" : "");
+    }
+    ESP_LOGI(TAG, "Sound bank ready: %d/%d effects from SD, %u bytes in PSRAM.", from_sd, AUDIO_SOUND_COUNT, total_bytes);
+}
+
+bool audio_sound_bank_get(audio_sound_id_t id, audio_sound_clip_t* clip) {
+    if (id < 0 || id >= AUDIO_SOUND_COUNT || !clip || !s_bank_mutex) return false;
+    bool ok = false;
+    xSemaphoreTake(s_bank_mutex, portMAX_DELAY);
+    if (s_loaded[id]) {
+        *clip = s_clips[id];
+        ok = true;
+    }
+    xSemaphoreGive(s_bank_mutex);
+    return ok;
+}
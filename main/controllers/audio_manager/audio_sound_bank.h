@@ -0,0 +1,60 @@
+/**
+ * @file audio_sound_bank.h
+ * @brief PSRAM-resident bank of short UI and notification sound effects.
+ *
+ * The declared effects (any format audio_decoder.h accepts) are read from the
+ * SD card once at startup, decoded to the mixer bus format (16-bit stereo at
+ * AUDIO_OUTPUT_SAMPLE_RATE) and kept in PSRAM, so playing one by ID involves no
+ * file I/O or conversion and keeps working when the card is absent or
+ * unmounted. Effects that cannot be loaded are replaced by a short synthesized
+ * chime so callers always have something to play.
+ */
+#ifndef AUDIO_SOUND_BANK_H
+#define AUDIO_SOUND_BANK_H
+
+#include <stdint.h>
+#include "audio_wav.h"
+
+/**
+ * @brief Identifiers of the preloaded sound effects.
+ */
+typedef enum {
+    AUDIO_SOUND_NOTIFICATION, //!< UI_SOUND_NOTIFICATION
+    AUDIO_SOUND_SUCCESS,      //!< UI_SOUND_SUCCESS
+    AUDIO_SOUND_ERROR,        //!< UI_SOUND_ERROR
+    AUDIO_SOUND_CLICK,        //!< UI_SOUND_CLICK
+    AUDIO_SOUND_COUNT
+} audio_sound_id_t;
+
+/**
+ * @brief A sound effect held in memory, ready to be streamed to the output.
+ */
+typedef struct {
+    const uint8_t* data;       //!< 16-bit stereo samples at AUDIO_OUTPUT_SAMPLE_RATE, in PSRAM.
+    audio_wav_info_t format;   //!< Format of the samples; `data_size` is the length of `data`.
+    const char* name;          //!< Source filename, for logging.
+    bool synthesized;          //!< True if the file could not be loaded and a fallback chime is used.
+} audio_sound_clip_t;
+
+/**
+ * @brief Loads every declared effect into PSRAM.
+ *
+ * Can be called again later (e.g. after the SD card is inserted) to replace
+ * synthesized fallbacks with the real files; effects already loaded from the
+ * card are kept as they are.
+ */
+void audio_sound_bank_load(void);
+
+/**
+ * @brief Gets a preloaded effect.
+ *
+ * The clip is copied out so it stays consistent even if the bank is reloaded
+ * concurrently. The sample memory it points to is never freed.
+ *
+ * @param id The effect identifier.
+ * @param clip Output structure for the clip.
+ * @return true if the effect is available, false if the ID is invalid or the bank has not been loaded.
+ */
+bool audio_sound_bank_get(audio_sound_id_t id, audio_sound_clip_t* clip);
+
+#endif // AUDIO_SOUND_BANK_H
@@ -0,0 +1,141 @@
+#include "audio_spectrum.h"
+#include <string.h>
+#include <math.h>
+
+#define N AUDIO_SPECTRUM_FFT_SIZE
+
+// --- BANDS ---
+#define BAND_MIN_HZ 50.0f
+#define BAND_MAX_HZ 16000.0f
+
+// --- LEVEL SCALE ---
+// The FFT scales by 1/N, so a full-scale sine under the Hann window peaks at a
+// bin power of about 2^26. Bars span RANGE_DB below that.
+#define FULL_SCALE_LOG2_Q8 (26 * 256)
+#define RANGE_DB 72
+#define RANGE_LOG2_Q8 ((RANGE_DB * 256 * 1000) / 3010) // dB -> log2 of power, Q8.
+
+// --- SMOOTHING (per spectrum frame, Q8 fractions of the distance to the target) ---
+#define ATTACK_Q8 192 // Rises most of the way in one frame.
+#define DECAY_Q8 40   // Falls ~16% per frame, ~200 ms to settle at 30 Hz.
+
+// log2(x) in Q8: integer part from the top set bit, fraction by linear interpolation
+// of the next 8 bits (error below 0.09, i.e. ~0.26 dB).
+static int32_t log2_q8(uint64_t x) {
+    if (x == 0) return 0;
+    const int msb = 63 - __builtin_clzll(x);
+    const uint32_t frac = (msb >= 8) ? (uint32_t)(x >> (msb - 8)) & 0xFF : (uint32_t)(x << (8 - msb)) & 0xFF;
+    return msb * 256 + (int32_t)frac;
+}
+
+// In-place radix-2 decimation-in-time FFT with a 1/2 scale per stage (1/N overall),
+// so the int16 buffers cannot overflow.
+static void fft_q15(audio_spectrum_t* an) {
+    int16_t* re = an->re;
+    int16_t* im = an->im;
+
+    for (uint32_t i = 1, j = 0; i < N; i++) {
+        uint32_t bit = N >> 1;
+        for (; j & bit; bit >>= 1) j ^= bit;
+        j |= bit;
+        if (i < j) {
+            int16_t t = re[i]; re[i] = re[j]; re[j] = t;
+            t = im[i]; im[i] = im[j]; im[j] = t;
+        }
+    }
+
+    for (uint32_t len = 2; len <= N; len <<= 1) {
+        const uint32_t half = len >> 1;
+        const uint32_t tw_step = N / len;
+        for (uint32_t start = 0; start < N; start += len) {
+            for (uint32_t k = 0; k < half; k++) {
+                const int32_t wr = an->cos_tab[k * tw_step];
+                const int32_t wi = -an->sin_tab[k * tw_step];
+                const uint32_t a = start + k;
+                const uint32_t b = a + half;
+                const int32_t tr = (wr * re[b] - wi * im[b]) >> 15;
+                const int32_t ti = (wr * im[b] + wi * re[b]) >> 15;
+                const int32_t ar = re[a];
+                const int32_t ai = im[a];
+                re[b] = (int16_t)((ar - tr) >> 1);
+                im[b] = (int16_t)((ai - ti) >> 1);
+                re[a] = (int16_t)((ar + tr) >> 1);
+                im[a] = (int16_t)((ai + ti) >> 1);
+            }
+        }
+    }
+}
+
+void audio_spectrum_init(audio_spectrum_t* an, uint32_t sample_rate, uint8_t bar_count) {
+    memset(an, 0, sizeof(audio_spectrum_t));
+    if (bar_count == 0) bar_count = 1;
+    if (bar_count > AUDIO_SPECTRUM_MAX_BARS) bar_count = AUDIO_SPECTRUM_MAX_BARS;
+    an->bar_count = bar_count;
+    an->hop = sample_rate / AUDIO_SPECTRUM_RATE_HZ;
+
+    for (int i = 0; i < N; i++) {
+        an->window[i] = (int16_t)lrintf(32767.0f * 0.5f * (1.0f - cosf(2.0f * (float)M_PI * i / N)));
+    }
+    for (int i = 0; i < N / 2; i++) {
+        an->cos_tab[i] = (int16_t)lrintf(32767.0f * cosf(2.0f * (float)M_PI * i / N));
+        an->sin_tab[i] = (int16_t)lrintf(32767.0f * sinf(2.0f * (float)M_PI * i / N));
+    }
+
+    // Log-spaced band edges. Low bands narrower than a bin are widened to one
+    // bin, which pushes the following edges up.
+    const float bin_hz = (float)sample_rate / N;
+    float max_hz = BAND_MAX_HZ;
+    if (max_hz > sample_rate / 2.0f) max_hz = sample_rate / 2.0f;
+    uint32_t prev = 0;
+    for (int b = 0; b <= bar_count; b++) {
+        const float hz = BAND_MIN_HZ * powf(max_hz / BAND_MIN_HZ, (float)b / bar_count);
+        uint32_t bin = (uint32_t)lrintf(hz / bin_hz);
+        if (bin < 1) bin = 1;
+        if (b > 0 && bin <= prev) bin = prev + 1;
+        if (bin > N / 2) bin = N / 2;
+        an->band_start[b] = (uint16_t)bin;
+        prev = bin;
+    }
+}
+
+void audio_spectrum_reset(audio_spectrum_t* an) {
+    memset(an->history, 0, sizeof(an->history));
+    an->since_last = 0;
+}
+
+bool audio_spectrum_push(audio_spectrum_t* an, const int16_t* mono, size_t samples, uint8_t* bars) {
+    bool updated = false;
+    for (size_t i = 0; i < samples; i++) {
+        an->history[an->write_pos] = mono[i];
+        an->write_pos = (an->write_pos + 1) & (N - 1);
+        if (++an->since_last < an->hop) continue;
+        an->since_last = 0;
+
+        // Window the last N samples, oldest first.
+        for (uint32_t k = 0; k < N; k++) {
+            const int16_t s = an->history[(an->write_pos + k) & (N - 1)];
+            an->re[k] = (int16_t)(((int32_t)s * an->window[k]) >> 15);
+            an->im[k] = 0;
+        }
+        fft_q15(an);
+
+        for (uint8_t b = 0; b < an->bar_count; b++) {
+            uint64_t power = 0;
+            for (uint32_t k = an->band_start[b]; k < an->band_start[b + 1]; k++) {
+                power += (uint32_t)((int32_t)an->re[k] * an->re[k]) + (uint32_t)((int32_t)an->im[k] * an->im[k]);
+            }
+            int32_t level = log2_q8(power) - (FULL_SCALE_LOG2_Q8 - RANGE_LOG2_Q8);
+            if (level < 0) level = 0;
+            int32_t target_q8 = (int32_t)(((int64_t)level * 255 * 256) / RANGE_LOG2_Q8);
+            if (target_q8 > 255 * 256) target_q8 = 255 * 256;
+
+            int32_t current = an->level_q8[b];
+            const int32_t rate = (target_q8 > current) ? ATTACK_Q8 : DECAY_Q8;
+            current += ((target_q8 - current) * rate) >> 8;
+            an->level_q8[b] = (uint16_t)current;
+            bars[b] = (uint8_t)(current >> 8);
+        }
+        updated = true;
+    }
+    return updated;
+}
@@ -0,0 +1,66 @@
+/**
+ * @file audio_spectrum.h
+ * @brief Fixed-point FFT spectrum analyzer for the audio visualizer.
+ *
+ * The analyzer is fed a mono tap of the output bus block by block and keeps
+ * the last AUDIO_SPECTRUM_FFT_SIZE samples. At AUDIO_SPECTRUM_RATE_HZ, independent
+ * of the block size, it runs a Hann-windowed Q15 FFT over them, sums the bin
+ * power into log-spaced frequency bands, converts each band to a 0-255 level
+ * on a dB scale and smooths it with a fast attack and slow decay. Only
+ * integer math runs per frame.
+ */
+#ifndef AUDIO_SPECTRUM_H
+#define AUDIO_SPECTRUM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define AUDIO_SPECTRUM_FFT_BITS 10
+#define AUDIO_SPECTRUM_FFT_SIZE (1 << AUDIO_SPECTRUM_FFT_BITS)
+#define AUDIO_SPECTRUM_MAX_BARS 32
+/** @brief Spectrum frames produced per second of audio. */
+#define AUDIO_SPECTRUM_RATE_HZ 30
+
+/**
+ * @brief State of one analyzer. Treat as opaque.
+ */
+typedef struct {
+    uint32_t hop;                                     //!< Samples between spectrum frames.
+    uint32_t since_last;                              //!< Samples pushed since the last frame.
+    uint32_t write_pos;                               //!< Next slot of `history`.
+    uint8_t bar_count;
+    uint16_t band_start[AUDIO_SPECTRUM_MAX_BARS + 1]; //!< First FFT bin of each band; the last entry ends the final band.
+    uint16_t level_q8[AUDIO_SPECTRUM_MAX_BARS];       //!< Smoothed bar levels (0-255 in Q8).
+    int16_t history[AUDIO_SPECTRUM_FFT_SIZE];         //!< Ring of the latest mono samples.
+    int16_t window[AUDIO_SPECTRUM_FFT_SIZE];          //!< Hann window (Q15).
+    int16_t cos_tab[AUDIO_SPECTRUM_FFT_SIZE / 2];     //!< Twiddle factors (Q15).
+    int16_t sin_tab[AUDIO_SPECTRUM_FFT_SIZE / 2];
+    int16_t re[AUDIO_SPECTRUM_FFT_SIZE];              //!< FFT work buffers.
+    int16_t im[AUDIO_SPECTRUM_FFT_SIZE];
+} audio_spectrum_t;
+
+/**
+ * @brief Builds the window, twiddle and band tables.
+ * @param an The analyzer.
+ * @param sample_rate Rate of the audio that will be pushed, in Hz.
+ * @param bar_count Number of output bars (1 to AUDIO_SPECTRUM_MAX_BARS).
+ */
+void audio_spectrum_init(audio_spectrum_t* an, uint32_t sample_rate, uint8_t bar_count);
+
+/**
+ * @brief Clears the sample history and lets the bars fall back to zero.
+ */
+void audio_spectrum_reset(audio_spectrum_t* an);
+
+/**
+ * @brief Feeds 16-bit mono samples to the analyzer.
+ *
+ * @param an The analyzer.
+ * @param mono Input samples.
+ * @param samples Number of samples.
+ * @param bars Receives `bar_count` levels (0-255) when a new spectrum frame is ready.
+ * @return true if `bars` was updated.
+ */
+bool audio_spectrum_push(audio_spectrum_t* an, const int16_t* mono, size_t samples, uint8_t* bars);
+
+#endif // AUDIO_SPECTRUM_H
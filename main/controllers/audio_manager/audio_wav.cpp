@@ -0,0 +1,69 @@
+#include "audio_wav.h"
+#include "esp_log.h"
+#include <string.h>
+
+static const char *TAG = "AUDIO_WAV";
+
+bool audio_wav_read_header(FILE* fp, audio_wav_info_t* info) {
+    if (!fp || !info) return false;
+    memset(info, 0, sizeof(audio_wav_info_t));
+
+    char riff_header[4];
+    uint32_t file_size;
+    char wave_header[4];
+
+    if (fread(riff_header, 1, 4, fp) != 4 || strncmp(riff_header, "RIFF", 4) != 0 ||
+        fread(&file_size, 1, 4, fp) != 4 ||
+        fread(wave_header, 1, 4, fp) != 4 || strncmp(wave_header, "WAVE", 4) != 0) {
+        ESP_LOGE(TAG, "Invalid RIFF/WAVE header.");
+        return false;
+    }
+
+    bool fmt_found = false;
+    bool data_found = false;
+    while (!data_found) {
+        char chunk_id[4];
+        uint32_t chunk_size;
+
+        if (fread(chunk_id, 1, 4, fp) != 4 || fread(&chunk_size, 1, 4, fp) != 4) {
+            ESP_LOGE(TAG, "Reached end of file or read error while searching for chunks.");
+            return false;
+        }
+
+        if (strncmp(chunk_id, "fmt ", 4) == 0) {
+            ESP_LOGD(TAG, "Found 'fmt ' chunk, size: %lu", chunk_size);
+            if (chunk_size < 16) {
+                ESP_LOGE(TAG, "Invalid 'fmt ' chunk size: %lu", chunk_size);
+                return false;
+            }
+            if (fread(info, 1, 16, fp) != 16) {
+                ESP_LOGE(TAG, "Truncated 'fmt ' chunk.");
+                return false;
+            }
+            if (chunk_size > 16) {
+                fseek(fp, chunk_size - 16, SEEK_CUR);
+            }
+            fmt_found = true;
+        } else if (strncmp(chunk_id, "data", 4) == 0) {
+            ESP_LOGD(TAG, "Found 'data' chunk, size: %lu", chunk_size);
+            info->data_size = chunk_size;
+            info->data_offset = (uint32_t)ftell(fp);
+            data_found = true;
+        } else {
+            char id_str[5] = {0};
+            strncpy(id_str, chunk_id, 4);
+            ESP_LOGI(TAG, "Skipping unknown chunk '%s' of size %lu", id_str, chunk_size);
+            fseek(fp, chunk_size, SEEK_CUR);
+        }
+    }
+
+    if (!fmt_found) {
+        ESP_LOGE(TAG, "Could not find essential 'fmt ' and 'data' chunks.");
+        return false;
+    }
+    if (info->byte_rate == 0) {
+        ESP_LOGE(TAG, "Byte rate is zero, cannot calculate duration.");
+        return false;
+    }
+    return true;
+}
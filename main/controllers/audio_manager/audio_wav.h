@@ -0,0 +1,38 @@
+/**
+ * @file audio_wav.h
+ * @brief Minimal RIFF/WAVE header parser shared by the playback path and the sound bank.
+ */
+#ifndef AUDIO_WAV_H
+#define AUDIO_WAV_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+/**
+ * @brief Format of a WAV stream, taken from its 'fmt ' chunk, plus the size and position of its 'data' chunk.
+ * The first six fields mirror the on-disk layout of the 16-byte PCM 'fmt ' chunk.
+ */
+typedef struct {
+    uint16_t audio_format;
+    uint16_t num_channels;
+    uint32_t sample_rate;
+    uint32_t byte_rate;
+    uint16_t block_align;
+    uint16_t bits_per_sample;
+    uint32_t data_size;
+    uint32_t data_offset; //!< File offset of the first byte of audio data, so a seek needs no chunk scan.
+} audio_wav_info_t;
+
+/**
+ * @brief Parses the RIFF header of an open WAV file.
+ *
+ * Unknown chunks before 'data' are skipped. On success the file is left
+ * positioned at the first byte of the audio data.
+ *
+ * @param fp An open file, positioned at the start of the RIFF header.
+ * @param info Output structure for the parsed format.
+ * @return true if both the 'fmt ' and 'data' chunks were found and the format is usable.
+ */
+bool audio_wav_read_header(FILE* fp, audio_wav_info_t* info);
+
+#endif // AUDIO_WAV_H
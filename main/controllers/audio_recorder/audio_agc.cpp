@@ -0,0 +1,124 @@
+#include "audio_agc.h"
+#include "config/app_config.h"
+#include "esp_log.h"
+#include <math.h>
+
+static const char *TAG = "AUDIO_AGC";
+
+// Levels are computed from the top 24 bits of the slot (the INMP441 resolution):
+// a 16-bit amplitude with 8 fractional bits.
+#define LEVEL_SHIFT 8
+#define LEVEL_FULL_SCALE_Q8 (32768 << LEVEL_SHIFT)
+// The highest gain that keeps the Q16 ramp and its steps within 32 bits (~84 dB).
+#define GAIN_LIMIT_Q16 (INT32_MAX / 2)
+
+static const audio_agc_config_t default_config = {
+    .target_dbfs = MIC_AGC_TARGET_DBFS,
+    .max_gain_db = MIC_AGC_MAX_GAIN_DB,
+    .initial_gain_db = MIC_AGC_INITIAL_GAIN_DB,
+    .noise_floor_dbfs = MIC_AGC_NOISE_FLOOR_DBFS,
+    .attack_ms = MIC_AGC_ATTACK_MS,
+    .release_ms = MIC_AGC_RELEASE_MS,
+};
+
+static int32_t db_to_gain_q16(float db) {
+    const double gain = 65536.0 * pow(10.0, db / 20.0);
+    if (gain >= GAIN_LIMIT_Q16) return GAIN_LIMIT_Q16;
+    return (gain < 1.0) ? 1 : (int32_t)lrint(gain);
+}
+
+// Gain that brings `level_q8` to `target` (a 16-bit amplitude), in Q16.
+static int32_t gain_for_level(int32_t target, int32_t level_q8) {
+    if (level_q8 <= 0) return GAIN_LIMIT_Q16;
+    const int64_t gain = ((int64_t)target << (16 + LEVEL_SHIFT)) / level_q8;
+    if (gain >= GAIN_LIMIT_Q16) return GAIN_LIMIT_Q16;
+    return (gain < 1) ? 1 : (int32_t)gain;
+}
+
+void audio_agc_init(audio_agc_t* agc, uint32_t sample_rate_hz, const audio_agc_config_t* config) {
+    if (!agc) return;
+    if (!config) config = &default_config;
+
+    agc->target = (int32_t)lrintf(32767.0f * powf(10.0f, fminf(config->target_dbfs, 0.0f) / 20.0f));
+    if (agc->target < 1) agc->target = 1;
+    agc->max_gain_q16 = db_to_gain_q16(config->max_gain_db);
+    agc->initial_gain_q16 = db_to_gain_q16(fminf(config->initial_gain_db, config->max_gain_db));
+    agc->noise_floor_q8 = (int32_t)lrintf(LEVEL_FULL_SCALE_Q8 * powf(10.0f, fminf(config->noise_floor_dbfs, 0.0f) / 20.0f));
+    agc->attack_frames = (uint32_t)(((uint64_t)config->attack_ms * sample_rate_hz) / 1000);
+    agc->release_frames = (uint32_t)(((uint64_t)config->release_ms * sample_rate_hz) / 1000);
+    audio_agc_reset(agc);
+
+    ESP_LOGD(TAG, "AGC: target %.1f dBFS, max gain %.1f dB, noise floor %.1f dBFS, attack %lu ms, release %lu ms.",
+             config->target_dbfs, config->max_gain_db, config->noise_floor_dbfs, config->attack_ms, config->release_ms);
+}
+
+void audio_agc_reset(audio_agc_t* agc) {
+    if (!agc) return;
+    agc->gain_q16 = agc->initial_gain_q16;
+    // The envelope the initial gain is right for, so the gain starts out steady.
+    agc->envelope_q8 = (int32_t)(((int64_t)agc->target << (16 + LEVEL_SHIFT)) / agc->gain_q16);
+    agc->clipped = 0;
+}
+
+void audio_agc_process(audio_agc_t* agc, const int32_t* __restrict in, int16_t* __restrict out, size_t frames, uint8_t channels) {
+    if (!agc || !in || !out || frames == 0 || channels == 0) return;
+    const size_t samples = frames * channels;
+
+    // Pass 1: block peak.
+    int32_t peak = 0;
+    for (size_t i = 0; i < samples; i++) {
+        int32_t level = in[i] >> LEVEL_SHIFT;
+        if (level < 0) level = -level;
+        if (level > peak) peak = level;
+    }
+
+    // Envelope follower, one step per block. It rises towards a louder peak by
+    // at most a factor of 1 + frames / attack_frames (about a doubling per
+    // attack time), so a clap or a knock only dents the gain, and decays with
+    // a one-pole release; frames / (tau + frames) approximates the coefficient
+    // 1 - exp(-frames / tau) for any block length.
+    // Blocks below the noise floor leave the envelope, and so the gain, where
+    // the last sound above it put them: letting it decay through a pause
+    // would raise the gain until the room noise reached the target level.
+    int32_t gain_from = agc->gain_q16;
+    int32_t gain_to = gain_from;
+    if (peak >= agc->noise_floor_q8) {
+        int32_t envelope = agc->envelope_q8;
+        if (peak > envelope) {
+            const int64_t limit = envelope + (int64_t)envelope * frames / (agc->attack_frames + 1);
+            envelope = (peak < limit) ? peak : (int32_t)limit;
+        } else {
+            const int32_t coeff_q15 = (int32_t)(((uint64_t)frames << 15) / (agc->release_frames + frames));
+            envelope += (int32_t)(((int64_t)(peak - envelope) * coeff_q15) >> 15);
+        }
+        agc->envelope_q8 = (envelope > 0) ? envelope : 1;
+        gain_to = gain_for_level(agc->target, agc->envelope_q8);
+        if (gain_to > agc->max_gain_q16) gain_to = agc->max_gain_q16;
+    }
+    // Neither end of the ramp may push this block's peak past full scale. A
+    // sudden loud onset steps the gain down at the block start instead of
+    // clipping while the envelope rises.
+    const int32_t safe_gain = gain_for_level(32767, peak);
+    if (gain_to > safe_gain) gain_to = safe_gain;
+    if (gain_from > safe_gain) gain_from = safe_gain;
+
+    // Pass 2: apply the gain ramped across the block. The product of a slot
+    // (16.16) and a Q16 gain has the 16-bit sample in its high word.
+    int32_t gain = gain_from;
+    const int32_t gain_step = (gain_to - gain_from) / (int32_t)samples;
+    uint32_t clipped = 0;
+    for (size_t i = 0; i < samples; i++) {
+        int32_t sample = (int32_t)(((int64_t)in[i] * gain) >> 32);
+        gain += gain_step;
+        if (sample > 32767) { sample = 32767; clipped++; }
+        else if (sample < -32768) { sample = -32768; clipped++; }
+        out[i] = (int16_t)sample;
+    }
+    agc->gain_q16 = gain_to;
+    agc->clipped += clipped;
+}
+
+float audio_agc_get_gain_db(const audio_agc_t* agc) {
+    if (!agc || agc->gain_q16 <= 0) return 0.0f;
+    return 20.0f * log10f((float)agc->gain_q16 / 65536.0f);
+}
@@ -0,0 +1,88 @@
+/**
+ * @file audio_agc.h
+ * @brief Fixed-point automatic gain control for the I2S microphone.
+ *
+ * Used by the recorder and the WiFi streamer in place of a fixed digital gain.
+ * The AGC takes raw 32-bit I2S slots and produces 16-bit PCM, so the
+ * conversion and the gain are a single pass and the low bits of the 24-bit
+ * microphone are kept until the gain has been applied.
+ *
+ * Work is split per block: one pass finds the block peak and updates a peak
+ * envelope (rate-limited attack, slow release), the gain that brings the envelope to
+ * the target level is computed once, and a second pass applies the gain,
+ * ramped linearly from the previous block's, with one 32x32 multiply per
+ * sample. Blocks that peak below the noise floor do not move the envelope, so
+ * pauses hold the speech gain instead of pumping up room noise, and the gain
+ * is always low enough for the block's own peak to stay below full scale.
+ */
+#ifndef AUDIO_AGC_H
+#define AUDIO_AGC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief AGC parameters. The defaults (MIC_AGC_* in app_config.h) are used
+ * when NULL is passed to audio_agc_init().
+ */
+typedef struct {
+    float target_dbfs;        //!< Peak envelope level the output is brought to.
+    float max_gain_db;        //!< Highest gain applied to quiet input.
+    float initial_gain_db;    //!< Gain until the first block above the noise floor.
+    float noise_floor_dbfs;   //!< Input block peak below which the gain is held.
+    uint32_t attack_ms;       //!< Time for the envelope to double (+6 dB) on louder input.
+    uint32_t release_ms;      //!< Envelope decay time constant, i.e. how fast the gain recovers.
+} audio_agc_config_t;
+
+/**
+ * @brief AGC state. Levels are input amplitudes relative to 16-bit full scale
+ * with 8 fractional bits (|slot| >> 8); gains are Q16.
+ */
+typedef struct {
+    // Parameters.
+    int32_t target;           //!< Target output level as a 16-bit amplitude.
+    int32_t max_gain_q16;
+    int32_t initial_gain_q16;
+    int32_t noise_floor_q8;
+    uint32_t attack_frames;
+    uint32_t release_frames;
+
+    // State.
+    int32_t envelope_q8;
+    int32_t gain_q16;         //!< Gain reached at the end of the last block.
+
+    // Counters.
+    uint32_t clipped;         //!< Output samples that still had to be clipped.
+} audio_agc_t;
+
+/**
+ * @brief Initializes the AGC.
+ * @param agc The AGC instance.
+ * @param sample_rate_hz Sample rate of the microphone in Hz.
+ * @param config Parameters, or NULL for the MIC_AGC_* defaults.
+ */
+void audio_agc_init(audio_agc_t* agc, uint32_t sample_rate_hz, const audio_agc_config_t* config);
+
+/**
+ * @brief Returns to the initial gain, e.g. at the start of a new recording.
+ */
+void audio_agc_reset(audio_agc_t* agc);
+
+/**
+ * @brief Converts a block of I2S slots to 16-bit PCM with the gain applied.
+ *
+ * Interleaved channels share the gain. Blocks of any size may be passed; the
+ * envelope time constants are scaled to the block length.
+ *
+ * @param agc The AGC instance.
+ * @param in Raw 32-bit I2S slots (left-justified samples).
+ * @param out Output for frames * channels 16-bit samples. May not alias `in`.
+ * @param frames Number of frames (samples per channel) in the block.
+ * @param channels Number of interleaved channels.
+ */
+void audio_agc_process(audio_agc_t* agc, const int32_t* in, int16_t* out, size_t frames, uint8_t channels);
+
+/** @brief Current gain in dB, for logs and status displays. */
+float audio_agc_get_gain_db(const audio_agc_t* agc);
+
+#endif // AUDIO_AGC_H
@@ -1,76 +1,209 @@
 #include "audio_recorder.h"
-#include "config/board_config.h"
+#include "audio_wav_writer.h"
+#include "audio_vad.h"
+#include "controllers/mic_capture/mic_capture.h"
 #include "config/app_config.h"
 #include "esp_log.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
-#include "driver/i2s_std.h"
 #include <string.h>
 #include <sys/unistd.h>
 #include <sys/stat.h>
+#include <dirent.h>
+#include <strings.h>
 #include <errno.h>
 #include "freertos/semphr.h"
+#include "freertos/ringbuf.h"
+#include "esp_heap_caps.h"
 #include <time.h>
 #include <math.h> 
 
 static const char *TAG = "AUDIO_REC";
 
-// --- Recording Gain Factor ---
-// Due to a potentially weak input signal from the MEMS microphone,
-// it may be necessary to apply significant digital gain. A value of 10.0f is a
-// reasonable starting point. Adjust if the audio is too quiet or distorted.
-#define RECORDING_GAIN (35.0f) 
-
-// WAV file header structure
-typedef struct {
-    char     riff_header[4];
-    uint32_t wav_size;
-    char     wave_header[4];
-    char     fmt_header[4];
-    uint32_t fmt_chunk_size;
-    uint16_t audio_format;
-    uint16_t num_channels;
-    uint32_t sample_rate;
-    uint32_t byte_rate;
-    uint16_t block_align;
-    uint16_t bits_per_sample;
-    char     data_header[4];
-    uint32_t data_size;
-} wav_header_t;
+// --- CAPTURE PIPELINE ---
+// The capture task takes the microphone's 16-bit blocks (already through the
+// AGC) from its mic_capture subscription and pushes them into a PSRAM ring
+// without ever waiting: if the ring is full the block is dropped and counted.
+// The writer task moves the ring to the card through an audio_wav_writer_t
+// (large preallocated writes), which also does the IMA-ADPCM encoding, away
+// from the time-critical capture.
+#define CAPTURE_FRAMES MIC_CAPTURE_BLOCK_FRAMES   // Frames per microphone block (32 ms at 16 kHz).
+#define CAPTURE_SAMPLES MIC_CAPTURE_BLOCK_SAMPLES
+#define CAPTURE_QUEUE_BLOCKS 16     // The subscription's queue (~0.5 s).
+#define CAPTURE_TASK_PRIORITY 6     // Below the capture service, above the writer.
+#define CAPTURE_WAIT_MS 100         // Max wait for a microphone block before re-checking state.
+#define WRITER_TASK_PRIORITY 5
+#define WRITER_WAIT_MS 100          // Max wait for ring data before re-checking state.
+// Blocks of silence the capture task holds back while trimming, written ahead
+// of the next word (REC_VAD_PREROLL_MS, rounded up to whole blocks).
+#define PREROLL_BLOCKS ((REC_VAD_PREROLL_MS * REC_SAMPLE_RATE / 1000 + CAPTURE_FRAMES - 1) / CAPTURE_FRAMES)
 
 // Recorder state variables
-static TaskHandle_t recording_task_handle = NULL;
+static TaskHandle_t writer_task_handle = NULL;
+static TaskHandle_t capture_task_handle = NULL;
 static volatile audio_recorder_state_t recorder_state = RECORDER_STATE_IDLE;
 static char current_filepath[256];
-static i2s_chan_handle_t rx_chan = NULL; // Initialize to NULL for robust cleanup
+static mic_capture_subscriber_t* capture_sub = NULL; // Owned by the capture task.
 static volatile time_t start_time;
+static RingbufHandle_t capture_ringbuf = NULL;
+static volatile bool capture_done = false; // Set by the capture task once it has pushed its last block.
+static audio_recorder_stats_t recorder_stats;
+static volatile uint32_t dma_overflows = 0;     // Since the start, kept up to date by the capture task.
+static volatile uint32_t upstream_dropped_frames = 0; // Lost before the ring (DMA overflows, a full subscription queue).
+static audio_vad_t vad; // Owned by the capture task.
+static audio_recorder_options_t recorder_options;
 
-static void audio_recording_task(void *arg);
+// Armed capture. Only the caller's task (the UI) arms, disarms and starts, so
+// these need no lock; the capture task only reads `armed`.
+static volatile bool armed = false;
+static bool recording_armed = false;  // The current recording was started armed: the capture task is already running.
+static mic_capture_block_t* arm_buffer = NULL; // arm_blocks blocks, owned by the capture task while it runs.
+static uint32_t arm_blocks = 0;
+static uint32_t arm_head = 0;         // Oldest block of the history.
+static uint32_t arm_count = 0;        // Blocks in the history.
+
+static void audio_writer_task(void *arg);
+static void audio_capture_task(void *arg);
+static void capture_ringbuf_flush(void);
+
+// Waits a moment for a capture task that is shutting down (e.g. just after a
+// disarm) to end its subscription.
+static bool wait_for_capture_exit(void) {
+    for (int i = 0; i < 50 && capture_task_handle != NULL; i++) vTaskDelay(pdMS_TO_TICKS(10));
+    return capture_task_handle == NULL;
+}
 
 // --- Public Functions ---
 void audio_recorder_init(void) {
     recorder_state = RECORDER_STATE_IDLE;
+    capture_ringbuf = xRingbufferCreateWithCaps(REC_RINGBUF_SIZE, RINGBUF_TYPE_BYTEBUF, MALLOC_CAP_SPIRAM);
+    if (!capture_ringbuf) {
+        ESP_LOGE(TAG, "Failed to allocate %d byte capture ring buffer in PSRAM.", REC_RINGBUF_SIZE);
+    }
     ESP_LOGI(TAG, "Audio Recorder Initialized.");
 }
 
 bool audio_recorder_start(const char *filepath) {
+    return audio_recorder_start_with_options(filepath, NULL);
+}
+
+bool audio_recorder_start_with_options(const char *filepath, const audio_recorder_options_t *options) {
     if (recorder_state != RECORDER_STATE_IDLE) {
         ESP_LOGE(TAG, "Recorder is already busy (state: %d)", recorder_state);
         return false;
     }
+    if (!capture_ringbuf) {
+        ESP_LOGE(TAG, "Capture ring buffer not available.");
+        return false;
+    }
+    if (armed) {
+        // The previous recording's capture may still be winding down.
+        for (int i = 0; i < 50 && !capture_done; i++) vTaskDelay(pdMS_TO_TICKS(10));
+        if (!capture_done) {
+            ESP_LOGE(TAG, "Capture task still busy with the last recording.");
+            return false;
+        }
+    } else if (!wait_for_capture_exit()) {
+        ESP_LOGE(TAG, "Capture task from the last recording did not stop.");
+        return false;
+    }
     strncpy(current_filepath, filepath, sizeof(current_filepath) - 1);
+    if (options) {
+        recorder_options = *options;
+    } else {
+        memset(&recorder_options, 0, sizeof(recorder_options));
+    }
+    memset(&recorder_stats, 0, sizeof(recorder_stats));
+    recorder_stats.ring_size_bytes = REC_RINGBUF_SIZE;
+    dma_overflows = 0;
+    upstream_dropped_frames = 0;
+    capture_ringbuf_flush(); // Nothing reads the ring while idle; clear anything an aborted start left.
+    // Armed, the capture task picks the recording up as soon as the state
+    // changes; otherwise the writer starts it once the file is open.
+    recording_armed = armed;
+    capture_done = !recording_armed;
     recorder_state = RECORDER_STATE_RECORDING;
     start_time = time(NULL);
-    BaseType_t result = xTaskCreate(audio_recording_task, "audio_record", 4096, NULL, 5, &recording_task_handle);
+    BaseType_t result = xTaskCreate(audio_writer_task, "audio_rec_write", 4096, NULL, WRITER_TASK_PRIORITY, &writer_task_handle);
     if (result != pdPASS) {
-        ESP_LOGE(TAG, "Failed to create audio recording task");
+        ESP_LOGE(TAG, "Failed to create audio writer task");
         recorder_state = RECORDER_STATE_IDLE;
         return false;
     }
-    ESP_LOGI(TAG, "Audio recording task created for file: %s (Targeting %d-bit WAV with gain %.2f)", filepath, REC_BITS_PER_SAMPLE, RECORDING_GAIN);
+    ESP_LOGI(TAG, "Audio recording task created for file: %s (Targeting %s WAV with AGC, trim %s, auto-stop %lu s%s)", filepath,
+             recorder_options.encoding == AUDIO_WAV_IMA_ADPCM ? "IMA-ADPCM" : "16-bit PCM",
+             recorder_options.trim_silence ? "on" : "off", recorder_options.auto_stop_silence_s,
+             recording_armed ? ", armed pre-roll" : "");
     return true;
 }
 
+bool audio_recorder_arm(uint32_t preroll_ms) {
+    if (armed) return true;
+    if (recorder_state != RECORDER_STATE_IDLE || !wait_for_capture_exit()) {
+        ESP_LOGE(TAG, "Cannot arm: recorder busy (state: %d)", recorder_state);
+        return false;
+    }
+    const uint32_t preroll_frames = (uint32_t)(((uint64_t)preroll_ms * REC_SAMPLE_RATE) / 1000);
+    arm_blocks = (preroll_frames + CAPTURE_FRAMES - 1) / CAPTURE_FRAMES;
+    if (arm_blocks == 0) arm_blocks = 1;
+    arm_buffer = (mic_capture_block_t*)heap_caps_malloc(arm_blocks * sizeof(mic_capture_block_t), MALLOC_CAP_SPIRAM);
+    if (!arm_buffer) {
+        ESP_LOGE(TAG, "Failed to allocate the %lu ms armed pre-roll.", preroll_ms);
+        return false;
+    }
+
+    armed = true;
+    capture_done = true; // No recording yet.
+    if (xTaskCreate(audio_capture_task, "audio_capture", 3072, NULL, CAPTURE_TASK_PRIORITY, &capture_task_handle) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create audio capture task");
+        armed = false;
+        capture_task_handle = NULL;
+        heap_caps_free(arm_buffer);
+        arm_buffer = NULL;
+        return false;
+    }
+    ESP_LOGI(TAG, "Armed with %lu ms of pre-roll (%lu blocks).", preroll_ms, arm_blocks);
+    return true;
+}
+
+void audio_recorder_disarm(void) {
+    if (!armed) return;
+    ESP_LOGI(TAG, "Disarming. The microphone stops after the current recording, if any.");
+    armed = false;
+}
+
+bool audio_recorder_is_armed(void) {
+    return armed;
+}
+
+uint32_t audio_recorder_recover_dir(const char *dir) {
+    DIR* d = opendir(dir);
+    if (!d) return 0; // Nothing recorded there yet.
+
+    uint32_t repaired = 0;
+    uint32_t checked = 0;
+    char path[256];
+    struct dirent* entry;
+    while ((entry = readdir(d)) != NULL) {
+        const size_t len = strlen(entry->d_name);
+        if (entry->d_type == DT_DIR || len < 4 || strcasecmp(entry->d_name + len - 4, ".wav") != 0) continue;
+        snprintf(path, sizeof(path), "%s/%s", dir, entry->d_name);
+        checked++;
+        const audio_wav_recovery_t result = audio_wav_writer_recover(path);
+        if (result == AUDIO_WAV_REPAIRED) {
+            repaired++;
+        } else if (result == AUDIO_WAV_EMPTY) {
+            ESP_LOGW(TAG, "Deleting empty recording %s", path);
+            unlink(path);
+        }
+    }
+    closedir(d);
+    if (repaired > 0) {
+        ESP_LOGW(TAG, "Repaired %lu of %lu recordings in %s.", repaired, checked, dir);
+    }
+    return repaired;
+}
+
 void audio_recorder_stop(void) {
     if (recorder_state == RECORDER_STATE_RECORDING) {
         ESP_LOGI(TAG, "Stop command received. Signalling task to terminate and save.");
@@ -96,152 +229,325 @@ uint32_t audio_recorder_get_duration_s(void) {
     return 0;
 }
 
-// --- WAV Header Creation ---
-static void create_wav_header(wav_header_t *header, uint32_t sample_rate, uint16_t bits_per_sample, uint16_t num_channels, uint32_t data_size) {
-    memcpy(header->riff_header, "RIFF", 4);
-    memcpy(header->wave_header, "WAVE", 4);
-    memcpy(header->fmt_header, "fmt ", 4);
-    header->fmt_chunk_size = 16;
-    header->audio_format = 1;    // PCM
-    header->num_channels = num_channels;
-    header->sample_rate = sample_rate;
-    header->bits_per_sample = bits_per_sample;
-    header->byte_rate = sample_rate * num_channels * (bits_per_sample / 8);
-    header->block_align = num_channels * (bits_per_sample / 8);
-    memcpy(header->data_header, "data", 4);
-    header->data_size = data_size;
-    header->wav_size = 36 + data_size;
-}
-
-// --- Audio Recording Task with Robust Error Handling ---
-static void audio_recording_task(void *arg) {
-    FILE *fp = NULL;
-    int32_t* i2s_raw_read_buffer = NULL;
-    int16_t* file_write_buffer = NULL;
-    uint32_t total_data_bytes_written_to_file = 0;
+void audio_recorder_get_stats(audio_recorder_stats_t *stats) {
+    if (!stats) return;
+    *stats = recorder_stats;
+    stats->dma_overflows = dma_overflows;
+    stats->dropped_frames += upstream_dropped_frames;
+}
 
-    // This loop runs only once and allows using 'break' as a structured 'goto' for cleanup.
-    do {
-        fp = fopen(current_filepath, "wb");
-        if (fp == NULL) {
-            ESP_LOGE(TAG, "Failed to open file for writing: %s, error: %s", current_filepath, strerror(errno));
-            recorder_state = RECORDER_STATE_ERROR;
-            break; // Jump to cleanup
+// --- Audio Capture Task ---
+// Pushes one block into the capture ring. Never blocks: a full ring means the
+// writer is stuck, and waiting would only move the loss into the subscription.
+static void push_block(const int16_t* samples, size_t count, bool* dropping) {
+    if (xRingbufferSend(capture_ringbuf, samples, count * sizeof(int16_t), 0) != pdTRUE) {
+        if (!*dropping) ESP_LOGW(TAG, "Capture ring full, dropping audio until the writer catches up.");
+        *dropping = true;
+        recorder_stats.dropped_frames += count / REC_NUM_CHANNELS;
+        return;
+    }
+    *dropping = false;
+    uint32_t depth = REC_RINGBUF_SIZE - xRingbufferGetCurFreeSize(capture_ringbuf);
+    if (depth > recorder_stats.max_queue_depth_bytes) recorder_stats.max_queue_depth_bytes = depth;
+}
+
+// Per-recording state of the capture task.
+typedef struct {
+    int16_t* preroll;                 // Blocks of silence held back while trimming.
+    size_t preroll_samples[PREROLL_BLOCKS];
+    uint32_t preroll_head;
+    uint32_t preroll_count;
+    bool use_vad;
+    uint32_t auto_stop_frames;
+    bool dropping;
+    int32_t last_gain_q16;
+    mic_capture_stats_t losses_at_start; // Service counters when the recording started.
+    uint32_t dropped_at_start;        // Subscription losses when it started.
+} capture_ctx_t;
+
+// Runs one block through the VAD and into the ring (or the trim pre-roll).
+static void capture_block(capture_ctx_t* ctx, const mic_capture_block_t* block) {
+    const size_t frames_read = block->frames;
+    const size_t samples_read = frames_read * REC_NUM_CHANNELS;
+    recorder_stats.captured_frames += frames_read;
+    ctx->last_gain_q16 = block->gain_q16;
+    const audio_vad_action_t action = ctx->use_vad ? audio_vad_process(&vad, block->samples, frames_read, REC_NUM_CHANNELS, block->gain_q16)
+                                                   : AUDIO_VAD_WRITE;
+
+    if (action == AUDIO_VAD_DEFER) {
+        // Hold the block back; the oldest one held is left out if the pre-roll is full.
+        if (ctx->preroll_count == PREROLL_BLOCKS) {
+            recorder_stats.trimmed_frames += ctx->preroll_samples[ctx->preroll_head] / REC_NUM_CHANNELS;
+            ctx->preroll_head = (ctx->preroll_head + 1) % PREROLL_BLOCKS;
+            ctx->preroll_count--;
         }
+        const uint32_t slot = (ctx->preroll_head + ctx->preroll_count) % PREROLL_BLOCKS;
+        memcpy(ctx->preroll + slot * CAPTURE_SAMPLES, block->samples, samples_read * sizeof(int16_t));
+        ctx->preroll_samples[slot] = samples_read;
+        ctx->preroll_count++;
+    } else {
+        for (; action == AUDIO_VAD_FLUSH_AND_WRITE && ctx->preroll_count > 0; ctx->preroll_count--) {
+            push_block(ctx->preroll + ctx->preroll_head * CAPTURE_SAMPLES, ctx->preroll_samples[ctx->preroll_head], &ctx->dropping);
+            ctx->preroll_head = (ctx->preroll_head + 1) % PREROLL_BLOCKS;
+        }
+        push_block(block->samples, samples_read, &ctx->dropping);
+    }
 
-        wav_header_t wav_header;
-        create_wav_header(&wav_header, REC_SAMPLE_RATE, REC_BITS_PER_SAMPLE, REC_NUM_CHANNELS, 0);
-        fwrite(&wav_header, 1, sizeof(wav_header_t), fp);
-
-        i2s_chan_config_t chan_cfg = I2S_CHANNEL_DEFAULT_CONFIG(I2S_NUM_1, I2S_ROLE_MASTER);
-        ESP_ERROR_CHECK(i2s_new_channel(&chan_cfg, NULL, &rx_chan));
-
-        i2s_std_config_t std_cfg = {
-            .clk_cfg = {
-                .sample_rate_hz = REC_SAMPLE_RATE,
-                .clk_src = I2S_CLK_SRC_DEFAULT,
-                .ext_clk_freq_hz = 0,
-                .mclk_multiple = I2S_MCLK_MULTIPLE_256,
-            },
-            .slot_cfg = I2S_STD_PHILIPS_SLOT_DEFAULT_CONFIG(I2S_DATA_BIT_WIDTH_32BIT, (REC_NUM_CHANNELS == 2) ? I2S_SLOT_MODE_STEREO : I2S_SLOT_MODE_MONO),
-            .gpio_cfg = {
-                .mclk = I2S_GPIO_UNUSED,
-                .bclk = I2S_MIC_BCLK_PIN,
-                .ws   = I2S_MIC_WS_PIN,
-                .dout = I2S_GPIO_UNUSED,
-                .din  = I2S_MIC_DIN_PIN,
-                .invert_flags = { .mclk_inv = false, .bclk_inv = false, .ws_inv = false },
-            },
-        };
-        std_cfg.slot_cfg.slot_mask = (REC_NUM_CHANNELS == 2) ? I2S_STD_SLOT_BOTH : I2S_STD_SLOT_LEFT;
-
-        ESP_ERROR_CHECK(i2s_channel_init_std_mode(rx_chan, &std_cfg));
-        ESP_ERROR_CHECK(i2s_channel_enable(rx_chan));
-
-        const int i2s_buffer_size_bytes = 4096;
-        i2s_raw_read_buffer = (int32_t*)malloc(i2s_buffer_size_bytes);
-        if (!i2s_raw_read_buffer) {
-            ESP_LOGE(TAG, "Failed to allocate I2S read buffer");
+    if (ctx->auto_stop_frames > 0 && vad.silence_frames >= ctx->auto_stop_frames && recorder_state == RECORDER_STATE_RECORDING) {
+        // Nothing was said at all: there is nothing worth keeping.
+        ESP_LOGI(TAG, "%lu s of silence, auto-stopping (%s).", recorder_options.auto_stop_silence_s,
+                 vad.heard_speech ? "saving" : "no speech, discarding");
+        recorder_stats.auto_stopped = true;
+        recorder_state = vad.heard_speech ? RECORDER_STATE_SAVING : RECORDER_STATE_CANCELLING;
+    }
+}
+
+// Audio lost before it reached this task since the recording started.
+static void update_upstream_losses(const capture_ctx_t* ctx) {
+    mic_capture_stats_t now;
+    mic_capture_get_stats(&now);
+    dma_overflows = now.dma_overflows - ctx->losses_at_start.dma_overflows;
+    upstream_dropped_frames = (now.dma_overflow_frames - ctx->losses_at_start.dma_overflow_frames) +
+                              (mic_capture_dropped_frames(capture_sub) - ctx->dropped_at_start);
+}
+
+// Armed: keeps the last arm_blocks blocks until a recording starts or the
+// recorder is disarmed.
+static void capture_armed(void) {
+    arm_head = 0;
+    arm_count = 0;
+    while (armed && recorder_state != RECORDER_STATE_RECORDING) {
+        const mic_capture_block_t* block = mic_capture_peek(capture_sub, CAPTURE_WAIT_MS);
+        if (!block) {
+            if (mic_capture_failed(capture_sub)) {
+                ESP_LOGE(TAG, "Microphone capture failed, disarming.");
+                armed = false;
+            }
+            continue;
+        }
+        const uint32_t slot = (arm_head + arm_count) % arm_blocks;
+        memcpy(&arm_buffer[slot], block, sizeof(mic_capture_block_t));
+        mic_capture_release(capture_sub);
+        if (arm_count == arm_blocks) {
+            arm_head = (arm_head + 1) % arm_blocks; // The oldest block was just overwritten.
+        } else {
+            arm_count++;
+        }
+    }
+}
+
+// Moves the microphone into the capture ring for as long as the recorder is
+// recording, starting with the armed history, if any.
+static void capture_recording(capture_ctx_t* ctx) {
+    ctx->preroll_head = 0;
+    ctx->preroll_count = 0;
+    ctx->use_vad = recorder_options.trim_silence || recorder_options.auto_stop_silence_s > 0;
+    ctx->auto_stop_frames = recorder_options.auto_stop_silence_s * REC_SAMPLE_RATE;
+    ctx->dropping = false;
+    if (recorder_options.trim_silence && !ctx->preroll) {
+        ctx->preroll = (int16_t*)malloc(PREROLL_BLOCKS * CAPTURE_SAMPLES * sizeof(int16_t));
+        if (!ctx->preroll) {
+            ESP_LOGE(TAG, "Failed to allocate capture buffers");
             recorder_state = RECORDER_STATE_ERROR;
-            break; // Jump to cleanup
+            return;
+        }
+    }
+    audio_vad_init(&vad, REC_SAMPLE_RATE, recorder_options.trim_silence);
+    mic_capture_get_stats(&ctx->losses_at_start);
+    ctx->dropped_at_start = mic_capture_dropped_frames(capture_sub);
+
+    // The audio from just before the start goes first, through the same
+    // path, so the VAD has learnt the room by the time it ends.
+    for (; arm_count > 0; arm_count--) {
+        capture_block(ctx, &arm_buffer[arm_head]);
+        recorder_stats.preroll_frames += arm_buffer[arm_head].frames;
+        arm_head = (arm_head + 1) % arm_blocks;
+    }
+
+    ESP_LOGI(TAG, "Starting capture loop...");
+    while (recorder_state == RECORDER_STATE_RECORDING) {
+        const mic_capture_block_t* block = mic_capture_peek(capture_sub, CAPTURE_WAIT_MS);
+        if (!block) {
+            if (mic_capture_failed(capture_sub)) {
+                ESP_LOGE(TAG, "Microphone capture failed.");
+                recorder_state = RECORDER_STATE_ERROR;
+            }
+            continue;
         }
+        capture_block(ctx, block);
+        mic_capture_release(capture_sub);
+        update_upstream_losses(ctx);
+    }
 
-        const int num_samples_in_buffer = i2s_buffer_size_bytes / sizeof(int32_t);
-        const int file_write_buffer_size_bytes = num_samples_in_buffer * (REC_BITS_PER_SAMPLE / 8);
-        file_write_buffer = (int16_t*)malloc(file_write_buffer_size_bytes);
-        if (!file_write_buffer) {
-            ESP_LOGE(TAG, "Failed to allocate file write buffer");
+    // Silence still held back is the tail of the recording: it is left out.
+    for (; ctx->preroll_count > 0; ctx->preroll_count--) {
+        recorder_stats.trimmed_frames += ctx->preroll_samples[ctx->preroll_head] / REC_NUM_CHANNELS;
+        ctx->preroll_head = (ctx->preroll_head + 1) % PREROLL_BLOCKS;
+    }
+    const float gain_db = (ctx->last_gain_q16 > 0) ? 20.0f * log10f((float)ctx->last_gain_q16 / 65536.0f) : 0.0f;
+    ESP_LOGI(TAG, "Capture finished. AGC gain %.1f dB.", gain_db);
+}
+
+// Tells the writer the capture has pushed its last block.
+static void signal_capture_done(void) {
+    capture_done = true;
+    TaskHandle_t writer = writer_task_handle;
+    if (writer) xTaskNotifyGive(writer);
+}
+
+// Holds the recorder's microphone subscription. Started by the writer for a
+// single recording, or by audio_recorder_arm(), in which case it keeps the
+// subscription and a short history of the microphone between recordings
+// until disarmed.
+// It does no file I/O and never waits for the ring, so its subscription queue
+// is always emptied in time. With trimming on, silence the VAD holds back
+// waits in a small pre-roll buffer until the next word (or is left out).
+static void audio_capture_task(void *arg) {
+    capture_ctx_t ctx = {};
+
+    do {
+        if (REC_BITS_PER_SAMPLE != 16) {
+            ESP_LOGE(TAG, "Unsupported REC_BITS_PER_SAMPLE. Gain/Conversion only for 16-bit.");
+            if (recorder_state == RECORDER_STATE_RECORDING) recorder_state = RECORDER_STATE_ERROR;
+            break;
+        }
+        capture_sub = mic_capture_subscribe("recorder", CAPTURE_QUEUE_BLOCKS);
+        if (!capture_sub) {
+            if (recorder_state == RECORDER_STATE_RECORDING) recorder_state = RECORDER_STATE_ERROR;
+            break;
+        }
+
+        for (;;) {
+            if (armed) capture_armed();
+            // Set only by audio_recorder_start(), which checks `armed` first:
+            // a recording started before a disarm is still taken.
+            if (recorder_state != RECORDER_STATE_RECORDING) break;
+            capture_recording(&ctx);
+            if (!armed) break; // Single recording, or disarmed during it: done.
+            signal_capture_done();
+        }
+    } while (0); // The loop runs only once.
+
+    mic_capture_unsubscribe(capture_sub);
+    capture_sub = NULL;
+    if (ctx.preroll) free(ctx.preroll);
+    if (arm_buffer) heap_caps_free(arm_buffer);
+    arm_buffer = NULL;
+    arm_count = 0;
+    armed = false; // In case the task failed before disarming.
+
+    ESP_LOGI(TAG, "Capture task finished.");
+    capture_task_handle = NULL;
+    signal_capture_done();
+    vTaskDelete(NULL);
+}
+
+// --- Audio Writer Task ---
+// Discards whatever the capture task left in the ring, e.g. after a cancel.
+static void capture_ringbuf_flush(void) {
+    size_t item_size = 0;
+    void *item;
+    while ((item = xRingbufferReceiveUpTo(capture_ringbuf, &item_size, 0, REC_RINGBUF_SIZE)) != NULL) {
+        vRingbufferReturnItem(capture_ringbuf, item);
+    }
+}
+
+// Owns the file for one recording: creates it, starts the capture task, moves
+// the ring to the card until the capture has stopped and the ring is drained,
+// then finalizes (or deletes) the file.
+static void audio_writer_task(void *arg) {
+    static audio_wav_writer_t writer;
+    bool file_open = false;
+
+    // This loop runs only once and allows using 'break' as a structured 'goto' for cleanup.
+    do {
+        if (!audio_wav_writer_open(&writer, current_filepath, REC_SAMPLE_RATE, REC_NUM_CHANNELS, recorder_options.encoding)) {
             recorder_state = RECORDER_STATE_ERROR;
             break; // Jump to cleanup
         }
+        file_open = true;
 
-        ESP_LOGI(TAG, "Starting recording loop...");
-        while (recorder_state == RECORDER_STATE_RECORDING) {
-            size_t bytes_read_from_i2s;
-            esp_err_t result = i2s_channel_read(rx_chan, i2s_raw_read_buffer, i2s_buffer_size_bytes, &bytes_read_from_i2s, pdMS_TO_TICKS(1000));
-            
-            if (result == ESP_OK && bytes_read_from_i2s > 0) {
-                if (REC_BITS_PER_SAMPLE == 16) {
-                    int samples_read = bytes_read_from_i2s / sizeof(int32_t);
-                    for (int i = 0; i < samples_read; i++) {
-                        int32_t sample_32bit = i2s_raw_read_buffer[i];
-                        int16_t original_sample = (int16_t)(sample_32bit >> 16);
-                        int32_t amplified_sample = (int32_t)((float)original_sample * RECORDING_GAIN);
-                        if (amplified_sample > 32767) amplified_sample = 32767;
-                        else if (amplified_sample < -32768) amplified_sample = -32768;
-                        file_write_buffer[i] = (int16_t)amplified_sample;
-                    }
-
-                    size_t bytes_to_write_to_file = samples_read * sizeof(int16_t);
-                    size_t bytes_written = fwrite(file_write_buffer, 1, bytes_to_write_to_file, fp);
-                    if (bytes_written < bytes_to_write_to_file) {
-                        ESP_LOGE(TAG, "File write failed. Wrote %d of %d bytes", (int)bytes_written, (int)bytes_to_write_to_file);
-                        recorder_state = RECORDER_STATE_ERROR;
-                        break; 
-                    }
-                    total_data_bytes_written_to_file += bytes_written;
-                } else {
-                    ESP_LOGE(TAG, "Unsupported REC_BITS_PER_SAMPLE. Gain/Conversion only for 16-bit.");
-                    recorder_state = RECORDER_STATE_ERROR;
-                    break;
-                }
-            } else if (result != ESP_ERR_TIMEOUT) {
-                ESP_LOGE(TAG, "I2S read failed: %s", esp_err_to_name(result));
+        // Armed, the capture task is already running and filling the ring.
+        if (!recording_armed) {
+            capture_done = false;
+            if (xTaskCreate(audio_capture_task, "audio_capture", 3072, NULL, CAPTURE_TASK_PRIORITY, &capture_task_handle) != pdPASS) {
+                ESP_LOGE(TAG, "Failed to create audio capture task");
+                capture_done = true;
                 recorder_state = RECORDER_STATE_ERROR;
                 break;
             }
-        } // End of while (recording)
+        }
 
+        ESP_LOGI(TAG, "Starting write loop...");
+        while (recorder_state != RECORDER_STATE_CANCELLING && recorder_state != RECORDER_STATE_ERROR) {
+            // Read the flag first: if the capture had already stopped, an empty ring means it is drained.
+            const bool drained_if_empty = capture_done;
+            size_t item_size = 0;
+            uint8_t *item = (uint8_t *)xRingbufferReceiveUpTo(capture_ringbuf, &item_size, pdMS_TO_TICKS(WRITER_WAIT_MS), REC_WRITE_CHUNK_SIZE);
+            if (!item) {
+                if (drained_if_empty) break;
+                continue;
+            }
+            const bool written = audio_wav_writer_write(&writer, item, item_size);
+            if (written && recorder_options.tap.on_audio) {
+                recorder_options.tap.on_audio(item, item_size, recorder_options.tap.arg);
+            }
+            vRingbufferReturnItem(capture_ringbuf, item);
+            recorder_stats.max_write_us = writer.write_us.max_us;
+            if (!written) {
+                recorder_state = RECORDER_STATE_ERROR;
+                break;
+            }
+        }
     } while(0); // The loop runs only once.
 
     // --- Centralized Cleanup Block ---
+    // The state is no longer RECORDING, so the capture task is on its way out.
+    while (!capture_done) ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(WRITER_WAIT_MS));
+    capture_ringbuf_flush();
+
+    if (file_open) {
+        if (recorder_state == RECORDER_STATE_SAVING) {
+            if (audio_wav_writer_finalize(&writer)) {
+                recorder_stats.saved = true;
+            } else {
+                recorder_state = RECORDER_STATE_ERROR;
+            }
+            recorder_stats.max_write_us = writer.write_us.max_us;
+        } else {
+            audio_wav_writer_close(&writer);
+        }
+    }
+
     audio_recorder_state_t final_state = recorder_state;
     ESP_LOGI(TAG, "Recording task stopping. Reason: State changed to %d", final_state);
-
-    if (i2s_raw_read_buffer) free(i2s_raw_read_buffer);
-    if (file_write_buffer) free(file_write_buffer);
-    if (rx_chan) {
-        i2s_channel_disable(rx_chan);
-        i2s_del_channel(rx_chan);
-        rx_chan = NULL;
+    audio_recorder_stats_t stats;
+    audio_recorder_get_stats(&stats);
+    if (recorder_options.trim_silence) {
+        ESP_LOGI(TAG, "Trimmed %lu of %lu frames of silence (%lu%%).", stats.trimmed_frames, stats.captured_frames,
+                 stats.captured_frames ? (uint32_t)((uint64_t)stats.trimmed_frames * 100 / stats.captured_frames) : 0);
+    }
+    if (stats.dropped_frames > 0) {
+        ESP_LOGW(TAG, "Recording lost %lu frames (%lu DMA overflows). Max queue depth %lu/%lu bytes, slowest write %lu us.",
+                 stats.dropped_frames, stats.dma_overflows, stats.max_queue_depth_bytes, stats.ring_size_bytes, stats.max_write_us);
+    } else {
+        ESP_LOGI(TAG, "Max queue depth %lu/%lu bytes, slowest write %lu us.",
+                 stats.max_queue_depth_bytes, stats.ring_size_bytes, stats.max_write_us);
+    }
+    if (writer.checkpoint_us.count > 0) {
+        ESP_LOGI(TAG, "%lu header checkpoints, mean %lu us, slowest %lu us.", writer.checkpoint_us.count,
+                 audio_histogram_mean(&writer.checkpoint_us), writer.checkpoint_us.max_us);
     }
 
-    if (fp) {
-        if (final_state == RECORDER_STATE_SAVING && total_data_bytes_written_to_file > 0) {
-            ESP_LOGI(TAG, "Finalizing WAV file. Updating header with final data size: %lu", total_data_bytes_written_to_file);
-            fseek(fp, 0, SEEK_SET);
-            wav_header_t final_header;
-            create_wav_header(&final_header, REC_SAMPLE_RATE, REC_BITS_PER_SAMPLE, REC_NUM_CHANNELS, total_data_bytes_written_to_file);
-            fwrite(&final_header, 1, sizeof(wav_header_t), fp);
+    if (file_open && (final_state == RECORDER_STATE_CANCELLING || final_state == RECORDER_STATE_ERROR)) {
+        ESP_LOGI(TAG, "Recording cancelled or errored. Deleting file: %s", current_filepath);
+        if (unlink(current_filepath) != 0) {
+            ESP_LOGE(TAG, "Failed to delete temporary file %s. Error: %s", current_filepath, strerror(errno));
         }
-        fclose(fp);
+    }
 
-        if (final_state == RECORDER_STATE_CANCELLING || final_state == RECORDER_STATE_ERROR) {
-            ESP_LOGI(TAG, "Recording cancelled or errored. Deleting file: %s", current_filepath);
-            if (unlink(current_filepath) != 0) {
-                ESP_LOGE(TAG, "Failed to delete temporary file %s. Error: %s", current_filepath, strerror(errno));
-            }
-        }
+    if (recorder_options.tap.on_end) {
+        recorder_options.tap.on_end(recorder_stats.saved, recorder_options.tap.arg);
     }
 
     if (final_state != RECORDER_STATE_ERROR) {
@@ -249,6 +555,6 @@ static void audio_recording_task(void *arg) {
     }
 
     ESP_LOGI(TAG, "Recording task finished and cleaned up for %s.", current_filepath);
-    recording_task_handle = NULL;
+    writer_task_handle = NULL;
     vTaskDelete(NULL); // The task self-deletes
 }
\ No newline at end of file
@@ -2,15 +2,30 @@
  * @file audio_recorder.h
  * @brief Manages audio recording from an I2S microphone to a WAV file.
  *
- * This controller operates in a dedicated FreeRTOS task to prevent blocking
- * the main application. It handles I2S configuration, file writing, and
- * correctly formatting the WAV header upon completion.
+ * This controller operates in dedicated FreeRTOS tasks to prevent blocking
+ * the main application: a capture task only moves the microphone blocks of
+ * its mic_capture subscription (16-bit, after the AGC) into a PSRAM ring
+ * buffer, and a writer task empties it to the SD card in large sector-aligned
+ * writes, so a slow card write never holds up the microphone. It handles file
+ * writing and correctly formatting the WAV header upon completion.
+ * Optionally, a voice activity detector trims silence and stops the recording
+ * once the speaker has gone quiet, and the file is stored as IMA-ADPCM
+ * (a quarter of the size of PCM) instead of 16-bit PCM.
+ *
+ * Starting the microphone takes a few hundred milliseconds (unless another
+ * subscriber already runs it), which would cut off the start of whatever is
+ * said as the user presses record. A view can arm the recorder instead: the
+ * microphone then runs in the background,
+ * keeping only its last few hundred milliseconds, and a recording starts
+ * with that history.
  */
 #ifndef AUDIO_RECORDER_H
 #define AUDIO_RECORDER_H
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
+#include "audio_wav_writer.h"
 
 /**
  * @brief States for the audio recorder.
@@ -20,9 +35,49 @@ typedef enum {
     RECORDER_STATE_RECORDING, //!< Actively recording audio.
     RECORDER_STATE_SAVING,    //!< Stop requested, finalizing WAV header.
     RECORDER_STATE_CANCELLING,//!< Cancel requested, stopping and deleting the file.
-    RECORDER_STATE_ERROR      //!< An error occurred (e.g., I2S read/write fail).
+    RECORDER_STATE_ERROR      //!< An error occurred (e.g., microphone or write failure).
 } audio_recorder_state_t;
 
+/**
+ * @brief Capture buffer health counters of the current (or last) recording.
+ */
+typedef struct {
+    uint32_t dropped_frames;        //!< Frames lost because the ring or the subscription queue was full, or the I2S DMA queue overflowed.
+    uint32_t dma_overflows;         //!< I2S DMA buffers overwritten before the capture service read them.
+    uint32_t max_queue_depth_bytes; //!< Highest ring fill level seen.
+    uint32_t ring_size_bytes;       //!< Configured ring size (REC_RINGBUF_SIZE).
+    uint32_t max_write_us;          //!< Longest single SD write.
+    uint32_t captured_frames;       //!< Frames read from the microphone.
+    uint32_t trimmed_frames;        //!< Frames of silence left out by trim_silence.
+    uint32_t preroll_frames;        //!< Frames captured before the start, while armed (part of captured_frames).
+    bool auto_stopped;              //!< The recording was ended by auto_stop_silence_s.
+    bool saved;                     //!< The recording was finalized and kept.
+} audio_recorder_stats_t;
+
+/**
+ * @brief Receives the audio of a recording as it is written, e.g. to upload it while recording.
+ *
+ * Both callbacks run on the writer task and must not block: a slow tap holds
+ * up the card writes.
+ */
+typedef struct {
+    void (*on_audio)(const void* pcm, size_t len, void* arg); //!< 16-bit PCM as it goes to the file, after trimming.
+    void (*on_end)(bool saved, void* arg);  //!< Once the file is finalized (saved) or deleted. Called exactly once
+                                            //!< if the recording started, and never after that.
+    void* arg;                              //!< Passed to both.
+} audio_recorder_tap_t;
+
+/**
+ * @brief Options for audio_recorder_start_with_options().
+ */
+typedef struct {
+    bool trim_silence;              //!< Leave out leading and trailing silence and shorten long pauses (see audio_vad.h).
+    uint32_t auto_stop_silence_s;   //!< Stop and save after this much silence, 0 to record until stopped.
+                                    //!< A recording without any speech is discarded instead.
+    audio_wav_encoding_t encoding;  //!< File encoding, AUDIO_WAV_PCM_16 by default.
+    audio_recorder_tap_t tap;       //!< Optional copy of the audio; on_audio NULL for none.
+} audio_recorder_options_t;
+
 /**
  * @brief Initializes the audio recorder manager. Must be called once at startup.
  */
@@ -36,6 +91,51 @@ void audio_recorder_init(void);
  */
 bool audio_recorder_start(const char *filepath);
 
+/**
+ * @brief Starts recording with voice activity and encoding options.
+ *
+ * @param filepath The full path of the .wav file to create on the filesystem.
+ * @param options Silence trimming, auto-stop and encoding settings, or NULL for the defaults
+ *                (no trimming, no auto-stop, 16-bit PCM).
+ * @return true if the recording task was successfully started, false otherwise.
+ */
+bool audio_recorder_start_with_options(const char *filepath, const audio_recorder_options_t *options);
+
+/**
+ * @brief Keeps the microphone running between recordings, so a recording
+ * starts with the last `preroll_ms` of audio before audio_recorder_start().
+ *
+ * While armed, the capture task only copies the microphone blocks into a
+ * small PSRAM history (no file access). Arm when a recording view opens and
+ * disarm when it closes: the microphone stays powered and clocked meanwhile.
+ * Arming, disarming and starting must be done from the same task.
+ *
+ * @param preroll_ms Audio kept ahead of the start, rounded up to whole capture blocks (32 ms).
+ * @return true if armed (or already armed), false if the recorder is busy or out of memory.
+ */
+bool audio_recorder_arm(uint32_t preroll_ms);
+
+/**
+ * @brief Stops the armed microphone. A recording in progress is not affected;
+ * the microphone stops when it ends.
+ */
+void audio_recorder_disarm(void);
+
+/**
+ * @brief Checks whether the recorder is armed.
+ */
+bool audio_recorder_is_armed(void);
+
+/**
+ * @brief Repairs the recordings in a directory that were cut short by a
+ * reset or power loss (see audio_wav_writer_recover()). Call it at boot,
+ * once the SD card is mounted and before anything records.
+ *
+ * @param dir Absolute path of the directory; a missing directory is not an error.
+ * @return Number of recordings repaired.
+ */
+uint32_t audio_recorder_recover_dir(const char *dir);
+
 /**
  * @brief Stops the current recording and saves the file.
  * Signals the recording task to finalize the WAV header and terminate.
@@ -58,5 +158,12 @@ audio_recorder_state_t audio_recorder_get_state(void);
  */
 uint32_t audio_recorder_get_duration_s(void);
 
+/**
+ * @brief Gets the capture buffer health counters of the current or last recording.
+ * The counters are reset when a new recording starts.
+ * @param stats Pointer to the structure to fill.
+ */
+void audio_recorder_get_stats(audio_recorder_stats_t *stats);
+
 
 #endif // AUDIO_RECORDER_H
\ No newline at end of file
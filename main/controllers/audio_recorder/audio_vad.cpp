@@ -0,0 +1,103 @@
+#include "audio_vad.h"
+#include "config/app_config.h"
+#include <math.h>
+
+// Levels are of the 16-bit samples, with the AGC gain taken back out.
+#define LEVEL_FULL_SCALE_SQUARED (2.0 * 32768.0 * 32768.0)
+
+// A block moderately above the noise floor also counts as speech if it
+// crosses zero often, like the hiss of a fricative (more than ~2 kHz).
+#define FRICATIVE_MARGIN_DB 4.0f
+#define FRICATIVE_MIN_ZCR 250  // Zero crossings per 1000 samples.
+// Blocks quieter than this are never speech, whatever the noise floor does:
+// it sits just above the self-noise of the INMP441.
+#define ABSOLUTE_MIN_DB (-78.0f)
+// The noise floor follows quieter blocks down at once and creeps up by this
+// much per second, so a long stretch of speech barely moves it.
+#define NOISE_RISE_DB_PER_S 1.0f
+
+void audio_vad_init(audio_vad_t* vad, uint32_t sample_rate_hz, bool trim) {
+    if (!vad) return;
+    *vad = {};
+    vad->trim = trim;
+    vad->sample_rate = sample_rate_hz;
+}
+
+static bool block_is_active(audio_vad_t* vad, const int16_t* pcm, size_t samples, int32_t gain_q16, float block_s) {
+    int64_t sum = 0;
+    int64_t sum_squares = 0;
+    uint32_t crossings = 0;
+    bool positive = false;
+    for (size_t i = 0; i < samples; i++) {
+        const int32_t x = pcm[i] - vad->dc;
+        sum += x;
+        sum_squares += (int64_t)x * x;
+        const bool now_positive = x > 0;
+        if (i > 0 && now_positive != positive) crossings++;
+        positive = now_positive;
+    }
+    vad->dc += (int32_t)(sum / (int64_t)samples);
+    vad->zero_crossings = (uint32_t)(((uint64_t)crossings * 1000) / samples);
+
+    const double mean_square = (double)sum_squares / (double)samples;
+    const double gain = (gain_q16 > 0) ? gain_q16 / 65536.0 : 1.0;
+    vad->energy_db = (mean_square > 0.0) ? (float)(10.0 * log10(mean_square / (gain * gain * LEVEL_FULL_SCALE_SQUARED))) : -150.0f;
+
+    if (!vad->noise_valid || vad->energy_db < vad->noise_db) {
+        vad->noise_db = vad->energy_db;
+        vad->noise_valid = true;
+    } else {
+        vad->noise_db += NOISE_RISE_DB_PER_S * block_s;
+    }
+
+    if (vad->energy_db < ABSOLUTE_MIN_DB) return false;
+    const float above_noise = vad->energy_db - vad->noise_db;
+    return above_noise >= REC_VAD_THRESHOLD_DB ||
+           (above_noise >= FRICATIVE_MARGIN_DB && vad->zero_crossings >= FRICATIVE_MIN_ZCR);
+}
+
+audio_vad_action_t audio_vad_process(audio_vad_t* vad, const int16_t* pcm, size_t frames, uint8_t channels, int32_t gain_q16) {
+    if (!vad || !pcm || frames == 0 || channels == 0) return AUDIO_VAD_WRITE;
+    const bool was_speech = vad->speech;
+
+    // --- Detector ---
+    const float block_s = (float)frames / (float)vad->sample_rate;
+    if (block_is_active(vad, pcm, frames * channels, gain_q16, block_s)) {
+        vad->active_run++;
+    } else {
+        vad->active_run = 0;
+    }
+    if (vad->active_run >= AUDIO_VAD_ONSET_BLOCKS || (was_speech && vad->active_run > 0)) {
+        vad->hangover_frames = (uint32_t)(((uint64_t)REC_VAD_HANGOVER_MS * vad->sample_rate) / 1000);
+        vad->speech = true;
+    } else if (vad->hangover_frames > frames) {
+        vad->hangover_frames -= frames;
+    } else {
+        vad->hangover_frames = 0;
+        vad->speech = false;
+    }
+
+    if (vad->speech) {
+        vad->heard_speech = true;
+        vad->silence_frames = 0;
+        vad->pause_written_frames = 0;
+    } else {
+        vad->silence_frames += frames;
+    }
+
+    // --- Trimmer ---
+    if (!vad->trim) return AUDIO_VAD_WRITE;
+    if (vad->speech) return was_speech ? AUDIO_VAD_WRITE : AUDIO_VAD_FLUSH_AND_WRITE;
+    if (!vad->heard_speech) return AUDIO_VAD_DEFER; // Leading silence.
+
+    // A pause: write its start, hold the rest back. With the hangover before
+    // it and the pre-roll written ahead of the next word, no pause exceeds the maximum.
+    const uint32_t kept_ms = REC_VAD_HANGOVER_MS + REC_VAD_PREROLL_MS;
+    const uint32_t head_ms = (REC_VAD_MAX_PAUSE_MS > kept_ms) ? REC_VAD_MAX_PAUSE_MS - kept_ms : 0;
+    const uint32_t pause_head_frames = (uint32_t)(((uint64_t)head_ms * vad->sample_rate) / 1000);
+    if (vad->pause_written_frames + frames <= pause_head_frames) {
+        vad->pause_written_frames += frames;
+        return AUDIO_VAD_WRITE;
+    }
+    return AUDIO_VAD_DEFER;
+}
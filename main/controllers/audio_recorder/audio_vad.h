@@ -0,0 +1,83 @@
+/**
+ * @file audio_vad.h
+ * @brief Energy / zero-crossing voice activity detector and silence trimmer for the recorder.
+ *
+ * The detector runs once per capture block on the 16-bit microphone audio,
+ * with the block's AGC gain taken back out so its levels do not move with
+ * the gain (see mic_capture.h). A block is active when its
+ * energy is well above a tracked noise floor, or moderately above it with the
+ * high zero-crossing rate of a fricative ("s", "f"). Speech starts after
+ * AUDIO_VAD_ONSET_BLOCKS active blocks in a row, which rejects clicks, and
+ * ends REC_VAD_HANGOVER_MS after the last active block.
+ *
+ * With trimming on, the VAD also tells the recorder what to do with each block:
+ * silence before the first word is held back, pauses longer than
+ * REC_VAD_MAX_PAUSE_MS are shortened, and silence after the last word is cut
+ * to the same length. Held-back blocks are kept by the caller in a pre-roll
+ * buffer of REC_VAD_PREROLL_MS, which is written ahead of the next word so its
+ * onset is never clipped.
+ */
+#ifndef AUDIO_VAD_H
+#define AUDIO_VAD_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/** @brief Active blocks in a row needed to start speech. */
+#define AUDIO_VAD_ONSET_BLOCKS 2
+
+/**
+ * @brief What the recorder does with a block.
+ */
+typedef enum {
+    AUDIO_VAD_WRITE,            //!< Write the block.
+    AUDIO_VAD_DEFER,            //!< Hold it in the pre-roll buffer, dropping the oldest held block if full.
+    AUDIO_VAD_FLUSH_AND_WRITE,  //!< Write the pre-roll buffer, then the block.
+} audio_vad_action_t;
+
+/**
+ * @brief Detector and trimmer state.
+ */
+typedef struct {
+    bool trim;                  //!< Trim silence, or only detect it.
+    uint32_t sample_rate;
+
+    // Detector.
+    float noise_db;             //!< Tracked noise floor (block energy in dBFS).
+    bool noise_valid;
+    int32_t dc;                 //!< Input DC offset (16-bit scale, after the gain), for the zero crossings.
+    uint32_t active_run;        //!< Active blocks in a row.
+    uint32_t hangover_frames;   //!< Frames of speech left after the last active block.
+
+    // Trimmer.
+    uint32_t pause_written_frames; //!< Silence written since the speech ended.
+
+    // Results, valid after each audio_vad_process() call.
+    bool speech;                //!< The block is part of speech (including the hangover).
+    bool heard_speech;          //!< Speech was detected at least once since the reset.
+    uint32_t silence_frames;    //!< Frames since the end of the last speech (or since the reset).
+    float energy_db;            //!< Energy of the block in dBFS.
+    uint32_t zero_crossings;    //!< Zero crossings per 1000 samples in the block.
+} audio_vad_t;
+
+/**
+ * @brief Initializes the VAD.
+ * @param vad The VAD instance.
+ * @param sample_rate_hz Sample rate of the microphone in Hz.
+ * @param trim true to return trimming actions, false to always return AUDIO_VAD_WRITE.
+ */
+void audio_vad_init(audio_vad_t* vad, uint32_t sample_rate_hz, bool trim);
+
+/**
+ * @brief Classifies one capture block.
+ *
+ * @param vad The VAD instance.
+ * @param pcm Interleaved 16-bit samples.
+ * @param frames Number of frames in the block.
+ * @param channels Number of interleaved channels.
+ * @param gain_q16 Gain (Q16) the samples were amplified by, taken out of the levels.
+ * @return What to do with the block.
+ */
+audio_vad_action_t audio_vad_process(audio_vad_t* vad, const int16_t* pcm, size_t frames, uint8_t channels, int32_t gain_q16);
+
+#endif // AUDIO_VAD_H
@@ -0,0 +1,416 @@
+#include "audio_wav_writer.h"
+#include "config/app_config.h"
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/unistd.h>
+#include <sys/stat.h>
+
+static const char *TAG = "WAV_WRITER";
+
+// WAV file header structure
+typedef struct {
+    char     riff_header[4];
+    uint32_t wav_size;
+    char     wave_header[4];
+    char     fmt_header[4];
+    uint32_t fmt_chunk_size;
+    uint16_t audio_format;
+    uint16_t num_channels;
+    uint32_t sample_rate;
+    uint32_t byte_rate;
+    uint16_t block_align;
+    uint16_t bits_per_sample;
+    char     data_header[4];
+    uint32_t data_size;
+} wav_header_t;
+
+// IMA-ADPCM header: the 'fmt ' chunk carries the frames per block, and a
+// 'fact' chunk the length in frames (the last block may be padded).
+typedef struct {
+    char     riff_header[4];
+    uint32_t wav_size;
+    char     wave_header[4];
+    char     fmt_header[4];
+    uint32_t fmt_chunk_size;
+    uint16_t audio_format;
+    uint16_t num_channels;
+    uint32_t sample_rate;
+    uint32_t byte_rate;
+    uint16_t block_align;
+    uint16_t bits_per_sample;
+    uint16_t extra_size;
+    uint16_t frames_per_block;
+    char     fact_header[4];
+    uint32_t fact_chunk_size;
+    uint32_t total_frames;
+    char     data_header[4];
+    uint32_t data_size;
+} wav_ima_header_t;
+
+static_assert(sizeof(wav_header_t) == 44, "wav_header_t must not be padded");
+static_assert(sizeof(wav_ima_header_t) == 60, "wav_ima_header_t must not be padded");
+static_assert(REC_WRITE_CHUNK_SIZE % 512 == 0, "REC_WRITE_CHUNK_SIZE must be a multiple of the sector size");
+static_assert(REC_PREALLOC_EXTENT_SIZE % REC_WRITE_CHUNK_SIZE == 0, "REC_PREALLOC_EXTENT_SIZE must be a multiple of REC_WRITE_CHUNK_SIZE");
+
+// --- WAV Header Creation ---
+// Fills `out` (at least sizeof(wav_ima_header_t) bytes) with the header for
+// `data_bytes` of audio holding `frames` frames and returns its size.
+static size_t create_wav_header(const audio_wav_writer_t* writer, uint8_t* out, uint32_t data_bytes, uint32_t frames) {
+    if (writer->encoding == AUDIO_WAV_IMA_ADPCM) {
+        wav_ima_header_t header;
+        memcpy(header.riff_header, "RIFF", 4);
+        memcpy(header.wave_header, "WAVE", 4);
+        memcpy(header.fmt_header, "fmt ", 4);
+        header.fmt_chunk_size = 20;
+        header.audio_format = AUDIO_IMA_ADPCM_WAV_FORMAT;
+        header.num_channels = writer->num_channels;
+        header.sample_rate = writer->sample_rate;
+        header.byte_rate = (uint32_t)(((uint64_t)writer->sample_rate * writer->block_align) / writer->block_frames);
+        header.block_align = writer->block_align;
+        header.bits_per_sample = 4;
+        header.extra_size = 2;
+        header.frames_per_block = (uint16_t)writer->block_frames;
+        memcpy(header.fact_header, "fact", 4);
+        header.fact_chunk_size = 4;
+        header.total_frames = frames;
+        memcpy(header.data_header, "data", 4);
+        header.data_size = data_bytes;
+        header.wav_size = sizeof(wav_ima_header_t) - 8 + data_bytes;
+        memcpy(out, &header, sizeof(header));
+        return sizeof(header);
+    }
+
+    wav_header_t header;
+    const uint16_t bits_per_sample = 16;
+    memcpy(header.riff_header, "RIFF", 4);
+    memcpy(header.wave_header, "WAVE", 4);
+    memcpy(header.fmt_header, "fmt ", 4);
+    header.fmt_chunk_size = 16;
+    header.audio_format = 1;    // PCM
+    header.num_channels = writer->num_channels;
+    header.sample_rate = writer->sample_rate;
+    header.bits_per_sample = bits_per_sample;
+    header.byte_rate = writer->sample_rate * writer->num_channels * (bits_per_sample / 8);
+    header.block_align = writer->num_channels * (bits_per_sample / 8);
+    memcpy(header.data_header, "data", 4);
+    header.data_size = data_bytes;
+    header.wav_size = 36 + data_bytes;
+    memcpy(out, &header, sizeof(header));
+    return sizeof(header);
+}
+
+// Grows the file by whole extents until it can hold `size` bytes. On FAT,
+// seeking past the end of a file open for writing links the whole cluster
+// chain in one call; the byte written at the new end makes the size stick on
+// any filesystem. The data in between is not written and not read back.
+static void grow_file(audio_wav_writer_t* writer, uint32_t size) {
+    uint32_t target = writer->allocated;
+    while (target < size) target += REC_PREALLOC_EXTENT_SIZE;
+
+    static const uint8_t zero = 0;
+    bool ok = fseek(writer->fp, (long)target - 1, SEEK_SET) == 0 && fwrite(&zero, 1, 1, writer->fp) == 1;
+    if (fseek(writer->fp, (long)writer->file_pos, SEEK_SET) != 0) ok = false;
+    if (!ok) {
+        // Most likely the card is nearly full. Carry on without it and let the real writes report the error.
+        ESP_LOGW(TAG, "Could not preallocate %lu bytes, writing without preallocation.", target);
+        writer->preallocate = false;
+        fseek(writer->fp, (long)writer->file_pos, SEEK_SET);
+        return;
+    }
+    writer->allocated = target;
+}
+
+// Frames in the first `data_bytes` bytes of audio. A partly written IMA-ADPCM
+// block still decodes up to its last whole group.
+static uint32_t frames_in_data(const audio_wav_writer_t* writer, uint32_t data_bytes) {
+    if (writer->encoding == AUDIO_WAV_IMA_ADPCM) {
+        return (data_bytes / writer->block_align) * writer->block_frames +
+               audio_ima_adpcm_frames_in(data_bytes % writer->block_align, writer->num_channels);
+    }
+    return data_bytes / (writer->num_channels * sizeof(int16_t));
+}
+
+// Rewrites the header for the audio already in the file and syncs it, so
+// the file survives a reset or brownout as a valid WAV of everything up to
+// here. Until the first sync FAT records no size at all: the file would
+// come back empty.
+static bool checkpoint(audio_wav_writer_t* writer) {
+    const int64_t start = esp_timer_get_time();
+    const uint32_t data_in_file = writer->file_pos - writer->header_bytes;
+    uint8_t header[sizeof(wav_ima_header_t)];
+    const size_t header_bytes = create_wav_header(writer, header, data_in_file, frames_in_data(writer, data_in_file));
+
+    bool ok = fseek(writer->fp, 0, SEEK_SET) == 0 && fwrite(header, 1, header_bytes, writer->fp) == header_bytes;
+    if (fseek(writer->fp, (long)writer->file_pos, SEEK_SET) != 0) ok = false;
+    if (ok && (fflush(writer->fp) != 0 || fsync(fileno(writer->fp)) != 0)) ok = false;
+
+    audio_histogram_record(&writer->checkpoint_us, (uint32_t)(esp_timer_get_time() - start));
+    writer->last_checkpoint_us = start; // The interval runs from start to start, however slow the card is.
+    if (!ok) ESP_LOGW(TAG, "WAV checkpoint failed: %s", strerror(errno));
+    return ok;
+}
+
+static bool flush_batch(audio_wav_writer_t* writer) {
+    if (writer->batch_fill == 0) return true;
+    if (writer->preallocate && writer->file_pos + writer->batch_fill > writer->allocated) {
+        grow_file(writer, writer->file_pos + writer->batch_fill);
+    }
+
+    const int64_t start = esp_timer_get_time();
+    size_t bytes_written = fwrite(writer->batch, 1, writer->batch_fill, writer->fp);
+    audio_histogram_record(&writer->write_us, (uint32_t)(esp_timer_get_time() - start));
+    if (bytes_written < writer->batch_fill) {
+        ESP_LOGE(TAG, "File write failed. Wrote %d of %d bytes", (int)bytes_written, (int)writer->batch_fill);
+        return false;
+    }
+    writer->file_pos += bytes_written;
+    writer->batch_fill = 0;
+
+    // A failed checkpoint only costs crash safety; the recording carries on.
+    if (REC_CHECKPOINT_INTERVAL_MS > 0 &&
+        esp_timer_get_time() - writer->last_checkpoint_us >= (int64_t)REC_CHECKPOINT_INTERVAL_MS * 1000) {
+        checkpoint(writer);
+    }
+    return true;
+}
+
+bool audio_wav_writer_open(audio_wav_writer_t* writer, const char* path, uint32_t sample_rate,
+                           uint16_t num_channels, audio_wav_encoding_t encoding) {
+    memset(writer, 0, sizeof(audio_wav_writer_t));
+    writer->sample_rate = sample_rate;
+    writer->num_channels = num_channels;
+    writer->encoding = encoding;
+    writer->preallocate = true;
+
+    if (encoding == AUDIO_WAV_IMA_ADPCM) {
+        writer->block_align = REC_ADPCM_BLOCK_ALIGN;
+        if (!audio_ima_adpcm_layout_valid(writer->block_align, num_channels)) {
+            ESP_LOGE(TAG, "Invalid IMA-ADPCM block size %u for %u channels", writer->block_align, num_channels);
+            return false;
+        }
+        writer->block_frames = audio_ima_adpcm_frames_per_block(writer->block_align, num_channels);
+        writer->block_pcm = (uint8_t*)malloc(writer->block_frames * num_channels * sizeof(int16_t) + writer->block_align);
+        if (!writer->block_pcm) {
+            ESP_LOGE(TAG, "Failed to allocate the IMA-ADPCM block buffer");
+            return false;
+        }
+        audio_ima_adpcm_encoder_init(&writer->encoder);
+    }
+
+    // DMA-capable RAM lets the SD driver write the batch without bouncing it.
+    writer->batch = (uint8_t*)heap_caps_malloc(REC_WRITE_CHUNK_SIZE, MALLOC_CAP_DMA);
+    if (!writer->batch) writer->batch = (uint8_t*)heap_caps_malloc(REC_WRITE_CHUNK_SIZE, MALLOC_CAP_SPIRAM);
+    if (!writer->batch) {
+        ESP_LOGE(TAG, "Failed to allocate file write buffer");
+        audio_wav_writer_close(writer);
+        return false;
+    }
+
+    writer->fp = fopen(path, "wb");
+    if (writer->fp == NULL) {
+        ESP_LOGE(TAG, "Failed to open file for writing: %s, error: %s", path, strerror(errno));
+        audio_wav_writer_close(writer);
+        return false;
+    }
+    setvbuf(writer->fp, NULL, _IONBF, 0); // Batches go straight to the driver, with no extra copy.
+
+    // The placeholder header leads the first batch; it is rewritten on finalize.
+    writer->header_bytes = (uint16_t)create_wav_header(writer, writer->batch, 0, 0);
+    writer->last_checkpoint_us = esp_timer_get_time();
+    writer->batch_fill = writer->header_bytes;
+    return true;
+}
+
+// Appends file bytes to the batch, writing each batch as it fills up.
+static bool append(audio_wav_writer_t* writer, const uint8_t* src, size_t len) {
+    while (len > 0) {
+        size_t n = REC_WRITE_CHUNK_SIZE - writer->batch_fill;
+        if (n > len) n = len;
+        memcpy(writer->batch + writer->batch_fill, src, n);
+        writer->batch_fill += n;
+        writer->data_bytes += n;
+        src += n;
+        len -= n;
+        if (writer->batch_fill == REC_WRITE_CHUNK_SIZE && !flush_batch(writer)) return false;
+    }
+    return true;
+}
+
+// Encodes the collected PCM (a full block, or the short last one) and appends it.
+static bool encode_block(audio_wav_writer_t* writer) {
+    const size_t frames = writer->block_pcm_fill / (writer->num_channels * sizeof(int16_t));
+    writer->block_pcm_fill = 0;
+    if (frames == 0) return true;
+
+    uint8_t* encoded = writer->block_pcm + writer->block_frames * writer->num_channels * sizeof(int16_t);
+    const int64_t start = esp_timer_get_time();
+    const size_t bytes = audio_ima_adpcm_encode_block(&writer->encoder, (const int16_t*)writer->block_pcm, frames,
+                                                      writer->num_channels, encoded);
+    writer->encode_us += (uint64_t)(esp_timer_get_time() - start);
+    return append(writer, encoded, bytes);
+}
+
+bool audio_wav_writer_write(audio_wav_writer_t* writer, const void* data, size_t len) {
+    const uint8_t* src = (const uint8_t*)data;
+    if (writer->encoding != AUDIO_WAV_IMA_ADPCM) {
+        writer->frames += len / (writer->num_channels * sizeof(int16_t));
+        return append(writer, src, len);
+    }
+
+    const size_t block_pcm_bytes = writer->block_frames * writer->num_channels * sizeof(int16_t);
+    while (len > 0) {
+        size_t n = block_pcm_bytes - writer->block_pcm_fill;
+        if (n > len) n = len;
+        memcpy(writer->block_pcm + writer->block_pcm_fill, src, n);
+        writer->block_pcm_fill += n;
+        src += n;
+        len -= n;
+        if (writer->block_pcm_fill == block_pcm_bytes) {
+            writer->frames += writer->block_frames;
+            if (!encode_block(writer)) return false;
+        }
+    }
+    return true;
+}
+
+bool audio_wav_writer_finalize(audio_wav_writer_t* writer) {
+    if (!writer->fp) return false;
+    bool ok = true;
+    if (writer->encoding == AUDIO_WAV_IMA_ADPCM) {
+        writer->frames += writer->block_pcm_fill / (writer->num_channels * sizeof(int16_t));
+        ok = encode_block(writer);
+        const uint32_t audio_ms = (uint32_t)(((uint64_t)writer->frames * 1000) / writer->sample_rate);
+        ESP_LOGI(TAG, "IMA-ADPCM: %lu frames encoded in %lu ms (%lux real time), %lu bytes.", writer->frames,
+                 (uint32_t)(writer->encode_us / 1000), writer->encode_us ? (uint32_t)(audio_ms * 1000ULL / writer->encode_us) : 0,
+                 writer->data_bytes);
+    }
+    if (!flush_batch(writer)) ok = false;
+
+    ESP_LOGI(TAG, "Finalizing WAV file. Updating header with final data size: %lu", writer->data_bytes);
+    uint8_t header[sizeof(wav_ima_header_t)];
+    const size_t header_bytes = create_wav_header(writer, header, writer->data_bytes, writer->frames);
+    if (fseek(writer->fp, 0, SEEK_SET) != 0 || fwrite(header, 1, header_bytes, writer->fp) != header_bytes) {
+        ESP_LOGE(TAG, "Failed to update the WAV header.");
+        ok = false;
+    }
+
+    const uint32_t final_size = writer->header_bytes + writer->data_bytes;
+    if (writer->allocated > final_size && ftruncate(fileno(writer->fp), final_size) != 0) {
+        ESP_LOGE(TAG, "Failed to truncate the file to %lu bytes: %s", final_size, strerror(errno));
+        ok = false;
+    }
+    audio_wav_writer_close(writer);
+    return ok;
+}
+
+void audio_wav_writer_close(audio_wav_writer_t* writer) {
+    if (writer->fp) fclose(writer->fp);
+    if (writer->batch) heap_caps_free(writer->batch);
+    if (writer->block_pcm) free(writer->block_pcm);
+    writer->fp = NULL;
+    writer->batch = NULL;
+    writer->block_pcm = NULL;
+}
+
+// --- Recovery ---
+static uint32_t read_le32(const uint8_t* p) { return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24); }
+static uint16_t read_le16(const uint8_t* p) { return (uint16_t)(p[0] | (p[1] << 8)); }
+static void write_le32(uint8_t* p, uint32_t v) { p[0] = (uint8_t)v; p[1] = (uint8_t)(v >> 8); p[2] = (uint8_t)(v >> 16); p[3] = (uint8_t)(v >> 24); }
+
+static bool write_u32_at(FILE* fp, long offset, uint32_t value) {
+    uint8_t bytes[4];
+    write_le32(bytes, value);
+    return fseek(fp, offset, SEEK_SET) == 0 && fwrite(bytes, 1, 4, fp) == 4;
+}
+
+audio_wav_recovery_t audio_wav_writer_recover(const char* path) {
+    FILE* fp = fopen(path, "r+b");
+    if (!fp) {
+        ESP_LOGE(TAG, "Cannot open %s for recovery: %s", path, strerror(errno));
+        return AUDIO_WAV_UNRECOVERABLE;
+    }
+    struct stat st;
+    const uint32_t file_size = (fstat(fileno(fp), &st) == 0) ? (uint32_t)st.st_size : 0;
+
+    // Walk the chunks up to 'data', noting where the sizes to fix are.
+    uint8_t chunk[16];
+    audio_wav_recovery_t result = AUDIO_WAV_UNRECOVERABLE;
+    uint16_t format = 0, channels = 0, block_align = 0;
+    long fact_offset = -1;
+    uint32_t pos = 12;
+    do {
+        if (file_size == 0) {
+            result = AUDIO_WAV_EMPTY;
+            break;
+        }
+        if (fread(chunk, 1, 12, fp) != 12 || memcmp(chunk, "RIFF", 4) != 0 || memcmp(chunk + 8, "WAVE", 4) != 0) break;
+        const uint32_t riff_size = read_le32(chunk + 4);
+        bool found_data = false;
+        uint32_t data_size = 0;
+        while (pos + 8 <= file_size && fseek(fp, pos, SEEK_SET) == 0 && fread(chunk, 1, 8, fp) == 8) {
+            const uint32_t size = read_le32(chunk + 4);
+            if (memcmp(chunk, "data", 4) == 0) {
+                found_data = true;
+                data_size = size;
+                break;
+            }
+            if (memcmp(chunk, "fmt ", 4) == 0 && size >= 16 && fread(chunk + 8, 1, 8, fp) == 8) {
+                format = read_le16(chunk + 8);
+                channels = read_le16(chunk + 10);
+                fseek(fp, pos + 8 + 12, SEEK_SET);
+                uint8_t align[2];
+                if (fread(align, 1, 2, fp) == 2) block_align = read_le16(align);
+            } else if (memcmp(chunk, "fact", 4) == 0 && size >= 4) {
+                fact_offset = (long)pos + 8;
+            }
+            if (size > file_size - pos) break; // A chunk running past the end: no 'data' to find.
+            pos += 8 + size + (size & 1);
+        }
+        if (!found_data || block_align == 0 || channels == 0) break;
+
+        const uint32_t data_start = pos + 8;
+        const uint32_t available = (file_size > data_start) ? file_size - data_start : 0;
+        if (riff_size + 8 == file_size && data_size <= available) {
+            result = AUDIO_WAV_INTACT;
+            break;
+        }
+
+        // A checkpointed size is the audio known to be written: anything past
+        // it is the preallocated tail, or audio after the last sync. Without
+        // one (or with one beyond the end), keep every whole block there is.
+        uint32_t recovered = data_size;
+        if (recovered == 0 || recovered > available) {
+            recovered = available - (available % block_align);
+            if (format == AUDIO_IMA_ADPCM_WAV_FORMAT) {
+                const uint32_t tail = available % block_align;
+                if (audio_ima_adpcm_frames_in(tail, channels) > 1) recovered = available;
+            }
+        }
+        if (recovered == 0) {
+            result = AUDIO_WAV_EMPTY;
+            break;
+        }
+
+        bool ok = write_u32_at(fp, 4, data_start - 8 + recovered) && write_u32_at(fp, (long)pos + 4, recovered);
+        if (ok && fact_offset >= 0 && format == AUDIO_IMA_ADPCM_WAV_FORMAT && audio_ima_adpcm_layout_valid(block_align, channels)) {
+            const uint32_t frames = (recovered / block_align) * audio_ima_adpcm_frames_per_block(block_align, channels) +
+                                    audio_ima_adpcm_frames_in(recovered % block_align, channels);
+            ok = write_u32_at(fp, fact_offset, frames);
+        }
+        if (ok && data_start + recovered < file_size) ok = ftruncate(fileno(fp), data_start + recovered) == 0;
+        if (ok) ok = fflush(fp) == 0 && fsync(fileno(fp)) == 0;
+        if (!ok) {
+            ESP_LOGE(TAG, "Failed to repair %s: %s", path, strerror(errno));
+            break;
+        }
+        ESP_LOGW(TAG, "Recovered %s: %lu of %lu bytes of audio kept.", path, recovered, available);
+        result = AUDIO_WAV_REPAIRED;
+    } while (0);
+
+    fclose(fp);
+    return result;
+}
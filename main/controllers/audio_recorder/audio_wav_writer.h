@@ -0,0 +1,117 @@
+/**
+ * @file audio_wav_writer.h
+ * @brief Writes a PCM or IMA-ADPCM WAV file to the SD card in large, cluster-aligned blocks.
+ *
+ * Audio is collected into REC_WRITE_CHUNK_SIZE batches that are written
+ * unbuffered, with the header at the head of the first one, so every
+ * write covers whole clusters at a cluster-aligned offset. The file is grown
+ * in REC_PREALLOC_EXTENT_SIZE extents ahead of the data, so FAT links clusters
+ * in bulk instead of on every write, and it is truncated to the audio actually
+ * written when finalized.
+ *
+ * In IMA-ADPCM mode the 16-bit PCM passed in is collected one block at a time
+ * (REC_ADPCM_BLOCK_ALIGN bytes once encoded) and compressed 4:1 as each block
+ * fills, so the encoder needs no more memory than that one block.
+ *
+ * Every REC_CHECKPOINT_INTERVAL_MS the header is rewritten with the sizes of
+ * the audio already on the card and the file is synced, so a reset or a
+ * brownout loses at most that much audio (plus one batch). The file then
+ * still carries its preallocated tail; audio_wav_writer_recover() cuts it
+ * off and makes such a file valid again.
+ */
+#ifndef AUDIO_WAV_WRITER_H
+#define AUDIO_WAV_WRITER_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "controllers/audio_manager/audio_health.h"
+#include "controllers/audio_manager/audio_ima_adpcm.h"
+
+/**
+ * @brief Sample encoding of the file. The input is 16-bit PCM either way.
+ */
+typedef enum {
+    AUDIO_WAV_PCM_16,       //!< 16-bit PCM (format 1).
+    AUDIO_WAV_IMA_ADPCM,    //!< 4-bit IMA-ADPCM (format 0x11), a quarter of the size.
+} audio_wav_encoding_t;
+
+/**
+ * @brief State of an open WAV file. Only the counters are meant to be read by callers.
+ */
+typedef struct {
+    FILE* fp;
+    uint8_t* batch;             //!< Next write, REC_WRITE_CHUNK_SIZE bytes.
+    size_t batch_fill;
+    uint32_t file_pos;          //!< Bytes written to the file so far.
+    uint32_t allocated;         //!< File size including the preallocated tail.
+    bool preallocate;           //!< Cleared if growing the file failed; it then grows with each write.
+    uint32_t sample_rate;
+    uint16_t num_channels;
+    audio_wav_encoding_t encoding;
+    uint16_t header_bytes;      //!< Size of the header at the start of the file.
+
+    // IMA-ADPCM.
+    uint8_t* block_pcm;         //!< PCM of the block being collected, followed by room for it encoded.
+    size_t block_pcm_fill;      //!< Bytes of PCM collected.
+    uint16_t block_align;       //!< Bytes per encoded block.
+    uint32_t block_frames;      //!< Frames per block.
+    audio_ima_adpcm_encoder_t encoder;
+
+    int64_t last_checkpoint_us;
+
+    // Counters.
+    uint32_t frames;            //!< Audio frames accepted so far.
+    uint32_t data_bytes;        //!< Bytes of (encoded) audio passed to the file so far.
+    uint64_t encode_us;         //!< Time spent encoding.
+    audio_histogram_t write_us; //!< Latency of each write to the card.
+    audio_histogram_t checkpoint_us; //!< Latency of each header rewrite and sync.
+} audio_wav_writer_t;
+
+/**
+ * @brief Creates (or replaces) a WAV file and allocates the write buffers.
+ * @param encoding How the 16-bit PCM passed to audio_wav_writer_write() is stored.
+ * @return true if the file is open. On failure nothing needs to be closed.
+ */
+bool audio_wav_writer_open(audio_wav_writer_t* writer, const char* path, uint32_t sample_rate,
+                           uint16_t num_channels, audio_wav_encoding_t encoding);
+
+/**
+ * @brief Appends interleaved 16-bit PCM. The card is written whenever a batch fills up.
+ * @return false if a write failed.
+ */
+bool audio_wav_writer_write(audio_wav_writer_t* writer, const void* data, size_t len);
+
+/**
+ * @brief Encodes the last (short) block, writes the last batch, fills in the header sizes, cuts off the
+ * preallocated tail and closes the file.
+ * @return false if any of it failed. The writer is closed either way.
+ */
+bool audio_wav_writer_finalize(audio_wav_writer_t* writer);
+
+/**
+ * @brief Closes the file as it is, e.g. before deleting it. Safe to call on a closed writer.
+ */
+void audio_wav_writer_close(audio_wav_writer_t* writer);
+
+/**
+ * @brief Result of audio_wav_writer_recover().
+ */
+typedef enum {
+    AUDIO_WAV_INTACT,        //!< The sizes in the header match the file; nothing was changed.
+    AUDIO_WAV_REPAIRED,      //!< The header was fixed and the file cut to the audio it holds.
+    AUDIO_WAV_EMPTY,         //!< Cut short before its first checkpoint: there is no audio in it.
+    AUDIO_WAV_UNRECOVERABLE, //!< Not a WAV file, or it could not be repaired.
+} audio_wav_recovery_t;
+
+/**
+ * @brief Repairs a recording that was not finalized, e.g. after a reset.
+ *
+ * The last checkpointed size is trusted and anything past it is cut off. A
+ * file that was never checkpointed keeps every whole block it holds.
+ *
+ * @param path The WAV file.
+ */
+audio_wav_recovery_t audio_wav_writer_recover(const char* path);
+
+#endif // AUDIO_WAV_WRITER_H
@@ -45,6 +45,7 @@ bool DailySummaryManager::save_summary(const DailySummaryData& summary) {
     if (summary.journal_entry_path.empty() && 
         summary.completed_habit_ids.empty() && 
         summary.voice_note_paths.empty() &&
+        summary.voice_note_transcripts.empty() &&
         summary.pomodoro_work_seconds == 0) {
         ESP_LOGD(TAG, "Skipping save for empty summary on date %lld", (long long)summary.date);
         return true;
@@ -72,6 +73,12 @@ bool DailySummaryManager::save_summary(const DailySummaryData& summary) {
     }
     cJSON_AddItemToObject(root, "voice_note_paths", notes);
 
+    cJSON *transcripts = cJSON_CreateObject();
+    for (const auto& entry : summary.voice_note_transcripts) {
+        cJSON_AddStringToObject(transcripts, entry.first.c_str(), entry.second.c_str());
+    }
+    cJSON_AddItemToObject(root, "voice_note_transcripts", transcripts);
+
     char *json_string = cJSON_PrintUnformatted(root);
     std::string filepath = get_filepath_for_date(summary.date);
     bool success = littlefs_manager_write_file(filepath.c_str(), json_string);
@@ -152,6 +159,16 @@ DailySummaryData DailySummaryManager::get_summary_for_date(time_t date) {
         }
     }
 
+    item = cJSON_GetObjectItem(root, "voice_note_transcripts");
+    if (cJSON_IsObject(item)) {
+        cJSON* transcript_json;
+        cJSON_ArrayForEach(transcript_json, item) {
+            if (cJSON_IsString(transcript_json)) {
+                summary.voice_note_transcripts[transcript_json->string] = transcript_json->valuestring;
+            }
+        }
+    }
+
     cJSON_Delete(root);
     return summary;
 }
@@ -232,6 +249,12 @@ void DailySummaryManager::add_voice_note_path(time_t date, const std::string& pa
     save_summary(summary);
 }
 
+void DailySummaryManager::set_voice_note_transcript(time_t date, const std::string& path, const std::string& text) {
+    DailySummaryData summary = get_summary_for_date(date);
+    summary.voice_note_transcripts[path] = text;
+    save_summary(summary);
+}
+
 void DailySummaryManager::add_pomodoro_work_time(time_t date, uint32_t seconds) {
     DailySummaryData summary = get_summary_for_date(date);
     summary.pomodoro_work_seconds += seconds;
@@ -68,6 +68,14 @@ public:
      */
     static void add_voice_note_path(time_t date, const std::string& path);
 
+    /**
+     * @brief Sets the transcript of a voice note in the summary for a given date.
+     * @param date The date the note was created.
+     * @param path The full path to the .wav file.
+     * @param text The transcribed text.
+     */
+    static void set_voice_note_transcript(time_t date, const std::string& path, const std::string& text);
+
     /**
      * @brief Adds completed Pomodoro work session time to the summary for a given date.
      * @param date The date of the session.
@@ -0,0 +1,639 @@
+#include "https_client.h"
+#include "config/app_config.h"
+#include "esp_log.h"
+#include "esp_tls.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "lwip/sockets.h"
+#include "lwip/netdb.h"
+#include <fcntl.h>
+#include <new>
+#include <vector>
+#include <string.h>
+#include <stdlib.h>
+
+static const char* TAG = "HTTPS_CLIENT";
+#define USER_AGENT "ESP32 HTTP Client/1.0"
+#define RX_BUFFER_SIZE 2048
+#define MAX_LINE_LENGTH 2048
+#define CHUNK_FRAME_SIZE 4096       // One outgoing TLS record (CONFIG_MBEDTLS_SSL_OUT_CONTENT_LEN).
+#define HANDSHAKE_POLL_MS 20        // Max wait for the server's next handshake flight before polling again.
+
+// A TLS connection to one host, in use by a request or idle in the pool.
+struct HttpsConnection {
+    std::string host;
+    int port = 443;
+    esp_tls_t* tls = nullptr;
+    int64_t idle_since_us = 0;
+};
+
+// One request/response exchange on a connection.
+class HttpsRequest {
+public:
+    HttpsConnection* conn = nullptr;
+    std::string method;
+    int timeout_ms = 0;
+    https_client_timing_t timing = {};
+    int64_t open_us = 0;
+    int64_t sent_us = 0;                // When the body ended (for the time to first byte).
+
+    // Request body
+    bool chunked_body = false;
+    int64_t body_left = 0;              // Bytes of a Content-Length body still to send.
+    bool body_ended = false;
+    std::vector<char> frame;            // A framed chunk, for chunked bodies.
+
+    // Response
+    int status = -1;
+    bool failed = false;
+    bool keep_alive = true;             // The server leaves the connection open after the response.
+    bool chunked_response = false;
+    int64_t content_left = -1;          // Body length from Content-Length; -1 runs to the end of the connection.
+    bool body_read = false;
+    std::vector<char> rx;
+    size_t rx_pos = 0;
+    size_t rx_len = 0;
+};
+
+// --- Pool ---
+static SemaphoreHandle_t s_pool_mutex = NULL;
+static std::vector<HttpsConnection*> s_idle;    // Oldest first.
+static esp_timer_handle_t s_reap_timer = NULL;
+
+#if CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS
+// The TLS session of the last new connection to each host. A connecting request
+// takes it out while it uses it, so it is never freed under another request.
+struct SavedSession {
+    std::string host;
+    int port;
+    esp_tls_client_session_t* session;
+};
+static std::vector<SavedSession> s_sessions;
+#endif
+
+static int64_t elapsed_since(int64_t start_us) {
+    return esp_timer_get_time() - start_us;
+}
+
+static void destroy_connection(HttpsConnection* conn) {
+    if (conn->tls) esp_tls_conn_destroy(conn->tls);
+    delete conn;
+}
+
+static int connection_fd(esp_tls_t* tls) {
+    int fd = -1;
+    if (esp_tls_get_conn_sockfd(tls, &fd) != ESP_OK) return -1;
+    return fd;
+}
+
+static bool wait_readable(int fd, int timeout_ms) {
+    fd_set rset;
+    FD_ZERO(&rset);
+    FD_SET(fd, &rset);
+    struct timeval tv = { timeout_ms / 1000, (timeout_ms % 1000) * 1000 };
+    return select(fd + 1, &rset, NULL, NULL, &tv) > 0;
+}
+
+// An idle connection is usable if it is younger than the keep-alive time and
+// nothing arrived on it: anything readable on an idle connection is the server closing it.
+static bool is_still_open(HttpsConnection* conn) {
+    if (elapsed_since(conn->idle_since_us) >= HTTPS_KEEP_ALIVE_MS * 1000LL) return false;
+    int fd = connection_fd(conn->tls);
+    return fd >= 0 && !wait_readable(fd, 0) && esp_tls_get_bytes_avail(conn->tls) <= 0;
+}
+
+// Takes an idle connection to the host out of the pool, closing any that are no longer usable.
+static HttpsConnection* take_idle(const std::string& host, int port) {
+    HttpsConnection* found = nullptr;
+    std::vector<HttpsConnection*> closed;
+    xSemaphoreTake(s_pool_mutex, portMAX_DELAY);
+    for (auto it = s_idle.end(); it != s_idle.begin();) {
+        --it; // Newest first.
+        HttpsConnection* conn = *it;
+        if (conn->host != host || conn->port != port) continue;
+        it = s_idle.erase(it);
+        if (!found && is_still_open(conn)) {
+            found = conn;
+        } else {
+            closed.push_back(conn);
+        }
+    }
+    xSemaphoreGive(s_pool_mutex);
+
+    for (HttpsConnection* conn : closed) {
+        ESP_LOGD(TAG, "Dropping a closed idle connection to %s", conn->host.c_str());
+        destroy_connection(conn);
+    }
+    return found;
+}
+
+// Closes the connections that have been idle for HTTPS_KEEP_ALIVE_MS, on the esp_timer task.
+static void reap_idle_connections(void* arg) {
+    std::vector<HttpsConnection*> expired;
+    int64_t next_expiry_us = -1;
+    xSemaphoreTake(s_pool_mutex, portMAX_DELAY);
+    for (auto it = s_idle.begin(); it != s_idle.end();) {
+        int64_t left_us = HTTPS_KEEP_ALIVE_MS * 1000LL - elapsed_since((*it)->idle_since_us);
+        if (left_us <= 0) {
+            expired.push_back(*it);
+            it = s_idle.erase(it);
+        } else {
+            if (next_expiry_us < 0 || left_us < next_expiry_us) next_expiry_us = left_us;
+            ++it;
+        }
+    }
+    if (next_expiry_us > 0) esp_timer_start_once(s_reap_timer, next_expiry_us);
+    xSemaphoreGive(s_pool_mutex);
+
+    for (HttpsConnection* conn : expired) {
+        ESP_LOGD(TAG, "Closing the idle connection to %s", conn->host.c_str());
+        destroy_connection(conn);
+    }
+}
+
+// Keeps a connection whose response was read to the end for the next request to its host.
+static void return_to_pool(HttpsConnection* conn) {
+    HttpsConnection* evicted = nullptr;
+    int idle_for_host = 0;
+    conn->idle_since_us = esp_timer_get_time();
+
+    xSemaphoreTake(s_pool_mutex, portMAX_DELAY);
+    for (HttpsConnection* other : s_idle) {
+        if (other->host == conn->host && other->port == conn->port) idle_for_host++;
+    }
+    if (idle_for_host >= HTTPS_MAX_IDLE_PER_HOST) {
+        for (auto it = s_idle.begin(); it != s_idle.end(); ++it) {
+            if ((*it)->host == conn->host && (*it)->port == conn->port) {
+                evicted = *it;
+                s_idle.erase(it);
+                break;
+            }
+        }
+    }
+    s_idle.push_back(conn);
+    esp_timer_stop(s_reap_timer);
+    esp_timer_start_once(s_reap_timer, HTTPS_KEEP_ALIVE_MS * 1000LL);
+    xSemaphoreGive(s_pool_mutex);
+
+    if (evicted) destroy_connection(evicted);
+}
+
+#if CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS
+static esp_tls_client_session_t* take_session(const std::string& host, int port) {
+    esp_tls_client_session_t* session = nullptr;
+    xSemaphoreTake(s_pool_mutex, portMAX_DELAY);
+    for (SavedSession& saved : s_sessions) {
+        if (saved.host == host && saved.port == port) {
+            session = saved.session;
+            saved.session = nullptr;
+            break;
+        }
+    }
+    xSemaphoreGive(s_pool_mutex);
+    return session;
+}
+
+static void keep_session(const std::string& host, int port, esp_tls_client_session_t* session) {
+    esp_tls_client_session_t* replaced = nullptr;
+    xSemaphoreTake(s_pool_mutex, portMAX_DELAY);
+    bool found = false;
+    for (SavedSession& saved : s_sessions) {
+        if (saved.host == host && saved.port == port) {
+            replaced = saved.session;
+            saved.session = session;
+            found = true;
+            break;
+        }
+    }
+    if (!found) s_sessions.push_back({host, port, session});
+    xSemaphoreGive(s_pool_mutex);
+
+    if (replaced) esp_tls_free_client_session(replaced);
+}
+#endif
+
+// Opens a new TLS connection, timing its phases into `timing`.
+static HttpsConnection* connect_to(const std::string& host, int port, const char* cert_pem, int timeout_ms, https_client_timing_t* timing) {
+    int64_t phase_start_us = esp_timer_get_time();
+    const int64_t deadline_us = phase_start_us + timeout_ms * 1000LL;
+
+    // Resolve the name first only to time it: esp-tls then finds it in lwIP's DNS cache.
+    struct addrinfo hints = {};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    struct addrinfo* addresses = nullptr;
+    if (getaddrinfo(host.c_str(), nullptr, &hints, &addresses) != 0 || !addresses) {
+        ESP_LOGE(TAG, "Could not resolve %s", host.c_str());
+        return nullptr;
+    }
+    freeaddrinfo(addresses);
+    timing->dns_us = elapsed_since(phase_start_us);
+    phase_start_us = esp_timer_get_time();
+
+    esp_tls_cfg_t cfg = {};
+    cfg.cacert_buf = reinterpret_cast<const unsigned char*>(cert_pem);
+    cfg.cacert_bytes = strlen(cert_pem) + 1;
+    cfg.timeout_ms = timeout_ms;
+    cfg.non_block = true; // Returns between the TCP connection and the handshake, so each can be timed.
+#if CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS
+    esp_tls_client_session_t* offered = take_session(host, port);
+    cfg.client_session = offered;
+    timing->session_offered = offered != nullptr;
+#endif
+
+    esp_tls_t* tls = esp_tls_init();
+    if (!tls) {
+        ESP_LOGE(TAG, "Failed to allocate a TLS connection");
+#if CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS
+        if (offered) keep_session(host, port, offered);
+#endif
+        return nullptr;
+    }
+
+    int ret;
+    bool handshaking = false;
+    while ((ret = esp_tls_conn_new_async(host.c_str(), host.length(), port, &cfg, tls)) == 0) {
+        esp_tls_conn_state_t state = ESP_TLS_INIT;
+        esp_tls_get_conn_state(tls, &state);
+        if (!handshaking && state == ESP_TLS_HANDSHAKE) {
+            handshaking = true;
+            timing->connect_us = elapsed_since(phase_start_us);
+            phase_start_us = esp_timer_get_time();
+        }
+        if (esp_timer_get_time() >= deadline_us) {
+            ESP_LOGE(TAG, "Timed out connecting to %s", host.c_str());
+            ret = -1;
+            break;
+        }
+        if (handshaking) {
+            int fd = connection_fd(tls);
+            if (fd >= 0) wait_readable(fd, HANDSHAKE_POLL_MS);
+        }
+    }
+    if (handshaking) {
+        timing->handshake_us = elapsed_since(phase_start_us);
+    } else {
+        timing->connect_us = elapsed_since(phase_start_us);
+    }
+
+    if (ret != 1) {
+        ESP_LOGE(TAG, "Could not connect to %s:%d", host.c_str(), port);
+        esp_tls_conn_destroy(tls);
+#if CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS
+        if (offered) keep_session(host, port, offered);
+#endif
+        return nullptr;
+    }
+
+#if CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS
+    // The session just negotiated (or resumed) replaces the one offered.
+    esp_tls_client_session_t* negotiated = esp_tls_get_client_session(tls);
+    if (negotiated) {
+        keep_session(host, port, negotiated);
+        if (offered) esp_tls_free_client_session(offered);
+    } else if (offered) {
+        keep_session(host, port, offered);
+    }
+#endif
+
+    auto* conn = new(std::nothrow) HttpsConnection();
+    if (!conn) {
+        esp_tls_conn_destroy(tls);
+        return nullptr;
+    }
+    conn->host = host;
+    conn->port = port;
+    conn->tls = tls;
+    return conn;
+}
+
+// Connections are made non-blocking (for timing the handshake); requests use
+// them blocking, with the request's timeout on every read and write.
+static bool set_request_timeouts(esp_tls_t* tls, int timeout_ms) {
+    int fd = connection_fd(tls);
+    if (fd < 0) return false;
+    int flags = fcntl(fd, F_GETFL, 0);
+    fcntl(fd, F_SETFL, flags & ~O_NONBLOCK);
+    struct timeval tv = { timeout_ms / 1000, (timeout_ms % 1000) * 1000 };
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+    return true;
+}
+
+static bool send_all(esp_tls_t* tls, const void* data, size_t len) {
+    const char* p = static_cast<const char*>(data);
+    while (len > 0) {
+        ssize_t written = esp_tls_conn_write(tls, p, len);
+        if (written <= 0) return false; // Includes a send timeout.
+        p += written;
+        len -= written;
+    }
+    return true;
+}
+
+// --- Response Parsing ---
+
+static bool fill_rx(HttpsRequest* request) {
+    ssize_t n = esp_tls_conn_read(request->conn->tls, request->rx.data(), request->rx.size());
+    if (n <= 0) return false; // Closed by the server, failed or timed out.
+    if (request->timing.ttfb_us == 0) request->timing.ttfb_us = elapsed_since(request->sent_us);
+    request->rx_pos = 0;
+    request->rx_len = n;
+    return true;
+}
+
+// Reads one line of the response, without its CRLF.
+static bool read_line(HttpsRequest* request, std::string& line) {
+    line.clear();
+    for (;;) {
+        if (request->rx_pos == request->rx_len && !fill_rx(request)) return false;
+        char c = request->rx[request->rx_pos++];
+        if (c == '\n') break;
+        if (line.length() >= MAX_LINE_LENGTH) return false;
+        line += c;
+    }
+    if (!line.empty() && line.back() == '\r') line.pop_back();
+    return true;
+}
+
+// Appends `len` bytes of the body, or everything up to the end of the connection if `len` is negative.
+static bool read_bytes(HttpsRequest* request, std::string& body, int64_t len) {
+    while (len != 0) {
+        if (request->rx_pos == request->rx_len && !fill_rx(request)) return len < 0;
+        size_t n = request->rx_len - request->rx_pos;
+        if (len > 0 && (int64_t)n > len) n = len;
+        body.append(&request->rx[request->rx_pos], n);
+        request->rx_pos += n;
+        if (len > 0) len -= n;
+    }
+    return true;
+}
+
+static bool read_chunked_body(HttpsRequest* request, std::string& body) {
+    std::string line;
+    for (;;) {
+        if (!read_line(request, line)) return false;
+        long size = strtol(line.c_str(), nullptr, 16); // Ignores chunk extensions.
+        if (size < 0) return false;
+        if (size == 0) break;
+        if (!read_bytes(request, body, size) || !read_line(request, line)) return false;
+    }
+    // Trailers, up to the empty line that ends the response.
+    do {
+        if (!read_line(request, line)) return false;
+    } while (!line.empty());
+    return true;
+}
+
+static bool header_is(const std::string& line, const char* name, std::string& value) {
+    size_t len = strlen(name);
+    if (line.length() <= len || line[len] != ':' || strncasecmp(line.c_str(), name, len) != 0) return false;
+    size_t start = line.find_first_not_of(" \t", len + 1);
+    value = start == std::string::npos ? "" : line.substr(start);
+    return true;
+}
+
+static bool parse_url(const char* url, std::string& host, int& port, std::string& path) {
+    static const char scheme[] = "https://";
+    if (!url || strncmp(url, scheme, sizeof(scheme) - 1) != 0) return false;
+    const char* authority = url + sizeof(scheme) - 1;
+    const char* authority_end = authority + strcspn(authority, "/?");
+    host.assign(authority, authority_end - authority);
+    port = 443;
+    size_t colon = host.find(':');
+    if (colon != std::string::npos) {
+        port = atoi(host.c_str() + colon + 1);
+        host.erase(colon);
+    }
+    path = *authority_end == '/' ? authority_end : std::string("/") + authority_end;
+    return !host.empty() && port > 0;
+}
+
+// --- Public API ---
+
+void https_client_init(void) {
+    s_pool_mutex = xSemaphoreCreateMutex();
+    if (s_pool_mutex == NULL) {
+        ESP_LOGE(TAG, "Failed to create pool mutex!");
+        return;
+    }
+    esp_timer_create_args_t reap_timer_args = {};
+    reap_timer_args.callback = reap_idle_connections;
+    reap_timer_args.name = "https_reap";
+    ESP_ERROR_CHECK(esp_timer_create(&reap_timer_args, &s_reap_timer));
+    ESP_LOGI(TAG, "HTTPS client initialized (connections kept alive for %d s).", HTTPS_KEEP_ALIVE_MS / 1000);
+}
+
+https_request_t https_client_open(const https_request_config_t* config) {
+    std::string host, path;
+    int port = 0;
+    if (!config || !config->method || !config->cert_pem || !parse_url(config->url, host, port, path)) {
+        ESP_LOGE(TAG, "Invalid request: %s", config && config->url ? config->url : "(null)");
+        return nullptr;
+    }
+
+    auto* request = new(std::nothrow) HttpsRequest();
+    if (!request) {
+        ESP_LOGE(TAG, "Failed to allocate memory for the request");
+        return nullptr;
+    }
+    request->open_us = esp_timer_get_time();
+    request->method = config->method;
+    request->timeout_ms = config->timeout_ms;
+    request->chunked_body = config->content_length < 0;
+    request->body_left = request->chunked_body ? 0 : config->content_length;
+
+    std::string head = request->method + " " + path + " HTTP/1.1\r\n";
+    head += "Host: " + host + (port != 443 ? ":" + std::to_string(port) : "") + "\r\n";
+    head += "User-Agent: " USER_AGENT "\r\n";
+    if (config->headers) head += config->headers;
+    if (request->chunked_body) {
+        head += "Transfer-Encoding: chunked\r\n";
+    } else if (config->content_length > 0 || (request->method != "GET" && request->method != "HEAD")) {
+        head += "Content-Length: " + std::to_string(config->content_length) + "\r\n";
+    }
+    head += "\r\n";
+
+    // The server may have closed a kept-alive connection just before it is
+    // used; the request then goes on a new connection.
+    request->conn = take_idle(host, port);
+    if (request->conn) {
+        request->timing.reused = true;
+        if (!set_request_timeouts(request->conn->tls, config->timeout_ms) || !send_all(request->conn->tls, head.data(), head.length())) {
+            ESP_LOGW(TAG, "Kept-alive connection to %s was closed; reconnecting.", host.c_str());
+            destroy_connection(request->conn);
+            request->conn = nullptr;
+            request->timing.reused = false;
+        }
+    }
+    if (!request->conn) {
+        request->conn = connect_to(host, port, config->cert_pem, config->timeout_ms, &request->timing);
+        if (!request->conn || !set_request_timeouts(request->conn->tls, config->timeout_ms) ||
+            !send_all(request->conn->tls, head.data(), head.length())) {
+            ESP_LOGE(TAG, "Failed to send the request to %s", host.c_str());
+            if (request->conn) destroy_connection(request->conn);
+            delete request;
+            return nullptr;
+        }
+    }
+
+    if (request->chunked_body) request->frame.resize(CHUNK_FRAME_SIZE);
+    return request;
+}
+
+bool https_client_write(https_request_t request, const void* data, size_t len) {
+    if (!request || request->failed || request->body_ended) return false;
+    if (len == 0) return true; // An empty chunk would end the body.
+
+    bool ok;
+    if (request->chunked_body) {
+        char size_line[16];
+        int n = snprintf(size_line, sizeof(size_line), "%x\r\n", (unsigned)len);
+        if (n + len + 2 <= request->frame.size()) {
+            memcpy(request->frame.data(), size_line, n);
+            memcpy(request->frame.data() + n, data, len);
+            memcpy(request->frame.data() + n + len, "\r\n", 2);
+            ok = send_all(request->conn->tls, request->frame.data(), n + len + 2);
+        } else {
+            ok = send_all(request->conn->tls, size_line, n) &&
+                 send_all(request->conn->tls, data, len) &&
+                 send_all(request->conn->tls, "\r\n", 2);
+        }
+    } else {
+        if ((int64_t)len > request->body_left) {
+            ESP_LOGE(TAG, "Body longer than its Content-Length");
+            request->failed = true;
+            return false;
+        }
+        ok = send_all(request->conn->tls, data, len);
+        request->body_left -= len;
+    }
+    if (!ok) request->failed = true;
+    return ok;
+}
+
+int https_client_fetch_headers(https_request_t request) {
+    if (!request || request->failed) return -1;
+    if (request->status >= 0) return request->status;
+
+    if (!request->body_ended) {
+        request->body_ended = true;
+        if (request->chunked_body && !send_all(request->conn->tls, "0\r\n\r\n", 5)) {
+            request->failed = true;
+            return -1;
+        }
+        if (!request->chunked_body && request->body_left != 0) {
+            ESP_LOGE(TAG, "Body shorter than its Content-Length");
+            request->failed = true;
+            return -1;
+        }
+    }
+    request->sent_us = esp_timer_get_time();
+    request->rx.resize(RX_BUFFER_SIZE);
+
+    std::string line, value;
+    int status = -1;
+    do { // Interim (1xx) responses are skipped.
+        int minor_version = 0;
+        if (!read_line(request, line) || sscanf(line.c_str(), "HTTP/1.%d %d", &minor_version, &status) != 2) {
+            request->failed = true;
+            return -1;
+        }
+        request->keep_alive = minor_version >= 1;
+        request->chunked_response = false;
+        request->content_left = -1;
+        for (;;) {
+            if (!read_line(request, line)) {
+                request->failed = true;
+                return -1;
+            }
+            if (line.empty()) break;
+            if (header_is(line, "Content-Length", value)) {
+                request->content_left = atoll(value.c_str());
+            } else if (header_is(line, "Transfer-Encoding", value)) {
+                request->chunked_response = strcasestr(value.c_str(), "chunked") != nullptr;
+            } else if (header_is(line, "Connection", value)) {
+                if (strcasestr(value.c_str(), "close")) request->keep_alive = false;
+                else if (strcasestr(value.c_str(), "keep-alive")) request->keep_alive = true;
+            }
+        }
+    } while (status >= 100 && status < 200);
+
+    if (request->method == "HEAD" || status == 204 || status == 304) {
+        request->chunked_response = false;
+        request->content_left = 0;
+    }
+    if (!request->chunked_response && request->content_left < 0) {
+        request->keep_alive = false; // The body runs to the end of the connection.
+    }
+    request->body_read = !request->chunked_response && request->content_left == 0;
+    request->status = status;
+    return status;
+}
+
+bool https_client_read_body(https_request_t request, std::string& body) {
+    if (!request || request->failed || request->status < 0) return false;
+    if (request->body_read) return true;
+
+    bool ok = request->chunked_response ? read_chunked_body(request, body)
+                                        : read_bytes(request, body, request->content_left);
+    if (!ok) {
+        request->failed = true;
+        return false;
+    }
+    request->body_read = true;
+    return true;
+}
+
+const https_client_timing_t* https_client_get_timing(https_request_t request) {
+    if (!request) return nullptr;
+    request->timing.total_us = elapsed_since(request->open_us);
+    return &request->timing;
+}
+
+void https_client_close(https_request_t request) {
+    if (!request) return;
+    https_client_timing_t& t = request->timing;
+    t.total_us = elapsed_since(request->open_us);
+    ESP_LOGI(TAG, "%s %s: status %d, dns %lld ms, connect %lld ms, tls %lld ms, ttfb %lld ms, total %lld ms%s%s",
+             request->method.c_str(), request->conn ? request->conn->host.c_str() : "?", request->status,
+             t.dns_us / 1000, t.connect_us / 1000, t.handshake_us / 1000, t.ttfb_us / 1000, t.total_us / 1000,
+             t.reused ? " (kept alive)" : "", t.session_offered ? " (session offered)" : "");
+
+    if (request->conn) {
+        // A connection is reusable only at a response boundary, with nothing unread.
+        bool reusable = !request->failed && request->body_read && request->keep_alive &&
+                        request->rx_pos == request->rx_len;
+        if (reusable) {
+            return_to_pool(request->conn);
+        } else {
+            destroy_connection(request->conn);
+        }
+    }
+    delete request;
+}
+
+int https_client_get(const char* url, const char* cert_pem, int timeout_ms, std::string& body) {
+    https_request_config_t config = {};
+    config.url = url;
+    config.method = "GET";
+    config.cert_pem = cert_pem;
+    config.timeout_ms = timeout_ms;
+
+    for (int attempt = 0; attempt < 2; attempt++) {
+        body.clear();
+        https_request_t request = https_client_open(&config);
+        if (!request) return -1;
+
+        int status = https_client_fetch_headers(request);
+        bool ok = status >= 0 && https_client_read_body(request, body);
+        // A GET can be sent again if a kept-alive connection failed before any response.
+        bool retry = !ok && status < 0 && request->timing.reused;
+        https_client_close(request);
+        if (ok) return status;
+        if (!retry) break;
+        ESP_LOGW(TAG, "Kept-alive connection failed before the response; retrying on a new one.");
+    }
+    return -1;
+}
@@ -0,0 +1,120 @@
+/**
+ * @file https_client.h
+ * @brief Shared HTTPS client: kept-alive connections per host, TLS session
+ *        resumption and per-request timing.
+ *
+ * A full TLS handshake costs the ESP32 one to two seconds of certificate and
+ * key-exchange work and tens of kilobytes of heap. Requests made through this
+ * client share that cost:
+ * - After a complete response the connection goes back to a pool (one idle
+ *   connection per host, closed after HTTPS_KEEP_ALIVE_MS), and the next
+ *   request to the same host is sent on it with no handshake at all.
+ * - The TLS session of every new connection is kept per host, and offered
+ *   when that host is connected to again, so that a server that still knows
+ *   it resumes it (an abbreviated handshake, without the certificate chain).
+ *
+ * Each request measures the phases it went through (see https_client_timing_t)
+ * and logs them when it is closed.
+ *
+ * A request is used much like esp_http_client's open/write/fetch_headers/read
+ * flow: open it, write the body, fetch the response headers, read the body,
+ * close it. Only one task may use a request at a time.
+ */
+#ifndef HTTPS_CLIENT_H
+#define HTTPS_CLIENT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+/**
+ * @brief Where the time of one request went, in microseconds.
+ *
+ * The connection phases are zero when the request was sent on a kept-alive connection.
+ */
+typedef struct {
+    int64_t dns_us;             //!< Resolving the host name.
+    int64_t connect_us;         //!< TCP connection (and setting up the TLS context).
+    int64_t handshake_us;       //!< TLS handshake.
+    int64_t ttfb_us;            //!< From the end of the request body to the first byte of the response.
+    int64_t total_us;           //!< From opening the request to closing it.
+    bool reused;                //!< Sent on a kept-alive connection.
+    bool session_offered;       //!< A saved TLS session was offered to the server for resumption.
+} https_client_timing_t;
+
+/**
+ * @brief What to send.
+ */
+typedef struct {
+    const char* url;            //!< "https://host[:port]/path[?query]".
+    const char* method;         //!< "GET", "POST", ...
+    const char* cert_pem;       //!< CA certificate of the server (PEM, NUL-terminated).
+    const char* headers;        //!< Extra request headers, each ending in "\r\n", or NULL.
+    int64_t content_length;     //!< Length of the body; -1 sends it chunked, as it is written.
+    int timeout_ms;             //!< For connecting and for each read or write.
+} https_request_config_t;
+
+class HttpsRequest;
+typedef HttpsRequest* https_request_t;
+
+/**
+ * @brief Initializes the connection pool. Must be called once at startup, before any request.
+ */
+void https_client_init(void);
+
+/**
+ * @brief Sends the request line and headers, on a kept-alive connection to
+ * the host if there is one and on a new connection otherwise.
+ *
+ * @return The request, to be closed with https_client_close(), or NULL if the
+ *         URL is invalid or the host could not be reached.
+ */
+https_request_t https_client_open(const https_request_config_t* config);
+
+/**
+ * @brief Sends part of the body. With a chunked body every call sends one
+ * chunk, framed, in a single write.
+ * @return false if the connection failed.
+ */
+bool https_client_write(https_request_t request, const void* data, size_t len);
+
+/**
+ * @brief Ends the body (with the last chunk, if chunked) and waits for the
+ * status line and headers of the response.
+ * @return The HTTP status code, or -1 if no response came.
+ */
+int https_client_fetch_headers(https_request_t request);
+
+/**
+ * @brief Reads the rest of the response body, appending it to `body`.
+ * @return false if the connection failed before the end of the body.
+ */
+bool https_client_read_body(https_request_t request, std::string& body);
+
+/**
+ * @brief Returns the timing of the request so far.
+ */
+const https_client_timing_t* https_client_get_timing(https_request_t request);
+
+/**
+ * @brief Ends the request and logs its timing. The connection goes back to the
+ * pool if the response was read to the end and the server keeps it open;
+ * otherwise it is closed.
+ */
+void https_client_close(https_request_t request);
+
+/**
+ * @brief Performs a GET and reads the whole response. If a kept-alive
+ * connection turns out to have been closed by the server, the request is
+ * sent again on a new one.
+ *
+ * @param url The URL to get.
+ * @param cert_pem CA certificate of the server.
+ * @param timeout_ms For connecting and for each read.
+ * @param body Receives the response body.
+ * @return The HTTP status code, or -1 if the request failed.
+ */
+int https_client_get(const char* url, const char* cert_pem, int timeout_ms, std::string& body);
+
+#endif // HTTPS_CLIENT_H
@@ -0,0 +1,380 @@
+#include "mic_capture.h"
+#include "config/board_config.h"
+#include "controllers/audio_recorder/audio_agc.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "driver/i2s_std.h"
+#include <atomic>
+#include <string.h>
+#include <math.h>
+
+static const char *TAG = "MIC_CAPTURE";
+
+// Above every consumer of the audio: it must never miss a DMA buffer.
+#define CAPTURE_TASK_PRIORITY 7
+#define READ_TIMEOUT_MS 100         // Max wait for I2S before re-checking for the last unsubscribe.
+
+// A subscriber's queue: a ring of `capacity` blocks (a power of two) with free
+// running indices. Only the capture task advances `head`, only the subscriber
+// advances `tail`; each reads the other's index with acquire ordering, so a
+// block is complete before it is seen and read before its slot is reused.
+struct mic_capture_subscriber {
+    const char* name;
+    mic_capture_block_t* slots;
+    uint32_t capacity;
+    std::atomic<uint32_t> head;     // Next slot the capture task fills.
+    std::atomic<uint32_t> tail;     // Next slot the subscriber reads.
+    SemaphoreHandle_t ready;        // Given after each block, for a waiting subscriber.
+    std::atomic<uint32_t> dropped_frames;
+    std::atomic<bool> failed;       // The capture task stopped on an error: no more blocks will come.
+    bool in_use;
+};
+
+static mic_capture_subscriber_t subscribers[MIC_CAPTURE_MAX_SUBSCRIBERS];
+// Guards subscribing and unsubscribing against the fan-out of a block. The
+// subscribers never take it, so reading audio needs no lock.
+static SemaphoreHandle_t subscribers_lock = NULL;
+static uint32_t subscriber_count = 0;
+
+static TaskHandle_t capture_task_handle = NULL;
+static volatile bool running = false;  // Cleared with the last unsubscribe.
+static bool closing = false;           // The task has seen that and is closing the channel. Under the lock.
+static bool capture_failed = false;    // The task stopped on an error. Under the lock; cleared with the last unsubscribe.
+static i2s_chan_handle_t rx_chan = NULL;
+static mic_capture_stats_t capture_stats;
+static volatile uint32_t dma_overflows = 0;       // Written from the I2S ISR.
+static volatile uint32_t dma_overflow_frames = 0; // Written from the I2S ISR.
+
+static void mic_capture_task(void *arg);
+
+void mic_capture_init(void) {
+    subscribers_lock = xSemaphoreCreateMutex();
+    if (!subscribers_lock) {
+        ESP_LOGE(TAG, "Failed to create the subscriber lock.");
+    }
+    ESP_LOGI(TAG, "Microphone capture service initialized.");
+}
+
+// --- I2S RX Channel ---
+// The driver drops the oldest DMA buffer when the capture task falls behind;
+// `event->size` is the size of that buffer, in 32-bit slots.
+static bool on_recv_queue_overflow(i2s_chan_handle_t handle, i2s_event_data_t *event, void *user_ctx) {
+    dma_overflows = dma_overflows + 1;
+    dma_overflow_frames = dma_overflow_frames + event->size / (sizeof(int32_t) * REC_NUM_CHANNELS);
+    return false;
+}
+
+static esp_err_t open_rx_channel(void) {
+    i2s_chan_config_t chan_cfg = I2S_CHANNEL_DEFAULT_CONFIG(I2S_NUM_1, I2S_ROLE_MASTER);
+    esp_err_t ret = i2s_new_channel(&chan_cfg, NULL, &rx_chan);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "i2s_new_channel failed: %s", esp_err_to_name(ret));
+        rx_chan = NULL;
+        return ret;
+    }
+
+    i2s_std_config_t std_cfg = {
+        .clk_cfg = {
+            .sample_rate_hz = REC_SAMPLE_RATE,
+            .clk_src = I2S_CLK_SRC_DEFAULT,
+            .ext_clk_freq_hz = 0,
+            .mclk_multiple = I2S_MCLK_MULTIPLE_256,
+        },
+        // The INMP441 sends 24-bit samples left-justified in 32-bit slots, on the left channel.
+        .slot_cfg = I2S_STD_PHILIPS_SLOT_DEFAULT_CONFIG(I2S_DATA_BIT_WIDTH_32BIT, (REC_NUM_CHANNELS == 2) ? I2S_SLOT_MODE_STEREO : I2S_SLOT_MODE_MONO),
+        .gpio_cfg = {
+            .mclk = I2S_GPIO_UNUSED,
+            .bclk = I2S_MIC_BCLK_PIN,
+            .ws   = I2S_MIC_WS_PIN,
+            .dout = I2S_GPIO_UNUSED,
+            .din  = I2S_MIC_DIN_PIN,
+            .invert_flags = { .mclk_inv = false, .bclk_inv = false, .ws_inv = false },
+        },
+    };
+    std_cfg.slot_cfg.slot_mask = (REC_NUM_CHANNELS == 2) ? I2S_STD_SLOT_BOTH : I2S_STD_SLOT_LEFT;
+
+    i2s_event_callbacks_t callbacks = {};
+    callbacks.on_recv_q_ovf = on_recv_queue_overflow;
+    ret = i2s_channel_init_std_mode(rx_chan, &std_cfg);
+    if (ret == ESP_OK) ret = i2s_channel_register_event_callback(rx_chan, &callbacks, NULL);
+    if (ret == ESP_OK) ret = i2s_channel_enable(rx_chan);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to start the I2S RX channel: %s", esp_err_to_name(ret));
+        i2s_del_channel(rx_chan);
+        rx_chan = NULL;
+    }
+    return ret;
+}
+
+// Opens the channel and starts the capture task. Called with the lock held.
+static bool start_capture(void) {
+    if (capture_task_handle != NULL && !closing) {
+        // The last subscription just ended, but the task has not stopped yet: keep it.
+        running = true;
+        return true;
+    }
+    // It is closing the channel (without the lock): wait for it to finish.
+    for (int i = 0; i < 50 && capture_task_handle != NULL; i++) vTaskDelay(pdMS_TO_TICKS(10));
+    if (capture_task_handle != NULL) {
+        ESP_LOGE(TAG, "Capture task from the last subscription did not stop.");
+        return false;
+    }
+
+    const int64_t start = esp_timer_get_time();
+    if (open_rx_channel() != ESP_OK) return false;
+    capture_stats.open_us = (uint32_t)(esp_timer_get_time() - start);
+    capture_stats.blocks = 0;
+
+    running = true;
+    closing = false;
+    if (xTaskCreate(mic_capture_task, "mic_capture", 3072, NULL, CAPTURE_TASK_PRIORITY, &capture_task_handle) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create the capture task");
+        running = false;
+        capture_task_handle = NULL;
+        i2s_channel_disable(rx_chan);
+        i2s_del_channel(rx_chan);
+        rx_chan = NULL;
+        return false;
+    }
+    ESP_LOGI(TAG, "Microphone started in %lu us.", capture_stats.open_us);
+    return true;
+}
+
+mic_capture_subscriber_t* mic_capture_subscribe(const char* name, uint32_t queue_blocks) {
+    if (!subscribers_lock) return NULL;
+    uint32_t capacity = 1;
+    while (capacity < queue_blocks) capacity <<= 1;
+
+    xSemaphoreTake(subscribers_lock, portMAX_DELAY);
+    mic_capture_subscriber_t* sub = NULL;
+    for (int i = 0; i < MIC_CAPTURE_MAX_SUBSCRIBERS; i++) {
+        if (!subscribers[i].in_use) {
+            sub = &subscribers[i];
+            break;
+        }
+    }
+    do {
+        if (!sub) {
+            ESP_LOGE(TAG, "No free subscriber slot for %s.", name);
+            break;
+        }
+        if (capture_failed) {
+            // The channel stays closed until the subscribers of the failed capture are gone.
+            ESP_LOGE(TAG, "Microphone capture failed; %s not subscribed.", name);
+            break;
+        }
+        sub->slots = (mic_capture_block_t*)heap_caps_malloc(capacity * sizeof(mic_capture_block_t), MALLOC_CAP_SPIRAM);
+        sub->ready = xSemaphoreCreateBinary();
+        if (!sub->slots || !sub->ready) {
+            ESP_LOGE(TAG, "Failed to allocate a %lu block queue for %s.", capacity, name);
+            break;
+        }
+        if (subscriber_count == 0 && !start_capture()) break;
+
+        sub->name = name;
+        sub->capacity = capacity;
+        sub->head.store(0, std::memory_order_relaxed);
+        sub->tail.store(0, std::memory_order_relaxed);
+        sub->dropped_frames.store(0, std::memory_order_relaxed);
+        sub->failed.store(false, std::memory_order_relaxed);
+        sub->in_use = true;
+        subscriber_count++;
+        capture_stats.subscribers = subscriber_count;
+        xSemaphoreGive(subscribers_lock);
+        ESP_LOGI(TAG, "%s subscribed (%lu blocks queued at most, %lu subscribers).", name, capacity, subscriber_count);
+        return sub;
+    } while (0);
+
+    if (sub) {
+        if (sub->slots) heap_caps_free(sub->slots);
+        if (sub->ready) vSemaphoreDelete(sub->ready);
+        sub->slots = NULL;
+        sub->ready = NULL;
+    }
+    xSemaphoreGive(subscribers_lock);
+    return NULL;
+}
+
+void mic_capture_unsubscribe(mic_capture_subscriber_t* sub) {
+    if (!sub || !subscribers_lock) return;
+    xSemaphoreTake(subscribers_lock, portMAX_DELAY);
+    if (sub->in_use) {
+        // Once the lock is ours the capture task is not filling this queue.
+        sub->in_use = false;
+        subscriber_count--;
+        capture_stats.subscribers = subscriber_count;
+        if (subscriber_count == 0) {
+            running = false; // The task closes the channel.
+            capture_failed = false;
+        }
+        const uint32_t dropped = sub->dropped_frames.load(std::memory_order_relaxed);
+        if (dropped > 0) {
+            ESP_LOGW(TAG, "%s unsubscribed, %lu frames lost to a full queue.", sub->name, dropped);
+        } else {
+            ESP_LOGI(TAG, "%s unsubscribed.", sub->name);
+        }
+        heap_caps_free(sub->slots);
+        vSemaphoreDelete(sub->ready);
+        sub->slots = NULL;
+        sub->ready = NULL;
+    }
+    xSemaphoreGive(subscribers_lock);
+}
+
+const mic_capture_block_t* mic_capture_peek(mic_capture_subscriber_t* sub, uint32_t timeout_ms) {
+    const uint32_t tail = sub->tail.load(std::memory_order_relaxed);
+    const TickType_t start = xTaskGetTickCount();
+    const TickType_t timeout = pdMS_TO_TICKS(timeout_ms);
+    while (sub->head.load(std::memory_order_acquire) == tail) {
+        if (sub->failed.load(std::memory_order_acquire)) return NULL;
+        // The semaphore may still hold a give for a block already read: check again after each wake-up.
+        const TickType_t waited = xTaskGetTickCount() - start;
+        if (waited >= timeout || xSemaphoreTake(sub->ready, timeout - waited) != pdTRUE) {
+            if (sub->head.load(std::memory_order_acquire) != tail) break;
+            return NULL;
+        }
+    }
+    return &sub->slots[tail & (sub->capacity - 1)];
+}
+
+void mic_capture_release(mic_capture_subscriber_t* sub) {
+    sub->tail.store(sub->tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+bool mic_capture_failed(const mic_capture_subscriber_t* sub) {
+    return sub && sub->failed.load(std::memory_order_acquire);
+}
+
+uint32_t mic_capture_dropped_frames(const mic_capture_subscriber_t* sub) {
+    return sub ? sub->dropped_frames.load(std::memory_order_relaxed) : 0;
+}
+
+void mic_capture_get_stats(mic_capture_stats_t* stats) {
+    if (!stats || !subscribers_lock) return;
+    xSemaphoreTake(subscribers_lock, portMAX_DELAY);
+    *stats = capture_stats;
+    xSemaphoreGive(subscribers_lock);
+    stats->dma_overflows = dma_overflows;
+    stats->dma_overflow_frames = dma_overflow_frames;
+}
+
+void mic_capture_block_levels(const mic_capture_block_t* block, float* peak_dbfs, float* rms_dbfs) {
+    const size_t samples = (size_t)block->frames * REC_NUM_CHANNELS;
+    int32_t peak = 0;
+    int64_t sum_squares = 0;
+    for (size_t i = 0; i < samples; i++) {
+        const int32_t x = block->samples[i];
+        const int32_t magnitude = (x < 0) ? -x : x;
+        if (magnitude > peak) peak = magnitude;
+        sum_squares += (int64_t)x * x;
+    }
+    const float gain_db = (block->gain_q16 > 0) ? 20.0f * log10f((float)block->gain_q16 / 65536.0f) : 0.0f;
+    if (peak_dbfs) *peak_dbfs = (peak > 0) ? 20.0f * log10f((float)peak / 32768.0f) - gain_db : -150.0f;
+    if (rms_dbfs) {
+        const double mean_square = samples ? (double)sum_squares / (double)samples : 0.0;
+        *rms_dbfs = (mean_square > 0.0) ? (float)(10.0 * log10(mean_square / (32768.0 * 32768.0))) - gain_db : -150.0f;
+    }
+}
+
+// --- Capture Task ---
+// Hands a block to one subscriber. Never waits: a full queue loses the block
+// for this subscriber only.
+static void push_block(mic_capture_subscriber_t* sub, const mic_capture_block_t* block) {
+    const uint32_t head = sub->head.load(std::memory_order_relaxed);
+    if (head - sub->tail.load(std::memory_order_acquire) >= sub->capacity) {
+        sub->dropped_frames.fetch_add(block->frames, std::memory_order_relaxed);
+        return;
+    }
+    mic_capture_block_t* slot = &sub->slots[head & (sub->capacity - 1)];
+    memcpy(slot->samples, block->samples, (size_t)block->frames * REC_NUM_CHANNELS * sizeof(int16_t));
+    slot->frames = block->frames;
+    slot->gain_q16 = block->gain_q16;
+    slot->sequence = block->sequence;
+    sub->head.store(head + 1, std::memory_order_release);
+    xSemaphoreGive(sub->ready);
+}
+
+// Tells every subscriber that no more blocks will come, waking any that waits.
+static void fail_subscribers(void) {
+    xSemaphoreTake(subscribers_lock, portMAX_DELAY);
+    capture_failed = true;
+    closing = true;
+    for (int i = 0; i < MIC_CAPTURE_MAX_SUBSCRIBERS; i++) {
+        if (!subscribers[i].in_use) continue;
+        subscribers[i].failed.store(true, std::memory_order_release);
+        xSemaphoreGive(subscribers[i].ready);
+    }
+    xSemaphoreGive(subscribers_lock);
+}
+
+// Reads the microphone for as long as anyone is subscribed. Each block is
+// converted once, into `block`, and copied to every subscriber's queue.
+// Returns the number of blocks read.
+static uint32_t capture_loop(int32_t* raw, mic_capture_block_t* block, audio_agc_t* agc) {
+    const size_t raw_bytes = MIC_CAPTURE_BLOCK_SAMPLES * sizeof(int32_t);
+    uint32_t sequence = 0;
+    for (;;) {
+        if (!running) {
+            // A subscription may have come in since, and kept the task.
+            xSemaphoreTake(subscribers_lock, portMAX_DELAY);
+            closing = !running;
+            xSemaphoreGive(subscribers_lock);
+            if (closing) return sequence;
+        }
+
+        size_t bytes_read = 0;
+        esp_err_t result = i2s_channel_read(rx_chan, raw, raw_bytes, &bytes_read, pdMS_TO_TICKS(READ_TIMEOUT_MS));
+        if (result != ESP_OK || bytes_read == 0) {
+            if (result != ESP_ERR_TIMEOUT) {
+                ESP_LOGE(TAG, "I2S read failed: %s", esp_err_to_name(result));
+                vTaskDelay(pdMS_TO_TICKS(READ_TIMEOUT_MS));
+            }
+            continue;
+        }
+
+        block->frames = (uint16_t)(bytes_read / (sizeof(int32_t) * REC_NUM_CHANNELS));
+        const int32_t gain_from = agc->gain_q16;
+        audio_agc_process(agc, raw, block->samples, block->frames, REC_NUM_CHANNELS);
+        block->gain_q16 = (int32_t)(((int64_t)gain_from + agc->gain_q16) / 2);
+        block->sequence = sequence++;
+
+        xSemaphoreTake(subscribers_lock, portMAX_DELAY);
+        for (int i = 0; i < MIC_CAPTURE_MAX_SUBSCRIBERS; i++) {
+            if (subscribers[i].in_use) push_block(&subscribers[i], block);
+        }
+        capture_stats.blocks = sequence;
+        xSemaphoreGive(subscribers_lock);
+    }
+}
+
+static void mic_capture_task(void *arg) {
+    int32_t* raw = (int32_t*)malloc(MIC_CAPTURE_BLOCK_SAMPLES * sizeof(int32_t));
+    mic_capture_block_t* block = (mic_capture_block_t*)malloc(sizeof(mic_capture_block_t));
+    static audio_agc_t agc;
+    audio_agc_init(&agc, REC_SAMPLE_RATE, NULL);
+
+    uint32_t blocks = 0;
+    if (raw && block) {
+        blocks = capture_loop(raw, block, &agc);
+    } else {
+        // Subscribers see mic_capture_failed() and get no more blocks. The
+        // service starts again once they have all unsubscribed.
+        ESP_LOGE(TAG, "Failed to allocate capture buffers");
+        fail_subscribers();
+    }
+
+    // A new subscriber waits for this before opening the channel again.
+    i2s_channel_disable(rx_chan);
+    i2s_del_channel(rx_chan);
+    rx_chan = NULL;
+    free(raw);
+    free(block);
+    ESP_LOGI(TAG, "Microphone stopped after %lu blocks. AGC gain %.1f dB, %lu samples clipped.",
+             blocks, audio_agc_get_gain_db(&agc), agc.clipped);
+    capture_task_handle = NULL;
+    vTaskDelete(NULL);
+}
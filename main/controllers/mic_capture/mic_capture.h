@@ -0,0 +1,116 @@
+/**
+ * @file mic_capture.h
+ * @brief Shared microphone capture service: owns the I2S RX channel of the INMP441.
+ *
+ * A single high-priority task reads the microphone on I2S_NUM_1 in blocks of
+ * MIC_CAPTURE_BLOCK_FRAMES, converts the 32-bit slots to 16-bit PCM once
+ * (through the microphone AGC, see audio_agc.h) and hands a copy of each
+ * block to every subscriber: the recorder, the WiFi streamer, a level meter.
+ * Each subscriber has its own single-producer / single-consumer queue of
+ * blocks, written only by the capture task and read only by the subscriber,
+ * so neither side ever takes a lock to move audio. A subscriber that falls
+ * behind loses blocks from its own queue (counted) without holding up the
+ * microphone or the other subscribers.
+ *
+ * The channel is opened with the first subscription and closed with the last,
+ * so only the first subscriber pays the few hundred milliseconds the channel
+ * takes to start.
+ */
+#ifndef MIC_CAPTURE_H
+#define MIC_CAPTURE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "config/app_config.h"
+
+/** @brief Frames per block (32 ms at 16 kHz). */
+#define MIC_CAPTURE_BLOCK_FRAMES 512
+#define MIC_CAPTURE_BLOCK_SAMPLES (MIC_CAPTURE_BLOCK_FRAMES * REC_NUM_CHANNELS)
+/** @brief Most subscribers at once. */
+#define MIC_CAPTURE_MAX_SUBSCRIBERS 4
+
+/**
+ * @brief One block of microphone audio, REC_SAMPLE_RATE and REC_NUM_CHANNELS.
+ */
+typedef struct {
+    int16_t samples[MIC_CAPTURE_BLOCK_SAMPLES]; //!< Interleaved 16-bit PCM, after the AGC.
+    uint16_t frames;            //!< Valid frames in `samples`.
+    int32_t gain_q16;           //!< Mean AGC gain over the block (Q16): divide by it for the level at the microphone.
+    uint32_t sequence;          //!< Block number since the channel opened.
+} mic_capture_block_t;
+
+/**
+ * @brief Health counters of the service.
+ */
+typedef struct {
+    uint32_t blocks;            //!< Blocks read since the channel opened.
+    uint32_t dma_overflows;     //!< I2S DMA buffers overwritten before the task read them (since boot).
+    uint32_t dma_overflow_frames; //!< Frames lost to those overflows (since boot).
+    uint32_t subscribers;       //!< Current subscribers.
+    uint32_t open_us;           //!< Time the last channel start took.
+} mic_capture_stats_t;
+
+typedef struct mic_capture_subscriber mic_capture_subscriber_t;
+
+/**
+ * @brief Initializes the service. Must be called once at startup, before any subscription.
+ */
+void mic_capture_init(void);
+
+/**
+ * @brief Subscribes to the microphone, starting it if needed.
+ *
+ * @param name Short name for the logs (kept, not copied).
+ * @param queue_blocks Blocks the subscriber's queue holds, rounded up to a power of two.
+ *        The subscriber must read at least this often (in blocks of 32 ms) not to lose audio.
+ * @return The subscription, or NULL if the channel could not be started, a failed capture
+ *         still has subscribers, or there is no free slot.
+ */
+mic_capture_subscriber_t* mic_capture_subscribe(const char* name, uint32_t queue_blocks);
+
+/**
+ * @brief Ends a subscription and frees its queue. The microphone stops with the last one.
+ * Must be called from the task that reads the subscription, or once it no longer does.
+ */
+void mic_capture_unsubscribe(mic_capture_subscriber_t* sub);
+
+/**
+ * @brief Returns the oldest block in the subscriber's queue, waiting for one if it is empty.
+ *
+ * The block stays valid, and in the queue, until mic_capture_release().
+ * Only the subscriber's own task may call this.
+ *
+ * @param timeout_ms How long to wait for a block, 0 not to wait.
+ * @return The block, or NULL if none arrived in time or the capture failed (see mic_capture_failed()).
+ */
+const mic_capture_block_t* mic_capture_peek(mic_capture_subscriber_t* sub, uint32_t timeout_ms);
+
+/**
+ * @brief Removes the block returned by the last mic_capture_peek() from the queue.
+ */
+void mic_capture_release(mic_capture_subscriber_t* sub);
+
+/**
+ * @brief Whether the capture stopped on an error (e.g. out of memory when the
+ * channel opened). No more blocks will come, and mic_capture_peek() no longer
+ * waits; the subscriber should unsubscribe. The service starts again with the
+ * next subscription once every subscriber of the failed capture has left.
+ */
+bool mic_capture_failed(const mic_capture_subscriber_t* sub);
+
+/**
+ * @brief Frames this subscriber lost because its queue was full.
+ */
+uint32_t mic_capture_dropped_frames(const mic_capture_subscriber_t* sub);
+
+/**
+ * @brief Gets the service's health counters.
+ */
+void mic_capture_get_stats(mic_capture_stats_t* stats);
+
+/**
+ * @brief Peak and RMS level of a block at the microphone (the AGC gain taken out), in dBFS.
+ */
+void mic_capture_block_levels(const mic_capture_block_t* block, float* peak_dbfs, float* rms_dbfs);
+
+#endif // MIC_CAPTURE_H
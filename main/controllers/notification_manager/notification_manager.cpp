@@ -8,10 +8,8 @@
 #include "views/view_manager.h"
 #include "components/popup_manager/popup_manager.h"
 #include "controllers/audio_manager/audio_manager.h"
-#include "controllers/sd_card_manager/sd_card_manager.h"
 #include "controllers/littlefs_manager/littlefs_manager.h"
 #include "views/core/standby_view/standby_view.h"
-#include <sys/stat.h>
 
 static const char *TAG = "NOTIF_MGR";
 
@@ -184,22 +182,7 @@ void NotificationManager::dispatcher_task(lv_timer_t* timer) {
         
         StandbyView::show_notification_popup(notif_to_show);
         
-        if (sd_manager_check_ready()) {
-            char sound_path[256];
-            snprintf(sound_path, sizeof(sound_path), "%s%s%s%s%s",
-                     SD_CARD_ROOT_PATH,
-                     ASSETS_BASE_SUBPATH,
-                     ASSETS_SOUNDS_SUBPATH,
-                     SOUNDS_EFFECTS_SUBPATH,
-                     UI_SOUND_NOTIFICATION);
-
-            struct stat st;
-            if (stat(sound_path, &st) == 0) {
-                audio_manager_play(sound_path);
-            } else {
-                ESP_LOGW(TAG, "Notification sound file not found at %s", sound_path);
-            }
-        }
+        audio_manager_play_sound(AUDIO_SOUND_NOTIFICATION);
 
         mark_as_read(notif_to_show.id);
     }
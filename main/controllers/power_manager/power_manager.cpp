@@ -7,15 +7,12 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "time.h"
-#include <sys/stat.h>
 
 // Include managers needed for direct wake-up actions
 #include "controllers/button_manager/button_manager.h"
 #include "controllers/notification_manager/notification_manager.h"
-#include "controllers/sd_card_manager/sd_card_manager.h"
 #include "controllers/audio_manager/audio_manager.h"
 #include "controllers/screen_manager/screen_manager.h"
-#include "models/asset_config.h" // Include the new asset path configuration
 
 /**
  * @brief DESIGN NOTE: Light Sleep Notification Handling
@@ -81,28 +78,15 @@ sleep_entry_point:
         // Woken by notification timer. Play sound and go back to sleep.
         ESP_LOGI(TAG, "Wakeup by timer. Playing notification sound and returning to sleep.");
         
-        if (sd_manager_check_ready()) {
-            char sound_path[256];
-            snprintf(sound_path, sizeof(sound_path), "%s%s%s%s%s",
-                     SD_CARD_ROOT_PATH,        // "/sdcard"
-                     ASSETS_BASE_SUBPATH,      // "/assets/"
-                     ASSETS_SOUNDS_SUBPATH,    // "sounds/"
-                     SOUNDS_EFFECTS_SUBPATH,   // "effects/"
-                     UI_SOUND_NOTIFICATION);   // "notification.wav" (from asset_config.h)
-
-            struct stat st;
-            if (stat(sound_path, &st) == 0) {
-                audio_manager_play(sound_path);
-                // Wait for the sound to finish playing.
-                while (audio_manager_get_state() != AUDIO_STATE_STOPPED) {
-                    vTaskDelay(pdMS_TO_TICKS(100));
-                }
-                ESP_LOGI(TAG, "Sound finished.");
-            } else {
-                ESP_LOGW(TAG, "Notification sound file not found at %s", sound_path);
+        // Played from the PSRAM sound bank: no SD readiness check or file access on wake.
+        if (audio_manager_play_sound(AUDIO_SOUND_NOTIFICATION)) {
+            // Wait for the sound to finish playing.
+            while (audio_manager_is_sound_playing()) {
+                vTaskDelay(pdMS_TO_TICKS(100));
             }
+            ESP_LOGI(TAG, "Sound finished.");
         } else {
-            ESP_LOGW(TAG, "SD card not ready, cannot play notification sound.");
+            ESP_LOGW(TAG, "Notification sound not available.");
         }
         
         goto sleep_entry_point; // Re-enter sleep cycle, screen remains OFF
@@ -1,20 +1,49 @@
 #include "stt_manager.h"
+#include "config/app_config.h"
 #include "config/secrets.h"
+#include "models/asset_config.h"
+#include "controllers/sd_card_manager/sd_card_manager.h"
 #include "esp_log.h"
-#include "esp_http_client.h"
+#include "controllers/https_client/https_client.h"
+#include "stt_upload_audio.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
 #include "cJSON.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "freertos/ringbuf.h"
 #include "freertos/event_groups.h"
 #include "controllers/wifi_manager/wifi_manager.h"
+#include <algorithm>
+#include <atomic>
 #include <memory>
 #include <vector>
+#include <string.h>
 
 static const char* TAG = "STT_MANAGER";
 #define GROQ_TRANSCRIPTIONS_URL "https://api.groq.com/openai/v1/audio/transcriptions"
 #define STT_MODEL "whisper-large-v3-turbo"
 #define BOUNDARY "----WebKitFormBoundary7MA4YWxkTrZu0gW"
 #define HTTP_POST_BUFFER_SIZE 2048
+#define STREAM_TASK_PRIORITY 4      // Below the recorder's writer, which feeds it.
+#define STREAM_WAIT_MS 100          // Max wait for audio before re-checking for the end.
+#define WAV_HEADER_SIZE 44
+
+// The multipart/form-data body around the audio.
+#define MULTIPART_HEAD(filename, content_type) \
+    "--" BOUNDARY "\r\n" \
+    "Content-Disposition: form-data; name=\"model\"\r\n\r\n" \
+    STT_MODEL "\r\n" \
+    "--" BOUNDARY "\r\n" \
+    "Content-Disposition: form-data; name=\"response_format\"\r\n\r\n" \
+    "json\r\n" \
+    "--" BOUNDARY "\r\n" \
+    "Content-Disposition: form-data; name=\"file\"; filename=\"" filename "\"\r\n" \
+    "Content-Type: " content_type "\r\n\r\n"
+#define WAV_PART_HEAD MULTIPART_HEAD("note.wav", "audio/wav")
+#define FLAC_PART_HEAD MULTIPART_HEAD("note.flac", "audio/flac")
+#define MULTIPART_TAIL "\r\n--" BOUNDARY "--\r\n"
 
 extern const char groq_api_ca_pem_start[] asm("_binary_groq_api_ca_pem_start");
 
@@ -30,125 +59,151 @@ public:
     std::string response_buffer;
 };
 
-// The HTTP event handler now appends data to a std::string, which is much safer.
-static esp_err_t _http_event_handler(esp_http_client_event_t *evt) {
-    auto* context = static_cast<SttRequestContext*>(evt->user_data);
-    if (!context) {
-        return ESP_FAIL;
+// A transcription streamed while recording. The recorder's writer task feeds
+// `ring` through the tap; the stream task empties it into the request. Both
+// hold a reference, and the last one to let go deletes it, so neither has to
+// wait for the other.
+class SttStreamContext {
+public:
+    SttStreamContext(const std::string& path, stt_result_callback_t func)
+        : request(path, func) {}
+    ~SttStreamContext() {
+        if (ring) vRingbufferDeleteWithCaps(ring);
+        if (wake) vSemaphoreDelete(wake);
     }
 
-    switch(evt->event_id) {
-        case HTTP_EVENT_ERROR:
-            ESP_LOGE(TAG, "HTTP_EVENT_ERROR");
-            break;
-        case HTTP_EVENT_ON_DATA: {
-            ESP_LOGD(TAG, "HTTP_EVENT_ON_DATA, len=%d", evt->data_len);
-            
-            // Get current size and calculate required new capacity
-            size_t current_size = context->response_buffer.length();
-            size_t required_capacity = current_size + evt->data_len;
-
-            // Pre-allocate memory without using exceptions
-            context->response_buffer.reserve(required_capacity);
-
-            // Check if reservation was successful by comparing capacity
-            if (context->response_buffer.capacity() < required_capacity) {
-                ESP_LOGE(TAG, "Failed to reserve memory for response buffer!");
-                return ESP_FAIL; // Signal failure
-            }
+    SttRequestContext request;
+    RingbufHandle_t ring = nullptr;
+    SemaphoreHandle_t wake = nullptr;   // Given when audio arrives and when the recording ends.
+    std::atomic<int> refs{2};           // The stream task and the recorder's tap.
+    std::atomic<bool> broken{false};    // Audio was lost or the upload failed: the file is sent instead.
+    std::atomic<bool> ended{false};
+    std::atomic<bool> saved{false};
+    int64_t end_us = 0;                 // When the recording ended.
+};
 
-            // Append data now that we know there is space
-            context->response_buffer.append(static_cast<const char*>(evt->data), evt->data_len);
-            break;
-        }
-        default:
-            break;
+static void release_stream(SttStreamContext* stream) {
+    if (stream->refs.fetch_sub(1) == 1) delete stream;
+}
+
+// --- Request Helpers (shared by the file and the streamed upload) ---
+
+static bool wait_for_network(TickType_t timeout) {
+    EventGroupHandle_t wifi_event_group = wifi_manager_get_event_group();
+    if (!wifi_event_group) {
+        ESP_LOGE(TAG, "WiFi event group not available!");
+        return false;
     }
-    return ESP_OK;
+    const EventBits_t ready = (EventBits_t)(WIFI_CONNECTED_BIT | TIME_SYNC_BIT);
+    EventBits_t bits = xEventGroupWaitBits(wifi_event_group, ready, pdFALSE, pdTRUE, timeout);
+    return (bits & ready) == ready;
 }
 
+// Opens the POST to the API (on a kept-alive connection if there is one). A
+// negative `content_length` sends the body chunked. Returns the request (to be
+// closed by the caller), or NULL with `result_text` set.
+static https_request_t open_transcription_request(int64_t content_length, std::string& result_text) {
+    std::string headers = "Authorization: Bearer " + std::string(GROQ_API_KEY) + "\r\n"
+                          "Content-Type: multipart/form-data; boundary=" BOUNDARY "\r\n";
 
-static void stt_transcription_task(void *pvParameters) {
-    // Take ownership of the context object. It will be automatically deleted when the task exits.
-    std::unique_ptr<SttRequestContext> context(static_cast<SttRequestContext*>(pvParameters));
+    https_request_config_t config = {};
+    config.url = GROQ_TRANSCRIPTIONS_URL;
+    config.method = "POST";
+    config.cert_pem = groq_api_ca_pem_start;
+    config.headers = headers.c_str();
+    config.content_length = content_length;
+    config.timeout_ms = 30000;
+
+    https_request_t request = https_client_open(&config);
+    if (!request) {
+        ESP_LOGE(TAG, "Failed to open HTTP connection.");
+        result_text = "Error: HTTP connection failed.";
+    }
+    return request;
+}
+
+// Reads the response of a request whose body has been sent.
+static bool read_transcription_response(https_request_t request, SttRequestContext* context, std::string& result_text) {
+    // Fetch headers first to get the final response length
+    int status_code = https_client_fetch_headers(request);
+    if (status_code < 0) {
+         ESP_LOGE(TAG, "HTTP client fetch headers failed");
+         result_text = "Error: HTTP fetch headers failed.";
+         return false;
+    }
+    ESP_LOGI(TAG, "HTTP Status = %d", status_code);
+
+    if (!https_client_read_body(request, context->response_buffer)) {
+         ESP_LOGE(TAG, "HTTP client read response failed");
+    }
 
-    esp_http_client_handle_t client = nullptr;
-    FILE* audio_file = nullptr;
-    std::string result_text;
     bool success = false;
-    
-    do {
-        ESP_LOGI(TAG, "STT task started. Waiting for WiFi & Time Sync...");
-        EventGroupHandle_t wifi_event_group = wifi_manager_get_event_group();
-        if (!wifi_event_group) {
-            ESP_LOGE(TAG, "WiFi event group not available!");
-            result_text = "Error: WiFi infrastructure not ready.";
-            break;
+    if (status_code == 200) {
+        cJSON *root = cJSON_Parse(context->response_buffer.c_str());
+        if (root) {
+            cJSON *text_item = cJSON_GetObjectItem(root, "text");
+            if (cJSON_IsString(text_item) && (text_item->valuestring != NULL)) {
+                result_text = text_item->valuestring;
+                success = true;
+            } else {
+                result_text = "Error: 'text' field not found in JSON response.";
+            }
+            cJSON_Delete(root);
+        } else {
+            result_text = "Error: Failed to parse JSON response.";
         }
+    } else {
+        result_text = "Error: HTTP " + std::to_string(status_code) + " - " + (context->response_buffer.empty() ? "No details" : context->response_buffer);
+    }
+    return success;
+}
 
-        EventBits_t bits = xEventGroupWaitBits(wifi_event_group, WIFI_CONNECTED_BIT | TIME_SYNC_BIT, pdFALSE, pdTRUE, pdMS_TO_TICKS(20000));
-        if ((bits & (WIFI_CONNECTED_BIT | TIME_SYNC_BIT)) != (WIFI_CONNECTED_BIT | TIME_SYNC_BIT)) {
-            ESP_LOGE(TAG, "Timed out waiting for WiFi connection and time sync.");
-            result_text = "Error: WiFi/Time not ready.";
-            break;
-        }
-        ESP_LOGI(TAG, "WiFi & Time Sync are ready. Proceeding with transcription.");
-        
-        audio_file = fopen(context->file_path.c_str(), "rb");
-        if (!audio_file) {
-            ESP_LOGE(TAG, "Failed to open audio file: %s", context->file_path.c_str());
-            result_text = "Error: Could not open audio file.";
-            break;
-        }
+static void save_transcript(const std::string& audio_path, const std::string& text) {
+    std::string dir = std::string(SD_CARD_ROOT_PATH) + "/" + USER_DATA_BASE_PATH + TRANSCRIPTS_SUBPATH;
+    std::string path = stt_manager_get_transcript_path(audio_path);
+    if (!sd_manager_create_directory(dir.c_str()) || !sd_manager_write_file(path.c_str(), text.c_str())) {
+        ESP_LOGW(TAG, "Could not save the transcript to %s", path.c_str());
+    }
+}
 
-        fseek(audio_file, 0, SEEK_END);
-        long file_size = ftell(audio_file);
-        fseek(audio_file, 0, SEEK_SET);
-
-        std::string body_header = 
-            "--" BOUNDARY "\r\n"
-            "Content-Disposition: form-data; name=\"model\"\r\n\r\n"
-            STT_MODEL "\r\n"
-            "--" BOUNDARY "\r\n"
-            "Content-Disposition: form-data; name=\"response_format\"\r\n\r\n"
-            "json\r\n"
-            "--" BOUNDARY "\r\n"
-            "Content-Disposition: form-data; name=\"file\"; filename=\"note.wav\"\r\n"
-            "Content-Type: audio/wav\r\n\r\n";
-
-        std::string body_footer = "\r\n--" BOUNDARY "--\r\n";
-        
-        long total_content_length = body_header.length() + file_size + body_footer.length();
-        
-        esp_http_client_config_t config = {};
-        config.url = GROQ_TRANSCRIPTIONS_URL;
-        config.event_handler = _http_event_handler;
-        config.user_data = context.get(); // Pass the context pointer
-        config.method = HTTP_METHOD_POST;
-        config.timeout_ms = 30000;
-        config.cert_pem = groq_api_ca_pem_start;
-        config.buffer_size = 2048;
-
-        client = esp_http_client_init(&config);
-        if (!client) {
-            ESP_LOGE(TAG, "Failed to initialize HTTP client");
-            result_text = "Error: HTTP client init failed.";
-            break;
+// Delivers the result and keeps a successful transcript.
+static void finish_request(SttRequestContext* context, bool success, std::string& result_text) {
+    if (success) {
+        save_transcript(context->file_path, result_text);
+    }
+    if (context->callback) {
+        if (!success && result_text.empty()) {
+            result_text = "Unknown transcription error";
         }
+        context->callback(success, result_text);
+    }
+}
 
-        std::string auth_header = "Bearer " + std::string(GROQ_API_KEY);
-        esp_http_client_set_header(client, "Authorization", auth_header.c_str());
+// --- File Upload ---
 
-        std::string content_type_header = "multipart/form-data; boundary=" + std::string(BOUNDARY);
-        esp_http_client_set_header(client, "Content-Type", content_type_header.c_str());
+// Sends the file as it is, with its length known up front. Returns false with
+// `result_text` set on failure; `*request` is left for the caller to close.
+static bool send_file(const std::string& path, https_request_t* request, uint32_t* bytes_sent, std::string& result_text) {
+    FILE* audio_file = fopen(path.c_str(), "rb");
+    if (!audio_file) {
+        ESP_LOGE(TAG, "Failed to open audio file: %s", path.c_str());
+        result_text = "Error: Could not open audio file.";
+        return false;
+    }
 
-        if (esp_http_client_open(client, total_content_length) != ESP_OK) {
-            ESP_LOGE(TAG, "Failed to open HTTP connection.");
-            result_text = "Error: HTTP connection failed.";
-            break;
-        }
-        
-        if (esp_http_client_write(client, body_header.c_str(), body_header.length()) < 0) {
+    fseek(audio_file, 0, SEEK_END);
+    long file_size = ftell(audio_file);
+    fseek(audio_file, 0, SEEK_SET);
+
+    const char body_header[] = WAV_PART_HEAD;
+    const char body_footer[] = MULTIPART_TAIL;
+    long total_content_length = (sizeof(body_header) - 1) + file_size + (sizeof(body_footer) - 1);
+
+    do {
+        *request = open_transcription_request(total_content_length, result_text);
+        if (!*request) break;
+
+        if (!https_client_write(*request, body_header, sizeof(body_header) - 1)) {
              ESP_LOGE(TAG, "Failed to write multipart headers");
              result_text = "Error: HTTP header write failed.";
              break;
@@ -157,73 +212,266 @@ static void stt_transcription_task(void *pvParameters) {
         std::vector<char> file_read_buffer(HTTP_POST_BUFFER_SIZE);
         size_t bytes_read;
         while ((bytes_read = fread(file_read_buffer.data(), 1, file_read_buffer.size(), audio_file)) > 0) {
-            if (esp_http_client_write(client, file_read_buffer.data(), bytes_read) < 0) {
+            if (!https_client_write(*request, file_read_buffer.data(), bytes_read)) {
                 ESP_LOGE(TAG, "Failed to write HTTP data");
                 result_text = "Error: HTTP data send failed.";
                 break;
             }
+            *bytes_sent += bytes_read;
         }
         if (!result_text.empty()) break; // Exit if an error occurred in the loop
 
-        if (esp_http_client_write(client, body_footer.c_str(), body_footer.length()) < 0) {
+        if (!https_client_write(*request, body_footer, sizeof(body_footer) - 1)) {
              ESP_LOGE(TAG, "Failed to write final boundary");
              result_text = "Error: HTTP final boundary write failed.";
              break;
         }
+    } while(0);
 
-        // Fetch headers first to get the final response length
-        if (esp_http_client_fetch_headers(client) < 0) {
-             ESP_LOGE(TAG, "HTTP client fetch headers failed");
-             result_text = "Error: HTTP fetch headers failed.";
-             break;
+    fclose(audio_file);
+    return result_text.empty();
+}
+
+// Sends the recording as FLAC (see stt_upload_audio.h), chunked since its
+// size is only known at the end. The frames are gathered into chunks of
+// STT_STREAM_CHUNK_SIZE, one outgoing TLS record each.
+static bool send_converted(stt_upload_audio_t* audio, https_request_t* request, std::string& result_text) {
+    *request = open_transcription_request(-1, result_text);
+    if (!*request) return false;
+
+    if (!https_client_write(*request, FLAC_PART_HEAD, sizeof(FLAC_PART_HEAD) - 1)) {
+        ESP_LOGE(TAG, "Failed to write multipart headers");
+        result_text = "Error: HTTP header write failed.";
+        return false;
+    }
+
+    std::vector<uint8_t> chunk;
+    chunk.reserve(STT_STREAM_CHUNK_SIZE);
+    const uint8_t* data;
+    size_t len;
+    while ((len = stt_upload_audio_next(audio, &data)) > 0) {
+        while (len > 0) {
+            const size_t n = std::min(len, STT_STREAM_CHUNK_SIZE - chunk.size());
+            chunk.insert(chunk.end(), data, data + n);
+            data += n;
+            len -= n;
+            if (chunk.size() < STT_STREAM_CHUNK_SIZE) break;
+            if (!https_client_write(*request, chunk.data(), chunk.size())) {
+                ESP_LOGE(TAG, "Failed to write HTTP data");
+                result_text = "Error: HTTP data send failed.";
+                return false;
+            }
+            chunk.clear();
         }
-        
-        // Now perform the read loop
-        int status_code = esp_http_client_get_status_code(client);
-        ESP_LOGI(TAG, "HTTP Status = %d", status_code);
-
-        // The response body is already being collected by the event handler
-        esp_err_t read_err = esp_http_client_read_response(client, nullptr, 0);
-        if (read_err != ESP_OK && read_err != ESP_ERR_HTTP_EAGAIN) {
-             ESP_LOGE(TAG, "HTTP client read response failed: %s", esp_err_to_name(read_err));
+    }
+    if (stt_upload_audio_failed(audio)) {
+        result_text = "Error: Could not read audio file.";
+        return false;
+    }
+
+    chunk.insert(chunk.end(), MULTIPART_TAIL, MULTIPART_TAIL + sizeof(MULTIPART_TAIL) - 1);
+    if (!https_client_write(*request, chunk.data(), chunk.size())) {
+        ESP_LOGE(TAG, "Failed to write final boundary");
+        result_text = "Error: HTTP final boundary write failed.";
+        return false;
+    }
+    return true;
+}
+
+static void stt_transcription_task(void *pvParameters) {
+    // Take ownership of the context object. It will be automatically deleted when the task exits.
+    std::unique_ptr<SttRequestContext> context(static_cast<SttRequestContext*>(pvParameters));
+
+    https_request_t request = nullptr;
+    stt_upload_audio_t* converted = nullptr;
+    std::string result_text;
+    bool success = false;
+
+    do {
+        ESP_LOGI(TAG, "STT task started. Waiting for WiFi & Time Sync...");
+        if (!wait_for_network(pdMS_TO_TICKS(20000))) {
+            ESP_LOGE(TAG, "Timed out waiting for WiFi connection and time sync.");
+            result_text = "Error: WiFi/Time not ready.";
+            break;
         }
-        
-        if (status_code == 200) {
-            cJSON *root = cJSON_Parse(context->response_buffer.c_str());
-            if (root) {
-                cJSON *text_item = cJSON_GetObjectItem(root, "text");
-                if (cJSON_IsString(text_item) && (text_item->valuestring != NULL)) {
-                    result_text = text_item->valuestring;
-                    success = true;
-                } else {
-                    result_text = "Error: 'text' field not found in JSON response.";
-                }
-                cJSON_Delete(root);
-            } else {
-                result_text = "Error: Failed to parse JSON response.";
-            }
+        ESP_LOGI(TAG, "WiFi & Time Sync are ready. Proceeding with transcription.");
+
+#if STT_UPLOAD_COMPRESS
+        converted = stt_upload_audio_open(context->file_path.c_str());
+#endif
+        const int64_t upload_start_us = esp_timer_get_time();
+        uint32_t bytes_sent = 0;
+        if (converted) {
+            if (!send_converted(converted, &request, result_text)) break;
+        } else {
+            if (!send_file(context->file_path, &request, &bytes_sent, result_text)) break;
+        }
+        const int64_t upload_ms = (esp_timer_get_time() - upload_start_us) / 1000;
+
+        if (converted) {
+            stt_upload_audio_stats_t stats;
+            stt_upload_audio_get_stats(converted, &stats);
+            ESP_LOGI(TAG, "Sent %lu bytes of FLAC for a %lu-byte file (%lu%%) in %lld ms (%lu ms converting); "
+                     "%lu of %lu ms of audio kept, %lu Hz x%u -> %lu Hz mono.",
+                     stats.upload_bytes, stats.source_bytes,
+                     stats.source_bytes ? (uint32_t)((uint64_t)stats.upload_bytes * 100 / stats.source_bytes) : 0,
+                     upload_ms, stats.process_us / 1000,
+                     (uint32_t)((uint64_t)stats.upload_frames * 1000 / stats.upload_rate),
+                     (uint32_t)((uint64_t)stats.source_frames * 1000 / stats.source_rate),
+                     stats.source_rate, stats.source_channels, stats.upload_rate);
         } else {
-            result_text = "Error: HTTP " + std::to_string(status_code) + " - " + (context->response_buffer.empty() ? "No details" : context->response_buffer);
+            ESP_LOGI(TAG, "Sent the %lu-byte file in %lld ms.", bytes_sent, upload_ms);
         }
 
+        success = read_transcription_response(request, context.get(), result_text);
+
     } while(0);
 
     // --- Automatic-style Cleanup ---
-    if (audio_file) fclose(audio_file);
-    if (client) esp_http_client_cleanup(client);
-    
+    if (converted) stt_upload_audio_close(converted);
+    if (request) https_client_close(request);
+
     // --- Safe Callback Invocation ---
-    if (context->callback) {
-        if (!success && result_text.empty()) {
-            result_text = "Unknown transcription error";
+    finish_request(context.get(), success, result_text);
+
+    ESP_LOGI(TAG, "STT task finished.");
+    vTaskDelete(NULL);
+}
+
+// --- Streamed Upload ---
+
+// The recorder's tap, on its writer task. Never waits: audio that does not
+// fit breaks the stream, and the file is sent instead.
+static void stream_on_audio(const void* pcm, size_t len, void* arg) {
+    auto* stream = static_cast<SttStreamContext*>(arg);
+    if (stream->broken) return;
+    if (xRingbufferSend(stream->ring, pcm, len, 0) != pdTRUE) {
+        ESP_LOGW(TAG, "Stream buffer full; the file will be uploaded once the recording ends.");
+        stream->broken = true;
+    }
+    xSemaphoreGive(stream->wake);
+}
+
+static void stream_on_end(bool saved, void* arg) {
+    auto* stream = static_cast<SttStreamContext*>(arg);
+    stream->end_us = esp_timer_get_time();
+    stream->saved = saved;
+    stream->ended = true;
+    xSemaphoreGive(stream->wake);
+    release_stream(stream);
+}
+
+static void put_le16(uint8_t* p, uint16_t v) { p[0] = v & 0xFF; p[1] = v >> 8; }
+static void put_le32(uint8_t* p, uint32_t v) { put_le16(p, v & 0xFFFF); put_le16(p + 2, v >> 16); }
+
+// Header of a 16-bit PCM WAV of unknown length. The sizes are left at their
+// maximum, which decoders take as "until the end of the stream".
+static void build_stream_wav_header(uint8_t* h) {
+    const uint32_t byte_rate = REC_SAMPLE_RATE * REC_NUM_CHANNELS * sizeof(int16_t);
+    memcpy(h, "RIFF", 4);
+    put_le32(h + 4, 0xFFFFFFFF);
+    memcpy(h + 8, "WAVEfmt ", 8);
+    put_le32(h + 16, 16);
+    put_le16(h + 20, 1); // PCM
+    put_le16(h + 22, REC_NUM_CHANNELS);
+    put_le32(h + 24, REC_SAMPLE_RATE);
+    put_le32(h + 28, byte_rate);
+    put_le16(h + 32, REC_NUM_CHANNELS * sizeof(int16_t));
+    put_le16(h + 34, 16);
+    memcpy(h + 36, "data", 4);
+    put_le32(h + 40, 0xFFFFFFFF);
+}
+
+// Owns a streamed request: connects as the recording starts, uploads the audio
+// as it is written, and finishes the request (or falls back to the file) once
+// the recording has ended.
+static void stt_stream_task(void *pvParameters) {
+    auto* stream = static_cast<SttStreamContext*>(pvParameters);
+    SttRequestContext* context = &stream->request;
+    https_request_t request = nullptr;
+    std::string result_text;
+    bool success = false;
+    uint32_t bytes_streamed = 0;
+
+    // --- Connect ---
+    const int64_t connect_start_us = esp_timer_get_time();
+    const TickType_t connect_deadline = xTaskGetTickCount() + pdMS_TO_TICKS(STT_STREAM_CONNECT_TIMEOUT_MS);
+    // A recording that ends before the connection is up is still sent, unless it was discarded.
+    auto discarded = [stream] { return stream->ended && !stream->saved; };
+    while (!discarded() && !wait_for_network(pdMS_TO_TICKS(STREAM_WAIT_MS))) {
+        if ((int32_t)(xTaskGetTickCount() - connect_deadline) >= 0) {
+            ESP_LOGW(TAG, "No WiFi/time sync for the stream; the file will be uploaded instead.");
+            stream->broken = true;
+            break;
         }
-        context->callback(success, result_text);
     }
-    
-    ESP_LOGI(TAG, "STT task finished.");
+    if (!stream->broken && !discarded()) {
+        request = open_transcription_request(-1, result_text);
+        uint8_t head[sizeof(WAV_PART_HEAD) - 1 + WAV_HEADER_SIZE];
+        memcpy(head, WAV_PART_HEAD, sizeof(WAV_PART_HEAD) - 1);
+        build_stream_wav_header(head + sizeof(WAV_PART_HEAD) - 1);
+        if (!request || !https_client_write(request, head, sizeof(head))) {
+            ESP_LOGW(TAG, "Could not open the stream (%s); the file will be uploaded instead.", result_text.c_str());
+            stream->broken = true;
+        } else {
+            ESP_LOGI(TAG, "Stream open after %lld ms.", (esp_timer_get_time() - connect_start_us) / 1000);
+        }
+    }
+
+    // --- Upload while recording ---
+    for (;;) {
+        // Read the flag first: if the recording had already ended, an empty ring means it is drained.
+        const bool drained_if_empty = stream->ended;
+        size_t item_size = 0;
+        void* item = xRingbufferReceiveUpTo(stream->ring, &item_size, 0, STT_STREAM_CHUNK_SIZE);
+        if (!item) {
+            if (drained_if_empty) break;
+            xSemaphoreTake(stream->wake, pdMS_TO_TICKS(STREAM_WAIT_MS));
+            continue;
+        }
+        if (!stream->broken && request) {
+            if (https_client_write(request, item, item_size)) {
+                bytes_streamed += item_size;
+            } else {
+                ESP_LOGW(TAG, "Stream upload failed; the file will be uploaded instead.");
+                stream->broken = true;
+            }
+        }
+        vRingbufferReturnItem(stream->ring, item);
+    }
+
+    // --- Finish ---
+    if (!stream->saved) {
+        result_text = "Error: Recording discarded.";
+    } else if (!stream->broken && request) {
+        if (https_client_write(request, MULTIPART_TAIL, sizeof(MULTIPART_TAIL) - 1)) {
+            success = read_transcription_response(request, context, result_text);
+            ESP_LOGI(TAG, "Streamed %lu bytes; transcript %lld ms after the recording ended.",
+                     bytes_streamed, (esp_timer_get_time() - stream->end_us) / 1000);
+        } else {
+            ESP_LOGW(TAG, "Could not end the stream; the file will be uploaded instead.");
+            stream->broken = true;
+        }
+    }
+    if (request) https_client_close(request);
+
+    if (stream->saved && stream->broken) {
+        // The file on the card is complete: send it the usual way, with the same callback.
+        if (!stt_manager_transcribe(context->file_path, context->callback)) {
+            result_text = "Error: Could not start the file upload.";
+            finish_request(context, false, result_text);
+        }
+    } else {
+        finish_request(context, success, result_text);
+    }
+
+    ESP_LOGI(TAG, "STT stream task finished.");
+    release_stream(stream);
     vTaskDelete(NULL);
 }
 
+// --- Public API ---
+
 void stt_manager_init(void) {
     ESP_LOGI(TAG, "STT Manager Initialized.");
 }
@@ -243,9 +491,52 @@ bool stt_manager_transcribe(const std::string& file_path, stt_result_callback_t
     BaseType_t result = xTaskCreate(stt_transcription_task, "stt_task", 8192, context, 5, NULL);
     if (result != pdPASS) {
         ESP_LOGE(TAG, "Failed to create STT transcription task");
-        delete context; 
+        delete context;
         return false;
     }
 
     return true;
-}
\ No newline at end of file
+}
+
+stt_stream_t stt_manager_stream_begin(const std::string& file_path, audio_recorder_tap_t* tap, stt_result_callback_t cb) {
+    if (file_path.empty() || !tap || !cb) {
+        ESP_LOGE(TAG, "Invalid arguments for a transcription stream.");
+        return nullptr;
+    }
+
+    auto* stream = new(std::nothrow) SttStreamContext(file_path, cb);
+    if (!stream) {
+        ESP_LOGE(TAG, "Failed to allocate memory for stream context");
+        return nullptr;
+    }
+    stream->ring = xRingbufferCreateWithCaps(STT_STREAM_BUFFER_SIZE, RINGBUF_TYPE_BYTEBUF, MALLOC_CAP_SPIRAM);
+    stream->wake = xSemaphoreCreateBinary();
+    if (!stream->ring || !stream->wake) {
+        ESP_LOGE(TAG, "Failed to allocate the stream buffer");
+        delete stream;
+        return nullptr;
+    }
+
+    if (xTaskCreate(stt_stream_task, "stt_stream", 8192, stream, STREAM_TASK_PRIORITY, NULL) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create STT stream task");
+        delete stream;
+        return nullptr;
+    }
+
+    tap->on_audio = stream_on_audio;
+    tap->on_end = stream_on_end;
+    tap->arg = stream;
+    return stream;
+}
+
+void stt_manager_stream_cancel(stt_stream_t stream) {
+    if (stream) stream_on_end(false, stream);
+}
+
+std::string stt_manager_get_transcript_path(const std::string& audio_path) {
+    size_t name_start = audio_path.find_last_of('/');
+    std::string name = audio_path.substr(name_start == std::string::npos ? 0 : name_start + 1);
+    size_t ext = name.find_last_of('.');
+    if (ext != std::string::npos) name.erase(ext);
+    return std::string(SD_CARD_ROOT_PATH) + "/" + USER_DATA_BASE_PATH + TRANSCRIPTS_SUBPATH + name + ".txt";
+}
@@ -3,8 +3,22 @@
  * @brief Manages audio transcription using the remote Groq Speech-to-Text API.
  *
  * This controller performs API requests in a dedicated FreeRTOS task to avoid
- * blocking the UI. It handles HTTPS communication, multipart/form-data creation,
- * and reports results via a callback.
+ * blocking the UI. It handles multipart/form-data creation and reports results
+ * via a callback; requests go through the shared HTTPS client, so one sent
+ * shortly after another reuses its connection (see https_client.h).
+ *
+ * A file is uploaded as FLAC, mono, at 16 kHz and with its silences trimmed
+ * (see stt_upload_audio.h), converted while it is sent; files that are
+ * already compressed are sent as they are.
+ *
+ * A recording can also be transcribed while it is being made: a stream opens
+ * the HTTPS connection as the recording starts and uploads the audio with
+ * chunked transfer encoding as the recorder writes it, so once the recording
+ * stops only the end of the request and the inference are left to wait for.
+ *
+ * Successful transcripts are saved on the SD card (see
+ * stt_manager_get_transcript_path()). Voice notes that could not be
+ * transcribed wait for the connection in stt_queue.h.
  */
 #ifndef STT_MANAGER_H
 #define STT_MANAGER_H
@@ -12,6 +26,7 @@
 #include <stdbool.h>
 #include <string>
 #include <functional>
+#include "controllers/audio_recorder/audio_recorder.h"
 
 /**
  * @brief Callback to notify the result of the transcription.
@@ -24,6 +39,12 @@
  */
 typedef std::function<void(bool success, const std::string& result)> stt_result_callback_t;
 
+/**
+ * @brief A transcription streamed while recording (see stt_manager_stream_begin()).
+ */
+class SttStreamContext;
+typedef SttStreamContext* stt_stream_t;
+
 /**
  * @brief Initializes the Speech-to-Text manager.
  */
@@ -41,4 +62,34 @@ void stt_manager_init(void);
  */
 bool stt_manager_transcribe(const std::string& file_path, stt_result_callback_t cb);
 
-#endif // STT_MANAGER_H
\ No newline at end of file
+/**
+ * @brief Starts transcribing a recording as it is made.
+ *
+ * Fills `tap` so that the recorder feeds the stream: pass it in the options of
+ * audio_recorder_start_with_options() for `file_path`. The audio is uploaded as
+ * 16-bit PCM whatever the file encoding. If the stream cannot keep up (no
+ * connection in time, its buffer filled, the connection dropped) the saved file
+ * is transcribed once the recording ends instead. A recording that is not saved
+ * reports a failure.
+ *
+ * @param file_path The file being recorded, for the fallback and the transcript's name.
+ * @param tap Filled with the stream's callbacks.
+ * @param cb Called once, from the stream's task, when the transcript is ready or has failed.
+ * @return The stream, or NULL if it could not be started (the recording can go ahead without it).
+ */
+stt_stream_t stt_manager_stream_begin(const std::string& file_path, audio_recorder_tap_t* tap, stt_result_callback_t cb);
+
+/**
+ * @brief Ends a stream whose recording did not start. Once the recorder has
+ * accepted the tap, the recording ends the stream instead.
+ */
+void stt_manager_stream_cancel(stt_stream_t stream);
+
+/**
+ * @brief Where the transcript of a recording is saved.
+ * @param audio_path Full path of the .wav file.
+ * @return Full path of its .txt transcript (which may not exist).
+ */
+std::string stt_manager_get_transcript_path(const std::string& audio_path);
+
+#endif // STT_MANAGER_H
@@ -0,0 +1,283 @@
+#include "stt_upload_audio.h"
+#include "config/app_config.h"
+#include "controllers/audio_manager/audio_decoder.h"
+#include "controllers/audio_manager/audio_resampler.h"
+#include "controllers/audio_manager/audio_flac.h"
+#include "controllers/audio_recorder/audio_vad.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include <stdio.h>
+#include <string.h>
+
+static const char* TAG = "STT_UPLOAD";
+
+#define WAV_FORMAT_PCM 1
+
+#define READ_FRAMES 512             // Frames decoded per read.
+#define VAD_BLOCK_MS 32             // Blocks classified by the VAD, like the recorder's capture blocks.
+#define VAD_UNITY_GAIN_Q16 (1 << 16) // The file's levels are what the VAD sees.
+// Blocks of silence held back while trimming (REC_VAD_PREROLL_MS, rounded up to whole blocks).
+#define PREROLL_BLOCKS ((REC_VAD_PREROLL_MS + VAD_BLOCK_MS - 1) / VAD_BLOCK_MS)
+
+struct stt_upload_audio_s {
+    FILE* fp;
+    audio_decoder_t decoder;
+    audio_resampler_t resampler;
+    bool resample;
+    audio_flac_encoder_t encoder;
+    audio_vad_t vad;
+    bool trim;
+    bool header_sent;
+    bool source_done;
+    bool failed;
+
+    int16_t* read_buf;          // READ_FRAMES stereo frames from the decoder.
+    int16_t* resampled;         // Stereo output of the resampler.
+    size_t resampled_capacity;
+
+    int16_t* block;             // Mono VAD block being filled.
+    uint32_t block_frames;
+    uint32_t block_fill;
+
+    int16_t* preroll;           // PREROLL_BLOCKS blocks.
+    uint32_t preroll_len[PREROLL_BLOCKS];
+    uint32_t preroll_head;
+    uint32_t preroll_count;
+
+    int16_t* pending;           // Mono audio kept for the upload, waiting to fill a FLAC frame.
+    uint32_t pending_frames;
+    uint32_t pending_capacity;
+
+    uint8_t* out;               // The piece handed out by stt_upload_audio_next().
+
+    stt_upload_audio_stats_t stats;
+};
+
+static void* alloc_buffer(size_t bytes) {
+    void* p = heap_caps_malloc(bytes, MALLOC_CAP_SPIRAM);
+    if (!p) p = heap_caps_malloc(bytes, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    return p;
+}
+
+// --- Trimming ---
+
+static void keep(stt_upload_audio_t* audio, const int16_t* pcm, uint32_t frames) {
+    memcpy(audio->pending + audio->pending_frames, pcm, frames * sizeof(int16_t));
+    audio->pending_frames += frames;
+    audio->stats.upload_frames += frames;
+}
+
+// Runs one mono block through the VAD into the upload (or the pre-roll), as the recorder does.
+static void take_block(stt_upload_audio_t* audio, const int16_t* pcm, uint32_t frames) {
+    const audio_vad_action_t action = audio->trim ? audio_vad_process(&audio->vad, pcm, frames, 1, VAD_UNITY_GAIN_Q16)
+                                                  : AUDIO_VAD_WRITE;
+    if (action == AUDIO_VAD_DEFER) {
+        if (audio->preroll_count == PREROLL_BLOCKS) {
+            audio->preroll_head = (audio->preroll_head + 1) % PREROLL_BLOCKS;
+            audio->preroll_count--;
+        }
+        const uint32_t slot = (audio->preroll_head + audio->preroll_count) % PREROLL_BLOCKS;
+        memcpy(audio->preroll + slot * audio->block_frames, pcm, frames * sizeof(int16_t));
+        audio->preroll_len[slot] = frames;
+        audio->preroll_count++;
+        return;
+    }
+    for (; action == AUDIO_VAD_FLUSH_AND_WRITE && audio->preroll_count > 0; audio->preroll_count--) {
+        keep(audio, audio->preroll + audio->preroll_head * audio->block_frames, audio->preroll_len[audio->preroll_head]);
+        audio->preroll_head = (audio->preroll_head + 1) % PREROLL_BLOCKS;
+    }
+    keep(audio, pcm, frames);
+}
+
+// Mixes stereo frames down to mono and cuts them into VAD blocks.
+static void feed(stt_upload_audio_t* audio, const int16_t* stereo, size_t frames) {
+    for (size_t i = 0; i < frames; i++) {
+        audio->block[audio->block_fill++] = (int16_t)(((int32_t)stereo[2 * i] + stereo[2 * i + 1]) >> 1);
+        if (audio->block_fill == audio->block_frames) {
+            take_block(audio, audio->block, audio->block_frames);
+            audio->block_fill = 0;
+        }
+    }
+}
+
+// Sends a file in which the VAD found no speech from the start, untrimmed:
+// the detector may just not suit it, and the API says when nothing was said.
+static bool restart_untrimmed(stt_upload_audio_t* audio) {
+    ESP_LOGI(TAG, "No speech detected; uploading the file untrimmed.");
+    if (!audio_decoder_seek(&audio->decoder, 0)) return false;
+    if (audio->resample) audio_resampler_reset(&audio->resampler);
+    audio->trim = false;
+    audio->block_fill = 0;
+    audio->preroll_count = 0;
+    audio->pending_frames = 0;
+    audio->stats.source_frames = 0;
+    audio->stats.upload_frames = 0;
+    return true;
+}
+
+// --- Source ---
+
+// Reads the next frames of the file into the upload. At the end of the file,
+// drains the resampler and the last partial block and sets `source_done`.
+static void read_source(stt_upload_audio_t* audio) {
+    const size_t frames = audio_decoder_read(&audio->decoder, audio->read_buf, READ_FRAMES);
+    audio->stats.source_frames += frames;
+
+    if (audio->resample) {
+        size_t used = 0;
+        while (used < frames) {
+            size_t consumed = 0;
+            const size_t produced = audio_resampler_process(&audio->resampler, audio->read_buf + used * 2, frames - used,
+                                                            audio->resampled, audio->resampled_capacity, &consumed);
+            feed(audio, audio->resampled, produced);
+            used += consumed;
+            if (consumed == 0 && produced == 0) break;
+        }
+    } else {
+        feed(audio, audio->read_buf, frames);
+    }
+    if (frames == READ_FRAMES) return;
+
+    if (audio->decoder.error) {
+        ESP_LOGE(TAG, "Read error after %lu frames.", audio->stats.source_frames);
+        audio->failed = true;
+        audio->source_done = true;
+        return;
+    }
+    if (audio->resample) {
+        const size_t tail = audio_resampler_flush(&audio->resampler, audio->resampled, audio->resampled_capacity);
+        feed(audio, audio->resampled, tail);
+    }
+    if (audio->block_fill > 0) {
+        take_block(audio, audio->block, audio->block_fill);
+        audio->block_fill = 0;
+    }
+    if (audio->trim && !audio->vad.heard_speech) {
+        if (!restart_untrimmed(audio)) {
+            audio->failed = true;
+            audio->source_done = true;
+        }
+        return;
+    }
+    audio->source_done = true;
+}
+
+// --- Public API ---
+
+stt_upload_audio_t* stt_upload_audio_open(const char* path) {
+    auto* audio = (stt_upload_audio_t*)heap_caps_calloc(1, sizeof(stt_upload_audio_t), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    if (!audio) return NULL;
+
+    audio->fp = fopen(path, "rb");
+    if (!audio->fp) {
+        ESP_LOGE(TAG, "Failed to open %s", path);
+        stt_upload_audio_close(audio);
+        return NULL;
+    }
+    fseek(audio->fp, 0, SEEK_END);
+    audio->stats.source_bytes = (uint32_t)ftell(audio->fp);
+    fseek(audio->fp, 0, SEEK_SET);
+
+    if (!audio_decoder_open(&audio->decoder, audio->fp)) {
+        ESP_LOGE(TAG, "Unsupported audio file: %s", path);
+        stt_upload_audio_close(audio);
+        return NULL;
+    }
+    // Lossless FLAC of the decoded audio is larger than IMA-ADPCM or QOA (4 and
+    // 3.2 bits a sample) and than 8-bit PCM.
+    if (audio->decoder.wav.audio_format != WAV_FORMAT_PCM || audio->decoder.wav.bits_per_sample < 16) {
+        ESP_LOGI(TAG, "%s is already compact (%s); not converting it.", path, audio->decoder.ops->name);
+        stt_upload_audio_close(audio);
+        return NULL;
+    }
+    const uint32_t source_rate = audio->decoder.sample_rate;
+    const uint32_t rate = (source_rate > STT_UPLOAD_SAMPLE_RATE) ? STT_UPLOAD_SAMPLE_RATE : source_rate;
+    audio->stats.source_rate = source_rate;
+    audio->stats.source_channels = audio->decoder.num_channels;
+    audio->stats.upload_rate = rate;
+
+    audio->resample = rate != source_rate;
+    if (audio->resample && !audio_resampler_configure(&audio->resampler, source_rate, rate)) {
+        stt_upload_audio_close(audio);
+        return NULL;
+    }
+    audio->resampled_capacity = audio->resample ? audio_resampler_max_output(&audio->resampler, READ_FRAMES) : 0;
+
+    audio->trim = STT_UPLOAD_TRIM_SILENCE;
+    audio_vad_init(&audio->vad, rate, audio->trim);
+    audio->block_frames = rate * VAD_BLOCK_MS / 1000;
+
+    if (!audio_flac_encoder_init(&audio->encoder, rate, 1, STT_UPLOAD_FLAC_BLOCK_FRAMES)) {
+        ESP_LOGE(TAG, "Failed to set up the FLAC encoder.");
+        stt_upload_audio_close(audio);
+        return NULL;
+    }
+
+    // Frames are read while less than a FLAC frame is pending. One read adds at
+    // most its own frames (twice that at the end, with the resampler's tail),
+    // a block begun before it and the pre-roll.
+    const size_t read_max = audio->resample ? audio->resampled_capacity : READ_FRAMES;
+    audio->pending_capacity = STT_UPLOAD_FLAC_BLOCK_FRAMES + 2 * read_max + (PREROLL_BLOCKS + 1) * audio->block_frames;
+    audio->read_buf = (int16_t*)alloc_buffer(READ_FRAMES * 2 * sizeof(int16_t));
+    audio->resampled = audio->resample ? (int16_t*)alloc_buffer(audio->resampled_capacity * 2 * sizeof(int16_t)) : NULL;
+    audio->block = (int16_t*)alloc_buffer(audio->block_frames * sizeof(int16_t));
+    audio->preroll = (int16_t*)alloc_buffer(PREROLL_BLOCKS * audio->block_frames * sizeof(int16_t));
+    audio->pending = (int16_t*)alloc_buffer(audio->pending_capacity * sizeof(int16_t));
+    audio->out = (uint8_t*)alloc_buffer(audio_flac_max_frame_bytes(&audio->encoder, STT_UPLOAD_FLAC_BLOCK_FRAMES));
+    if (!audio->read_buf || (audio->resample && !audio->resampled) || !audio->block || !audio->preroll ||
+        !audio->pending || !audio->out) {
+        ESP_LOGE(TAG, "Failed to allocate the upload buffers.");
+        stt_upload_audio_close(audio);
+        return NULL;
+    }
+    return audio;
+}
+
+size_t stt_upload_audio_next(stt_upload_audio_t* audio, const uint8_t** data) {
+    if (!audio || !data) return 0;
+    const int64_t start_us = esp_timer_get_time();
+    size_t len = 0;
+
+    if (!audio->header_sent) {
+        len = audio_flac_stream_header(&audio->encoder, audio->out);
+        audio->header_sent = true;
+    } else {
+        while (audio->pending_frames < STT_UPLOAD_FLAC_BLOCK_FRAMES && !audio->source_done) read_source(audio);
+        if (audio->pending_frames > 0 && !audio->failed) {
+            const uint32_t frames = (audio->pending_frames < STT_UPLOAD_FLAC_BLOCK_FRAMES) ? audio->pending_frames
+                                                                                          : STT_UPLOAD_FLAC_BLOCK_FRAMES;
+            len = audio_flac_encode_frame(&audio->encoder, audio->pending, frames, audio->out);
+            audio->pending_frames -= frames;
+            memmove(audio->pending, audio->pending + frames, audio->pending_frames * sizeof(int16_t));
+        }
+    }
+
+    audio->stats.upload_bytes += len;
+    audio->stats.process_us += (uint32_t)(esp_timer_get_time() - start_us);
+    *data = audio->out;
+    return len;
+}
+
+bool stt_upload_audio_failed(const stt_upload_audio_t* audio) {
+    return !audio || audio->failed;
+}
+
+void stt_upload_audio_get_stats(const stt_upload_audio_t* audio, stt_upload_audio_stats_t* stats) {
+    if (audio && stats) *stats = audio->stats;
+}
+
+void stt_upload_audio_close(stt_upload_audio_t* audio) {
+    if (!audio) return;
+    audio_decoder_close(&audio->decoder);
+    if (audio->fp) fclose(audio->fp);
+    audio_resampler_deinit(&audio->resampler);
+    audio_flac_encoder_deinit(&audio->encoder);
+    if (audio->read_buf) heap_caps_free(audio->read_buf);
+    if (audio->resampled) heap_caps_free(audio->resampled);
+    if (audio->block) heap_caps_free(audio->block);
+    if (audio->preroll) heap_caps_free(audio->preroll);
+    if (audio->pending) heap_caps_free(audio->pending);
+    if (audio->out) heap_caps_free(audio->out);
+    heap_caps_free(audio);
+}
@@ -0,0 +1,76 @@
+/**
+ * @file stt_upload_audio.h
+ * @brief Shrinks a recording on its way to the speech-to-text API.
+ *
+ * The file is read from the card one block at a time and handed out as a FLAC
+ * stream, ready to be written into the request body as it is produced; nothing
+ * is copied whole into RAM. On the way it is:
+ * - decoded (PCM WAV of 16 bits or more; compressed and 8-bit files are
+ *   smaller as they are than as lossless FLAC, and are not converted),
+ * - resampled down to STT_UPLOAD_SAMPLE_RATE if the file is at a higher rate,
+ * - mixed down to mono,
+ * - with STT_UPLOAD_TRIM_SILENCE, stripped of leading and trailing silence and
+ *   long pauses by the recorder's VAD (audio_vad.h). A file in which no speech
+ *   is found is sent untrimmed rather than empty,
+ * - FLAC-encoded (audio_flac.h), which is lossless, so the transcript does
+ *   not suffer.
+ *
+ * Journals and voice notes are already 16 kHz mono and trimmed as they are
+ * recorded, so for them it is mostly the FLAC coding that counts: around 60%
+ * of the bytes of the WAV.
+ */
+#ifndef STT_UPLOAD_AUDIO_H
+#define STT_UPLOAD_AUDIO_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct stt_upload_audio_s stt_upload_audio_t;
+
+/**
+ * @brief What the preparation did, for the logs.
+ */
+typedef struct {
+    uint32_t source_bytes;      //!< Size of the file.
+    uint32_t source_rate;       //!< Sample rate of the file.
+    uint16_t source_channels;
+    uint32_t source_frames;     //!< Frames read from the file.
+    uint32_t upload_rate;       //!< Sample rate of the upload.
+    uint32_t upload_frames;     //!< Frames left after trimming.
+    uint32_t upload_bytes;      //!< FLAC bytes handed out so far.
+    uint32_t process_us;        //!< Time spent reading, converting and encoding.
+} stt_upload_audio_stats_t;
+
+/**
+ * @brief Opens a recording for upload.
+ * @param path Full path of the audio file.
+ * @return The open stream, or NULL if the file cannot be read, is not 16-bit
+ *         (or wider) PCM, or memory is short. The file is then best sent as it is.
+ */
+stt_upload_audio_t* stt_upload_audio_open(const char* path);
+
+/**
+ * @brief Produces the next piece of the FLAC stream (the stream header first, then one frame per call).
+ *
+ * @param audio An open stream.
+ * @param data Set to the bytes, valid until the next call.
+ * @return Number of bytes, 0 at the end of the stream or on a read error (see stt_upload_audio_failed()).
+ */
+size_t stt_upload_audio_next(stt_upload_audio_t* audio, const uint8_t** data);
+
+/**
+ * @brief Whether the stream ended early because the file could not be read.
+ */
+bool stt_upload_audio_failed(const stt_upload_audio_t* audio);
+
+/**
+ * @brief Gets the statistics of the stream so far.
+ */
+void stt_upload_audio_get_stats(const stt_upload_audio_t* audio, stt_upload_audio_stats_t* stats);
+
+/**
+ * @brief Closes the file and frees the stream.
+ */
+void stt_upload_audio_close(stt_upload_audio_t* audio);
+
+#endif // STT_UPLOAD_AUDIO_H
@@ -0,0 +1,308 @@
+#include "stt_queue.h"
+#include "config/app_config.h"
+#include "models/asset_config.h"
+#include "controllers/littlefs_manager/littlefs_manager.h"
+#include "controllers/sd_card_manager/sd_card_manager.h"
+#include "controllers/wifi_manager/wifi_manager.h"
+#include "controllers/daily_summary_manager/daily_summary_manager.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "cJSON.h"
+#include "lvgl.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "freertos/event_groups.h"
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+static const char* TAG = "STT_QUEUE";
+#define QUEUE_TASK_PRIORITY 3       // Below the STT tasks it starts.
+#define OFFLINE_POLL_MS 10000       // Max wait for the network before re-checking.
+
+// --- File paths derived from the central asset_config.h ---
+static const std::string s_queue_filepath = std::string(USER_DATA_BASE_PATH) + STT_QUEUE_FILENAME;
+static const std::string s_queue_temp_filepath = std::string(USER_DATA_BASE_PATH) + STT_QUEUE_TEMP_FILENAME;
+
+struct SttJob {
+    std::string audio_path;
+    time_t date;                // Day whose summary gets the transcript (0: none).
+    uint32_t attempts;          // Failed uploads so far (saved).
+    int64_t next_try_us;        // Not uploaded again before this esp_timer time (not saved).
+    bool running;
+};
+
+// Guarded by s_mutex; callbacks of the STT tasks update it.
+static std::vector<SttJob> s_jobs;
+static int s_running = 0;
+static SemaphoreHandle_t s_mutex = nullptr;
+static TaskHandle_t s_task = nullptr;
+
+// --- Persistence ---
+
+// Called with s_mutex held.
+static void save_jobs() {
+    cJSON *root = cJSON_CreateArray();
+    if (!root) {
+        ESP_LOGE(TAG, "Failed to create cJSON array.");
+        return;
+    }
+    for (const auto& job : s_jobs) {
+        cJSON *job_json = cJSON_CreateObject();
+        cJSON_AddStringToObject(job_json, "path", job.audio_path.c_str());
+        cJSON_AddNumberToObject(job_json, "date", (double)job.date);
+        cJSON_AddNumberToObject(job_json, "attempts", job.attempts);
+        cJSON_AddItemToArray(root, job_json);
+    }
+    char *json_string = cJSON_PrintUnformatted(root);
+    cJSON_Delete(root);
+    if (!json_string) {
+        ESP_LOGE(TAG, "Failed to print cJSON to string.");
+        return;
+    }
+
+    // Written to a temporary file first, so that a reset never leaves half a queue.
+    if (!littlefs_manager_write_file(s_queue_temp_filepath.c_str(), json_string)) {
+        ESP_LOGE(TAG, "Failed to write the temporary queue file.");
+    } else if (littlefs_manager_file_exists(s_queue_filepath.c_str()) &&
+               !littlefs_manager_delete_file(s_queue_filepath.c_str())) {
+        ESP_LOGE(TAG, "Failed to delete the old queue file.");
+        littlefs_manager_delete_file(s_queue_temp_filepath.c_str());
+    } else if (!littlefs_manager_rename_file(s_queue_temp_filepath.c_str(), s_queue_filepath.c_str())) {
+        ESP_LOGE(TAG, "Failed to rename the temporary queue file.");
+    }
+    free(json_string);
+}
+
+static void load_jobs() {
+    if (littlefs_manager_file_exists(s_queue_temp_filepath.c_str())) {
+        ESP_LOGW(TAG, "Found a temporary queue file from an incomplete write; restoring it.");
+        littlefs_manager_delete_file(s_queue_filepath.c_str());
+        if (!littlefs_manager_rename_file(s_queue_temp_filepath.c_str(), s_queue_filepath.c_str())) {
+            littlefs_manager_delete_file(s_queue_temp_filepath.c_str());
+        }
+    }
+
+    char* buffer = nullptr;
+    size_t size = 0;
+    if (!littlefs_manager_read_file(s_queue_filepath.c_str(), &buffer, &size) || !buffer) {
+        return; // Nothing queued.
+    }
+    cJSON *root = cJSON_ParseWithLength(buffer, size);
+    free(buffer);
+    if (!cJSON_IsArray(root)) {
+        ESP_LOGE(TAG, "Failed to parse %s; starting with an empty queue.", s_queue_filepath.c_str());
+        cJSON_Delete(root);
+        return;
+    }
+
+    cJSON* job_json;
+    cJSON_ArrayForEach(job_json, root) {
+        cJSON* path = cJSON_GetObjectItem(job_json, "path");
+        cJSON* date = cJSON_GetObjectItem(job_json, "date");
+        cJSON* attempts = cJSON_GetObjectItem(job_json, "attempts");
+        if (!cJSON_IsString(path)) continue;
+        s_jobs.push_back({path->valuestring,
+                          cJSON_IsNumber(date) ? (time_t)date->valuedouble : 0,
+                          cJSON_IsNumber(attempts) ? (uint32_t)attempts->valueint : 0,
+                          0, false});
+    }
+    cJSON_Delete(root);
+}
+
+// --- Results ---
+
+struct SummaryTranscript {
+    time_t date;
+    std::string audio_path;
+    std::string text;
+};
+
+// DailySummaryManager and the views it notifies belong to the UI task.
+static void write_summary_on_ui_thread(void* user_data) {
+    std::unique_ptr<SummaryTranscript> transcript(static_cast<SummaryTranscript*>(user_data));
+    DailySummaryManager::set_voice_note_transcript(transcript->date, transcript->audio_path, transcript->text);
+}
+
+static void add_to_summary(time_t date, const std::string& audio_path, const std::string& text) {
+    if (date == 0) return;
+    auto* transcript = new(std::nothrow) SummaryTranscript{date, audio_path, text};
+    if (transcript && lv_async_call(write_summary_on_ui_thread, transcript) != LV_RESULT_OK) {
+        ESP_LOGE(TAG, "Could not add the transcript of %s to the summary.", audio_path.c_str());
+        delete transcript;
+    }
+}
+
+static int64_t retry_delay_us(uint32_t attempts) {
+    int64_t delay_ms = (int64_t)STT_QUEUE_RETRY_BASE_MS << std::min<uint32_t>(attempts - 1, 16);
+    return std::min<int64_t>(delay_ms, STT_QUEUE_RETRY_MAX_MS) * 1000;
+}
+
+// Result of a queued upload, on the STT task that made it.
+static void on_job_done(const std::string& audio_path, bool success, const std::string& result) {
+    const bool online = wifi_manager_is_connected();
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    auto it = std::find_if(s_jobs.begin(), s_jobs.end(), [&](const SttJob& job) { return job.audio_path == audio_path; });
+    if (it != s_jobs.end()) {
+        SttJob& job = *it;
+        job.running = false;
+        s_running--;
+        bool drop = true;
+        if (success) {
+            ESP_LOGI(TAG, "Transcribed %s.", audio_path.c_str());
+            add_to_summary(job.date, audio_path, result);
+        } else if (!sd_manager_file_exists(audio_path.c_str())) {
+            ESP_LOGW(TAG, "%s no longer exists; dropped from the queue.", audio_path.c_str());
+        } else if (!online) {
+            ESP_LOGI(TAG, "%s not transcribed while offline (%s); waiting for the connection.", audio_path.c_str(), result.c_str());
+            drop = false;
+        } else if (++job.attempts >= STT_QUEUE_MAX_ATTEMPTS) {
+            ESP_LOGE(TAG, "%s failed %lu times (%s); dropped from the queue.", audio_path.c_str(), (unsigned long)job.attempts, result.c_str());
+        } else {
+            job.next_try_us = esp_timer_get_time() + retry_delay_us(job.attempts);
+            ESP_LOGW(TAG, "%s failed (%s); attempt %lu, retrying in %lld ms.", audio_path.c_str(), result.c_str(),
+                     (unsigned long)job.attempts, retry_delay_us(job.attempts) / 1000);
+            drop = false;
+        }
+        if (drop) s_jobs.erase(it);
+        save_jobs();
+    }
+    xSemaphoreGive(s_mutex);
+    xTaskNotifyGive(s_task);
+}
+
+// --- Worker ---
+
+// Starts the jobs that are due, up to STT_QUEUE_MAX_CONCURRENT at once, and
+// returns how long to wait for the next one. Called with s_mutex held.
+static TickType_t dispatch_due_jobs() {
+    const int64_t now_us = esp_timer_get_time();
+    bool changed = false;
+
+    auto gone = [&](const SttJob& job) {
+        if (job.running || sd_manager_file_exists(job.audio_path.c_str())) return false;
+        ESP_LOGW(TAG, "%s no longer exists; dropped from the queue.", job.audio_path.c_str());
+        return true;
+    };
+    auto first_gone = std::remove_if(s_jobs.begin(), s_jobs.end(), gone);
+    if (first_gone != s_jobs.end()) {
+        s_jobs.erase(first_gone, s_jobs.end());
+        changed = true;
+    }
+
+    int64_t next_due_us = INT64_MAX;
+    for (auto& job : s_jobs) {
+        if (job.running) continue;
+        if (job.next_try_us > now_us || s_running >= STT_QUEUE_MAX_CONCURRENT) {
+            next_due_us = std::min(next_due_us, std::max(job.next_try_us, now_us));
+            continue;
+        }
+        const std::string audio_path = job.audio_path;
+        if (!stt_manager_transcribe(audio_path, [audio_path](bool success, const std::string& result) {
+                on_job_done(audio_path, success, result);
+            })) {
+            // Out of memory for the task: not the note's fault, so not an attempt.
+            job.next_try_us = now_us + (int64_t)STT_QUEUE_RETRY_BASE_MS * 1000;
+            next_due_us = std::min(next_due_us, job.next_try_us);
+            continue;
+        }
+        ESP_LOGI(TAG, "Uploading %s (%lu earlier attempts).", audio_path.c_str(), (unsigned long)job.attempts);
+        job.running = true;
+        s_running++;
+    }
+
+    if (changed) save_jobs();
+    // A job that waits for a free slot is started when a running one ends.
+    if (next_due_us == INT64_MAX || s_running >= STT_QUEUE_MAX_CONCURRENT) return portMAX_DELAY;
+    return pdMS_TO_TICKS((next_due_us - now_us) / 1000) + 1;
+}
+
+static void stt_queue_task(void *pvParameters) {
+    bool was_online = false;
+    for (;;) {
+        const bool online = wifi_manager_is_connected();
+        TickType_t wait = portMAX_DELAY;
+
+        xSemaphoreTake(s_mutex, portMAX_DELAY);
+        if (online && !was_online) {
+            // A new connection: every waiting note goes now, backoff or not.
+            for (auto& job : s_jobs) job.next_try_us = 0;
+            if (!s_jobs.empty()) ESP_LOGI(TAG, "Online with %d notes to transcribe.", (int)s_jobs.size());
+        }
+        if (online) wait = dispatch_due_jobs();
+        const bool waiting_for_network = !online && !s_jobs.empty();
+        xSemaphoreGive(s_mutex);
+        was_online = online;
+
+        if (waiting_for_network) {
+            EventGroupHandle_t wifi_event_group = wifi_manager_get_event_group();
+            if (wifi_event_group) {
+                xEventGroupWaitBits(wifi_event_group, WIFI_CONNECTED_BIT | TIME_SYNC_BIT, pdFALSE, pdTRUE, pdMS_TO_TICKS(OFFLINE_POLL_MS));
+            } else {
+                vTaskDelay(pdMS_TO_TICKS(OFFLINE_POLL_MS));
+            }
+        } else {
+            // Woken early by new notes and finished uploads.
+            ulTaskNotifyTake(pdTRUE, wait);
+        }
+    }
+}
+
+// --- Public API ---
+
+void stt_queue_init(void) {
+    s_mutex = xSemaphoreCreateMutex();
+    if (!s_mutex) {
+        ESP_LOGE(TAG, "Failed to create the queue mutex.");
+        return;
+    }
+    load_jobs();
+    if (xTaskCreate(stt_queue_task, "stt_queue", 4096, NULL, QUEUE_TASK_PRIORITY, &s_task) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create the STT queue task.");
+        vSemaphoreDelete(s_mutex);
+        s_mutex = nullptr;
+        return;
+    }
+    ESP_LOGI(TAG, "STT queue initialized with %d pending notes.", (int)s_jobs.size());
+}
+
+bool stt_queue_add(const std::string& audio_path, time_t date) {
+    if (!s_mutex || audio_path.empty()) return false;
+    if (!sd_manager_file_exists(audio_path.c_str())) {
+        ESP_LOGD(TAG, "Not queueing %s: the file does not exist.", audio_path.c_str());
+        return false;
+    }
+
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    bool queued = true;
+    auto it = std::find_if(s_jobs.begin(), s_jobs.end(), [&](const SttJob& job) { return job.audio_path == audio_path; });
+    if (it != s_jobs.end()) {
+        if (it->date == 0 && date != 0) {
+            it->date = date;
+            save_jobs();
+        }
+    } else if (s_jobs.size() >= STT_QUEUE_MAX_JOBS) {
+        ESP_LOGE(TAG, "Queue full (%d notes); %s not queued.", STT_QUEUE_MAX_JOBS, audio_path.c_str());
+        queued = false;
+    } else {
+        s_jobs.push_back({audio_path, date, 0, 0, false});
+        save_jobs();
+        ESP_LOGI(TAG, "Queued %s (%d pending).", audio_path.c_str(), (int)s_jobs.size());
+    }
+    xSemaphoreGive(s_mutex);
+
+    if (queued) xTaskNotifyGive(s_task);
+    return queued;
+}
+
+stt_stream_t stt_queue_stream_begin(const std::string& audio_path, time_t date, audio_recorder_tap_t* tap) {
+    return stt_manager_stream_begin(audio_path, tap, [audio_path, date](bool success, const std::string& result) {
+        if (success) {
+            ESP_LOGI(TAG, "Voice note transcribed as it was recorded (%u characters).", (unsigned)result.length());
+            add_to_summary(date, audio_path, result);
+        } else if (stt_queue_add(audio_path, date)) {
+            ESP_LOGW(TAG, "Voice note not transcribed (%s); queued.", result.c_str());
+        }
+    });
+}
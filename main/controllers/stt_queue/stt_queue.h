@@ -0,0 +1,55 @@
+/**
+ * @file stt_queue.h
+ * @brief Durable queue of voice notes waiting to be transcribed.
+ *
+ * A note that cannot be transcribed when it is recorded (no WiFi or time sync,
+ * a failed upload) is kept in a queue saved in LittleFS, so it survives a
+ * restart, and is uploaded once the device is online:
+ * - Nothing is tried while offline. When the connection comes up, every
+ *   waiting note is uploaded in that window, STT_QUEUE_MAX_CONCURRENT at once.
+ * - A failed upload (while online) is retried after STT_QUEUE_RETRY_BASE_MS,
+ *   doubled on every failure up to STT_QUEUE_RETRY_MAX_MS; after
+ *   STT_QUEUE_MAX_ATTEMPTS failures the note is dropped from the queue.
+ * - A note whose file is gone is dropped.
+ *
+ * The transcripts are saved like any other (see stt_manager.h) and written
+ * into the daily summary of the day the note was recorded.
+ */
+#ifndef STT_QUEUE_H
+#define STT_QUEUE_H
+
+#include <stdbool.h>
+#include <string>
+#include <time.h>
+#include "controllers/stt_manager/stt_manager.h"
+
+/**
+ * @brief Loads the saved queue and starts the task that uploads it.
+ * Requires LittleFS and the WiFi manager to be initialized first.
+ */
+void stt_queue_init(void);
+
+/**
+ * @brief Queues a recording for transcription. Safe to call from any task.
+ *
+ * A note that is already queued keeps its place (and gets `date` if it had none).
+ *
+ * @param audio_path Full path of the .wav file.
+ * @param date The day whose summary gets the transcript, or 0 for none.
+ * @return true if the note is queued, false if its file does not exist or the queue is full.
+ */
+bool stt_queue_add(const std::string& audio_path, time_t date);
+
+/**
+ * @brief Transcribes a recording as it is made (see stt_manager_stream_begin()),
+ * writing the transcript into the daily summary, and queues the note if the
+ * stream and its file fallback both fail.
+ *
+ * @param audio_path The file being recorded.
+ * @param date The day whose summary gets the transcript.
+ * @param tap Filled with the stream's callbacks, for audio_recorder_start_with_options().
+ * @return The stream, or NULL if it could not be started.
+ */
+stt_stream_t stt_queue_stream_begin(const std::string& audio_path, time_t date, audio_recorder_tap_t* tap);
+
+#endif // STT_QUEUE_H
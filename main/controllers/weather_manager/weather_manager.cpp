@@ -1,7 +1,7 @@
 #include "weather_manager.h"
 #include "config/app_config.h" // Include application configuration
 #include "controllers/wifi_manager/wifi_manager.h"
-#include "esp_http_client.h"
+#include "controllers/https_client/https_client.h"
 #include "esp_log.h"
 #include "cJSON.h"
 #include "freertos/FreeRTOS.h"
@@ -9,6 +9,7 @@
 #include "freertos/semphr.h"
 #include "lvgl.h" // For LV_SYMBOL_* defines
 #include <string>
+#include <string.h>
 
 static const char* TAG = "WEATHER_MGR";
 
@@ -17,69 +18,23 @@ static std::vector<ForecastData> s_cached_forecast;
 static SemaphoreHandle_t s_data_mutex = NULL;
 extern const char open_meteo_ca_pem_start[] asm("_binary_open_meteo_ca_pem_start");
 
-/**
- * @brief A context struct to hold state for a single HTTP request,
- *        used by the event handler.
- */
-struct WeatherRequestContext {
-    std::string response_buffer;
-};
-
-esp_err_t _http_event_handler(esp_http_client_event_t *evt) {
-    auto* context = static_cast<WeatherRequestContext*>(evt->user_data);
-    if (!context) {
-        return ESP_FAIL;
-    }
-    
-    switch (evt->event_id) {
-        case HTTP_EVENT_ON_DATA:
-            context->response_buffer.append(static_cast<const char*>(evt->data), evt->data_len);
-            break;
-        case HTTP_EVENT_ON_FINISH:
-            ESP_LOGD(TAG, "HTTP_EVENT_ON_FINISH");
-            break;
-        case HTTP_EVENT_DISCONNECTED:
-            ESP_LOGD(TAG, "HTTP_EVENT_DISCONNECTED");
-            break;
-        default:
-            break;
-    }
-    return ESP_OK;
-}
-
 void WeatherManager::weather_fetch_task(void* pvParameters) {
     for (;;) {
         ESP_LOGI(TAG, "Waiting for WiFi and Time Sync...");
         xEventGroupWaitBits(wifi_manager_get_event_group(), WIFI_CONNECTED_BIT | TIME_SYNC_BIT, pdFALSE, pdTRUE, portMAX_DELAY);
         ESP_LOGI(TAG, "Network ready. Fetching weather data.");
 
-        WeatherRequestContext context;
-        esp_http_client_handle_t client = nullptr;
-
-        esp_http_client_config_t config = {};
-        config.url = WEATHER_API_URL; // Use the constant from app_config.h
-        config.event_handler = _http_event_handler;
-        config.user_data = &context;
-        config.timeout_ms = 15000;
-        config.cert_pem = open_meteo_ca_pem_start;
-        config.method = HTTP_METHOD_GET;
-
-        client = esp_http_client_init(&config);
-        if (!client) {
-            ESP_LOGE(TAG, "Failed to initialize HTTP client. Retrying in %d minutes.", WEATHER_FETCH_INTERVAL_MS / 60000);
-            vTaskDelay(pdMS_TO_TICKS(WEATHER_FETCH_INTERVAL_MS));
-            continue;
-        }
-
-        esp_err_t err = esp_http_client_perform(client);
+        // Use the constant from app_config.h. The TLS session of the last fetch is
+        // offered again, which spares the full handshake if the server still has it.
+        std::string response_buffer;
+        int status_code = https_client_get(WEATHER_API_URL, open_meteo_ca_pem_start, 15000, response_buffer);
 
-        if (err == ESP_OK) {
-            int status_code = esp_http_client_get_status_code(client);
-            ESP_LOGI(TAG, "HTTP GET request successful. Status = %d, content_length = %lld",
-                     status_code, esp_http_client_get_content_length(client));
+        if (status_code >= 0) {
+            ESP_LOGI(TAG, "HTTP GET request successful. Status = %d, content_length = %u",
+                     status_code, (unsigned)response_buffer.length());
 
             if (status_code == 200) {
-                cJSON *root = cJSON_Parse(context.response_buffer.c_str());
+                cJSON *root = cJSON_Parse(response_buffer.c_str());
                 if (root) {
                     cJSON *hourly = cJSON_GetObjectItem(root, "hourly");
                     if (hourly) {
@@ -146,17 +101,15 @@ void WeatherManager::weather_fetch_task(void* pvParameters) {
                     }
                     cJSON_Delete(root);
                 } else {
-                     ESP_LOGE(TAG, "Failed to parse JSON response. Response was: %s", context.response_buffer.c_str());
+                     ESP_LOGE(TAG, "Failed to parse JSON response. Response was: %s", response_buffer.c_str());
                 }
             } else {
-                 ESP_LOGE(TAG, "HTTP request failed with status code: %d. Body: %s", status_code, context.response_buffer.c_str());
+                 ESP_LOGE(TAG, "HTTP request failed with status code: %d. Body: %s", status_code, response_buffer.c_str());
             }
         } else {
-            ESP_LOGE(TAG, "HTTP GET request failed: %s", esp_err_to_name(err));
+            ESP_LOGE(TAG, "HTTP GET request failed.");
         }
 
-        esp_http_client_cleanup(client);
-        
         ESP_LOGI(TAG, "Weather task sleeping for %d minutes.", WEATHER_FETCH_INTERVAL_MS / 60000);
         vTaskDelay(pdMS_TO_TICKS(WEATHER_FETCH_INTERVAL_MS));
     }
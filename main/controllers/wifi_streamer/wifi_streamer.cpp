@@ -3,23 +3,22 @@
 #include "config/app_config.h"
 #include "config/secrets.h"
 #include "controllers/wifi_manager/wifi_manager.h"
+#include "controllers/mic_capture/mic_capture.h"
 #include "esp_log.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
-#include "driver/i2s_std.h"
 #include "lwip/sockets.h"
 #include "lwip/netdb.h"
 #include <string.h>
+#include <stdarg.h>
 #include <fcntl.h> // For fcntl
 
 static const char *TAG = "WIFI_STREAMER";
 
-// --- I2S Configuration ---
-// NOTE: Must match REC_SAMPLE_RATE in config.h for consistency
-#define I2S_SAMPLE_RATE         (REC_SAMPLE_RATE) 
-#define I2S_BUFFER_SAMPLES_READ (1024)
-#define I2S_BUFFER_BYTES_READ   (I2S_BUFFER_SAMPLES_READ * sizeof(int32_t))
-#define I2S_BUFFER_BYTES_SEND   (I2S_BUFFER_SAMPLES_READ * sizeof(int16_t))
+// --- Microphone ---
+// Blocks come from the shared capture service, REC_SAMPLE_RATE 16-bit PCM after the AGC.
+#define MIC_QUEUE_BLOCKS 16     // ~0.5 s: rides out a slow send.
+#define MIC_WAIT_MS 10          // Max wait for a block before polling the server again.
 
 // --- Network and Protocol ---
 #define SERVER_CMD_BUFFER_SIZE 32
@@ -35,7 +34,6 @@ static char s_status_message[128] = "Idle";
 // --- Function Prototypes ---
 static void audio_stream_task(void *pvParameters);
 static void update_status_message(const char* format, ...);
-static esp_err_t setup_i2s_for_streaming(i2s_chan_handle_t *rx_handle);
 
 // --- Public API (Unchanged) ---
 void wifi_streamer_init(void) {
@@ -85,64 +83,10 @@ static void update_status_message(const char* format, ...) {
     ESP_LOGI(TAG, "Status: %s", s_status_message);
 }
 
-// --- FIX: Use the robust I2S configuration from audio_recorder.cpp ---
-static esp_err_t setup_i2s_for_streaming(i2s_chan_handle_t *rx_handle) {
-    // Using I2S_NUM_1 for the microphone to avoid conflict with speaker on I2S_NUM_0
-    i2s_chan_config_t chan_cfg = I2S_CHANNEL_DEFAULT_CONFIG(I2S_NUM_1, I2S_ROLE_MASTER);
-    esp_err_t ret = i2s_new_channel(&chan_cfg, NULL, rx_handle);
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "i2s_new_channel failed: %s", esp_err_to_name(ret));
-        return ret;
-    }
-
-    i2s_std_config_t std_cfg = {
-        .clk_cfg = {
-            .sample_rate_hz = I2S_SAMPLE_RATE,
-            .clk_src = I2S_CLK_SRC_DEFAULT,
-            .ext_clk_freq_hz = 0,
-            .mclk_multiple = I2S_MCLK_MULTIPLE_256,
-        },
-        // This is the crucial part for INMP441: 32-bit slot, MONO mode
-        .slot_cfg = I2S_STD_PHILIPS_SLOT_DEFAULT_CONFIG(I2S_DATA_BIT_WIDTH_32BIT, I2S_SLOT_MODE_MONO),
-        .gpio_cfg = {
-            .mclk = I2S_GPIO_UNUSED,
-            .bclk = I2S_MIC_BCLK_PIN,
-            .ws   = I2S_MIC_WS_PIN,
-            .dout = I2S_GPIO_UNUSED,
-            .din  = I2S_MIC_DIN_PIN,
-            .invert_flags = { .mclk_inv = false, .bclk_inv = false, .ws_inv = false },
-        },
-    };
-    // The INMP441 is a mono microphone that transmits data on the left channel of the I2S frame.
-    std_cfg.slot_cfg.slot_mask = I2S_STD_SLOT_LEFT;
-
-    ret = i2s_channel_init_std_mode(*rx_handle, &std_cfg);
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "i2s_channel_init_std_mode failed: %s", esp_err_to_name(ret));
-        i2s_del_channel(*rx_handle);
-        *rx_handle = NULL;
-        return ret;
-    }
-    
-    ret = i2s_channel_enable(*rx_handle);
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "i2s_channel_enable failed: %s", esp_err_to_name(ret));
-        i2s_del_channel(*rx_handle);
-        *rx_handle = NULL;
-        return ret;
-    }
-
-    ESP_LOGI(TAG, "I2S driver for streaming configured and enabled successfully.");
-    return ESP_OK;
-}
-
-
 // --- MAIN TASK (Unchanged from last version) ---
 static void audio_stream_task(void *pvParameters) {
     int sock = -1;
-    i2s_chan_handle_t rx_handle = NULL;
-    int32_t* i2s_raw_read_buffer = NULL;
-    int16_t* i2s_processed_send_buffer = NULL;
+    mic_capture_subscriber_t* mic = NULL; // Subscribed only while streaming.
     char server_cmd_buffer[SERVER_CMD_BUFFER_SIZE];
 
     update_status_message("Waiting for WiFi...");
@@ -150,20 +94,6 @@ static void audio_stream_task(void *pvParameters) {
         if (s_streamer_state == WIFI_STREAM_STATE_STOPPING) goto cleanup;
         vTaskDelay(pdMS_TO_TICKS(100));
     }
-    
-    i2s_raw_read_buffer = (int32_t*)malloc(I2S_BUFFER_BYTES_READ);
-    i2s_processed_send_buffer = (int16_t*)malloc(I2S_BUFFER_BYTES_SEND);
-    if (!i2s_raw_read_buffer || !i2s_processed_send_buffer) {
-        update_status_message("Error: Memory allocation failed");
-        s_streamer_state = WIFI_STREAM_STATE_ERROR;
-        goto cleanup;
-    }
-    
-    if (setup_i2s_for_streaming(&rx_handle) != ESP_OK) {
-        update_status_message("Error: I2S init failed");
-        s_streamer_state = WIFI_STREAM_STATE_ERROR;
-        goto cleanup;
-    }
 
     while (s_streamer_state != WIFI_STREAM_STATE_STOPPING) {
         update_status_message("Connecting to %s...", STREAMING_SERVER_IP);
@@ -210,26 +140,34 @@ static void audio_stream_task(void *pvParameters) {
             if (len > 0) {
                 server_cmd_buffer[len] = 0;
                 if (strstr(server_cmd_buffer, CMD_START_STREAM)) {
+                    if (!mic) mic = mic_capture_subscribe("streamer", MIC_QUEUE_BLOCKS);
+                    if (!mic) {
+                        update_status_message("Error: Microphone unavailable");
+                        s_streamer_state = WIFI_STREAM_STATE_ERROR;
+                        break;
+                    }
                     s_streamer_state = WIFI_STREAM_STATE_STREAMING;
                     update_status_message("Streaming audio...");
                 } else if (strstr(server_cmd_buffer, CMD_STOP_STREAM)) {
+                    mic_capture_unsubscribe(mic);
+                    mic = NULL;
                     s_streamer_state = WIFI_STREAM_STATE_CONNECTED_IDLE;
                     update_status_message("Connected. Waiting for server.");
                 }
             }
             
             if (s_streamer_state == WIFI_STREAM_STATE_STREAMING) {
-                size_t bytes_read_from_i2s = 0;
-                i2s_channel_read(rx_handle, (void*)i2s_raw_read_buffer,
-                                 I2S_BUFFER_BYTES_READ, &bytes_read_from_i2s, pdMS_TO_TICKS(10));
-                
-                if (bytes_read_from_i2s > 0) {
-                    int num_samples = bytes_read_from_i2s / sizeof(int32_t);
-                    for (int i = 0; i < num_samples; i++) {
-                        i2s_processed_send_buffer[i] = (int16_t)(i2s_raw_read_buffer[i] >> 16);
-                    }
-                    int bytes_to_send = num_samples * sizeof(int16_t);
-                    if (send(sock, i2s_processed_send_buffer, bytes_to_send, 0) < 0) {
+                const mic_capture_block_t* block = mic_capture_peek(mic, MIC_WAIT_MS);
+                if (!block && mic_capture_failed(mic)) {
+                    update_status_message("Error: Microphone stopped");
+                    s_streamer_state = WIFI_STREAM_STATE_ERROR;
+                    break;
+                }
+                if (block) {
+                    int bytes_to_send = block->frames * REC_NUM_CHANNELS * sizeof(int16_t);
+                    int sent = send(sock, block->samples, bytes_to_send, 0);
+                    mic_capture_release(mic);
+                    if (sent < 0) {
                          update_status_message("Error: Send failed");
                          s_streamer_state = WIFI_STREAM_STATE_ERROR;
                          break;
@@ -241,6 +179,8 @@ static void audio_stream_task(void *pvParameters) {
         } 
         
         if (sock >= 0) { close(sock); sock = -1; }
+        mic_capture_unsubscribe(mic);
+        mic = NULL;
         if (s_streamer_state == WIFI_STREAM_STATE_ERROR) {
             vTaskDelay(pdMS_TO_TICKS(2000));
         }
@@ -249,12 +189,7 @@ static void audio_stream_task(void *pvParameters) {
 cleanup:
     ESP_LOGI(TAG, "Cleaning up stream task...");
     if (sock >= 0) close(sock);
-    if (rx_handle) {
-        i2s_channel_disable(rx_handle);
-        i2s_del_channel(rx_handle);
-    }
-    if(i2s_raw_read_buffer) free(i2s_raw_read_buffer);
-    if(i2s_processed_send_buffer) free(i2s_processed_send_buffer);
+    mic_capture_unsubscribe(mic);
     
     update_status_message("Idle");
     s_streamer_state = WIFI_STREAM_STATE_IDLE;
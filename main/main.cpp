@@ -7,6 +7,7 @@
 #include "esp_netif.h"
 #include "lvgl.h"
 #include <cstring>
+#include <string>
 
 // Include all configuration headers
 #include "config/board_config.h"
@@ -21,10 +22,13 @@
 #include "controllers/littlefs_manager/littlefs_manager.h"
 #include "controllers/audio_manager/audio_manager.h"
 #include "controllers/audio_recorder/audio_recorder.h"
+#include "controllers/mic_capture/mic_capture.h"
 #include "controllers/wifi_manager/wifi_manager.h"
 #include "controllers/wifi_streamer/wifi_streamer.h"
+#include "controllers/https_client/https_client.h"
 #include "controllers/data_manager/data_manager.h"
 #include "controllers/stt_manager/stt_manager.h"
+#include "controllers/stt_queue/stt_queue.h"
 #include "controllers/power_manager/power_manager.h"
 #include "controllers/habit_data_manager/habit_data_manager.h"
 #include "controllers/notification_manager/notification_manager.h"
@@ -111,6 +115,14 @@ extern "C" void app_main(void) {
             ESP_LOGI(TAG, "SD Card mounted successfully during startup.");
             // Initialize managers that depend on the SD card
             FurnitureDataManager::get_instance().init();
+
+            // Recordings interrupted by a reset or power loss get their WAV headers fixed.
+            const char* recording_dirs[] = { RECORDINGS_SUBPATH, VOICE_NOTES_SUBPATH, JOURNAL_SUBPATH };
+            for (const char* subpath : recording_dirs) {
+                std::string dir = std::string(SD_CARD_ROOT_PATH) + "/" + USER_DATA_BASE_PATH + subpath;
+                dir.pop_back(); // Drop the trailing '/'.
+                audio_recorder_recover_dir(dir.c_str());
+            }
         } else {
             ESP_LOGW(TAG, "Failed to mount SD Card during startup. Assets will not be available.");
         }
@@ -122,13 +134,16 @@ extern "C" void app_main(void) {
 
     button_manager_init();
     audio_manager_init();
+    mic_capture_init();
     audio_recorder_init();
     
     wifi_manager_init_sta();
     wifi_streamer_init();
+    https_client_init();
     WeatherManager::init();
     PetManager::get_instance().init();
     stt_manager_init();
+    stt_queue_init();
 
     // Initialize the view manager, which creates the main UI.
     view_manager_init();
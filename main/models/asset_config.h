@@ -38,6 +38,11 @@ constexpr const char* RECORDINGS_SUBPATH = "recordings/"; // For mic test record
 constexpr const char* VOICE_NOTES_SUBPATH = "notes/";      // For the voice notes feature
 constexpr const char* JOURNAL_SUBPATH = "journal/";      // For daily voice journal entries
 constexpr const char* SUMMARY_SUBPATH = "summary/";      // For daily summary JSON files
+constexpr const char* TRANSCRIPTS_SUBPATH = "transcripts/"; // Transcripts of voice notes, one .txt per recording
+
+// --- User Data: Transcription Queue (in USER_DATA_BASE_PATH) ---
+constexpr const char* STT_QUEUE_FILENAME      = "stt_queue.json";     // Voice notes waiting to be transcribed
+constexpr const char* STT_QUEUE_TEMP_FILENAME = "stt_queue.json.tmp";
 
 // --- User Data: Room Sub-structure ---
 constexpr const char* ROOM_SUBPATH = "room/";
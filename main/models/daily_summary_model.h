@@ -3,6 +3,7 @@
 
 #include <string>
 #include <vector>
+#include <map>
 #include <time.h>
 #include <cstdint>
 
@@ -16,6 +17,7 @@ struct DailySummaryData {
     std::string journal_entry_path;
     std::vector<uint32_t> completed_habit_ids;
     std::vector<std::string> voice_note_paths;
+    std::map<std::string, std::string> voice_note_transcripts; // Transcript of a voice note, by its path.
     uint32_t pomodoro_work_seconds = 0; // Total seconds of completed Pomodoro work sessions.
 };
 
@@ -3,6 +3,7 @@
 #include "controllers/sd_card_manager/sd_card_manager.h"
 #include "controllers/button_manager/button_manager.h"
 #include "controllers/daily_summary_manager/daily_summary_manager.h"
+#include "config/app_config.h"
 #include "models/asset_config.h"
 #include "esp_log.h"
 #include <time.h>
@@ -29,6 +30,7 @@ DailyJournalView::~DailyJournalView() {
         ESP_LOGW(TAG, "View deleted during recording. Cancelling operation.");
         audio_recorder_cancel();
     }
+    audio_recorder_disarm();
 }
 
 void DailyJournalView::create(lv_obj_t* parent) {
@@ -41,6 +43,11 @@ void DailyJournalView::create(lv_obj_t* parent) {
     setup_button_handlers();
 
     ui_update_timer = lv_timer_create(DailyJournalView::ui_update_timer_cb, 250, this);
+
+    // Keep the microphone running so a recording includes what was said as OK was pressed.
+    if (!audio_recorder_arm(REC_ARM_PREROLL_MS)) {
+        ESP_LOGW(TAG, "Could not arm the recorder; recordings will start without pre-roll.");
+    }
 }
 
 // --- UI & Handler Setup ---
@@ -112,14 +119,23 @@ void DailyJournalView::update_ui() {
     if (current_state != last_known_state) {
         ESP_LOGD(TAG, "Recorder state changed from %d to %d", last_known_state, current_state);
 
-        // Check for successful save completion
-        if (last_known_state == RECORDER_STATE_SAVING && current_state == RECORDER_STATE_IDLE) {
+        // Check for successful save completion. An auto-stop can pass through
+        // SAVING between two polls, so the recorder's own outcome is used.
+        const bool recording_ended = current_state == RECORDER_STATE_IDLE &&
+            (last_known_state == RECORDER_STATE_RECORDING || last_known_state == RECORDER_STATE_SAVING ||
+             last_known_state == RECORDER_STATE_CANCELLING);
+        audio_recorder_stats_t stats;
+        audio_recorder_get_stats(&stats);
+        if (recording_ended && stats.saved) {
             ESP_LOGI(TAG, "Journal entry saved successfully. Updating daily summary with path: %s", current_filepath.c_str());
             // Use the stored start time to ensure the summary is for the correct day
             DailySummaryManager::set_journal_path(m_recording_start_time, current_filepath);
         }
 
         update_ui_for_state(current_state);
+        if (recording_ended && !stats.saved && stats.auto_stopped) {
+            lv_label_set_text(status_label, "No speech heard, discarded.");
+        }
         last_known_state = current_state;
     }
     if (current_state == RECORDER_STATE_RECORDING) {
@@ -141,7 +157,8 @@ void DailyJournalView::get_filepath_for_date(std::string& path_from_root, time_t
 
 void DailyJournalView::start_recording() {
     ESP_LOGI(TAG, "Starting new journal entry: %s", current_filepath.c_str());
-    if (!audio_recorder_start(current_filepath.c_str())) {
+    const audio_recorder_options_t options = { .trim_silence = true, .auto_stop_silence_s = REC_AUTO_STOP_SILENCE_S };
+    if (!audio_recorder_start_with_options(current_filepath.c_str(), &options)) {
         update_ui_for_state(RECORDER_STATE_ERROR);
     }
 }
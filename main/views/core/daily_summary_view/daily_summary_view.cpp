@@ -324,7 +324,12 @@ void DailySummaryView::update_ui() {
             lv_obj_t* notes_card = create_content_card(m_content_area, ContentItem::NOTES, LV_SYMBOL_FILE, "Voice Notes");
             lv_obj_t* notes_value_label = lv_label_create(lv_obj_get_child(lv_obj_get_child(notes_card, 1), 1));
             lv_obj_add_style(notes_value_label, &m_style_card_title, 0);
-            lv_label_set_text_fmt(notes_value_label, "%d saved notes", (int)m_current_summary.voice_note_paths.size());
+            if (m_current_summary.voice_note_transcripts.empty()) {
+                lv_label_set_text_fmt(notes_value_label, "%d saved notes", (int)m_current_summary.voice_note_paths.size());
+            } else {
+                lv_label_set_text_fmt(notes_value_label, "%d saved notes, %d transcribed",
+                    (int)m_current_summary.voice_note_paths.size(), (int)m_current_summary.voice_note_transcripts.size());
+            }
         }
 
         // Pomodoro/Focus Time card (conditional)
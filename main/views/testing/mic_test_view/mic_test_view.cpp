@@ -10,6 +10,12 @@
 
 static const char *TAG = "MIC_TEST_VIEW";
 
+// Level meter range, in dBFS at the microphone (speech at arm's length peaks around -50).
+#define METER_FLOOR_DBFS (-90)
+#define METER_CEILING_DBFS (-10)
+// Blocks the meter's queue holds: more than one UI update's worth (250 ms).
+#define METER_QUEUE_BLOCKS 16
+
 // --- Lifecycle Methods ---
 MicTestView::MicTestView() {
     ESP_LOGI(TAG, "MicTestView constructed");
@@ -24,11 +30,15 @@ MicTestView::~MicTestView() {
         ESP_LOGW(TAG, "View closed while recording was active. Cancelling recording.");
         audio_recorder_cancel();
     }
+    if (has_recording && audio_manager_is_playing()) {
+        audio_manager_stop();
+    }
 
     if (ui_update_timer) {
         lv_timer_del(ui_update_timer);
         ui_update_timer = nullptr;
     }
+    mic_capture_unsubscribe(meter);
 }
 
 void MicTestView::create(lv_obj_t* parent) {
@@ -40,6 +50,8 @@ void MicTestView::create(lv_obj_t* parent) {
     setup_ui(container);
     setup_button_handlers();
 
+    meter = mic_capture_subscribe("level meter", METER_QUEUE_BLOCKS);
+    if (!meter) lv_label_set_text(level_label, "Mic unavailable");
     ui_update_timer = lv_timer_create(MicTestView::ui_update_timer_cb, 250, this);
 }
 
@@ -61,12 +73,21 @@ void MicTestView::setup_ui(lv_obj_t* parent) {
     status_label = lv_label_create(parent);
     lv_obj_set_style_text_font(status_label, &lv_font_montserrat_18, 0);
 
+    level_bar = lv_bar_create(parent);
+    lv_obj_set_size(level_bar, LV_PCT(80), 12);
+    lv_bar_set_range(level_bar, METER_FLOOR_DBFS, METER_CEILING_DBFS);
+    lv_bar_set_value(level_bar, METER_FLOOR_DBFS, LV_ANIM_OFF);
+
+    level_label = lv_label_create(parent);
+    lv_label_set_text(level_label, "-- dBFS");
+
     update_ui_for_state(audio_recorder_get_state());
 }
 
 void MicTestView::setup_button_handlers() {
     button_manager_register_handler(BUTTON_OK, BUTTON_EVENT_TAP, MicTestView::ok_press_cb, true, this);
     button_manager_register_handler(BUTTON_CANCEL, BUTTON_EVENT_TAP, MicTestView::cancel_press_cb, true, this);
+    button_manager_register_handler(BUTTON_RIGHT, BUTTON_EVENT_TAP, MicTestView::right_press_cb, true, this);
 }
 
 // --- UI Logic ---
@@ -77,7 +98,7 @@ void MicTestView::format_time(char* buf, size_t buf_size, uint32_t time_s) {
 void MicTestView::update_ui_for_state(audio_recorder_state_t state) {
     switch (state) {
         case RECORDER_STATE_IDLE:
-            lv_label_set_text(status_label, "Press OK to record");
+            lv_label_set_text(status_label, has_recording ? "OK: record, RIGHT: play back" : "Press OK to record");
             lv_label_set_text(time_label, "00:00");
             lv_label_set_text(icon_label, LV_SYMBOL_AUDIO);
             lv_obj_set_style_text_color(icon_label, lv_color_white(), 0);
@@ -110,6 +131,11 @@ void MicTestView::update_ui() {
 
     if (current_state != last_known_state) {
         ESP_LOGD(TAG, "Recorder state changed from %d to %d", last_known_state, current_state);
+        if (current_state == RECORDER_STATE_IDLE && last_known_state == RECORDER_STATE_SAVING) {
+            audio_recorder_stats_t stats;
+            audio_recorder_get_stats(&stats);
+            has_recording = stats.saved;
+        }
         update_ui_for_state(current_state);
         last_known_state = current_state;
     }
@@ -119,6 +145,33 @@ void MicTestView::update_ui() {
         format_time(time_buf, sizeof(time_buf), audio_recorder_get_duration_s());
         lv_label_set_text(time_label, time_buf);
     }
+    update_level_meter();
+}
+
+// Shows the loudest block since the last update.
+void MicTestView::update_level_meter() {
+    if (!meter) return;
+    float peak = -150.0f;
+    bool any = false;
+    const mic_capture_block_t* block;
+    while ((block = mic_capture_peek(meter, 0)) != nullptr) {
+        float block_peak;
+        mic_capture_block_levels(block, &block_peak, nullptr);
+        mic_capture_release(meter);
+        if (block_peak > peak) peak = block_peak;
+        any = true;
+    }
+    if (!any) {
+        if (mic_capture_failed(meter)) {
+            // Leaving lets the service start again for the next subscriber.
+            mic_capture_unsubscribe(meter);
+            meter = nullptr;
+            lv_label_set_text(level_label, "Mic unavailable");
+        }
+        return;
+    }
+    lv_bar_set_value(level_bar, (int32_t)peak, LV_ANIM_OFF);
+    lv_label_set_text_fmt(level_label, "%d dBFS", (int)peak);
 }
 
 // --- Instance Methods for Actions ---
@@ -151,7 +204,10 @@ void MicTestView::on_ok_press() {
         snprintf(current_filepath, sizeof(current_filepath), "%s%s", recordings_dir_str.c_str(), filename);
 
         ESP_LOGI(TAG, "Starting recording to file: %s", current_filepath);
-        if (!audio_recorder_start(current_filepath)) {
+        if (audio_manager_is_playing()) audio_manager_stop();
+        has_recording = false;
+        const audio_recorder_options_t options = { .trim_silence = false, .auto_stop_silence_s = 0, .encoding = AUDIO_WAV_IMA_ADPCM };
+        if (!audio_recorder_start_with_options(current_filepath, &options)) {
             ESP_LOGE(TAG, "Failed to start audio recorder.");
             update_ui_for_state(RECORDER_STATE_ERROR);
         }
@@ -166,6 +222,16 @@ void MicTestView::on_cancel_press() {
     view_manager_load_view(VIEW_ID_MENU);
 }
 
+// Plays the last recording through the player, which decodes the IMA-ADPCM
+// the recorder wrote: a round trip through both codec halves.
+void MicTestView::on_right_press() {
+    if (!has_recording || audio_recorder_get_state() != RECORDER_STATE_IDLE) return;
+    ESP_LOGI(TAG, "Playing back %s", current_filepath);
+    if (!audio_manager_play(current_filepath)) {
+        lv_label_set_text(status_label, "Error: Can't play file!");
+    }
+}
+
 // --- Static Callbacks (Bridge to C-style APIs) ---
 void MicTestView::ok_press_cb(void* user_data) {
     static_cast<MicTestView*>(user_data)->on_ok_press();
@@ -175,6 +241,10 @@ void MicTestView::cancel_press_cb(void* user_data) {
     static_cast<MicTestView*>(user_data)->on_cancel_press();
 }
 
+void MicTestView::right_press_cb(void* user_data) {
+    static_cast<MicTestView*>(user_data)->on_right_press();
+}
+
 void MicTestView::ui_update_timer_cb(lv_timer_t* timer) {
     auto* view = static_cast<MicTestView*>(lv_timer_get_user_data(timer));
     if (view) {
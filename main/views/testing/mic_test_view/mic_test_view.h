@@ -4,6 +4,8 @@
 #include "views/view.h"
 #include "controllers/audio_recorder/audio_recorder.h"
 #include "controllers/button_manager/button_manager.h"
+#include "controllers/audio_manager/audio_manager.h"
+#include "controllers/mic_capture/mic_capture.h"
 #include "esp_log.h"
 #include "lvgl.h" // Include LVGL for lv_timer_t
 
@@ -12,6 +14,9 @@
  *
  * This class provides a user interface to start, stop, and cancel audio recordings.
  * It displays the recording state, elapsed time, and handles file creation on the SD card.
+ * Recordings are stored as IMA-ADPCM, and the last one can be played back to check the encoder.
+ * A level meter, with its own microphone subscription, shows the input level while the view
+ * is open, recording or not.
  */
 class MicTestView : public View {
 public:
@@ -24,11 +29,15 @@ private:
     lv_obj_t* status_label = nullptr;
     lv_obj_t* time_label = nullptr;
     lv_obj_t* icon_label = nullptr;
+    lv_obj_t* level_bar = nullptr;
+    lv_obj_t* level_label = nullptr;
     lv_timer_t* ui_update_timer = nullptr;
 
     // --- State ---
     char current_filepath[256] = {0};
+    bool has_recording = false; // current_filepath holds a saved recording.
     audio_recorder_state_t last_known_state;
+    mic_capture_subscriber_t* meter = nullptr; // Read from the UI timer.
 
     // --- Private Methods ---
     void setup_ui(lv_obj_t* parent);
@@ -36,14 +45,17 @@ private:
     void format_time(char* buf, size_t buf_size, uint32_t time_s);
     void update_ui_for_state(audio_recorder_state_t state);
     void update_ui(); // The method called by the timer
+    void update_level_meter();
 
     // --- Instance Methods for Actions ---
     void on_ok_press();
     void on_cancel_press();
+    void on_right_press();
 
     // --- Static Callbacks (Bridge to C-style APIs) ---
     static void ok_press_cb(void* user_data);
     static void cancel_press_cb(void* user_data);
+    static void right_press_cb(void* user_data);
     static void ui_update_timer_cb(lv_timer_t* timer);
 };
 
@@ -2,13 +2,81 @@
 #include "views/view_manager.h"
 #include "components/text_viewer/text_viewer.h"
 #include "controllers/sd_card_manager/sd_card_manager.h"
+#include "controllers/audio_recorder/audio_wav_writer.h"
+#include "config/app_config.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 #include <cstring>
 #include <time.h>
 #include <sys/stat.h>
+#include <sys/unistd.h>
 
 static const char *TAG = "SD_TEST_VIEW";
 
+// --- Recording Write Benchmark ---
+// Writes the same amount of audio to the card twice: in 2 KB appends to a plain
+// "wb" file, as the recorder used to, and through audio_wav_writer_t
+// (preallocated file, cluster-aligned REC_WRITE_CHUNK_SIZE writes). It runs in
+// its own task; the view polls for the results.
+#define BENCH_TOTAL_BYTES (1024 * 1024)
+#define BENCH_APPEND_BYTES 2048
+
+typedef struct {
+    bool ok;
+    uint32_t total_us;
+    audio_histogram_t write_us;
+} bench_result_t;
+
+static bench_result_t bench_results[2]; // Plain appends, then the WAV writer.
+static volatile bool bench_running = false;
+static volatile bool bench_done = false;
+
+static void write_bench_task(void* arg) {
+    static audio_wav_writer_t writer;
+    static uint8_t chunk[BENCH_APPEND_BYTES];
+    char path[64];
+    snprintf(path, sizeof(path), "%s/wbench.wav", sd_manager_get_mount_point());
+    for (size_t i = 0; i < sizeof(chunk); i++) chunk[i] = (uint8_t)i;
+    memset(bench_results, 0, sizeof(bench_results));
+
+    bench_result_t* plain = &bench_results[0];
+    int64_t start = esp_timer_get_time();
+    FILE* fp = fopen(path, "wb");
+    plain->ok = (fp != NULL);
+    for (uint32_t written = 0; plain->ok && written < BENCH_TOTAL_BYTES; written += sizeof(chunk)) {
+        const int64_t t = esp_timer_get_time();
+        plain->ok = fwrite(chunk, 1, sizeof(chunk), fp) == sizeof(chunk);
+        audio_histogram_record(&plain->write_us, (uint32_t)(esp_timer_get_time() - t));
+    }
+    if (fp) fclose(fp);
+    plain->total_us = (uint32_t)(esp_timer_get_time() - start);
+    unlink(path);
+
+    bench_result_t* prealloc = &bench_results[1];
+    start = esp_timer_get_time();
+    prealloc->ok = audio_wav_writer_open(&writer, path, REC_SAMPLE_RATE, REC_NUM_CHANNELS, AUDIO_WAV_PCM_16);
+    for (uint32_t written = 0; prealloc->ok && written < BENCH_TOTAL_BYTES; written += sizeof(chunk)) {
+        prealloc->ok = audio_wav_writer_write(&writer, chunk, sizeof(chunk));
+    }
+    if (prealloc->ok) prealloc->ok = audio_wav_writer_finalize(&writer);
+    else audio_wav_writer_close(&writer);
+    prealloc->total_us = (uint32_t)(esp_timer_get_time() - start);
+    prealloc->write_us = writer.write_us;
+    unlink(path);
+
+    for (int i = 0; i < 2; i++) {
+        const bench_result_t* r = &bench_results[i];
+        ESP_LOGI(TAG, "Write benchmark %s: %s, %lu writes in %lu ms, mean %lu us, p99 <= %lu us, max %lu us",
+                 i == 0 ? "2 KB appends" : "preallocated", r->ok ? "ok" : "FAILED", r->write_us.count, r->total_us / 1000,
+                 audio_histogram_mean(&r->write_us), audio_histogram_percentile(&r->write_us, 99), r->write_us.max_us);
+    }
+    bench_done = true;
+    bench_running = false;
+    vTaskDelete(NULL);
+}
+
 // --- Lifecycle Methods ---
 SdTestView::SdTestView() {
     ESP_LOGI(TAG, "SdTestView constructed");
@@ -16,6 +84,10 @@ SdTestView::SdTestView() {
 
 SdTestView::~SdTestView() {
     ESP_LOGI(TAG, "SdTestView destructed, cleaning up resources.");
+    if (bench_timer) {
+        lv_timer_del(bench_timer);
+        bench_timer = nullptr;
+    }
     
     destroy_action_menu(false);
     reset_action_menu_styles();
@@ -36,6 +108,7 @@ void SdTestView::create(lv_obj_t* parent) {
 void SdTestView::setup_initial_button_handlers() {
     button_manager_register_handler(BUTTON_OK, BUTTON_EVENT_TAP, SdTestView::initial_ok_press_cb, true, this);
     button_manager_register_handler(BUTTON_CANCEL, BUTTON_EVENT_TAP, SdTestView::initial_cancel_press_cb, true, this);
+    button_manager_register_handler(BUTTON_RIGHT, BUTTON_EVENT_TAP, SdTestView::initial_right_press_cb, true, this);
 }
 
 void SdTestView::create_initial_view() {
@@ -49,13 +122,14 @@ void SdTestView::create_initial_view() {
     info_label_widget = lv_label_create(container);
     lv_obj_set_style_text_align(info_label_widget, LV_TEXT_ALIGN_CENTER, 0);
     lv_obj_center(info_label_widget);
-    lv_label_set_text(info_label_widget, "Press OK to open\nthe file explorer.");
+    lv_label_set_text(info_label_widget, "Press OK to open\nthe file explorer.\n\nRIGHT: write benchmark");
 
     setup_initial_button_handlers();
 }
 
 void SdTestView::show_file_explorer() {
     lv_obj_clean(container);
+    info_label_widget = nullptr;
 
     lv_obj_t* main_cont = lv_obj_create(container);
     lv_obj_remove_style_all(main_cont);
@@ -137,6 +211,7 @@ void SdTestView::destroy_action_menu(bool refresh_explorer) {
 // --- Instance Methods for Actions ---
 
 void SdTestView::on_initial_ok_press() {
+    if (bench_running) return; // Remounting would pull the card from under the benchmark.
     sd_manager_unmount();
     if (sd_manager_mount()) {
         show_file_explorer();
@@ -149,6 +224,42 @@ void SdTestView::on_initial_cancel_press() {
     view_manager_load_view(VIEW_ID_MENU);
 }
 
+void SdTestView::on_initial_right_press() {
+    if (bench_running || !info_label_widget) return;
+    if (!sd_manager_check_ready()) {
+        lv_label_set_text(info_label_widget, "SD card not ready.");
+        return;
+    }
+    bench_running = true;
+    bench_done = false;
+    if (xTaskCreate(write_bench_task, "sd_write_bench", 4096, NULL, 4, NULL) != pdPASS) {
+        bench_running = false;
+        lv_label_set_text(info_label_widget, "Could not start the benchmark.");
+        return;
+    }
+    lv_label_set_text_fmt(info_label_widget, "Writing %d KB twice...", BENCH_TOTAL_BYTES / 1024);
+    if (!bench_timer) bench_timer = lv_timer_create(SdTestView::bench_timer_cb, 250, this);
+}
+
+void SdTestView::on_bench_timer() {
+    if (!bench_done) return;
+    lv_timer_del(bench_timer);
+    bench_timer = nullptr;
+    if (!info_label_widget) return;
+
+    char text[256];
+    size_t len = 0;
+    for (int i = 0; i < 2; i++) {
+        const bench_result_t* r = &bench_results[i];
+        const uint32_t kb_per_s = r->total_us ? (uint32_t)((uint64_t)BENCH_TOTAL_BYTES * 1000000 / 1024 / r->total_us) : 0;
+        len += snprintf(text + len, sizeof(text) - len, "%s%s: %s\n%lu KB/s, max write %lu ms\n",
+                        i ? "\n" : "", i == 0 ? "2 KB appends" : "Preallocated", r->ok ? "ok" : "FAILED",
+                        kb_per_s, r->write_us.max_us / 1000);
+        if (len >= sizeof(text)) break;
+    }
+    lv_label_set_text(info_label_widget, text);
+}
+
 void SdTestView::on_file_selected(const char* path) {
     struct stat st;
     if (stat(path, &st) == 0 && S_ISREG(st.st_mode)) { // It's a regular file
@@ -263,6 +374,8 @@ void SdTestView::reset_action_menu_styles() {
 // --- Static Callbacks for Button Manager (Pass `this`) ---
 void SdTestView::initial_ok_press_cb(void* user_data) { static_cast<SdTestView*>(user_data)->on_initial_ok_press(); }
 void SdTestView::initial_cancel_press_cb(void* user_data) { static_cast<SdTestView*>(user_data)->on_initial_cancel_press(); }
+void SdTestView::initial_right_press_cb(void* user_data) { static_cast<SdTestView*>(user_data)->on_initial_right_press(); }
+void SdTestView::bench_timer_cb(lv_timer_t* timer) { static_cast<SdTestView*>(lv_timer_get_user_data(timer))->on_bench_timer(); }
 void SdTestView::action_menu_ok_cb(void* user_data) { static_cast<SdTestView*>(user_data)->on_action_menu_ok(); }
 void SdTestView::action_menu_cancel_cb(void* user_data) { static_cast<SdTestView*>(user_data)->on_action_menu_cancel(); }
 void SdTestView::action_menu_left_cb(void* user_data) { static_cast<SdTestView*>(user_data)->on_action_menu_nav(false); }
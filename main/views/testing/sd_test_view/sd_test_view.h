@@ -11,7 +11,7 @@
  *
  * This view provides a comprehensive interface for interacting with the SD card,
  * including a file explorer, file viewer, and file management actions (create,
- * rename, delete).
+ * rename, delete). It can also benchmark the write pattern used for recordings.
  */
 class SdTestView : public View {
 public:
@@ -25,6 +25,7 @@ private:
     lv_obj_t* action_menu_container = nullptr;
     lv_obj_t* text_viewer_obj = nullptr;
     lv_obj_t* file_explorer_host_container = nullptr;
+    lv_timer_t* bench_timer = nullptr;
 
     // --- State ---
     lv_group_t* action_menu_group = nullptr;
@@ -44,6 +45,8 @@ private:
     // --- Instance Methods for Button/Component Actions ---
     void on_initial_ok_press();
     void on_initial_cancel_press();
+    void on_initial_right_press();
+    void on_bench_timer();
     
     void on_file_selected(const char* path);
     void on_file_long_pressed(const char* path);
@@ -59,6 +62,8 @@ private:
     // --- Static Callbacks for Button Manager (Bridge to instance methods) ---
     static void initial_ok_press_cb(void* user_data);
     static void initial_cancel_press_cb(void* user_data);
+    static void initial_right_press_cb(void* user_data);
+    static void bench_timer_cb(lv_timer_t* timer);
     static void action_menu_ok_cb(void* user_data);
     static void action_menu_cancel_cb(void* user_data);
     static void action_menu_left_cb(void* user_data);
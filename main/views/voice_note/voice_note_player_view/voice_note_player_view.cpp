@@ -3,6 +3,7 @@
 #include "controllers/sd_card_manager/sd_card_manager.h"
 #include "controllers/wifi_manager/wifi_manager.h"
 #include "controllers/stt_manager/stt_manager.h"
+#include "controllers/stt_queue/stt_queue.h"
 #include "controllers/button_manager/button_manager.h"
 #include "components/file_explorer/file_explorer.h"
 #include "components/audio_player_component/audio_player_component.h"
@@ -200,16 +201,33 @@ void VoiceNotePlayerView::on_action_menu_ok() {
         sd_manager_delete_item(path_str.c_str());
         destroy_action_menu(true);
     } else if (strcmp(action_text, "Transcribe") == 0) {
+        // A note transcribed while it was recorded already has its transcript.
+        std::string transcript_path = stt_manager_get_transcript_path(path_str);
+        char* transcript = nullptr;
+        size_t transcript_size = 0;
+        if (sd_manager_file_exists(transcript_path.c_str()) &&
+            sd_manager_read_file(transcript_path.c_str(), &transcript, &transcript_size)) {
+            ESP_LOGI(TAG, "Showing saved transcript %s", transcript_path.c_str());
+            destroy_action_menu(false);
+            lv_obj_clean(container);
+            text_viewer_create(container, "Transcription", transcript, viewer_exit_cb_c, this);
+            return;
+        }
+
         if (!wifi_manager_is_connected()) {
              wifi_manager_init_sta(); 
         }
         destroy_action_menu(false);
         show_loading_indicator("Transcribing...");
         
-        auto stt_lambda_cb = [this](bool success, const std::string& result) {
+        auto stt_lambda_cb = [this, path_str](bool success, const std::string& result) {
             auto result_data = std::make_unique<transcription_result_data_t>();
             result_data->success = success;
             result_data->result_text = result;
+            // Not lost: the queue uploads it once the device is online.
+            if (!success && stt_queue_add(path_str, 0)) {
+                result_data->result_text += "\n\nQueued: it will be transcribed when the device is online.";
+            }
             result_data->instance = this;
 
             lv_async_call(on_transcription_complete_ui_thread, result_data.release());
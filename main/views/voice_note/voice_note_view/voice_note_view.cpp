@@ -2,6 +2,10 @@
 #include "views/view_manager.h"
 #include "controllers/sd_card_manager/sd_card_manager.h"
 #include "controllers/daily_summary_manager/daily_summary_manager.h"
+#include "controllers/stt_manager/stt_manager.h"
+#include "controllers/stt_queue/stt_queue.h"
+#include "controllers/wifi_manager/wifi_manager.h"
+#include "config/app_config.h"
 #include "models/asset_config.h" // Include the asset configuration
 #include <time.h>
 #include <sys/stat.h>
@@ -29,6 +33,7 @@ VoiceNoteView::~VoiceNoteView() {
         ESP_LOGW(TAG, "View deleted during recording. Cancelling operation.");
         audio_recorder_cancel();
     }
+    audio_recorder_disarm();
 }
 
 void VoiceNoteView::create(lv_obj_t* parent) {
@@ -41,6 +46,11 @@ void VoiceNoteView::create(lv_obj_t* parent) {
     setup_button_handlers();
 
     ui_update_timer = lv_timer_create(VoiceNoteView::ui_update_timer_cb, 250, this);
+
+    // Keep the microphone running so a recording includes what was said as OK was pressed.
+    if (!audio_recorder_arm(REC_ARM_PREROLL_MS)) {
+        ESP_LOGW(TAG, "Could not arm the recorder; recordings will start without pre-roll.");
+    }
 }
 
 // --- UI & Handler Setup ---
@@ -114,13 +124,26 @@ void VoiceNoteView::update_ui() {
     if (current_state != last_known_state) {
         ESP_LOGD(TAG, "Recorder state changed from %d to %d", last_known_state, current_state);
         
-        // Check for successful save completion
-        if (last_known_state == RECORDER_STATE_SAVING && current_state == RECORDER_STATE_IDLE) {
+        // Check for successful save completion. An auto-stop can pass through
+        // SAVING between two polls, so the recorder's own outcome is used.
+        const bool recording_ended = current_state == RECORDER_STATE_IDLE &&
+            (last_known_state == RECORDER_STATE_RECORDING || last_known_state == RECORDER_STATE_SAVING ||
+             last_known_state == RECORDER_STATE_CANCELLING);
+        audio_recorder_stats_t stats;
+        audio_recorder_get_stats(&stats);
+        if (recording_ended && stats.saved) {
             ESP_LOGI(TAG, "Voice note saved successfully. Updating daily summary.");
-            DailySummaryManager::add_voice_note_path(time(NULL), current_filepath);
+            DailySummaryManager::add_voice_note_path(recording_start_time, current_filepath);
+            // A note that was not streamed is transcribed from the queue, now or once online.
+            if (!recording_streamed) {
+                stt_queue_add(current_filepath, recording_start_time);
+            }
         }
 
         update_ui_for_state(current_state);
+        if (recording_ended && !stats.saved && stats.auto_stopped) {
+            lv_label_set_text(status_label, "No speech heard, discarded.");
+        }
         last_known_state = current_state;
     }
 
@@ -162,7 +185,16 @@ void VoiceNoteView::on_ok_press() {
         snprintf(current_filepath, sizeof(current_filepath), "%s%s", notes_dir_str.c_str(), filename);
 
         ESP_LOGI(TAG, "Starting new voice note: %s", current_filepath);
-        if (!audio_recorder_start(current_filepath)) {
+        audio_recorder_options_t options = { .trim_silence = true, .auto_stop_silence_s = REC_AUTO_STOP_SILENCE_S };
+        // Online, the note is transcribed as it is recorded; the player shows the saved transcript.
+        recording_start_time = now;
+        stt_stream_t stream = nullptr;
+        if (STT_STREAM_VOICE_NOTES && wifi_manager_is_connected()) {
+            stream = stt_queue_stream_begin(current_filepath, recording_start_time, &options.tap);
+        }
+        recording_streamed = stream != nullptr;
+        if (!audio_recorder_start_with_options(current_filepath, &options)) {
+            stt_manager_stream_cancel(stream);
             update_ui_for_state(RECORDER_STATE_ERROR);
         }
     } else if (state == RECORDER_STATE_RECORDING) {
@@ -5,6 +5,7 @@
 #include "controllers/audio_recorder/audio_recorder.h"
 #include "controllers/button_manager/button_manager.h"
 #include "esp_log.h"
+#include <time.h>
 
 /**
  * @brief View for recording voice notes.
@@ -28,6 +29,8 @@ private:
 
     // --- State ---
     char current_filepath[256] = {0};
+    time_t recording_start_time = 0;
+    bool recording_streamed = false;    // Its transcription stream queues it if it fails.
     audio_recorder_state_t last_known_state;
 
     // --- Private Methods ---
@@ -0,0 +1,380 @@
+// Decoders of the player (audio_decoder.h) on fixtures written here: 10 s of
+// 44.1 kHz audio, mono and stereo, as 16-bit PCM WAV, IMA-ADPCM WAV and QOA.
+// The IMA-ADPCM and QOA files come from encoders in this file (not the
+// firmware's), written from the format descriptions, which keep the samples a
+// decoder must reconstruct. audio_decoder_read() must return exactly those
+// samples (the source itself for PCM), as 16-bit stereo; the SNR against the
+// source is printed as a sanity check of the fixtures. Then the decode time of
+// each file, in microseconds per second of audio, from a host file.
+#include "controllers/audio_manager/audio_decoder.h"
+#include "controllers/audio_manager/audio_ima_adpcm.h"
+#include "controllers/audio_manager/audio_qoa.h"
+#include "host_test.h"
+#include <algorithm>
+#include <math.h>
+#include <string.h>
+#include <vector>
+
+#define SAMPLE_RATE 44100
+#define SECONDS 10
+#define FRAMES (SAMPLE_RATE * SECONDS)
+#define IMA_BLOCK_ALIGN_PER_CHANNEL 1024 // What common encoders use at 44.1 kHz, not the recorder's 256.
+#define MIN_SNR_DB 25.0
+#define TIMING_RUNS 5
+
+// The source: a chord with some noise, a different one on the right channel.
+static std::vector<int16_t> make_source(uint16_t channels) {
+    std::vector<int16_t> pcm((size_t)FRAMES * channels);
+    uint32_t seed = 7;
+    for (uint32_t i = 0; i < FRAMES; i++) {
+        const double t = (double)i / SAMPLE_RATE;
+        for (uint16_t c = 0; c < channels; c++) {
+            const double f = c ? 1.5 : 1.0;
+            const double x = 7000 * sin(2 * M_PI * 220 * f * t) + 4000 * sin(2 * M_PI * 554.4 * f * t) +
+                             2500 * sin(2 * M_PI * 1318.5 * f * t) + 600 * host_random(&seed);
+            pcm[(size_t)i * channels + c] = (int16_t)lrint(x);
+        }
+    }
+    return pcm;
+}
+
+static void put_le16(std::vector<uint8_t>* out, uint16_t v) {
+    out->push_back((uint8_t)v);
+    out->push_back((uint8_t)(v >> 8));
+}
+
+static void put_le32(std::vector<uint8_t>* out, uint32_t v) {
+    put_le16(out, (uint16_t)v);
+    put_le16(out, (uint16_t)(v >> 16));
+}
+
+static void put_tag(std::vector<uint8_t>* out, const char* tag) {
+    for (int i = 0; i < 4; i++) out->push_back((uint8_t)tag[i]);
+}
+
+static void put_be(std::vector<uint8_t>* out, uint64_t v, int bytes) {
+    for (int i = bytes - 1; i >= 0; i--) out->push_back((uint8_t)(v >> (8 * i)));
+}
+
+static bool write_file(const char* path, const std::vector<uint8_t>& data) {
+    FILE* fp = fopen(path, "wb");
+    if (!fp) return false;
+    const bool ok = fwrite(data.data(), 1, data.size(), fp) == data.size();
+    return fclose(fp) == 0 && ok;
+}
+
+static inline int16_t clamp16(int32_t v) { return (int16_t)std::min(32767, std::max(-32768, v)); }
+
+// --- IMA-ADPCM ---
+
+static const int16_t IMA_STEPS[89] = {
+    7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45, 50, 55, 60, 66, 73, 80, 88, 97,
+    107, 118, 130, 143, 157, 173, 190, 209, 230, 253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658, 724, 796,
+    876, 963, 1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024, 3327, 3660, 4026, 4428, 4871,
+    5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623,
+    27086, 29794, 32767,
+};
+static const int8_t IMA_INDEX_STEPS[16] = { -1, -1, -1, -1, 2, 4, 6, 8, -1, -1, -1, -1, 2, 4, 6, 8 };
+
+struct ima_channel {
+    int32_t predictor;
+    int32_t index;
+};
+
+// Codes one sample (IMA's reference quantizer) and moves `ch` on as a decoder would.
+static uint8_t ima_encode_sample(ima_channel* ch, int16_t sample) {
+    const int32_t step = IMA_STEPS[ch->index];
+    int32_t diff = sample - ch->predictor;
+    uint8_t code = 0;
+    if (diff < 0) {
+        code = 8;
+        diff = -diff;
+    }
+    if (diff >= step) {
+        code |= 4;
+        diff -= step;
+    }
+    if (diff >= step >> 1) {
+        code |= 2;
+        diff -= step >> 1;
+    }
+    if (diff >= step >> 2) code |= 1;
+
+    int32_t delta = step >> 3;
+    if (code & 4) delta += step;
+    if (code & 2) delta += step >> 1;
+    if (code & 1) delta += step >> 2;
+    ch->predictor = clamp16(ch->predictor + ((code & 8) ? -delta : delta));
+    ch->index = std::min(88, std::max(0, ch->index + IMA_INDEX_STEPS[code]));
+    return code;
+}
+
+// A WAV file (format 0x11, with the fact chunk) and, in `decoded`, the samples
+// it decodes to: the last block is padded to whole 8-sample groups with its last frame.
+static std::vector<uint8_t> encode_ima(const std::vector<int16_t>& pcm, uint16_t channels, std::vector<int16_t>* decoded) {
+    const uint16_t block_align = IMA_BLOCK_ALIGN_PER_CHANNEL * channels;
+    const uint32_t block_frames = (block_align - 4u * channels) * 2 / channels + 1;
+    std::vector<uint8_t> data;
+    decoded->clear();
+    ima_channel state[2] = {};
+    for (uint32_t start = 0; start < FRAMES; start += block_frames) {
+        const uint32_t frames = std::min<uint32_t>(block_frames, FRAMES - start);
+        const uint32_t groups = (frames - 1 + 7) / 8;
+        auto sample = [&](uint32_t i, uint16_t c) {
+            return pcm[(size_t)std::min(start + i, (uint32_t)FRAMES - 1) * channels + c];
+        };
+        // Header: the first frame as is, and the step index carried over from the last block.
+        std::vector<int16_t> out((1 + groups * 8) * channels);
+        for (uint16_t c = 0; c < channels; c++) {
+            state[c].predictor = sample(0, c);
+            put_le16(&data, (uint16_t)state[c].predictor);
+            data.push_back((uint8_t)state[c].index);
+            data.push_back(0);
+            out[c] = (int16_t)state[c].predictor;
+        }
+        for (uint32_t g = 0; g < groups; g++) {
+            for (uint16_t c = 0; c < channels; c++) {
+                for (uint32_t i = 0; i < 8; i += 2) {
+                    const uint32_t f = 1 + g * 8 + i;
+                    const uint8_t lo = ima_encode_sample(&state[c], sample(f, c));
+                    out[f * channels + c] = (int16_t)state[c].predictor;
+                    const uint8_t hi = ima_encode_sample(&state[c], sample(f + 1, c));
+                    out[(f + 1) * channels + c] = (int16_t)state[c].predictor;
+                    data.push_back((uint8_t)(lo | hi << 4));
+                }
+            }
+        }
+        decoded->insert(decoded->end(), out.begin(), out.end());
+    }
+
+    std::vector<uint8_t> file;
+    file.reserve(60 + data.size());
+    put_tag(&file, "RIFF");
+    put_le32(&file, (uint32_t)(52 + data.size()));
+    put_tag(&file, "WAVE");
+    put_tag(&file, "fmt ");
+    put_le32(&file, 20);
+    put_le16(&file, AUDIO_IMA_ADPCM_WAV_FORMAT);
+    put_le16(&file, channels);
+    put_le32(&file, SAMPLE_RATE);
+    put_le32(&file, (uint32_t)((uint64_t)SAMPLE_RATE * block_align / block_frames));
+    put_le16(&file, block_align);
+    put_le16(&file, 4);
+    put_le16(&file, 2);
+    put_le16(&file, (uint16_t)block_frames);
+    put_tag(&file, "fact");
+    put_le32(&file, 4);
+    put_le32(&file, FRAMES);
+    put_tag(&file, "data");
+    put_le32(&file, (uint32_t)data.size());
+    file.insert(file.end(), data.begin(), data.end());
+    return file;
+}
+
+// --- QOA ---
+
+// round((s + 1)^2.75) and the dequantized steps, in units of it.
+static const int32_t QOA_SCALEFACTORS[16] = { 1, 7, 21, 45, 84, 138, 211, 304, 421, 562, 731, 928, 1157, 1419, 1715, 2048 };
+static const double QOA_STEPS[8] = { 0.75, -0.75, 2.5, -2.5, 4.5, -4.5, 7, -7 };
+
+struct qoa_lms {
+    int32_t history[4];
+    int32_t weights[4];
+};
+
+static int32_t qoa_dequant(int sf, int q) {
+    const double v = QOA_SCALEFACTORS[sf] * QOA_STEPS[q];
+    return (int32_t)(v < 0 ? -floor(-v + 0.5) : floor(v + 0.5));
+}
+
+static int32_t qoa_predict(const qoa_lms* lms) {
+    int32_t p = 0;
+    for (int k = 0; k < 4; k++) p += lms->weights[k] * lms->history[k];
+    return p >> 13;
+}
+
+static void qoa_update(qoa_lms* lms, int16_t sample, int32_t residual) {
+    const int32_t delta = residual >> 4;
+    for (int k = 0; k < 4; k++) lms->weights[k] += lms->history[k] < 0 ? -delta : delta;
+    memmove(lms->history, lms->history + 1, 3 * sizeof(int32_t));
+    lms->history[3] = sample;
+}
+
+// Codes one slice of `n` samples (stride `channels`) with the best of the 16
+// scale factors. Large LMS weights are penalized as in the reference encoder,
+// so they stay within the 16 bits a frame header stores.
+static uint64_t qoa_encode_slice(qoa_lms* lms, const int16_t* in, uint32_t n, uint16_t channels, int16_t* out) {
+    uint64_t best_slice = 0;
+    double best_error = INFINITY;
+    qoa_lms best_lms = *lms;
+    std::vector<int16_t> trial(n), best(n);
+    for (int sf = 0; sf < 16; sf++) {
+        qoa_lms st = *lms;
+        uint64_t slice = (uint64_t)sf;
+        double error = 0;
+        for (uint32_t i = 0; i < n; i++) {
+            const int32_t predicted = qoa_predict(&st);
+            const int32_t residual = in[(size_t)i * channels] - predicted;
+            int q = 0;
+            for (int k = 1; k < 8; k++) {
+                if (abs(residual - qoa_dequant(sf, k)) < abs(residual - qoa_dequant(sf, q))) q = k;
+            }
+            const int32_t dequantized = qoa_dequant(sf, q);
+            trial[i] = clamp16(predicted + dequantized);
+            const double e = in[(size_t)i * channels] - trial[i];
+            const int64_t w = (int64_t)st.weights[0] * st.weights[0] + (int64_t)st.weights[1] * st.weights[1] +
+                              (int64_t)st.weights[2] * st.weights[2] + (int64_t)st.weights[3] * st.weights[3];
+            const int64_t penalty = (w >> 18) - 0x8ff;
+            error += e * e + (penalty > 0 ? (double)penalty * penalty : 0);
+            qoa_update(&st, trial[i], dequantized);
+            slice = slice << 3 | (uint64_t)q;
+        }
+        if (error < best_error) {
+            best_error = error;
+            best_slice = slice << (3 * (AUDIO_QOA_SLICE_LEN - n));
+            best_lms = st;
+            best.swap(trial);
+        }
+    }
+    *lms = best_lms;
+    for (uint32_t i = 0; i < n; i++) out[(size_t)i * channels] = best[i];
+    return best_slice;
+}
+
+// A QOA file of the whole stream and, in `decoded`, the samples it decodes to.
+static std::vector<uint8_t> encode_qoa(const std::vector<int16_t>& pcm, uint16_t channels, std::vector<int16_t>* decoded) {
+    std::vector<uint8_t> file;
+    put_tag(&file, AUDIO_QOA_MAGIC);
+    put_be(&file, FRAMES, 4);
+    decoded->assign(pcm.size(), 0);
+    qoa_lms lms[2];
+    for (auto& st : lms) st = { { 0, 0, 0, 0 }, { 0, 0, -(1 << 13), 1 << 14 } };
+    for (uint32_t start = 0; start < FRAMES; start += AUDIO_QOA_FRAME_LEN) {
+        const uint16_t n = (uint16_t)std::min<uint32_t>(AUDIO_QOA_FRAME_LEN, FRAMES - start);
+        file.push_back((uint8_t)channels);
+        put_be(&file, SAMPLE_RATE, 3);
+        put_be(&file, n, 2);
+        put_be(&file, audio_qoa_frame_size(channels, n), 2);
+        for (uint16_t c = 0; c < channels; c++) {
+            uint64_t history = 0, weights = 0;
+            for (int k = 0; k < 4; k++) {
+                // The decoder starts from the 16-bit values, so the encoder does too.
+                lms[c].weights[k] = (int16_t)lms[c].weights[k];
+                history = history << 16 | (uint16_t)lms[c].history[k];
+                weights = weights << 16 | (uint16_t)lms[c].weights[k];
+            }
+            put_be(&file, history, 8);
+            put_be(&file, weights, 8);
+        }
+        for (uint32_t s = 0; s < n; s += AUDIO_QOA_SLICE_LEN) {
+            const uint32_t len = std::min<uint32_t>(AUDIO_QOA_SLICE_LEN, n - s);
+            for (uint16_t c = 0; c < channels; c++) {
+                const size_t at = (size_t)(start + s) * channels + c;
+                put_be(&file, qoa_encode_slice(&lms[c], &pcm[at], len, channels, &(*decoded)[at]), 8);
+            }
+        }
+    }
+    return file;
+}
+
+// --- Decoding ---
+
+// Decodes `path` through audio_decoder_read(). Returns false if it does not open.
+static bool decode_file(const char* path, std::vector<int16_t>* out, const char** codec) {
+    FILE* fp = fopen(path, "rb");
+    audio_decoder_t dec = {};
+    if (!fp || !audio_decoder_open(&dec, fp)) {
+        if (fp) fclose(fp);
+        return false;
+    }
+    *codec = dec.ops->name;
+    out->clear();
+    std::vector<int16_t> buf(1024 * 2);
+    size_t n;
+    while ((n = audio_decoder_read(&dec, buf.data(), 1024)) > 0) out->insert(out->end(), buf.begin(), buf.begin() + n * 2);
+    HOST_CHECK(!dec.error, "%s: decoder error", path);
+    HOST_CHECK(dec.sample_rate == SAMPLE_RATE, "%s: %lu Hz", path, (unsigned long)dec.sample_rate);
+    audio_decoder_close(&dec);
+    fclose(fp);
+    return true;
+}
+
+static double snr_db(const std::vector<int16_t>& source, uint16_t channels, const std::vector<int16_t>& stereo) {
+    double signal = 0, noise = 0;
+    for (uint32_t i = 0; i < FRAMES && (size_t)i * 2 + 1 < stereo.size(); i++) {
+        for (uint16_t c = 0; c < 2; c++) {
+            const double x = source[(size_t)i * channels + (channels == 2 ? c : 0)];
+            const double e = stereo[(size_t)i * 2 + c] - x;
+            signal += x * x;
+            noise += e * e;
+        }
+    }
+    return noise > 0 ? 10 * log10(signal / noise) : INFINITY;
+}
+
+// Decodes one fixture, compares it with `reference` (interleaved, `channels`
+// channels, possibly longer than the source) and times it.
+static void check_fixture(const char* path, const std::vector<uint8_t>& file, const std::vector<int16_t>& source,
+                          const std::vector<int16_t>& reference, uint16_t channels) {
+    HOST_CHECK(write_file(path, file), "cannot write %s", path);
+    std::vector<int16_t> got;
+    const char* codec = "?";
+    if (!decode_file(path, &got, &codec)) {
+        HOST_CHECK(false, "cannot open %s", path);
+        return;
+    }
+
+    // The reference as 16-bit stereo, which is what the player gets.
+    const size_t ref_frames = reference.size() / channels;
+    std::vector<int16_t> expect(ref_frames * 2);
+    for (size_t i = 0; i < ref_frames; i++) {
+        expect[i * 2] = reference[i * channels];
+        expect[i * 2 + 1] = reference[i * channels + channels - 1];
+    }
+    size_t mismatch = 0;
+    for (size_t i = 0; i < std::min(expect.size(), got.size()); i++) mismatch += expect[i] != got[i];
+    HOST_CHECK(got.size() == expect.size() && mismatch == 0, "%s: %zu frames decoded, %zu expected, %zu samples differ",
+               path, got.size() / 2, ref_frames, mismatch);
+    const double snr = snr_db(source, channels, got);
+    HOST_CHECK(snr >= MIN_SNR_DB, "%s: SNR %.1f dB against the source", path, snr);
+
+    double best_s = INFINITY;
+    for (int run = 0; run < TIMING_RUNS; run++) {
+        const double start = host_now_s();
+        decode_file(path, &got, &codec);
+        best_s = std::min(best_s, host_now_s() - start);
+    }
+    char snr_text[16];
+    snprintf(snr_text, sizeof(snr_text), isinf(snr) ? "exact" : "%.1f dB", snr);
+    printf("  %-10s %-6s %7.0f KB  %-8s %8zu frames %s  %7.1f us per s of audio\n", codec,
+           channels == 1 ? "mono" : "stereo", file.size() / 1024.0, snr_text, got.size() / 2,
+           mismatch == 0 && got.size() == expect.size() ? "match" : "DIFFER", best_s * 1e6 / SECONDS);
+    remove(path);
+}
+
+int main(void) {
+    printf("audio_decoder_read() on %d s of %d Hz audio, best of %d decodes from a host file:\n", SECONDS, SAMPLE_RATE,
+           TIMING_RUNS);
+    for (uint16_t channels = 1; channels <= 2; channels++) {
+        const std::vector<int16_t> source = make_source(channels);
+        std::vector<int16_t> reference;
+
+        HOST_CHECK(host_write_wav16("decode_pcm.wav", source.data(), FRAMES, SAMPLE_RATE, channels),
+                   "cannot write decode_pcm.wav");
+        FILE* fp = fopen("decode_pcm.wav", "rb");
+        std::vector<uint8_t> pcm_file;
+        if (fp) {
+            int c;
+            while ((c = fgetc(fp)) != EOF) pcm_file.push_back((uint8_t)c);
+            fclose(fp);
+        }
+        check_fixture("decode_pcm.wav", pcm_file, source, source, channels);
+
+        const std::vector<uint8_t> ima_file = encode_ima(source, channels, &reference);
+        check_fixture("decode_ima.wav", ima_file, source, reference, channels);
+
+        const std::vector<uint8_t> qoa_file = encode_qoa(source, channels, &reference);
+        check_fixture("decode.qoa", qoa_file, source, reference, channels);
+    }
+    return host_test_result();
+}
@@ -0,0 +1,157 @@
+// Test and cycle count of the fused output chain (audio_dsp_chain_process)
+// against the multi-pass output stage it replaced: saturate, LR4 high-pass,
+// visualizer downmix and a float volume multiply taken under a mutex.
+#include "controllers/audio_manager/audio_dsp.h"
+#include "controllers/audio_manager/audio_spectrum.h"
+#include "host_test.h"
+#include <math.h>
+#include <mutex>
+#include <stdlib.h>
+#include <string.h>
+
+#define SAMPLE_RATE 48000
+#define FRAMES 512
+#define BLOCKS 500
+#define REPEATS 40
+#define BARS 16
+#define DELAY (AUDIO_DSP_LIMITER_LOOKAHEAD - 1) // Output lag behind the tap.
+
+static int32_t acc[FRAMES * 2];
+static int16_t out[FRAMES * 2];
+static int16_t tap[FRAMES];
+
+// --- The old output stage ---
+
+static std::mutex volume_mutex;
+static float volume_factor;
+
+static void old_output_stage(audio_dsp_lr4_hpf_t* hpf, bool hpf_on, audio_spectrum_t* spectrum, uint8_t* bars) {
+    for (size_t i = 0; i < FRAMES * 2; i++) {
+        const int32_t v = acc[i];
+        out[i] = (int16_t)(v > 32767 ? 32767 : (v < -32768 ? -32768 : v));
+    }
+    if (hpf_on) audio_dsp_lr4_hpf_process(hpf, out, FRAMES, 2);
+    for (size_t i = 0; i < FRAMES; i++) tap[i] = (int16_t)(((int32_t)out[2 * i] + out[2 * i + 1]) >> 1);
+    audio_spectrum_push(spectrum, tap, FRAMES, bars);
+    float factor;
+    {
+        std::lock_guard<std::mutex> lock(volume_mutex);
+        factor = volume_factor;
+    }
+    if (factor < 0.999f) {
+        for (size_t i = 0; i < FRAMES * 2; i++) out[i] = (int16_t)((float)out[i] * factor);
+    }
+}
+
+// Two tones and noise, at `level` of full scale.
+static void fill_block(double level, uint32_t* seed) {
+    for (int i = 0; i < FRAMES; i++) {
+        acc[2 * i] = (int32_t)(level * (25000 * sin(i * 0.05) + 7000 * host_random(seed)));
+        acc[2 * i + 1] = (int32_t)(level * (25000 * sin(i * 0.031) + 7000 * host_random(seed)));
+    }
+}
+
+// Cycles per frame of both stages, for volumes below and above 50% (the HPF is on above).
+static void benchmark(void) {
+    static audio_spectrum_t spectrum;
+    uint8_t bars[AUDIO_SPECTRUM_MAX_BARS];
+    audio_spectrum_init(&spectrum, SAMPLE_RATE, BARS);
+    uint32_t seed = 1;
+    fill_block(1.0, &seed);
+
+    printf("%s per frame, %d-frame blocks, minimum of %d runs:\n", host_cycles_unit(), FRAMES, REPEATS);
+    for (int volume : { 30, 80 }) {
+        const bool hpf_on = volume >= 50;
+        const uint32_t cutoff = hpf_on ? 60 + (350 - 60) * (volume - 50) / 50 : 0;
+        audio_dsp_lr4_hpf_t hpf;
+        memset(&hpf, 0, sizeof(hpf));
+        if (hpf_on) audio_dsp_lr4_hpf_set_cutoff(&hpf, (float)cutoff, SAMPLE_RATE);
+        volume_factor = volume / 100.0f;
+        static audio_dsp_chain_t chain;
+        audio_dsp_chain_init(&chain, SAMPLE_RATE);
+        audio_dsp_chain_set_hpf_cutoff(&chain, cutoff);
+        audio_dsp_chain_set_gain(&chain, volume * AUDIO_DSP_UNITY_GAIN / 100);
+
+        for (int with_fft = 0; with_fft < 2; with_fft++) {
+            // A hop longer than the run keeps the FFT from running.
+            spectrum.hop = with_fft ? SAMPLE_RATE / AUDIO_SPECTRUM_RATE_HZ : UINT32_MAX;
+            uint64_t best_old = UINT64_MAX, best_fused = UINT64_MAX;
+            for (int r = 0; r < REPEATS; r++) {
+                const uint64_t c0 = host_cycles();
+                for (int b = 0; b < BLOCKS; b++) old_output_stage(&hpf, hpf_on, &spectrum, bars);
+                const uint64_t c1 = host_cycles();
+                for (int b = 0; b < BLOCKS; b++) {
+                    audio_dsp_chain_process(&chain, acc, out, tap, FRAMES);
+                    audio_spectrum_push(&spectrum, tap, FRAMES, bars);
+                }
+                const uint64_t c2 = host_cycles();
+                if (c1 - c0 < best_old) best_old = c1 - c0;
+                if (c2 - c1 < best_fused) best_fused = c2 - c1;
+            }
+            const double n = (double)BLOCKS * FRAMES;
+            printf("  volume %d%%, HPF %-3s, %-11s: old %5.1f | fused (with limiter) %5.1f\n", volume,
+                   hpf_on ? "on" : "off", with_fft ? "with FFT" : "stages only", best_old / n, best_fused / n);
+        }
+    }
+}
+
+// At unity gain and below the limiter threshold, the fused chain must reproduce
+// the old stage bit for bit: the same tap, and the same output DELAY frames later.
+static void check_matches_old_stage(void) {
+    static audio_spectrum_t spectrum;
+    uint8_t bars[AUDIO_SPECTRUM_MAX_BARS];
+    audio_spectrum_init(&spectrum, SAMPLE_RATE, BARS);
+    audio_dsp_lr4_hpf_t hpf;
+    memset(&hpf, 0, sizeof(hpf));
+    audio_dsp_lr4_hpf_set_cutoff(&hpf, 234, SAMPLE_RATE);
+    static audio_dsp_chain_t chain;
+    audio_dsp_chain_init(&chain, SAMPLE_RATE);
+    audio_dsp_chain_set_hpf_cutoff(&chain, 234);
+    volume_factor = 1.0f;
+
+    const int blocks = 50;
+    static int16_t old_out[blocks * FRAMES * 2], fused_out[blocks * FRAMES * 2];
+    int tap_mismatches = 0, out_mismatches = 0;
+    uint32_t seed = 7;
+    for (int b = 0; b < blocks; b++) {
+        fill_block(0.5, &seed);
+        old_output_stage(&hpf, true, &spectrum, bars);
+        int16_t old_tap[FRAMES];
+        memcpy(old_tap, tap, sizeof(tap));
+        memcpy(&old_out[b * FRAMES * 2], out, sizeof(out));
+        audio_dsp_chain_process(&chain, acc, out, tap, FRAMES);
+        memcpy(&fused_out[b * FRAMES * 2], out, sizeof(out));
+        tap_mismatches += memcmp(old_tap, tap, sizeof(tap)) != 0;
+    }
+    for (int i = 0; i < (blocks * FRAMES - DELAY) * 2; i++) out_mismatches += old_out[i] != fused_out[i + DELAY * 2];
+    printf("fused vs old stage: %d tap blocks and %d output samples differ\n", tap_mismatches, out_mismatches);
+    HOST_CHECK(tap_mismatches == 0, "the visualizer tap differs in %d blocks", tap_mismatches);
+    HOST_CHECK(out_mismatches == 0, "%d output samples differ", out_mismatches);
+}
+
+// A volume change is ramped across one block: no step larger than the ramp's.
+static void check_gain_ramp(void) {
+    static audio_dsp_chain_t chain;
+    audio_dsp_chain_init(&chain, SAMPLE_RATE);
+    const int32_t level = 20000;
+    for (int i = 0; i < FRAMES * 2; i++) acc[i] = level;
+    static int16_t ramp[3 * FRAMES * 2];
+    audio_dsp_chain_process(&chain, acc, ramp, NULL, FRAMES);
+    audio_dsp_chain_set_gain(&chain, 0);
+    audio_dsp_chain_process(&chain, acc, ramp + FRAMES * 2, NULL, FRAMES);
+    audio_dsp_chain_process(&chain, acc, ramp + 2 * FRAMES * 2, NULL, FRAMES);
+    // From where the level leaves the limiter's delay line.
+    int max_step = 0;
+    for (int i = DELAY + 1; i < 3 * FRAMES; i++) max_step = std::max(max_step, abs(ramp[2 * i] - ramp[2 * i - 2]));
+    const int allowed = level / FRAMES + 1;
+    printf("gain 100%% -> 0%%: max step %d (one block ramp %d), ends at %d\n", max_step, allowed, ramp[3 * FRAMES * 2 - 2]);
+    HOST_CHECK(max_step <= allowed, "gain step of %d", max_step);
+    HOST_CHECK(ramp[3 * FRAMES * 2 - 2] == 0, "gain did not reach 0");
+}
+
+int main(void) {
+    check_matches_old_stage();
+    check_gain_ramp();
+    benchmark();
+    return host_test_result();
+}
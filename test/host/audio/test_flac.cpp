@@ -0,0 +1,330 @@
+// Round trip of the FLAC encoder (audio_flac.h) through a decoder for the
+// subset it writes: every stream is decoded with its CRCs and frame numbers
+// checked and compared sample for sample with what went in. Covers silence,
+// 0/-1 dither (escaped partitions of width 1), low-level sines, a last frame
+// shorter than a block and block sizes that are not powers of two.
+#include "controllers/audio_manager/audio_flac.h"
+#include "host_test.h"
+#include <math.h>
+#include <string.h>
+#include <vector>
+
+#define SAMPLE_RATE 16000
+
+// --- Decoder ---
+
+struct bit_reader {
+    const uint8_t* data;
+    size_t size;
+    size_t bit;
+    bool overrun;
+};
+
+static uint32_t read_bits(bit_reader* br, uint32_t n) {
+    uint32_t v = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        if (br->bit >= br->size * 8) {
+            br->overrun = true;
+            return 0;
+        }
+        v = (v << 1) | ((br->data[br->bit >> 3] >> (7 - (br->bit & 7))) & 1);
+        br->bit++;
+    }
+    return v;
+}
+
+static int32_t read_signed(bit_reader* br, uint32_t n) {
+    const uint32_t v = read_bits(br, n);
+    return n && (v >> (n - 1)) ? (int32_t)(v - (1ull << n)) : (int32_t)v;
+}
+
+static uint32_t read_unary(bit_reader* br) {
+    uint32_t q = 0;
+    while (!br->overrun && read_bits(br, 1) == 0) q++;
+    return q;
+}
+
+static uint8_t crc8(const uint8_t* p, size_t n) {
+    uint8_t crc = 0;
+    while (n--) {
+        crc ^= *p++;
+        for (int i = 0; i < 8; i++) crc = (uint8_t)(crc & 0x80 ? (crc << 1) ^ 0x07 : crc << 1);
+    }
+    return crc;
+}
+
+static uint16_t crc16(const uint8_t* p, size_t n) {
+    uint16_t crc = 0;
+    while (n--) {
+        crc ^= (uint16_t)(*p++ << 8);
+        for (int i = 0; i < 8; i++) crc = (uint16_t)(crc & 0x8000 ? (crc << 1) ^ 0x8005 : crc << 1);
+    }
+    return crc;
+}
+
+struct decode_stats {
+    uint32_t frames;
+    uint32_t constant, verbatim, fixed; // Subframes by type.
+    uint32_t escaped;                   // Escaped residual partitions.
+};
+
+// Residual of a fixed subframe of order `order`; false if it is malformed.
+static bool read_residual(bit_reader* br, uint32_t block, uint32_t order, int32_t* out, decode_stats* stats) {
+    if (read_bits(br, 2) != 0) return false; // Only 4-bit Rice parameters are written.
+    const uint32_t partition_order = read_bits(br, 4);
+    if ((block >> partition_order) < order || (block >> partition_order << partition_order) != block) return false;
+    for (uint32_t p = 0; p < (1u << partition_order); p++) {
+        const uint32_t count = (block >> partition_order) - (p == 0 ? order : 0);
+        const uint32_t k = read_bits(br, 4);
+        if (k == 15) {
+            stats->escaped++;
+            const uint32_t width = read_bits(br, 5);
+            for (uint32_t i = 0; i < count; i++) *out++ = width ? read_signed(br, width) : 0;
+        } else {
+            for (uint32_t i = 0; i < count; i++) {
+                const uint32_t folded = (read_unary(br) << k) | read_bits(br, k);
+                *out++ = (int32_t)(folded >> 1) ^ -(int32_t)(folded & 1);
+            }
+        }
+    }
+    return !br->overrun;
+}
+
+// Decodes a whole stream into interleaved samples; false (with a message) on the first error.
+static bool decode(const std::vector<uint8_t>& stream, uint32_t rate, uint16_t channels, uint32_t block_frames,
+                   std::vector<int16_t>* pcm, decode_stats* stats) {
+    *stats = {};
+    pcm->clear();
+    const uint8_t* d = stream.data();
+    if (stream.size() < AUDIO_FLAC_STREAM_HEADER_SIZE || memcmp(d, "fLaC", 4) != 0) {
+        fprintf(stderr, "no stream header\n");
+        return false;
+    }
+    bit_reader br = { d, stream.size(), 4 * 8, false };
+    const uint32_t last_and_type = read_bits(&br, 8), length = read_bits(&br, 24);
+    const uint32_t min_block = read_bits(&br, 16), max_block = read_bits(&br, 16);
+    read_bits(&br, 24); // Minimum and maximum frame size.
+    read_bits(&br, 24);
+    const uint32_t info_rate = read_bits(&br, 20), info_channels = read_bits(&br, 3) + 1;
+    const uint32_t bits_per_sample = read_bits(&br, 5) + 1;
+    if (last_and_type != 0x80 || length != 34 || min_block != block_frames || max_block != block_frames ||
+        info_rate != rate || info_channels != channels || bits_per_sample != 16) {
+        fprintf(stderr, "STREAMINFO: blocks %u..%u, %u Hz, %u channels, %u bits\n", min_block, max_block, info_rate,
+                info_channels, bits_per_sample);
+        return false;
+    }
+    br.bit = AUDIO_FLAC_STREAM_HEADER_SIZE * 8;
+
+    std::vector<int32_t> residual(block_frames), samples(block_frames);
+    while (br.bit < stream.size() * 8) {
+        const size_t start = br.bit / 8;
+        if (read_bits(&br, 16) != 0xFFF8) {
+            fprintf(stderr, "frame %u: no sync\n", stats->frames);
+            return false;
+        }
+        const uint32_t size_code = read_bits(&br, 4), rate_code = read_bits(&br, 4);
+        const uint32_t assignment = read_bits(&br, 4), sample_size = read_bits(&br, 3);
+        read_bits(&br, 1);
+        // Frame number, UTF-8 style.
+        uint32_t first = read_bits(&br, 8), extra = 0, number;
+        if (first < 0x80) {
+            number = first;
+        } else {
+            uint32_t mask = 0x40;
+            while (first & mask) {
+                extra++;
+                mask >>= 1;
+            }
+            number = first & (mask - 1);
+            for (uint32_t i = 0; i < extra; i++) number = (number << 6) | (read_bits(&br, 8) & 0x3F);
+        }
+        uint32_t block;
+        if (size_code == 1) block = 192;
+        else if (size_code >= 2 && size_code <= 5) block = 576u << (size_code - 2);
+        else if (size_code == 6) block = read_bits(&br, 8) + 1;
+        else if (size_code == 7) block = read_bits(&br, 16) + 1;
+        else if (size_code >= 8) block = 256u << (size_code - 8);
+        else block = 0;
+        const uint8_t header_crc = (uint8_t)read_bits(&br, 8);
+        if (rate_code != 0 || assignment != channels - 1u || sample_size != 4 || number != stats->frames ||
+            block == 0 || block > block_frames || header_crc != crc8(d + start, br.bit / 8 - 1 - start)) {
+            fprintf(stderr, "frame %u: bad header (number %u, block %u)\n", stats->frames, number, block);
+            return false;
+        }
+
+        const size_t base = pcm->size();
+        pcm->resize(base + (size_t)block * channels);
+        for (uint16_t c = 0; c < channels; c++) {
+            const uint32_t header = read_bits(&br, 8);
+            const uint32_t type = header >> 1;
+            if (header & 0x81) {
+                fprintf(stderr, "frame %u: padding or wasted bits in a subframe header\n", stats->frames);
+                return false;
+            }
+            if (type == 0) {
+                stats->constant++;
+                const int32_t v = read_signed(&br, 16);
+                for (uint32_t i = 0; i < block; i++) samples[i] = v;
+            } else if (type == 1) {
+                stats->verbatim++;
+                for (uint32_t i = 0; i < block; i++) samples[i] = read_signed(&br, 16);
+            } else if (type >= 8 && type <= 12) {
+                stats->fixed++;
+                const uint32_t order = type - 8;
+                for (uint32_t i = 0; i < order; i++) samples[i] = read_signed(&br, 16);
+                if (order > block || !read_residual(&br, block, order, residual.data(), stats)) {
+                    fprintf(stderr, "frame %u: bad residual\n", stats->frames);
+                    return false;
+                }
+                for (uint32_t i = order; i < block; i++) {
+                    const int32_t* x = &samples[i];
+                    const int32_t e = residual[i - order];
+                    switch (order) {
+                    case 0: samples[i] = e; break;
+                    case 1: samples[i] = e + x[-1]; break;
+                    case 2: samples[i] = e + 2 * x[-1] - x[-2]; break;
+                    case 3: samples[i] = e + 3 * x[-1] - 3 * x[-2] + x[-3]; break;
+                    default: samples[i] = e + 4 * x[-1] - 6 * x[-2] + 4 * x[-3] - x[-4]; break;
+                    }
+                }
+            } else {
+                fprintf(stderr, "frame %u: subframe type %u\n", stats->frames, type);
+                return false;
+            }
+            for (uint32_t i = 0; i < block; i++) {
+                if (samples[i] < -32768 || samples[i] > 32767) {
+                    fprintf(stderr, "frame %u: sample %d out of range\n", stats->frames, samples[i]);
+                    return false;
+                }
+                (*pcm)[base + (size_t)i * channels + c] = (int16_t)samples[i];
+            }
+        }
+        br.bit = (br.bit + 7) & ~(size_t)7;
+        const size_t end = br.bit / 8;
+        const uint16_t frame_crc = (uint16_t)read_bits(&br, 16);
+        if (br.overrun || frame_crc != crc16(d + start, end - start)) {
+            fprintf(stderr, "frame %u: bad CRC-16\n", stats->frames);
+            return false;
+        }
+        stats->frames++;
+    }
+    return true;
+}
+
+// --- Round trip ---
+
+static std::vector<uint8_t> encode(const std::vector<int16_t>& pcm, uint16_t channels, uint32_t block_frames) {
+    audio_flac_encoder_t enc = {};
+    std::vector<uint8_t> stream;
+    if (!audio_flac_encoder_init(&enc, SAMPLE_RATE, channels, block_frames)) return stream;
+    stream.resize(AUDIO_FLAC_STREAM_HEADER_SIZE);
+    audio_flac_stream_header(&enc, stream.data());
+    std::vector<uint8_t> frame(audio_flac_max_frame_bytes(&enc, block_frames));
+    const size_t frames = pcm.size() / channels;
+    for (size_t pos = 0; pos < frames; pos += block_frames) {
+        const uint32_t n = (uint32_t)(frames - pos < block_frames ? frames - pos : block_frames);
+        const size_t len = audio_flac_encode_frame(&enc, &pcm[pos * channels], n, frame.data());
+        HOST_CHECK(len > 0 && len <= audio_flac_max_frame_bytes(&enc, n), "frame of %u: %zu bytes", n, len);
+        stream.insert(stream.end(), frame.begin(), frame.begin() + len);
+    }
+    audio_flac_encoder_deinit(&enc);
+    return stream;
+}
+
+// Encodes, decodes and compares; `max_ratio` bounds the size against 16-bit PCM
+// (above 1 for noise: verbatim subframes plus the frame headers).
+static void round_trip(const char* what, const std::vector<int16_t>& pcm, uint16_t channels, uint32_t block_frames,
+                       double max_ratio, decode_stats* out_stats = NULL) {
+    const std::vector<uint8_t> stream = encode(pcm, channels, block_frames);
+    std::vector<int16_t> decoded;
+    decode_stats stats;
+    const bool ok = decode(stream, SAMPLE_RATE, channels, block_frames, &decoded, &stats);
+    const double ratio = (double)stream.size() / (pcm.size() * 2);
+    printf("  %-26s %u ch, block %5u: %6zu frames -> %6zu bytes (%5.1f%%), subframes %u const %u fixed %u verbatim, "
+           "%u escaped partitions\n",
+           what, channels, block_frames, pcm.size() / channels, stream.size(), 100.0 * ratio, stats.constant,
+           stats.fixed, stats.verbatim, stats.escaped);
+    HOST_CHECK(ok, "%s, block %u: the stream does not decode", what, block_frames);
+    size_t mismatch = 0;
+    while (ok && mismatch < pcm.size() && mismatch < decoded.size() && pcm[mismatch] == decoded[mismatch]) mismatch++;
+    HOST_CHECK(!ok || (decoded.size() == pcm.size() && mismatch == pcm.size()),
+               "%s, block %u: %zu of %zu samples back, first difference at %zu (%d decoded as %d)", what, block_frames,
+               decoded.size(), pcm.size(), mismatch, mismatch < pcm.size() ? pcm[mismatch] : 0,
+               mismatch < decoded.size() ? decoded[mismatch] : 0);
+    HOST_CHECK(ratio <= max_ratio, "%s, block %u: %.1f%% of PCM, expected at most %.1f%%", what, block_frames,
+               100.0 * ratio, 100.0 * max_ratio);
+    if (out_stats) *out_stats = stats;
+}
+
+static std::vector<int16_t> sine(size_t frames, uint16_t channels, double amplitude, double freq_hz) {
+    std::vector<int16_t> pcm(frames * channels);
+    for (size_t i = 0; i < frames; i++) {
+        for (uint16_t c = 0; c < channels; c++) {
+            pcm[i * channels + c] = (int16_t)lrint(amplitude * sin(2 * M_PI * freq_hz * (c + 1) * i / SAMPLE_RATE));
+        }
+    }
+    return pcm;
+}
+
+// Samples of 0 and -1 only; `density` is the share of -1.
+static std::vector<int16_t> dither(size_t frames, uint16_t channels, double density, uint32_t seed) {
+    std::vector<int16_t> pcm(frames * channels);
+    for (int16_t& s : pcm) s = (host_random(&seed) + 1) / 2 < density ? -1 : 0;
+    return pcm;
+}
+
+static std::vector<int16_t> noise(size_t frames, uint16_t channels, double amplitude, uint32_t seed) {
+    std::vector<int16_t> pcm(frames * channels);
+    for (int16_t& s : pcm) s = (int16_t)lrint(amplitude * host_random(&seed));
+    return pcm;
+}
+
+int main() {
+    static const uint32_t BLOCKS[] = { 100, 1000, 4095, 4096 };
+
+    printf("Silence:\n");
+    for (uint16_t channels : { 1, 2 }) {
+        round_trip("silence", std::vector<int16_t>(16000 * channels, 0), channels, 4096, 0.01);
+    }
+
+    printf("0/-1 dither (escaped partitions of width 1):\n");
+    for (uint32_t block : BLOCKS) {
+        for (uint16_t channels : { 1, 2 }) {
+            decode_stats stats;
+            round_trip("dither, half -1", dither(16000 + 37, channels, 0.5, 7 + block), channels, block, 0.16,
+                       &stats);
+            HOST_CHECK(stats.escaped > 0, "dither, block %u: no escaped partitions", block);
+        }
+        round_trip("dither, sparse -1", dither(16000, 1, 0.02, 11 + block), 1, block, 0.16);
+    }
+
+    printf("Low-level sines:\n");
+    round_trip("30 LSB sine", sine(16000, 1, 30, 440), 1, 100, 0.25);
+    for (double amplitude : { 1.0, 2.0, 3.0, 30.0, 300.0 }) {
+        for (uint32_t block : BLOCKS) {
+            char what[40];
+            snprintf(what, sizeof(what), "%g LSB sine", amplitude);
+            round_trip(what, sine(16000 + 1, 2, amplitude, 440), 2, block, 0.30);
+        }
+    }
+
+    printf("Loud material (fixed and verbatim subframes):\n");
+    for (uint32_t block : BLOCKS) {
+        round_trip("full-scale sine", sine(16000, 2, 32767, 1000), 2, block, 0.90);
+        round_trip("full-scale noise", noise(16000, 1, 32767, 3 + block), 1, block, 1.06);
+    }
+
+    printf("Last frame shorter than a block:\n");
+    for (size_t extra : { 1, 3, 5, 15, 17, 4095 }) {
+        char what[40];
+        snprintf(what, sizeof(what), "sine + %zu frames", extra);
+        round_trip(what, sine(2 * 4096 + extra, 1, 1000, 300), 1, 4096, 0.25);
+    }
+
+    printf("Other block sizes:\n");
+    for (uint32_t block : { 16, 192, 576, 1152, 4608, 65535 }) {
+        round_trip("300 LSB sine", sine(3 * block + 7, 2, 300, 250), 2, block, 0.90);
+    }
+
+    return host_test_result();
+}
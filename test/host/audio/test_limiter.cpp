@@ -0,0 +1,148 @@
+// THD+N, peak and cost test of the look-ahead limiter at the end of the output
+// chain (audio_dsp_chain_process), against hard clipping at 16-bit full scale.
+#include "controllers/audio_manager/audio_dsp.h"
+#include "host_test.h"
+#include <math.h>
+#include <stdlib.h>
+#include <vector>
+
+#define SAMPLE_RATE 48000
+#define FRAMES 512
+#define BLOCKS (SAMPLE_RATE / FRAMES) // About a second.
+#define DELAY (AUDIO_DSP_LIMITER_LOOKAHEAD - 1)
+#define THRESHOLD_DBFS -1.0f
+#define RELEASE_MS 60
+#define REPEATS 40
+
+// The limiter's distortion must stay this far below the signal at any input level.
+#define MAX_LIMITER_THDN_DB -90.0
+// Hard clipping at +6 dBFS, for contrast, is no better than this.
+#define MIN_CLIP_THDN_DB_AT_6DB -20.0
+
+static void init_chain(audio_dsp_chain_t* chain) {
+    audio_dsp_chain_init(chain, SAMPLE_RATE);
+    audio_dsp_chain_set_limiter(chain, THRESHOLD_DBFS, RELEASE_MS);
+}
+
+// A second of a sine at `level_db` relative to full scale through the limiter, and hard clipped.
+static void run_sine(double freq_hz, double level_db) {
+    static audio_dsp_chain_t chain;
+    init_chain(&chain);
+    std::vector<int16_t> limited(BLOCKS * FRAMES), clipped(BLOCKS * FRAMES);
+    int32_t acc[FRAMES * 2];
+    int16_t out[FRAMES * 2];
+    const double amplitude = 32767.0 * pow(10, level_db / 20);
+    for (int b = 0; b < BLOCKS; b++) {
+        for (int i = 0; i < FRAMES; i++) {
+            const int32_t v = (int32_t)lrint(amplitude * sin(2 * M_PI * freq_hz * (b * FRAMES + i) / SAMPLE_RATE));
+            acc[2 * i] = acc[2 * i + 1] = v;
+            clipped[b * FRAMES + i] = (int16_t)(v > 32767 ? 32767 : (v < -32768 ? -32768 : v));
+        }
+        audio_dsp_chain_process(&chain, acc, out, NULL, FRAMES);
+        for (int i = 0; i < FRAMES; i++) limited[b * FRAMES + i] = out[2 * i];
+    }
+    // A quarter second from the middle, once the limiter has settled. The
+    // limited signal is DELAY frames late, which the sine fit does not mind.
+    const size_t start = SAMPLE_RATE / 2, n = SAMPLE_RATE / 4;
+    const double clip_db = -host_sine_fit_snr_db(&clipped[start], n, 1, freq_hz, SAMPLE_RATE);
+    const double lim_db = -host_sine_fit_snr_db(&limited[start], n, 1, freq_hz, SAMPLE_RATE);
+    printf("  %6.0f Hz %+4.1f dBFS: hard clip %6.1f dB | limiter %6.1f dB\n", freq_hz, level_db, clip_db, lim_db);
+    HOST_CHECK(lim_db <= MAX_LIMITER_THDN_DB, "%.0f Hz at %+.1f dBFS: limiter THD+N %.1f dB", freq_hz, level_db, lim_db);
+    if (level_db >= 6.0) {
+        HOST_CHECK(clip_db >= MIN_CLIP_THDN_DB_AT_6DB, "%.0f Hz: hard clip THD+N only %.1f dB", freq_hz, clip_db);
+    }
+    if (amplitude * 1.01 < 32767.0 * pow(10, THRESHOLD_DBFS / 20)) {
+        // Below the threshold the limiter only delays the signal.
+        int differ = 0;
+        for (size_t i = DELAY; i < limited.size(); i++) differ += limited[i] != clipped[i - DELAY];
+        HOST_CHECK(differ == 0, "%.0f Hz at %+.1f dBFS: %d samples changed below the threshold", freq_hz, level_db, differ);
+    }
+}
+
+// Random full-scale +6 dB spikes over a signal: no output sample may pass the threshold.
+static void check_spikes(void) {
+    static audio_dsp_chain_t chain;
+    init_chain(&chain);
+    const int threshold = (int)lrintf(32767 * powf(10, THRESHOLD_DBFS / 20));
+    int32_t acc[FRAMES * 2];
+    int16_t out[FRAMES * 2];
+    int peak = 0;
+    srand(1);
+    for (int b = 0; b < 40; b++) {
+        for (int i = 0; i < FRAMES * 2; i++) {
+            const int32_t spike = (rand() % 100 < 2) ? ((rand() & 1) ? 65535 : -65535) : 0;
+            acc[i] = (b < 20) ? 0 : spike + ((b >= 30) ? 20000 : 0);
+        }
+        audio_dsp_chain_process(&chain, acc, out, NULL, FRAMES);
+        for (int i = 0; i < FRAMES * 2; i++) peak = std::max(peak, abs(out[i]));
+    }
+    printf("Random +6 dB spikes: output peak %d, threshold %d\n", peak, threshold);
+    HOST_CHECK(peak <= threshold, "peak %d over the threshold %d", peak, threshold);
+    HOST_CHECK(peak >= threshold - 1, "spikes only reached %d, limiting too hard", peak);
+}
+
+// What the mixer does when it goes idle: one look-ahead of silence plays out
+// every frame of the sound that is still in the delay line.
+static void check_drain(void) {
+    static audio_dsp_chain_t chain;
+    init_chain(&chain);
+    int32_t acc[FRAMES * 2];
+    int16_t out[(FRAMES + AUDIO_DSP_LIMITER_LOOKAHEAD) * 2];
+    for (int i = 0; i < FRAMES * 2; i++) acc[i] = 10000 + i;
+    audio_dsp_chain_process(&chain, acc, out, NULL, FRAMES);
+    int32_t silence[AUDIO_DSP_LIMITER_LOOKAHEAD * 2] = {};
+    audio_dsp_chain_process(&chain, silence, out + FRAMES * 2, NULL, AUDIO_DSP_LIMITER_LOOKAHEAD);
+    int lost = 0;
+    for (int i = 0; i < FRAMES * 2; i++) lost += out[i + DELAY * 2] != acc[i];
+    printf("Drain: %d of %d samples not played out\n", lost, FRAMES * 2);
+    HOST_CHECK(lost == 0, "%d samples left in the look-ahead", lost);
+}
+
+// Cycles per block of the chain, and of a hard-clipping gain stage for scale.
+static void benchmark(void) {
+    static int32_t acc[FRAMES * 2];
+    static int16_t out[FRAMES * 2], tap[FRAMES];
+    uint32_t seed = 1;
+    for (int i = 0; i < FRAMES * 2; i++) acc[i] = (int32_t)(30000 * sin(i * 0.01) + 10000 * host_random(&seed));
+
+    uint64_t best_clip = UINT64_MAX;
+    for (int r = 0; r < REPEATS; r++) {
+        const uint64_t c0 = host_cycles();
+        for (int b = 0; b < BLOCKS; b++) {
+            for (int i = 0; i < FRAMES * 2; i++) {
+                const int32_t v = (acc[i] * 30000) >> 15;
+                out[i] = (int16_t)(v > 32767 ? 32767 : (v < -32768 ? -32768 : v));
+            }
+            asm volatile("" : : "r"(out) : "memory");
+        }
+        best_clip = std::min(best_clip, host_cycles() - c0);
+    }
+    printf("%s per %d-frame block, minimum of %d runs:\n  hard-clipping gain stage: %.0f\n", host_cycles_unit(),
+           FRAMES, REPEATS, (double)best_clip / BLOCKS);
+
+    for (uint32_t cutoff : { 0u, 200u }) {
+        static audio_dsp_chain_t chain;
+        init_chain(&chain);
+        audio_dsp_chain_set_hpf_cutoff(&chain, cutoff);
+        audio_dsp_chain_set_gain(&chain, 30000);
+        uint64_t best = UINT64_MAX;
+        for (int r = 0; r < REPEATS; r++) {
+            const uint64_t c0 = host_cycles();
+            for (int b = 0; b < BLOCKS; b++) audio_dsp_chain_process(&chain, acc, out, tap, FRAMES);
+            best = std::min(best, host_cycles() - c0);
+        }
+        printf("  chain with limiter, HPF %-3s: %.0f (%.1f per frame)\n", cutoff ? "on" : "off", (double)best / BLOCKS,
+               (double)best / BLOCKS / FRAMES);
+    }
+}
+
+int main(void) {
+    printf("THD+N, unity gain, HPF off, limiter %.0f dBFS / %d ms:\n", THRESHOLD_DBFS, RELEASE_MS);
+    for (double freq : { 100.0, 1000.0 }) {
+        for (double level : { -6.0, -1.5, 0.0, 3.0, 6.0 }) run_sine(freq, level);
+    }
+    check_spikes();
+    check_drain();
+    benchmark();
+    return host_test_result();
+}
@@ -0,0 +1,155 @@
+// Golden-output test and benchmark of the fixed-point LR4 high-pass
+// (audio_dsp_lr4_hpf_process) against an ideal double-precision filter and
+// the float implementation it replaced.
+#include "controllers/audio_manager/audio_dsp.h"
+#include "host_test.h"
+#include <math.h>
+#include <string.h>
+#include <vector>
+
+#define SAMPLE_RATE 44100
+#define SECONDS 10
+#define FRAMES (SAMPLE_RATE * SECONDS)
+#define BLOCK_FRAMES 512
+
+// Bounds against the double reference, in LSB, over samples the reference does not clip.
+#define MAX_ERROR_LSB 1.0
+#define RMS_ERROR_LSB 0.35
+
+static const double Q_VALUES[AUDIO_DSP_LR4_STAGES] = { 0.541196, 1.306563 };
+
+// --- The float filter of the original audio_manager.cpp, as it was ---
+
+typedef struct { float b0, b1, b2, a1, a2; } float_coeffs_t;
+typedef struct { float x1, x2, y1, y2; } float_state_t;
+
+static void float_design(float_coeffs_t* c, float cutoff_freq, float sample_rate) {
+    for (int i = 0; i < AUDIO_DSP_LR4_STAGES; i++) {
+        const float q = (float)Q_VALUES[i];
+        const float omega = 2.0f * M_PI * cutoff_freq / sample_rate;
+        const float cos_omega = cosf(omega);
+        const float alpha = sinf(omega) / (2.0f * q);
+        const float a0_inv = 1.0f / (1.0f + alpha);
+        c[i].b0 = ((1.0f + cos_omega) / 2.0f) * a0_inv;
+        c[i].b1 = (-(1.0f + cos_omega)) * a0_inv;
+        c[i].b2 = ((1.0f + cos_omega) / 2.0f) * a0_inv;
+        c[i].a1 = (-2.0f * cos_omega) * a0_inv;
+        c[i].a2 = (1.0f - alpha) * a0_inv;
+    }
+}
+
+static int16_t float_apply(float_state_t* state, const float_coeffs_t* coeffs, int16_t input) {
+    float result = coeffs->b0 * input + coeffs->b1 * state->x1 + coeffs->b2 * state->x2 -
+                   coeffs->a1 * state->y1 - coeffs->a2 * state->y2;
+    state->x2 = state->x1;
+    state->x1 = input;
+    state->y2 = state->y1;
+    state->y1 = result;
+    if (result > 32767.0f) result = 32767.0f;
+    if (result < -32768.0f) result = -32768.0f;
+    return (int16_t)result;
+}
+
+// --- Ideal reference: double precision, no quantization between the stages ---
+
+struct double_biquad {
+    double b0, b1, b2, a1, a2;
+    double x1 = 0, x2 = 0, y1 = 0, y2 = 0;
+
+    double step(double x) {
+        const double y = b0 * x + b1 * x1 + b2 * x2 - a1 * y1 - a2 * y2;
+        x2 = x1; x1 = x;
+        y2 = y1; y1 = y;
+        return y;
+    }
+};
+
+static void double_design(double_biquad* stages, double cutoff, double rate) {
+    for (int i = 0; i < AUDIO_DSP_LR4_STAGES; i++) {
+        const double w = 2.0 * M_PI * cutoff / rate, co = cos(w), alpha = sin(w) / (2.0 * Q_VALUES[i]);
+        const double a0_inv = 1.0 / (1.0 + alpha);
+        stages[i] = { (1 + co) / 2 * a0_inv, -(1 + co) * a0_inv, (1 + co) / 2 * a0_inv, -2 * co * a0_inv, (1 - alpha) * a0_inv };
+    }
+}
+
+// Stereo programme: log sweep 20 Hz-20 kHz, white noise and a 110 Hz square, the
+// right channel inverted and quieter, at `left_level` and `right_level` of full scale.
+static std::vector<int16_t> make_input(double left_level, double right_level) {
+    std::vector<int16_t> in(FRAMES * 2);
+    uint32_t seed = 1;
+    for (int i = 0; i < FRAMES; i++) {
+        const double t = (double)i / SAMPLE_RATE;
+        const double sweep = sin(2 * M_PI * 20 * SECONDS / log(1000.0) * (pow(1000.0, t / SECONDS) - 1));
+        const double v = 0.5 * sweep + 0.2 * host_random(&seed) + 0.2 * (((i / 200) & 1) ? 1 : -1);
+        in[2 * i] = (int16_t)lrint(v * 32767 * left_level);
+        in[2 * i + 1] = (int16_t)lrint(-v * 32767 * right_level);
+    }
+    return in;
+}
+
+// Filters `in` with the three implementations and checks the fixed-point error bounds.
+static void run(const char* name, const std::vector<int16_t>& in, float cutoff) {
+    // Float baseline, one sample at a time as the old playback loop did.
+    float_coeffs_t fc[AUDIO_DSP_LR4_STAGES];
+    float_design(fc, cutoff, SAMPLE_RATE);
+    float_state_t fs[2][AUDIO_DSP_LR4_STAGES] = {};
+    std::vector<int16_t> old_out = in;
+    double t0 = host_now_s();
+    for (int i = 0; i < FRAMES * 2; i++) {
+        float_state_t* s = fs[i & 1];
+        old_out[i] = float_apply(&s[1], &fc[1], float_apply(&s[0], &fc[0], old_out[i]));
+    }
+    const double float_s = host_now_s() - t0;
+
+    // Fixed point, in playback-sized blocks.
+    audio_dsp_lr4_hpf_t hpf;
+    memset(&hpf, 0, sizeof(hpf));
+    audio_dsp_lr4_hpf_set_cutoff(&hpf, cutoff, SAMPLE_RATE);
+    std::vector<int16_t> out = in;
+    t0 = host_now_s();
+    for (int off = 0; off < FRAMES; off += BLOCK_FRAMES) {
+        const int n = (FRAMES - off < BLOCK_FRAMES) ? FRAMES - off : BLOCK_FRAMES;
+        audio_dsp_lr4_hpf_process(&hpf, &out[2 * off], n, 2);
+    }
+    const double fixed_s = host_now_s() - t0;
+
+    double_biquad ref[2][AUDIO_DSP_LR4_STAGES];
+    double_design(ref[0], cutoff, SAMPLE_RATE);
+    double_design(ref[1], cutoff, SAMPLE_RATE);
+    double max_fixed = 0, max_float = 0, sum_fixed = 0;
+    long compared = 0, clipped = 0;
+    for (int i = 0; i < FRAMES * 2; i++) {
+        double_biquad* r = ref[i & 1];
+        const double y = r[1].step(r[0].step(in[i]));
+        if (y > 32767.0 || y < -32768.0) {
+            clipped++;
+            continue;
+        }
+        const double e_fixed = fabs(out[i] - y), e_float = fabs(old_out[i] - y);
+        max_fixed = fmax(max_fixed, e_fixed);
+        max_float = fmax(max_float, e_float);
+        sum_fixed += e_fixed * e_fixed;
+        compared++;
+    }
+    const double rms_fixed = sqrt(sum_fixed / compared);
+
+    printf("%s, fc=%3.0f Hz: fixed vs ideal max %.2f LSB rms %.3f LSB | float vs ideal max %.0f LSB | "
+           "%ld clipped samples skipped | ms per audio second: fixed %.3f, float %.3f\n",
+           name, cutoff, max_fixed, rms_fixed, max_float, clipped, fixed_s * 1e3 / SECONDS, float_s * 1e3 / SECONDS);
+    HOST_CHECK(max_fixed <= MAX_ERROR_LSB, "%s, fc=%.0f: max error %.3f LSB", name, cutoff, max_fixed);
+    HOST_CHECK(rms_fixed <= RMS_ERROR_LSB, "%s, fc=%.0f: rms error %.3f LSB", name, cutoff, rms_fixed);
+    HOST_CHECK(max_fixed < max_float, "%s, fc=%.0f: no better than the float code (%.2f vs %.2f LSB)", name, cutoff,
+               max_fixed, max_float);
+}
+
+int main(void) {
+    // Moderate level: the float code's error is its rounding. Near full scale:
+    // the float code also clamps between its stages, where the signal overshoots.
+    const std::vector<int16_t> moderate = make_input(0.4, 0.3);
+    const std::vector<int16_t> loud = make_input(0.98, 0.7);
+    for (float cutoff : { 60.0f, 150.0f, 350.0f }) {
+        run("moderate", moderate, cutoff);
+        run("near full scale", loud, cutoff);
+    }
+    return host_test_result();
+}
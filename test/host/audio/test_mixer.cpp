@@ -0,0 +1,126 @@
+// Exactness test and benchmark of the mixer block kernels (audio_mixer.h) with
+// 2, 4 and 8 voices: one ramped background voice plus constant-gain effects.
+#include "controllers/audio_manager/audio_mixer.h"
+#include "host_test.h"
+#include <math.h>
+#include <string.h>
+#include <vector>
+
+#define SAMPLE_RATE 44100
+#define SECONDS 10
+#define FRAMES (SAMPLE_RATE * SECONDS)
+#define BLOCK_FRAMES 512
+#define REPEATS 5
+
+// A whole second of audio may cost at most this share of real time with 8 voices
+// (the board mixes at a few percent; the host should be far below).
+#define MAX_REALTIME_SHARE 0.02
+
+#define DUCKED_GAIN_Q15 9830 // 30%
+#define EFFECT_GAIN_Q15 16384
+
+struct clip {
+    std::vector<uint8_t> data;
+    audio_wav_info_t format;
+};
+
+// A sine clip, alternately 16-bit stereo, 16-bit mono and 24-bit stereo so the
+// conversion paths are all exercised.
+static clip make_clip(int index) {
+    static const uint16_t channels[3] = { 2, 1, 2 }, bits[3] = { 16, 16, 24 };
+    clip c;
+    const uint16_t ch = channels[index % 3], b = bits[index % 3], bytes = b / 8;
+    c.format = { 1, ch, SAMPLE_RATE, (uint32_t)(SAMPLE_RATE * ch * bytes), (uint16_t)(ch * bytes), b,
+                 (uint32_t)(FRAMES * ch * bytes) };
+    c.data.resize(c.format.data_size);
+    uint8_t* p = c.data.data();
+    for (int i = 0; i < FRAMES * ch; i++) {
+        const int32_t v = (int32_t)(20000 * sin(0.01 * (index + 1) * i)) << (b - 16);
+        for (int k = 0; k < bytes; k++) *p++ = (uint8_t)(v >> (8 * k));
+    }
+    return c;
+}
+
+static void saturate(const int32_t* acc, int16_t* out, size_t samples) {
+    for (size_t i = 0; i < samples; i++) {
+        const int32_t v = acc[i];
+        out[i] = (int16_t)(v > INT16_MAX ? INT16_MAX : (v < INT16_MIN ? INT16_MIN : v));
+    }
+}
+
+// Mixes every block of `voices` clips; returns the checksum of the output.
+static uint64_t mix(const std::vector<clip>& clips, int voices) {
+    std::vector<audio_mixer_voice_t> v(voices);
+    for (int i = 0; i < voices; i++) {
+        audio_mixer_voice_start(&v[i], clips[i].data.data(), &clips[i].format, i == 0 ? AUDIO_MIXER_UNITY_GAIN : EFFECT_GAIN_Q15);
+    }
+    int32_t acc[BLOCK_FRAMES * AUDIO_MIXER_CHANNELS];
+    int16_t voice[BLOCK_FRAMES * AUDIO_MIXER_CHANNELS], out[BLOCK_FRAMES * AUDIO_MIXER_CHANNELS];
+    uint64_t checksum = 0;
+    int32_t gain = AUDIO_MIXER_UNITY_GAIN;
+    while (v[0].active) {
+        memset(acc, 0, sizeof(acc));
+        const size_t frames = audio_mixer_voice_render(&v[0], voice, BLOCK_FRAMES);
+        // Duck and recover every block, as while effects start and stop.
+        const int32_t next = (gain == AUDIO_MIXER_UNITY_GAIN) ? DUCKED_GAIN_Q15 : AUDIO_MIXER_UNITY_GAIN;
+        audio_mixer_accumulate_ramp(acc, voice, frames, gain, next);
+        gain = next;
+        for (int i = 1; i < voices; i++) {
+            const size_t n = audio_mixer_voice_render(&v[i], voice, BLOCK_FRAMES);
+            audio_mixer_accumulate(acc, voice, n * AUDIO_MIXER_CHANNELS, v[i].gain_q15);
+        }
+        saturate(acc, out, frames * AUDIO_MIXER_CHANNELS);
+        for (size_t i = 0; i < frames * AUDIO_MIXER_CHANNELS; i++) checksum = checksum * 31 + (uint16_t)out[i];
+    }
+    return checksum;
+}
+
+// The same mix, one sample at a time from the clip bytes.
+static uint64_t mix_reference(const std::vector<clip>& clips, int voices) {
+    uint64_t checksum = 0;
+    int32_t gain = AUDIO_MIXER_UNITY_GAIN;
+    for (int block = 0; block * BLOCK_FRAMES < FRAMES; block++) {
+        const int frames = (FRAMES - block * BLOCK_FRAMES < BLOCK_FRAMES) ? FRAMES - block * BLOCK_FRAMES : BLOCK_FRAMES;
+        const int32_t next = (gain == AUDIO_MIXER_UNITY_GAIN) ? DUCKED_GAIN_Q15 : AUDIO_MIXER_UNITY_GAIN;
+        const int32_t step_q23 = ((next - gain) << 8) / frames;
+        for (int f = 0; f < frames; f++) {
+            for (int ch = 0; ch < AUDIO_MIXER_CHANNELS; ch++) {
+                int32_t sum = 0;
+                for (int i = 0; i < voices; i++) {
+                    const audio_wav_info_t& fmt = clips[i].format;
+                    const int bytes = fmt.bits_per_sample / 8;
+                    const int c = (fmt.num_channels == 2) ? ch : 0;
+                    const uint8_t* p = clips[i].data.data() + (size_t)(block * BLOCK_FRAMES + f) * fmt.block_align + c * bytes;
+                    const int16_t s = (int16_t)(p[bytes - 2] | (p[bytes - 1] << 8));
+                    const int32_t g = (i == 0) ? ((gain << 8) + f * step_q23) >> 8 : EFFECT_GAIN_Q15;
+                    sum += (s * g) >> 15;
+                }
+                const int16_t out = (int16_t)(sum > INT16_MAX ? INT16_MAX : (sum < INT16_MIN ? INT16_MIN : sum));
+                checksum = checksum * 31 + (uint16_t)out;
+            }
+        }
+        gain = next;
+    }
+    return checksum;
+}
+
+int main(void) {
+    std::vector<clip> clips;
+    for (int i = 0; i < 8; i++) clips.push_back(make_clip(i));
+
+    for (int voices : { 2, 4, 8 }) {
+        const uint64_t expected = mix_reference(clips, voices);
+        double best = 1e9;
+        uint64_t checksum = 0;
+        for (int r = 0; r < REPEATS; r++) {
+            const double t0 = host_now_s();
+            checksum = mix(clips, voices);
+            best = fmin(best, host_now_s() - t0);
+        }
+        const double share = best / SECONDS;
+        printf("%d voices: %.3f ms per second of audio (%.4f%% of real time)\n", voices, share * 1e3, share * 100);
+        HOST_CHECK(checksum == expected, "%d voices: output differs from the sample-by-sample mix", voices);
+        HOST_CHECK(share < MAX_REALTIME_SHARE, "%d voices: %.2f%% of real time", voices, share * 100);
+    }
+    return host_test_result();
+}
@@ -0,0 +1,126 @@
+// Quality and throughput test of the polyphase resampler (audio_resampler.h)
+// for the source rates played back on the 48 kHz bus.
+#include "controllers/audio_manager/audio_resampler.h"
+#include "host_test.h"
+#include <math.h>
+#include <vector>
+
+#define OUT_RATE 48000
+#define SECONDS 5
+#define CHUNK_FRAMES 1024 // Frames handed to the resampler per call, like a reader chunk.
+#define TONE_AMPLITUDE 16000
+
+// Cost of a second of audio, as a share of real time, not to be exceeded on the host.
+#define MAX_REALTIME_SHARE 0.02
+
+// The flushed tail may add up to half a subfilter of input frames to in * 48000 / rate.
+#define MAX_EXTRA_INPUT_FRAMES (AUDIO_RESAMPLER_TAPS / 2)
+
+struct rate_case {
+    uint32_t rate;
+    double min_snr_1k_db;      //!< THD+N (as SNR) of a 1 kHz tone.
+    double min_snr_high_db;    //!< THD+N of a tone at 0.4 * rate.
+};
+
+// The figures quoted when the resampler went in, rounded down to the dB.
+static const rate_case CASES[] = {
+    { 8000, 85.0, 81.0 },
+    { 11025, 82.0, 78.0 },
+    { 16000, 83.0, 76.0 },
+    { 22050, 80.0, 78.0 },
+    { 32000, 85.0, 76.0 },
+    { 44100, 83.0, 78.0 },
+};
+
+// Stopband: the image of the 0.4 * rate tone (at 0.6 * rate, folded below 24 kHz)
+// must be this far below the tone.
+#define MIN_IMAGE_REJECTION_DB 77.0
+
+// Amplitude of the component of `x` (left channel) at `freq_hz` (least-squares fit).
+static double tone_amplitude(const int16_t* x, size_t frames, double freq_hz) {
+    double ss = 0, cc = 0, sc = 0, ys = 0, yc = 0;
+    const double w = 2.0 * M_PI * freq_hz / OUT_RATE;
+    for (size_t i = 0; i < frames; i++) {
+        const double s = sin(w * i), c = cos(w * i), y = x[2 * i];
+        ss += s * s; cc += c * c; sc += s * c; ys += y * s; yc += y * c;
+    }
+    const double det = ss * cc - sc * sc;
+    const double a = (ys * cc - yc * sc) / det, b = (yc * ss - ys * sc) / det;
+    return sqrt(a * a + b * b);
+}
+
+// Where the first image of a tone at `freq_hz` sampled at `rate` lands on the bus
+// (folded back below the output Nyquist frequency if it is above it).
+static double image_frequency(double freq_hz, uint32_t rate) {
+    double f = rate - freq_hz;
+    if (f > OUT_RATE / 2) f = OUT_RATE - f;
+    return f;
+}
+
+// Resamples a stereo tone in reader-sized chunks, then flushes.
+static std::vector<int16_t> resample(audio_resampler_t* rs, const std::vector<int16_t>& in, double* seconds) {
+    const size_t in_frames = in.size() / 2;
+    std::vector<int16_t> out((audio_resampler_max_output(rs, in_frames) + AUDIO_RESAMPLER_TAPS) * 2);
+    size_t pos = 0, produced = 0;
+    const double t0 = host_now_s();
+    while (pos < in_frames) {
+        size_t chunk = (in_frames - pos < CHUNK_FRAMES) ? in_frames - pos : CHUNK_FRAMES;
+        while (chunk) {
+            size_t used = 0;
+            produced += audio_resampler_process(rs, &in[pos * 2], chunk, &out[produced * 2], out.size() / 2 - produced, &used);
+            pos += used;
+            chunk -= used;
+        }
+    }
+    produced += audio_resampler_flush(rs, &out[produced * 2], out.size() / 2 - produced);
+    *seconds = host_now_s() - t0;
+    out.resize(produced * 2);
+    return out;
+}
+
+int main(void) {
+    printf("in rate  THD+N @1 kHz  THD+N @0.4*fs  image rejection  out frames  ms per audio second\n");
+    for (const rate_case& c : CASES) {
+        audio_resampler_t rs = {};
+        HOST_CHECK(audio_resampler_configure(&rs, c.rate, OUT_RATE), "%lu: configure failed", (unsigned long)c.rate);
+
+        double snr[2] = {}, image_rej = 0, seconds = 0;
+        size_t out_frames = 0;
+        const double freqs[2] = { 1000.0, 0.4 * c.rate };
+        for (int k = 0; k < 2; k++) {
+            std::vector<int16_t> in(c.rate * SECONDS * 2);
+            for (size_t i = 0; i < in.size() / 2; i++) {
+                in[2 * i] = in[2 * i + 1] = (int16_t)lrint(TONE_AMPLITUDE * sin(2 * M_PI * freqs[k] * i / c.rate));
+            }
+            double t = 0;
+            const std::vector<int16_t> out = resample(&rs, in, &t);
+            audio_resampler_reset(&rs);
+
+            // Two seconds from the middle, clear of the start-up and the flushed tail.
+            const int16_t* mid = &out[(OUT_RATE / 2) * 2];
+            snr[k] = host_sine_fit_snr_db(mid, OUT_RATE * 2, 2, freqs[k], OUT_RATE);
+            if (k == 0) {
+                out_frames = out.size() / 2;
+                seconds = t;
+            } else {
+                const double signal = tone_amplitude(mid, OUT_RATE * 2, freqs[k]);
+                const double image = tone_amplitude(mid, OUT_RATE * 2, image_frequency(freqs[k], c.rate));
+                image_rej = 20 * log10(signal / fmax(image, 1e-9));
+            }
+        }
+        audio_resampler_deinit(&rs);
+
+        const double expected_frames = (double)SECONDS * OUT_RATE;
+        const double max_extra = ceil((double)MAX_EXTRA_INPUT_FRAMES * OUT_RATE / c.rate);
+        const double share = seconds / SECONDS;
+        printf("%7lu  %9.1f dB  %10.1f dB  %12.1f dB  %10zu  %10.3f\n", (unsigned long)c.rate, snr[0], snr[1],
+               image_rej, out_frames, share * 1e3);
+        HOST_CHECK(snr[0] >= c.min_snr_1k_db, "%lu: THD+N @1 kHz %.1f dB", (unsigned long)c.rate, snr[0]);
+        HOST_CHECK(snr[1] >= c.min_snr_high_db, "%lu: THD+N @0.4*fs %.1f dB", (unsigned long)c.rate, snr[1]);
+        HOST_CHECK(image_rej >= MIN_IMAGE_REJECTION_DB, "%lu: image rejection %.1f dB", (unsigned long)c.rate, image_rej);
+        HOST_CHECK(out_frames >= expected_frames && out_frames <= expected_frames + max_extra,
+                   "%lu: %zu frames out, %.0f expected", (unsigned long)c.rate, out_frames, expected_frames);
+        HOST_CHECK(share < MAX_REALTIME_SHARE, "%lu: %.2f%% of real time", (unsigned long)c.rate, share * 100);
+    }
+    return host_test_result();
+}
@@ -0,0 +1,199 @@
+#!/usr/bin/env python3
+"""Local HTTPS server for the HTTPS client tests.
+
+TLS 1.2 at most, with session tickets, and HTTP/1.1 keep-alive, like the
+servers the device talks to. Connections idle for longer than --idle-s are
+closed by the server.
+
+GET:
+  /weather    JSON with a Content-Length
+  /chunked    JSON with a chunked body (chunk extensions and a trailer included)
+  /close      answers with "Connection: close" and closes
+  /drop-next  answers, then drops the next request on the same connection unanswered
+POST /openai/v1/audio/transcriptions: stand-in for the speech-to-text API.
+  Takes the multipart upload stt_manager sends (a WAV or a FLAC file, with a
+  Content-Length or chunked), waits --infer-ms, and answers {"text": ...}
+  describing what it received, e.g. for a streamed recording
+  "ok=1 fmt=wav ch=1 rate=16000 audio=<data bytes> header_size=max chunked=1 chunks=<n>".
+POST (any other path): answers {"received": <body bytes>, "chunks": <chunks>}.
+
+Every JSON answer also carries "conn" (connections accepted so far) and
+"served_on_conn" (requests answered on this connection, this one included).
+
+  server.py --cert C --key K [--idle-s S] [--infer-ms M] [--port P]
+      serves until interrupted;
+  server.py --cert C --key K [--idle-s S] [--infer-ms M] -- COMMAND...
+      serves on a free port while COMMAND runs, with HOST_TLS_PORT and
+      HOST_TLS_IDLE_S in its environment, and exits with its status.
+"""
+import argparse
+import json
+import os
+import socket
+import socketserver
+import ssl
+import struct
+import subprocess
+import sys
+import threading
+import time
+
+TRANSCRIPTIONS_PATH = "/openai/v1/audio/transcriptions"
+
+connections = 0
+connections_lock = threading.Lock()
+
+
+def describe_upload(headers, body, chunks):
+    """What a transcription upload held: the format of its file part and how much audio."""
+    boundary = headers.get("content-type", "").partition("boundary=")[2].encode()
+    name_at = body.find(b'filename="')
+    if not boundary or name_at < 0:
+        return "ok=0 no file part"
+    start = body.index(b"\r\n\r\n", name_at) + 4
+    end = body.rfind(b"\r\n--" + boundary + b"--")
+    if end < start:
+        return "ok=0 no closing boundary"
+    data = body[start:end]
+    chunked = headers.get("transfer-encoding", "").lower() == "chunked"
+    if data[:4] == b"RIFF" and data[8:16] == b"WAVEfmt " and len(data) >= 44:
+        fmt, channels, rate = struct.unpack("<HHI", data[20:28])
+        header_size = struct.unpack("<I", data[40:44])[0]
+        return "ok=%d fmt=wav ch=%d rate=%d audio=%d header_size=%s chunked=%d chunks=%d" % (
+            fmt == 1, channels, rate, len(data) - 44, "max" if header_size == 0xFFFFFFFF else header_size, chunked, chunks)
+    if data[:4] == b"fLaC" and len(data) >= 26:
+        # STREAMINFO: 20 bits of sample rate, 3 of channels - 1, 5 of bits per sample - 1.
+        info = int.from_bytes(data[18:21], "big")
+        return "ok=1 fmt=flac ch=%d rate=%d bytes=%d chunked=%d chunks=%d" % (
+            ((info >> 1) & 7) + 1, info >> 4, len(data), chunked, chunks)
+    return "ok=0 unknown format"
+
+
+class Handler(socketserver.StreamRequestHandler):
+    def setup(self):
+        global connections
+        with connections_lock:
+            connections += 1
+            self.conn = connections
+        self.request.settimeout(self.server.idle_s)
+        super().setup()
+
+    def handle(self):
+        try:
+            self.serve()
+        except (ValueError, ConnectionError, socket.timeout, ssl.SSLError, OSError):
+            pass
+
+    def reply(self, body, extra=b"", chunked=False):
+        if chunked:
+            mid = len(body) // 2
+            data = b"".join(b"%x;ext=1\r\n%s\r\n" % (len(p), p) for p in (body[:mid], body[mid:]))
+            data += b"0\r\nX-Trailer: 1\r\n\r\n"
+            head = b"HTTP/1.1 200 OK\r\nContent-Type: application/json\r\nTransfer-Encoding: chunked\r\n"
+        else:
+            data = body
+            head = b"HTTP/1.1 200 OK\r\nContent-Type: application/json\r\nContent-Length: %d\r\n" % len(body)
+        self.wfile.write(head + extra + b"\r\n" + data)
+        self.wfile.flush()
+
+    def read_body(self, headers):
+        """Returns the request body and the number of chunks it came in (0 if not chunked)."""
+        if headers.get("transfer-encoding", "").lower() != "chunked":
+            return self.rfile.read(int(headers.get("content-length", "0"))), 0
+        body = bytearray()
+        chunks = 0
+        while True:
+            size = int(self.rfile.readline().split(b";")[0].strip(), 16)
+            if size == 0:
+                while self.rfile.readline() not in (b"\r\n", b""):
+                    pass
+                return bytes(body), chunks
+            body += self.rfile.read(size)
+            self.rfile.read(2)
+            chunks += 1
+
+    def post(self, path, headers, body, chunks, info):
+        if path == TRANSCRIPTIONS_PATH:
+            text = describe_upload(headers, body, chunks)
+            time.sleep(self.server.infer_ms / 1000.0)
+            self.reply(json.dumps({"text": text}).encode())
+        else:
+            self.reply(json.dumps(dict(info, received=len(body), chunks=chunks)).encode())
+
+
+    def serve(self):
+        drop_next = False
+        served = 0
+        while True:
+            line = self.rfile.readline()
+            if not line:
+                return
+            method, path, _ = line.decode().split(" ", 2)
+            headers = {}
+            while True:
+                header = self.rfile.readline().decode()
+                if header in ("\r\n", ""):
+                    break
+                name, value = header.split(":", 1)
+                headers[name.strip().lower()] = value.strip()
+            if drop_next:
+                return
+            served += 1
+            info = {"conn": self.conn, "served_on_conn": served}
+            if method != "GET":
+                body, chunks = self.read_body(headers)
+                self.post(path, headers, body, chunks, info)
+            elif path == "/chunked":
+                self.reply(json.dumps(dict(info, kind="chunked")).encode(), chunked=True)
+            elif path == "/close":
+                self.reply(json.dumps(dict(info, kind="close")).encode(), b"Connection: close\r\n")
+                return
+            else:
+                drop_next = path == "/drop-next"
+                self.reply(json.dumps(dict(info, kind="weather")).encode())
+
+
+class Server(socketserver.ThreadingMixIn, socketserver.TCPServer):
+    allow_reuse_address = True
+    daemon_threads = True
+
+    def __init__(self, address, handler, context, idle_s, infer_ms):
+        super().__init__(address, handler)
+        self.context = context
+        self.idle_s = idle_s
+        self.infer_ms = infer_ms
+
+    def get_request(self):
+        sock, address = self.socket.accept()
+        sock.settimeout(self.idle_s)
+        return self.context.wrap_socket(sock, server_side=True), address
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--cert", required=True, help="server certificate (PEM)")
+    parser.add_argument("--key", required=True, help="server key (PEM)")
+    parser.add_argument("--idle-s", type=float, default=60, help="idle connections are closed after this")
+    parser.add_argument("--infer-ms", type=float, default=400, help="time the transcription stand-in takes")
+    parser.add_argument("--port", type=int, default=0)
+    parser.add_argument("command", nargs="*")
+    args = parser.parse_args()
+
+    context = ssl.SSLContext(ssl.PROTOCOL_TLS_SERVER)
+    context.maximum_version = ssl.TLSVersion.TLSv1_2
+    context.load_cert_chain(args.cert, args.key)
+    server = Server(("127.0.0.1", args.port), Handler, context, args.idle_s, args.infer_ms)
+    if not args.command:
+        print("Serving on port %d" % server.server_address[1], flush=True)
+        server.serve_forever()
+        return 0
+
+    threading.Thread(target=server.serve_forever, daemon=True).start()
+    env = dict(os.environ, HOST_TLS_PORT=str(server.server_address[1]), HOST_TLS_IDLE_S=str(args.idle_s))
+    status = subprocess.call(args.command, env=env)
+    server.shutdown()
+    return 1 if status < 0 else status
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,194 @@
+// The HTTPS client (https_client.h) against net/server.py over real TLS:
+// kept-alive connections reused for GETs and POSTs (sized and chunked bodies,
+// chunked responses), sessions resumed when a new connection is needed
+// (after Connection: close, after the server closed the idle connection, and
+// after the reaper closed it), and the GET retry when a kept-alive connection
+// turns out to be dead.
+//
+// Runs under the server: server.py ... -- test_https_client <ca.pem>
+#include "controllers/https_client/https_client.h"
+#include "config/app_config.h"
+#include "host_test.h"
+#include "host_tls.h"
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <stdlib.h>
+#include <string>
+#include <thread>
+#include <unistd.h>
+
+#define TIMEOUT_MS 5000
+
+static std::string ca_pem, base_url;
+
+// The same as https_client_get(), keeping the timing.
+static int get(const char* path, std::string& body, https_client_timing_t* timing) {
+    const std::string url = base_url + path;
+    https_request_config_t config = {};
+    config.url = url.c_str();
+    config.method = "GET";
+    config.cert_pem = ca_pem.c_str();
+    config.timeout_ms = TIMEOUT_MS;
+    body.clear();
+    https_request_t request = https_client_open(&config);
+    if (!request) return -1;
+    int status = https_client_fetch_headers(request);
+    if (status >= 0 && !https_client_read_body(request, body)) status = -1;
+    *timing = *https_client_get_timing(request);
+    https_client_close(request);
+    return status;
+}
+
+static void print_timing(const char* what, const https_client_timing_t& t) {
+    printf("  %-28s dns %6.2f  connect %6.2f  tls %6.2f  ttfb %6.2f  total %6.2f ms  %s%s\n", what, t.dns_us / 1e3,
+           t.connect_us / 1e3, t.handshake_us / 1e3, t.ttfb_us / 1e3, t.total_us / 1e3, t.reused ? "kept-alive " : "",
+           t.session_offered ? "session offered" : "");
+}
+
+static bool has(const std::string& body, const std::string& field) { return body.find(field) != std::string::npos; }
+
+static void check_handshakes(const char* what, int full, int resumed) {
+    host_tls_stats_t stats;
+    host_tls_get_stats(&stats);
+    printf("  handshakes: %d full, %d resumed\n", stats.full_handshakes, stats.resumed_handshakes);
+    HOST_CHECK(stats.full_handshakes == full && stats.resumed_handshakes == resumed,
+               "%s: %d full and %d resumed handshakes, expected %d and %d", what, stats.full_handshakes,
+               stats.resumed_handshakes, full, resumed);
+}
+
+static int open_connections(void) {
+    host_tls_stats_t stats;
+    host_tls_get_stats(&stats);
+    return stats.open_connections;
+}
+
+static void check_keep_alive(void) {
+    printf("Five GETs, then a chunked response, on one connection:\n");
+    std::string body;
+    https_client_timing_t t;
+    for (int i = 1; i <= 5; i++) {
+        const int status = get("/weather", body, &t);
+        print_timing(("GET /weather #" + std::to_string(i)).c_str(), t);
+        HOST_CHECK(status == 200 && has(body, "\"served_on_conn\": " + std::to_string(i)), "GET #%d: %d %s", i, status,
+                   body.c_str());
+        HOST_CHECK(t.reused == (i > 1), "GET #%d: reused %d", i, t.reused);
+    }
+    const int status = get("/chunked", body, &t);
+    print_timing("GET /chunked", t);
+    HOST_CHECK(status == 200 && t.reused && has(body, "\"kind\": \"chunked\"") && has(body, "\"served_on_conn\": 6"),
+               "chunked response: %d %s", status, body.c_str());
+    check_handshakes("keep-alive", 1, 0);
+}
+
+static void check_post_bodies(void) {
+    printf("Sized and chunked POST bodies on the kept-alive connection:\n");
+    const std::string payload(5000, 'x');
+    for (bool chunked : { false, true }) {
+        const std::string url = base_url + "/echo";
+        https_request_config_t config = {};
+        config.url = url.c_str();
+        config.method = "POST";
+        config.cert_pem = ca_pem.c_str();
+        config.headers = "Content-Type: application/octet-stream\r\n";
+        config.content_length = chunked ? -1 : 10000;
+        config.timeout_ms = TIMEOUT_MS;
+        https_request_t request = https_client_open(&config);
+        HOST_CHECK(request != NULL, "POST: open failed");
+        if (!request) continue;
+        const bool sent = https_client_write(request, payload.data(), 3000) &&
+                          https_client_write(request, payload.data(), 5000) &&
+                          https_client_write(request, payload.data(), 2000);
+        const int status = sent ? https_client_fetch_headers(request) : -1;
+        std::string body;
+        if (status >= 0) https_client_read_body(request, body);
+        const https_client_timing_t t = *https_client_get_timing(request);
+        https_client_close(request);
+        print_timing(chunked ? "POST chunked" : "POST sized", t);
+        const std::string expected = std::string("\"received\": 10000, \"chunks\": ") + (chunked ? "3" : "0");
+        HOST_CHECK(status == 200 && t.reused && has(body, expected), "POST %s: %d %s", chunked ? "chunked" : "sized",
+                   status, body.c_str());
+    }
+    check_handshakes("POST", 1, 0);
+}
+
+static void check_connection_close(void) {
+    printf("Connection: close is not kept; the next connection resumes the session:\n");
+    std::string body;
+    https_client_timing_t t;
+    int status = get("/close", body, &t);
+    print_timing("GET /close", t);
+    HOST_CHECK(status == 200 && open_connections() == 0, "Connection: close: %d, %d connections open", status,
+               open_connections());
+    status = get("/weather", body, &t);
+    print_timing("GET /weather", t);
+    HOST_CHECK(status == 200 && !t.reused && t.session_offered, "after close: %d, reused %d, session offered %d",
+               status, t.reused, t.session_offered);
+    check_handshakes("Connection: close", 1, 1);
+}
+
+static void check_server_idle_close(double idle_s) {
+    printf("The server closes the idle connection before the keep-alive time (%.1f s):\n", idle_s);
+    std::this_thread::sleep_for(std::chrono::milliseconds((int)(idle_s * 1000) + 500));
+    std::string body;
+    https_client_timing_t t;
+    const int status = get("/weather", body, &t);
+    print_timing("GET /weather after idle", t);
+    HOST_CHECK(status == 200 && !t.reused && t.session_offered,
+               "stale connection: %d, reused %d, session offered %d", status, t.reused, t.session_offered);
+    check_handshakes("server idle close", 1, 2);
+}
+
+static void check_get_retry(void) {
+    printf("A kept-alive connection dropped without an answer: https_client_get() sends again:\n");
+    std::string body;
+    https_client_timing_t t;
+    get("/drop-next", body, &t);
+    const int status = https_client_get((base_url + "/weather").c_str(), ca_pem.c_str(), TIMEOUT_MS, body);
+    printf("  %d %s\n", status, body.c_str());
+    HOST_CHECK(status == 200 && has(body, "\"served_on_conn\": 1"), "retry: %d %s", status, body.c_str());
+    check_handshakes("retry", 1, 3);
+}
+
+static void check_reaper(void) {
+    printf("The reaper closes idle connections after HTTPS_KEEP_ALIVE_MS (%d ms):\n", HTTPS_KEEP_ALIVE_MS);
+    HOST_CHECK(open_connections() == 1, "%d connections open before", open_connections());
+    std::this_thread::sleep_for(std::chrono::milliseconds(HTTPS_KEEP_ALIVE_MS + 500));
+    HOST_CHECK(open_connections() == 0, "%d connections left open by the reaper", open_connections());
+    std::string body;
+    https_client_timing_t t;
+    const int status = get("/weather", body, &t);
+    print_timing("GET /weather after reaping", t);
+    HOST_CHECK(status == 200 && !t.reused && t.session_offered, "after reaping: %d, reused %d, session offered %d",
+               status, t.reused, t.session_offered);
+    check_handshakes("reaper", 1, 4);
+}
+
+int main(int argc, char** argv) {
+    const char* port = getenv("HOST_TLS_PORT");
+    const char* idle_s = getenv("HOST_TLS_IDLE_S");
+    std::ifstream ca(argc > 1 ? argv[1] : "");
+    if (!port || !idle_s || !ca) {
+        fprintf(stderr, "usage: server.py --cert C --key K --idle-s S -- %s <ca.pem>\n", argv[0]);
+        return 2;
+    }
+    std::stringstream pem;
+    pem << ca.rdbuf();
+    ca_pem = pem.str();
+    base_url = std::string("https://localhost:") + port;
+    // Below the keep-alive time, so the client meets a connection the server has closed.
+    HOST_CHECK(atof(idle_s) * 1000 < HTTPS_KEEP_ALIVE_MS, "the server's idle time must be below HTTPS_KEEP_ALIVE_MS");
+
+    https_client_init();
+    check_keep_alive();
+    check_post_bodies();
+    check_connection_close();
+    check_server_idle_close(atof(idle_s));
+    check_get_retry();
+    check_reaper();
+
+    // The reaper's timer is armed again; leave without destroying what it waits on.
+    const int result = host_test_result();
+    fflush(stdout);
+    _exit(result);
+}
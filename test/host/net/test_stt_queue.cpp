@@ -0,0 +1,398 @@
+// The transcription queue (stt_queue.h) against stand-ins for the uploads,
+// LittleFS, the SD card and the WiFi state: stt_manager_transcribe() only
+// records each upload, and the test finishes it with success or failure.
+//
+// - Before a reboot (a forked child): notes queued while offline wait, going
+//   online uploads them at most STT_QUEUE_MAX_CONCURRENT at a time, and the
+//   process ends in the middle of an upload, like a power cut.
+// - After it: userdata/stt_queue.json is reloaded, as left behind or from
+//   the temporary file of an interrupted save; every note comes back with
+//   its date and failed attempts, and the one cut off is uploaded again.
+// - Retries: a note failing while online is retried after
+//   STT_QUEUE_RETRY_BASE_MS, doubled each time up to STT_QUEUE_RETRY_MAX_MS,
+//   and dropped after STT_QUEUE_MAX_ATTEMPTS failures. The waits pass on the
+//   esp_timer clock (host_advance_time()), not in real time.
+//
+// LittleFS is the directory stt_queue_fs/ in the working directory.
+#include "controllers/stt_queue/stt_queue.h"
+#include "controllers/daily_summary_manager/daily_summary_manager.h"
+#include "controllers/littlefs_manager/littlefs_manager.h"
+#include "controllers/sd_card_manager/sd_card_manager.h"
+#include "controllers/wifi_manager/wifi_manager.h"
+#include "config/app_config.h"
+#include "models/asset_config.h"
+#include "cJSON.h"
+#include "esp_timer.h"
+#include "lvgl.h"
+#include "host_test.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <mutex>
+#include <set>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#define FS_DIR "stt_queue_fs"
+#define SETTLE_MS 150      // Time given to the queue task to act before checking that it did not.
+#define CALL_TIMEOUT_S 5   // Time given to it to start an upload.
+#define EXTRA_NOTES 5
+
+namespace fs = std::filesystem;
+
+static const std::string QUEUE_FILE = std::string(USER_DATA_BASE_PATH) + STT_QUEUE_FILENAME;
+static const std::string QUEUE_TEMP_FILE = std::string(USER_DATA_BASE_PATH) + STT_QUEUE_TEMP_FILENAME;
+
+static void sleep_ms(int ms) { std::this_thread::sleep_for(std::chrono::milliseconds(ms)); }
+
+// --- Platform stand-ins ---
+
+const int WIFI_CONNECTED_BIT = 1 << 0;
+const int TIME_SYNC_BIT = 1 << 1;
+static EventGroupHandle_t wifi_events;
+static std::atomic<bool> online{ false };
+
+EventGroupHandle_t wifi_manager_get_event_group(void) { return wifi_events; }
+bool wifi_manager_is_connected(void) { return online; }
+
+static void set_online(bool on) {
+    online = on;
+    if (on) {
+        xEventGroupSetBits(wifi_events, WIFI_CONNECTED_BIT | TIME_SYNC_BIT);
+    } else {
+        xEventGroupClearBits(wifi_events, WIFI_CONNECTED_BIT | TIME_SYNC_BIT);
+    }
+}
+
+// Recordings on the SD card, by path.
+static std::mutex card_mutex;
+static std::set<std::string> card_files;
+
+bool sd_manager_file_exists(const char* path) {
+    std::lock_guard<std::mutex> lock(card_mutex);
+    return card_files.count(path) > 0;
+}
+
+static void record_note(const std::string& path) {
+    std::lock_guard<std::mutex> lock(card_mutex);
+    card_files.insert(path);
+}
+
+// LittleFS, as files under FS_DIR.
+static std::string fs_path(const char* filename) { return std::string(FS_DIR "/") + filename; }
+
+bool littlefs_manager_file_exists(const char* filename) { return fs::exists(fs_path(filename)); }
+
+bool littlefs_manager_read_file(const char* filename, char** buffer, size_t* size) {
+    FILE* fp = fopen(fs_path(filename).c_str(), "rb");
+    if (!fp) return false;
+    std::string content;
+    char chunk[512];
+    size_t n;
+    while ((n = fread(chunk, 1, sizeof(chunk), fp)) > 0) content.append(chunk, n);
+    fclose(fp);
+    *buffer = strdup(content.c_str());
+    *size = content.size();
+    return *buffer != nullptr;
+}
+
+bool littlefs_manager_write_file(const char* filename, const char* content) {
+    fs::create_directories(fs::path(fs_path(filename)).parent_path());
+    FILE* fp = fopen(fs_path(filename).c_str(), "wb");
+    if (!fp) return false;
+    const bool ok = fputs(content, fp) >= 0;
+    return fclose(fp) == 0 && ok;
+}
+
+bool littlefs_manager_delete_file(const char* filename) { return remove(fs_path(filename).c_str()) == 0; }
+
+bool littlefs_manager_rename_file(const char* old_name, const char* new_name) {
+    return rename(fs_path(old_name).c_str(), fs_path(new_name).c_str()) == 0;
+}
+
+// Transcripts written into the daily summaries: "<date> <path> <text>".
+static std::mutex summary_mutex;
+static std::vector<std::string> summaries;
+
+void DailySummaryManager::set_voice_note_transcript(time_t date, const std::string& path, const std::string& text) {
+    std::lock_guard<std::mutex> lock(summary_mutex);
+    summaries.push_back(std::to_string((long long)date) + " " + path + " " + text);
+}
+
+// The UI task: run at once.
+lv_result_t lv_async_call(lv_async_cb_t async_xcb, void* user_data) {
+    async_xcb(user_data);
+    return LV_RESULT_OK;
+}
+
+stt_stream_t stt_manager_stream_begin(const std::string&, audio_recorder_tap_t*, stt_result_callback_t) { return nullptr; }
+
+// --- Uploads ---
+
+typedef struct {
+    std::string path;
+    stt_result_callback_t cb;
+    int64_t started_us; // esp_timer time.
+} upload_t;
+
+static std::mutex upload_mutex;
+static std::condition_variable upload_started;
+static std::vector<upload_t> running_uploads;
+static int uploads_started = 0;
+static int max_in_flight = 0;
+
+bool stt_manager_transcribe(const std::string& file_path, stt_result_callback_t cb) {
+    std::lock_guard<std::mutex> lock(upload_mutex);
+    running_uploads.push_back(upload_t{ file_path, cb, esp_timer_get_time() });
+    uploads_started++;
+    max_in_flight = std::max(max_in_flight, (int)running_uploads.size());
+    upload_started.notify_all();
+    return true;
+}
+
+// Waits until `count` uploads have been started in total.
+static bool wait_for_uploads(int count) {
+    std::unique_lock<std::mutex> lock(upload_mutex);
+    return upload_started.wait_for(lock, std::chrono::seconds(CALL_TIMEOUT_S), [&] { return uploads_started >= count; });
+}
+
+static int started_count() {
+    std::lock_guard<std::mutex> lock(upload_mutex);
+    return uploads_started;
+}
+
+static std::vector<std::string> running_paths() {
+    std::lock_guard<std::mutex> lock(upload_mutex);
+    std::vector<std::string> paths;
+    for (const upload_t& u : running_uploads) paths.push_back(u.path);
+    std::sort(paths.begin(), paths.end());
+    return paths;
+}
+
+// Ends the running upload of `path`, as the STT task would. Returns false if it is not running.
+static bool finish_upload(const std::string& path, bool success, const std::string& result) {
+    stt_result_callback_t cb;
+    {
+        std::lock_guard<std::mutex> lock(upload_mutex);
+        auto it = std::find_if(running_uploads.begin(), running_uploads.end(), [&](const upload_t& u) { return u.path == path; });
+        if (it == running_uploads.end()) return false;
+        cb = it->cb;
+        running_uploads.erase(it);
+    }
+    cb(success, result);
+    return true;
+}
+
+// --- The saved queue ---
+
+typedef struct {
+    std::string path;
+    long long date;
+    int attempts;
+} saved_job_t;
+
+static std::vector<saved_job_t> saved_jobs() {
+    std::vector<saved_job_t> jobs;
+    char* buffer = nullptr;
+    size_t size = 0;
+    if (!littlefs_manager_read_file(QUEUE_FILE.c_str(), &buffer, &size)) return jobs;
+    cJSON* root = cJSON_Parse(buffer);
+    free(buffer);
+    cJSON* job;
+    cJSON_ArrayForEach(job, root) {
+        cJSON* path = cJSON_GetObjectItem(job, "path");
+        cJSON* date = cJSON_GetObjectItem(job, "date");
+        cJSON* attempts = cJSON_GetObjectItem(job, "attempts");
+        jobs.push_back(saved_job_t{ cJSON_IsString(path) ? path->valuestring : "",
+                                    cJSON_IsNumber(date) ? (long long)date->valuedouble : -1,
+                                    cJSON_IsNumber(attempts) ? attempts->valueint : -1 });
+    }
+    cJSON_Delete(root);
+    return jobs;
+}
+
+static const saved_job_t* find_job(const std::vector<saved_job_t>& jobs, const std::string& path) {
+    for (const saved_job_t& job : jobs) {
+        if (job.path == path) return &job;
+    }
+    return nullptr;
+}
+
+// --- Before the reboot ---
+
+static const time_t DAY_A = 1760400000, DAY_B = 1760486400, DAY_C = 1760572800;
+static const std::string NOTE_A = "/sdcard/notes/a.wav", NOTE_B = "/sdcard/notes/b.wav", NOTE_C = "/sdcard/notes/c.wav";
+
+static void before_reboot(void) {
+    printf("Before the reboot:\n");
+    record_note(NOTE_A);
+    record_note(NOTE_B);
+    record_note(NOTE_C);
+    stt_queue_init();
+
+    // Offline: queued and saved, not uploaded.
+    HOST_CHECK(stt_queue_add(NOTE_A, DAY_A), "%s not queued", NOTE_A.c_str());
+    HOST_CHECK(stt_queue_add(NOTE_B, 0), "%s not queued", NOTE_B.c_str());
+    HOST_CHECK(stt_queue_add(NOTE_C, DAY_C), "%s not queued", NOTE_C.c_str());
+    HOST_CHECK(stt_queue_add(NOTE_B, DAY_B), "%s not queued again", NOTE_B.c_str()); // Keeps its place, gets the date.
+    HOST_CHECK(!stt_queue_add("/sdcard/notes/missing.wav", DAY_A), "a note without a file was queued");
+    sleep_ms(SETTLE_MS);
+    HOST_CHECK(started_count() == 0, "%d uploads started while offline", started_count());
+    std::vector<saved_job_t> jobs = saved_jobs();
+    HOST_CHECK(jobs.size() == 3 && jobs[0].path == NOTE_A && jobs[1].path == NOTE_B && jobs[2].path == NOTE_C,
+               "%zu notes saved while offline, expected a, b, c", jobs.size());
+    printf("  offline: 3 notes queued and saved, no upload\n");
+
+    // Online: two at once. a fails and waits for its retry, which lets c start.
+    set_online(true);
+    HOST_CHECK(wait_for_uploads(STT_QUEUE_MAX_CONCURRENT), "the uploads did not start when online");
+    sleep_ms(SETTLE_MS);
+    std::vector<std::string> running = running_paths();
+    HOST_CHECK(running == (std::vector<std::string>{ NOTE_A, NOTE_B }), "%zu uploads running when online, expected a and b",
+               running.size());
+    HOST_CHECK(finish_upload(NOTE_A, false, "HTTP 503"), "a was not uploading");
+    HOST_CHECK(wait_for_uploads(3), "c did not start when a finished");
+    HOST_CHECK(finish_upload(NOTE_B, false, "HTTP 500"), "b was not uploading");
+    sleep_ms(SETTLE_MS);
+    running = running_paths();
+    HOST_CHECK(running == std::vector<std::string>{ NOTE_C }, "%zu uploads running, expected only c (a and b wait)",
+               running.size());
+    jobs = saved_jobs();
+    const saved_job_t* a = find_job(jobs, NOTE_A);
+    const saved_job_t* b = find_job(jobs, NOTE_B);
+    HOST_CHECK(a && a->attempts == 1 && b && b->attempts == 1 && b->date == DAY_B, "attempts of a and b not saved");
+    printf("  online: %d uploads started, at most %d at once; a and b failed once, c uploading at the power cut\n",
+           started_count(), max_in_flight);
+    HOST_CHECK(max_in_flight == STT_QUEUE_MAX_CONCURRENT, "%d uploads at once", max_in_flight);
+}
+
+// --- After the reboot ---
+
+static void after_reboot(void) {
+    printf("After the reboot (the save was cut between deleting the old file and renaming the new one):\n");
+    record_note(NOTE_A);
+    record_note(NOTE_B);
+    record_note(NOTE_C);
+    const std::vector<saved_job_t> before = saved_jobs();
+    HOST_CHECK(before.size() == 3, "%zu notes in %s after the reboot", before.size(), QUEUE_FILE.c_str());
+    HOST_CHECK(littlefs_manager_rename_file(QUEUE_FILE.c_str(), QUEUE_TEMP_FILE.c_str()), "cannot move the queue file");
+
+    stt_queue_init();
+    sleep_ms(SETTLE_MS);
+    HOST_CHECK(started_count() == 0, "%d uploads started while offline", started_count());
+    HOST_CHECK(littlefs_manager_file_exists(QUEUE_FILE.c_str()) && !littlefs_manager_file_exists(QUEUE_TEMP_FILE.c_str()),
+               "the temporary queue file was not restored");
+
+    // Online again: everything goes, backoff or not, two at a time, each
+    // transcript into the summary of the day it was queued with.
+    set_online(true);
+    for (int i = 0; i < EXTRA_NOTES; i++) {
+        const std::string path = "/sdcard/notes/extra" + std::to_string(i) + ".wav";
+        record_note(path);
+        HOST_CHECK(stt_queue_add(path, 0), "%s not queued", path.c_str());
+    }
+    const int total = 3 + EXTRA_NOTES;
+    int done = 0;
+    while (done < total && wait_for_uploads(done + 1)) {
+        sleep_ms(20);
+        for (const std::string& path : running_paths()) {
+            HOST_CHECK(finish_upload(path, true, "text of " + path), "%s was not uploading", path.c_str());
+            done++;
+        }
+    }
+    HOST_CHECK(done == total, "%d of %d notes uploaded", done, total);
+    HOST_CHECK(max_in_flight == STT_QUEUE_MAX_CONCURRENT, "%d uploads at once", max_in_flight);
+    {
+        std::lock_guard<std::mutex> lock(summary_mutex);
+        auto has = [&](time_t date, const std::string& path) {
+            const std::string line = std::to_string((long long)date) + " " + path + " text of " + path;
+            return std::find(summaries.begin(), summaries.end(), line) != summaries.end();
+        };
+        HOST_CHECK(summaries.size() == 3 && has(DAY_A, NOTE_A) && has(DAY_B, NOTE_B) && has(DAY_C, NOTE_C),
+                   "%zu transcripts in the summaries, expected a, b and c on their days", summaries.size());
+    }
+    HOST_CHECK(saved_jobs().empty(), "%zu notes left in the saved queue", saved_jobs().size());
+    printf("  reloaded a (1 attempt), b (1 attempt), c (cut off); with %d new notes all %d uploaded, at most %d at once\n",
+           EXTRA_NOTES, total, max_in_flight);
+}
+
+// --- Retries ---
+
+static void check_retries(void) {
+    printf("Retries of a note that keeps failing online (base %d s, max %d s, %d attempts):\n",
+           STT_QUEUE_RETRY_BASE_MS / 1000, STT_QUEUE_RETRY_MAX_MS / 1000, STT_QUEUE_MAX_ATTEMPTS);
+    const std::string note = "/sdcard/notes/retry.wav";
+    record_note(note);
+    int started = started_count();
+    HOST_CHECK(stt_queue_add(note, 0) && wait_for_uploads(started + 1), "the note did not start uploading");
+    started++;
+
+    for (uint32_t attempts = 1; attempts <= STT_QUEUE_MAX_ATTEMPTS; attempts++) {
+        HOST_CHECK(finish_upload(note, false, "HTTP 503"), "attempt %lu was not running", (unsigned long)attempts);
+        sleep_ms(SETTLE_MS);
+        const std::vector<saved_job_t> jobs = saved_jobs();
+        const saved_job_t* job = find_job(jobs, note);
+        if (attempts == STT_QUEUE_MAX_ATTEMPTS) {
+            HOST_CHECK(!job, "still queued after %lu failures", (unsigned long)attempts);
+            host_advance_time((int64_t)STT_QUEUE_RETRY_MAX_MS * 1000);
+            sleep_ms(SETTLE_MS);
+            HOST_CHECK(started_count() == started, "retried after %lu failures", (unsigned long)attempts);
+            printf("  failure %lu: dropped from the queue\n", (unsigned long)attempts);
+            break;
+        }
+        HOST_CHECK(job && job->attempts == (int)attempts, "%d attempts saved after %lu failures", job ? job->attempts : -1,
+                   (unsigned long)attempts);
+
+        // Not before the delay (less a second), then at once. The wait passes
+        // on the esp_timer clock; re-adding the note only wakes the task.
+        const int64_t expected_ms = std::min<int64_t>((int64_t)STT_QUEUE_RETRY_BASE_MS << (attempts - 1), STT_QUEUE_RETRY_MAX_MS);
+        const int64_t failed_us = esp_timer_get_time();
+        host_advance_time(expected_ms * 1000 - 1000000);
+        stt_queue_add(note, 0);
+        sleep_ms(SETTLE_MS);
+        HOST_CHECK(started_count() == started, "attempt %lu retried before %lld s", (unsigned long)attempts + 1,
+                   (long long)(expected_ms / 1000));
+        host_advance_time(1000000);
+        stt_queue_add(note, 0);
+        const bool retried = wait_for_uploads(started + 1);
+        HOST_CHECK(retried, "attempt %lu not retried after %lld s", (unsigned long)attempts + 1, (long long)(expected_ms / 1000));
+        if (!retried) break;
+        started++;
+        std::lock_guard<std::mutex> lock(upload_mutex);
+        const double after_s = (running_uploads.back().started_us - failed_us) / 1e6;
+        printf("  failure %lu: retried after %6.1f s (expected %4lld s)\n", (unsigned long)attempts, after_s,
+               (long long)(expected_ms / 1000));
+    }
+}
+
+int main(void) {
+    fs::remove_all(FS_DIR);
+    wifi_events = xEventGroupCreate();
+
+    // The first boot runs in a child process, which ends without shutting the queue down.
+    fflush(stdout);
+    const pid_t child = fork();
+    if (child == 0) {
+        before_reboot();
+        fflush(stdout);
+        _exit(host_test_failures == 0 ? 0 : 1);
+    }
+    int status = 0;
+    HOST_CHECK(child > 0 && waitpid(child, &status, 0) == child && WIFEXITED(status) && WEXITSTATUS(status) == 0,
+               "the run before the reboot failed (status 0x%x)", status);
+
+    after_reboot();
+    check_retries();
+
+    // The queue task never exits; leave without destroying what it uses.
+    const int result = host_test_result();
+    fflush(stdout);
+    _exit(result);
+}
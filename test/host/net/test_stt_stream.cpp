@@ -0,0 +1,386 @@
+// Stop-to-transcript time of voice notes, streamed while they are recorded
+// (stt_manager_stream_begin()) against uploaded once saved
+// (stt_manager_transcribe()), through the real recorder, capture service,
+// stt_manager and HTTPS client, against the transcription stand-in of
+// net/server.py over TLS.
+//
+// The network is modeled on top of the loopback (host_tls.h): a 1.2 s full
+// handshake, 300 ms resumed, and a 100 kB/s uplink; the server takes 400 ms
+// to "transcribe". The microphone delivers a speech-like signal in real time.
+// Besides the timing, every case checks what reached the server: a streamed
+// note must arrive whole (every byte of the saved file's audio), a cancelled
+// one must report a single failure, and a stream that falls behind must fall
+// back to uploading the file.
+//
+// Then the same journal clip, 10 s, 60 s and 5 min long, is uploaded once as
+// the WAV it is saved as and once as the FLAC stt_upload_audio.h makes of it,
+// comparing the bytes sent and the time from the request to the transcript.
+//
+// Runs under the server: server.py ... -- test_stt_stream <ca.pem>
+#include "controllers/stt_manager/stt_manager.h"
+#include "controllers/stt_manager/stt_upload_audio.h"
+#include "controllers/audio_recorder/audio_recorder.h"
+#include "controllers/https_client/https_client.h"
+#include "controllers/mic_capture/mic_capture.h"
+#include "controllers/sd_card_manager/sd_card_manager.h"
+#include "controllers/wifi_manager/wifi_manager.h"
+#include "config/app_config.h"
+#include "host_i2s.h"
+#include "host_test.h"
+#include "host_tls.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <fstream>
+#include <map>
+#include <math.h>
+#include <mutex>
+#include <stdlib.h>
+#include <string>
+#include <sys/stat.h>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+
+#define NOTE_PATH "stt_stream_note.wav"
+#define CLIP_PATH "stt_stream_journal.wav"
+#define RESULT_TIMEOUT_S 30
+// A 5-minute WAV is 9.6 MB, over a minute and a half on the modeled uplink.
+#define CLIP_TIMEOUT_S 240
+#define UPLINK_KBPS 800
+#define STALLED_UPLINK_KBPS 16
+
+using steady_clock = std::chrono::steady_clock;
+
+// --- Platform stand-ins ---
+
+// The API's CA certificate, embedded in the firmware; here the test CA, read at startup.
+char host_groq_ca_pem[16384] asm("_binary_groq_api_ca_pem_start");
+
+const int WIFI_CONNECTED_BIT = 1 << 0;
+const int TIME_SYNC_BIT = 1 << 1;
+static EventGroupHandle_t wifi_events;
+
+EventGroupHandle_t wifi_manager_get_event_group(void) { return wifi_events; }
+bool wifi_manager_is_connected(void) { return true; }
+
+// Transcripts saved "on the card", by path.
+static std::mutex card_mutex;
+static std::map<std::string, std::string> card_files;
+
+bool sd_manager_create_directory(const char*) { return true; }
+
+bool sd_manager_write_file(const char* path, const char* content) {
+    std::lock_guard<std::mutex> lock(card_mutex);
+    card_files[path] = content;
+    return true;
+}
+
+static std::string saved_transcript(const std::string& path) {
+    std::lock_guard<std::mutex> lock(card_mutex);
+    auto file = card_files.find(path);
+    return file == card_files.end() ? "" : file->second;
+}
+
+// --- Upload format ---
+
+// Set to send the next file as it is, as the firmware does with STT_UPLOAD_COMPRESS off.
+static std::atomic<bool> send_as_wav{false};
+
+// stt_upload_audio_open(), wrapped by the linker (C++ symbol, hence the mangled name).
+extern "C" stt_upload_audio_t* __real__Z21stt_upload_audio_openPKc(const char* path);
+
+extern "C" stt_upload_audio_t* __wrap__Z21stt_upload_audio_openPKc(const char* path) {
+    return send_as_wav ? NULL : __real__Z21stt_upload_audio_openPKc(path);
+}
+
+// --- Microphone ---
+
+// Syllables of a 300 Hz tone with noise at -20 dBFS, 400 ms each, 150 ms apart,
+// over a -60 dBFS noise floor: the VAD keeps it all, as it would speech.
+static int32_t speech_sample(uint64_t n, uint32_t* seed) {
+    const uint64_t syllable = REC_SAMPLE_RATE * 550 / 1000;
+    const bool voiced = n % syllable < REC_SAMPLE_RATE * 400 / 1000;
+    const double floor = 0.001 * host_random(seed);
+    const double voice = voiced ? 0.1 * (0.6 * sin(2 * M_PI * 300.0 * n / REC_SAMPLE_RATE) + 0.4 * host_random(seed)) : 0;
+    return (int32_t)((floor + voice) * 2147483647.0) & ~0xFF;
+}
+
+// Delivers the signal in real time, like the I2S DMA. After the channel was
+// idle the clock is picked up from the current time.
+static size_t microphone(void* dst, size_t bytes) {
+    static steady_clock::time_point clock_start = steady_clock::now();
+    static uint64_t frames_read = 0;
+    static uint32_t seed = 1;
+    const size_t frames = bytes / sizeof(int32_t) / REC_NUM_CHANNELS;
+    auto frames_time = [](uint64_t count) { return std::chrono::microseconds(count * 1000000 / REC_SAMPLE_RATE); };
+    const auto now = steady_clock::now();
+    if (now > clock_start + frames_time(frames_read) + std::chrono::milliseconds(100)) {
+        clock_start = now - frames_time(frames_read);
+    }
+    std::this_thread::sleep_until(clock_start + frames_time(frames_read + frames));
+    int32_t* slots = (int32_t*)dst;
+    for (size_t i = 0; i < frames; i++) {
+        const int32_t v = speech_sample(frames_read + i, &seed);
+        for (int c = 0; c < REC_NUM_CHANNELS; c++) slots[i * REC_NUM_CHANNELS + c] = v;
+    }
+    frames_read += frames;
+    return bytes;
+}
+
+// --- Results ---
+
+static std::mutex result_mutex;
+static std::condition_variable result_changed;
+static int callbacks = 0;
+static bool last_success = false;
+static std::string last_text;
+static steady_clock::time_point last_at;
+
+static void on_result(bool success, const std::string& text) {
+    std::lock_guard<std::mutex> lock(result_mutex);
+    callbacks++;
+    last_success = success;
+    last_text = text;
+    last_at = steady_clock::now();
+    result_changed.notify_all();
+}
+
+typedef struct {
+    int callbacks;
+    bool success;
+    std::string text;
+    double stop_to_result_ms;  //!< From the stop (or cancel) to the callback.
+    long file_audio_bytes;     //!< Audio in the saved file (past its 44-byte header), -1 if there is none.
+} note_result_t;
+
+static void set_uplink(uint32_t kbps) {
+    host_tls_config_t model = {};
+    model.full_handshake_ms = 1200;
+    model.resumed_handshake_ms = 300;
+    model.uplink_kbps = kbps;
+    host_tls_set_config(&model);
+}
+
+typedef enum { NOTE_FILE, NOTE_STREAM, NOTE_CANCEL, NOTE_STALLED } note_mode_t;
+
+// Records a note of `seconds`, ends it and waits for its transcript.
+static note_result_t record_note(note_mode_t mode, double seconds) {
+    unlink(NOTE_PATH);
+    {
+        std::lock_guard<std::mutex> lock(result_mutex);
+        callbacks = 0;
+    }
+    {
+        std::lock_guard<std::mutex> lock(card_mutex);
+        card_files.erase(stt_manager_get_transcript_path(NOTE_PATH));
+    }
+
+    audio_recorder_options_t options = {};
+    if (mode != NOTE_FILE && !stt_manager_stream_begin(NOTE_PATH, &options.tap, on_result)) {
+        HOST_CHECK(false, "could not start a stream");
+        return { 0, false, "", 0, -1 };
+    }
+    if (!audio_recorder_start_with_options(NOTE_PATH, &options)) {
+        HOST_CHECK(false, "could not start recording");
+        return { 0, false, "", 0, -1 };
+    }
+    if (mode == NOTE_STALLED) set_uplink(STALLED_UPLINK_KBPS);
+    std::this_thread::sleep_for(std::chrono::milliseconds((int)(seconds * 1000)));
+
+    const auto stop_at = steady_clock::now();
+    if (mode == NOTE_CANCEL) {
+        audio_recorder_cancel();
+    } else {
+        audio_recorder_stop();
+    }
+    if (mode == NOTE_STALLED) set_uplink(UPLINK_KBPS);
+    while (audio_recorder_get_state() != RECORDER_STATE_IDLE) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    struct stat st;
+    const long file_audio_bytes = stat(NOTE_PATH, &st) == 0 ? (long)st.st_size - 44 : -1;
+    if (mode == NOTE_FILE) stt_manager_transcribe(NOTE_PATH, on_result);
+
+    std::unique_lock<std::mutex> lock(result_mutex);
+    result_changed.wait_for(lock, std::chrono::seconds(RESULT_TIMEOUT_S), [] { return callbacks > 0; });
+    // A second callback would come soon after the first.
+    result_changed.wait_for(lock, std::chrono::milliseconds(500), [] { return callbacks > 1; });
+    const double ms = callbacks ? std::chrono::duration<double, std::milli>(last_at - stop_at).count() : -1;
+    return { callbacks, last_success, last_text, ms, file_audio_bytes };
+}
+
+static bool has(const std::string& text, const std::string& field) { return text.find(field) != std::string::npos; }
+
+static void print_note(const char* what, double seconds, const note_result_t& r) {
+    printf("  %-22s %4.1f s: stop->transcript %6.0f ms, %d callback(s), file audio %7ld bytes\n    %s: %s\n", what,
+           seconds, r.stop_to_result_ms, r.callbacks, r.file_audio_bytes, r.success ? "ok" : "failed", r.text.c_str());
+}
+
+// A streamed note reached the server whole, as a chunked WAV of unknown length, and its transcript was saved.
+static void check_streamed(const char* what, const note_result_t& r) {
+    HOST_CHECK(r.callbacks == 1 && r.success, "%s: %d callbacks, success %d", what, r.callbacks, r.success);
+    HOST_CHECK(has(r.text, "ok=1 fmt=wav ch=1 rate=16000 audio=" + std::to_string(r.file_audio_bytes) + " header_size=max chunked=1"),
+               "%s: the server did not get the file's %ld bytes of audio as a stream: %s", what, r.file_audio_bytes,
+               r.text.c_str());
+    HOST_CHECK(saved_transcript(stt_manager_get_transcript_path(NOTE_PATH)) == r.text, "%s: transcript not saved", what);
+}
+
+// A note uploaded once saved went as FLAC (see stt_upload_audio.h).
+static void check_uploaded(const char* what, const note_result_t& r) {
+    HOST_CHECK(r.callbacks == 1 && r.success, "%s: %d callbacks, success %d", what, r.callbacks, r.success);
+    HOST_CHECK(has(r.text, "ok=1 fmt=flac ch=1 rate=16000"), "%s: the server did not get the file as FLAC: %s", what,
+               r.text.c_str());
+    HOST_CHECK(saved_transcript(stt_manager_get_transcript_path(NOTE_PATH)) == r.text, "%s: transcript not saved", what);
+}
+
+// --- Journal clips ---
+
+// A journal as saved: 16 kHz mono, already trimmed by the VAD, so only short
+// pauses are left. Voiced syllables of 8 harmonics on a pitch wandering
+// around 150 Hz, at about -20 dBFS, 150 ms apart and 600 ms between
+// sentences, over a -60 dBFS noise floor.
+static bool write_journal_clip(const char* path, double seconds) {
+    const uint32_t rate = STT_UPLOAD_SAMPLE_RATE;
+    const size_t frames = (size_t)(seconds * rate);
+    const size_t syllable = rate * 300 / 1000, gap = rate * 150 / 1000, sentence_gap = rate * 600 / 1000;
+    std::vector<int16_t> samples(frames);
+    uint32_t seed = 7;
+    double phase = 0;
+    size_t in_syllable = 0, syllables = 0, pause = 0;
+    for (size_t n = 0; n < frames; n++) {
+        double v = 0.001 * host_random(&seed);
+        if (pause) {
+            pause--;
+        } else {
+            const double pitch = 150.0 + 30.0 * sin(2 * M_PI * 0.7 * n / rate) + 10.0 * sin(2 * M_PI * 3.1 * n / rate);
+            phase += 2 * M_PI * pitch / rate;
+            const double envelope = sin(M_PI * in_syllable / syllable);
+            double voice = 0;
+            for (int k = 1; k <= 8; k++) voice += sin(k * phase) / k;
+            v += 0.06 * envelope * voice;
+            if (++in_syllable == syllable) {
+                in_syllable = 0;
+                pause = ++syllables % 6 ? gap : sentence_gap;
+            }
+        }
+        samples[n] = (int16_t)lrint(std::max(-1.0, std::min(1.0, v)) * 32767.0);
+    }
+    return host_write_wav16(path, samples.data(), frames, rate, 1);
+}
+
+// Sends a saved file and waits for its transcript; the time is from the request to the callback.
+static note_result_t upload_file(const char* path, bool as_wav) {
+    {
+        std::lock_guard<std::mutex> lock(result_mutex);
+        callbacks = 0;
+    }
+    struct stat st;
+    const long file_audio_bytes = stat(path, &st) == 0 ? (long)st.st_size - 44 : -1;
+    send_as_wav = as_wav;
+    const auto start = steady_clock::now();
+    stt_manager_transcribe(path, on_result);
+
+    std::unique_lock<std::mutex> lock(result_mutex);
+    result_changed.wait_for(lock, std::chrono::seconds(CLIP_TIMEOUT_S), [] { return callbacks > 0; });
+    send_as_wav = false;
+    const double ms = callbacks ? std::chrono::duration<double, std::milli>(last_at - start).count() : -1;
+    return { callbacks, last_success, last_text, ms, file_audio_bytes };
+}
+
+// The number after `field` in the server's reply, -1 if absent.
+static long reply_field(const std::string& text, const std::string& field) {
+    const size_t at = text.find(" " + field + "=");
+    return at == std::string::npos ? -1 : atol(text.c_str() + at + field.size() + 2);
+}
+
+// The same clip as WAV and as FLAC, at the lengths journals come in.
+static void compare_wav_and_flac(void) {
+    printf("Journal clip uploaded as WAV and as FLAC (%d kB/s uplink):\n", UPLINK_KBPS / 8);
+    printf("  %6s %10s %9s %10s %9s %6s %6s\n", "length", "WAV bytes", "WAV ms", "FLAC bytes", "FLAC ms", "bytes",
+           "time");
+    for (double seconds : { 10.0, 60.0, 300.0 }) {
+        if (!write_journal_clip(CLIP_PATH, seconds)) {
+            HOST_CHECK(false, "could not write the %.0f s clip", seconds);
+            continue;
+        }
+        const note_result_t wav = upload_file(CLIP_PATH, true);
+        const note_result_t flac = upload_file(CLIP_PATH, false);
+        HOST_CHECK(wav.callbacks == 1 && wav.success && has(wav.text, "ok=1 fmt=wav ch=1 rate=16000 audio=" +
+                   std::to_string(wav.file_audio_bytes) + " "), "%.0f s clip: the server did not get the WAV whole: %s",
+                   seconds, wav.text.c_str());
+        HOST_CHECK(flac.callbacks == 1 && flac.success && has(flac.text, "ok=1 fmt=flac ch=1 rate=16000"),
+                   "%.0f s clip: the server did not get it as FLAC: %s", seconds, flac.text.c_str());
+        const long wav_bytes = reply_field(wav.text, "audio") + 44;
+        const long flac_bytes = reply_field(flac.text, "bytes");
+        const double byte_ratio = wav_bytes > 0 ? (double)flac_bytes / wav_bytes : 0;
+        const double time_ratio = wav.stop_to_result_ms > 0 ? flac.stop_to_result_ms / wav.stop_to_result_ms : 0;
+        printf("  %5.0fs %10ld %9.0f %10ld %9.0f %5.0f%% %5.0f%%\n", seconds, wav_bytes, wav.stop_to_result_ms,
+               flac_bytes, flac.stop_to_result_ms, 100 * byte_ratio, 100 * time_ratio);
+        // Recorded speech codes to around 60% of the WAV (stt_upload_audio.h); this cleaner clip to less.
+        HOST_CHECK(flac_bytes > 0 && byte_ratio < 0.75, "%.0f s clip: FLAC is %.0f%% of the WAV", seconds,
+                   100 * byte_ratio);
+        HOST_CHECK(flac.stop_to_result_ms < wav.stop_to_result_ms,
+                   "%.0f s clip: the FLAC upload took %.0f ms, the WAV %.0f ms", seconds, flac.stop_to_result_ms,
+                   wav.stop_to_result_ms);
+    }
+    unlink(CLIP_PATH);
+}
+
+int main(int argc, char** argv) {
+    const char* port = getenv("HOST_TLS_PORT");
+    std::ifstream ca(argc > 1 ? argv[1] : "");
+    if (!port || !ca) {
+        fprintf(stderr, "usage: server.py --cert C --key K -- %s <ca.pem>\n", argv[0]);
+        return 2;
+    }
+    ca.read(host_groq_ca_pem, sizeof(host_groq_ca_pem) - 1);
+    host_tls_route("api.groq.com", atoi(port));
+    set_uplink(UPLINK_KBPS);
+    wifi_events = xEventGroupCreate();
+    xEventGroupSetBits(wifi_events, WIFI_CONNECTED_BIT | TIME_SYNC_BIT);
+    host_i2s_set_rx_source(microphone);
+
+    mic_capture_init();
+    audio_recorder_init();
+    https_client_init();
+    stt_manager_init();
+
+    printf("Stop to transcript (1.2 s full / 300 ms resumed handshake, %d kB/s uplink, 400 ms inference):\n",
+           UPLINK_KBPS / 8);
+    // The first connection: the note ends well before the handshake does, and is still streamed.
+    note_result_t r = record_note(NOTE_STREAM, 0.5);
+    print_note("streamed, ends early", 0.5, r);
+    check_streamed("short streamed note", r);
+
+    const double seconds = 6;
+    const note_result_t streamed = record_note(NOTE_STREAM, seconds);
+    print_note("streamed", seconds, streamed);
+    check_streamed("streamed note", streamed);
+    const note_result_t uploaded = record_note(NOTE_FILE, seconds);
+    print_note("uploaded once saved", seconds, uploaded);
+    check_uploaded("uploaded note", uploaded);
+    HOST_CHECK(streamed.stop_to_result_ms < uploaded.stop_to_result_ms,
+               "streaming took %.0f ms from stop to transcript, the file upload %.0f ms", streamed.stop_to_result_ms,
+               uploaded.stop_to_result_ms);
+
+    // A discarded recording ends its stream with one failure and nothing saved.
+    r = record_note(NOTE_CANCEL, 1.0);
+    print_note("cancelled", 1.0, r);
+    HOST_CHECK(r.callbacks == 1 && !r.success && has(r.text, "discarded"), "cancelled note: %d callbacks, %s",
+               r.callbacks, r.text.c_str());
+    HOST_CHECK(r.file_audio_bytes < 0, "the cancelled recording's file was kept");
+    HOST_CHECK(saved_transcript(stt_manager_get_transcript_path(NOTE_PATH)).empty(), "a transcript of a cancelled note");
+
+    // An uplink slower than the audio fills the stream's buffer: the saved file goes instead, with one callback.
+    r = record_note(NOTE_STALLED, seconds);
+    print_note("stream fell behind", seconds, r);
+    check_uploaded("note whose stream fell behind", r);
+    unlink(NOTE_PATH);
+
+    compare_wav_and_flac();
+
+    // The recorder's and the HTTPS client's tasks never exit; leave without destroying what they use.
+    const int result = host_test_result();
+    fflush(stdout);
+    _exit(result);
+}
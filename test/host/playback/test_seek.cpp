@@ -0,0 +1,171 @@
+// Seek test for the player: audio_decoder_seek() must land on the exact frame
+// in every format, and audio_manager_seek()/fast_forward()/rewind() must get
+// audio from the new position to I2S quickly and without underruns. The
+// player runs on host threads with real-time I2S pacing, reading files from
+// disk, first as they are and then through a model of SD card latency.
+#include "controllers/audio_manager/audio_manager.h"
+#include "controllers/audio_manager/audio_decoder.h"
+#include "controllers/audio_manager/audio_sound_bank.h"
+#include "controllers/audio_recorder/audio_wav_writer.h"
+#include "host_i2s.h"
+#include "host_sd.h"
+#include "host_test.h"
+#include <algorithm>
+#include <chrono>
+#include <math.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+#define DECODER_SEEKS 200
+#define COMPARE_FRAMES 3000
+#define SETTLE_MS 400            // Time given to each seek before it is checked.
+#define MAX_SEEK_LATENCY_US 100000
+
+// The sound bank is not under test.
+void audio_sound_bank_load(void) {}
+bool audio_sound_bank_get(audio_sound_id_t, audio_sound_clip_t*) { return false; }
+
+static void sleep_ms(int ms) { std::this_thread::sleep_for(std::chrono::milliseconds(ms)); }
+
+// Writes `seconds` of a 1 kHz tone with the recorder's WAV writer.
+static void write_tone(const char* path, uint32_t rate, uint16_t channels, audio_wav_encoding_t encoding, uint32_t seconds) {
+    audio_wav_writer_t writer = {};
+    HOST_CHECK(audio_wav_writer_open(&writer, path, rate, channels, encoding), "cannot create %s", path);
+    std::vector<int16_t> block(rate / 10 * channels);
+    for (uint32_t t = 0; t < seconds * 10; t++) {
+        for (size_t i = 0; i < block.size(); i++) {
+            const uint32_t frame = t * (rate / 10) + (uint32_t)(i / channels);
+            block[i] = (int16_t)lrint(8000.0 * sin(2 * M_PI * 1000.0 * frame / rate) + ((i % channels) ? 300 : 0));
+        }
+        audio_wav_writer_write(&writer, block.data(), block.size() * sizeof(int16_t));
+    }
+    HOST_CHECK(audio_wav_writer_finalize(&writer), "cannot finish %s", path);
+}
+
+// --- audio_decoder_seek() against a full decode ---
+
+static void check_decoder_seeks(const char* path) {
+    FILE* fp = fopen(path, "rb");
+    audio_decoder_t dec = {};
+    if (!fp || !audio_decoder_open(&dec, fp)) {
+        HOST_CHECK(false, "cannot open %s", path);
+        if (fp) fclose(fp);
+        return;
+    }
+    std::vector<int16_t> all, buf(1024 * 2);
+    size_t n;
+    while ((n = audio_decoder_read(&dec, buf.data(), 1024)) > 0) all.insert(all.end(), buf.begin(), buf.begin() + n * 2);
+    const uint32_t total = (uint32_t)(all.size() / 2);
+
+    int exact = 0;
+    uint32_t seed = 1;
+    for (int t = 0; t < DECODER_SEEKS; t++) {
+        const uint32_t frame = (t == 0) ? 0 : (t == 1) ? total : (t == 2) ? total - 1
+                                                                           : (uint32_t)((host_random(&seed) + 1) / 2 * total);
+        if (!audio_decoder_seek(&dec, frame)) continue;
+        std::vector<int16_t> got;
+        while (got.size() < COMPARE_FRAMES * 2 && (n = audio_decoder_read(&dec, buf.data(), 1024)) > 0) {
+            got.insert(got.end(), buf.begin(), buf.begin() + n * 2);
+        }
+        const size_t expect = std::min<size_t>(total - frame, COMPARE_FRAMES);
+        if (got.size() / 2 >= expect && memcmp(got.data(), all.data() + (size_t)frame * 2, expect * 4) == 0) exact++;
+    }
+    printf("%-26s %-9s %7lu frames: %d/%d seeks exact\n", path, dec.ops->name, (unsigned long)total, exact, DECODER_SEEKS);
+    HOST_CHECK(exact == DECODER_SEEKS, "%s: %d of %d seeks not exact", path, DECODER_SEEKS - exact, DECODER_SEEKS);
+    audio_decoder_close(&dec);
+    fclose(fp);
+}
+
+// --- Seeks through the player ---
+
+static std::vector<uint32_t> latencies;
+
+// Runs one seek and checks where playback is SETTLE_MS later. Relative seeks
+// start from where playback had got to, so they may land up to a second later.
+static void player_seek(const char* what, bool (*fn)(uint32_t), uint32_t arg, uint32_t expect_s) {
+    audio_playback_stats_t before;
+    audio_manager_get_playback_stats(&before);
+    HOST_CHECK(fn(arg), "%s was refused", what);
+    sleep_ms(SETTLE_MS);
+    audio_playback_stats_t after;
+    audio_manager_get_playback_stats(&after);
+    const uint32_t progress = audio_manager_get_progress_s();
+    printf("  %-22s -> at %3lu s, latency %6lu us, underruns %lu\n", what, (unsigned long)progress,
+           (unsigned long)after.seek_latency_us, (unsigned long)after.underruns);
+    HOST_CHECK(progress >= expect_s && progress <= expect_s + 1, "%s: at %lu s, expected %lu s", what,
+               (unsigned long)progress, (unsigned long)expect_s);
+    HOST_CHECK(after.seek_latency_us > 0 && after.seek_latency_us <= MAX_SEEK_LATENCY_US, "%s: latency %lu us", what,
+               (unsigned long)after.seek_latency_us);
+    HOST_CHECK(after.underruns == 0, "%s: %lu underruns", what, (unsigned long)after.underruns);
+    latencies.push_back(after.seek_latency_us);
+}
+
+static void run_player(const char* label) {
+    latencies.clear();
+    printf("%s\n", label);
+    audio_manager_play("seek_48k.wav");
+    sleep_ms(1500);
+    player_seek("seek 20", audio_manager_seek, 20, 20);
+    player_seek("fast_forward 5", audio_manager_fast_forward, 5, 25);
+    player_seek("rewind 10", audio_manager_rewind, 10, 15);
+    player_seek("seek 0", audio_manager_seek, 0, 0);
+    player_seek("seek 29", audio_manager_seek, 29, 29);
+
+    audio_manager_play("seek_44k.wav");
+    sleep_ms(1000);
+    player_seek("44.1 kHz seek 15", audio_manager_seek, 15, 15);
+
+    audio_manager_play("seek_ima.wav");
+    sleep_ms(1000);
+    player_seek("IMA-ADPCM seek 7", audio_manager_seek, 7, 7);
+
+    // Back into a queued track the reader has already finished: it is replayed
+    // and the track queued after it still follows.
+    audio_manager_play("seek_short.wav");
+    audio_manager_queue_add("seek_48k.wav");
+    sleep_ms(300);
+    player_seek("replayed track seek 0", audio_manager_seek, 0, 0);
+    HOST_CHECK(audio_manager_queue_length() == 1, "queue length %lu after the replay", (unsigned long)audio_manager_queue_length());
+    sleep_ms(1200);
+    HOST_CHECK(strstr(audio_manager_get_current_file(), "seek_48k.wav") != NULL, "the queued track did not follow: %s",
+               audio_manager_get_current_file());
+
+    // A seek while paused moves the position without playing.
+    audio_manager_pause();
+    audio_manager_seek(10);
+    HOST_CHECK(audio_manager_get_progress_s() == 10, "paused seek: at %lu s", (unsigned long)audio_manager_get_progress_s());
+    audio_manager_resume();
+    sleep_ms(300);
+    audio_manager_stop();
+
+    std::sort(latencies.begin(), latencies.end());
+    printf("  seek-to-audio latency over %zu seeks: min %.1f / median %.1f / max %.1f ms\n", latencies.size(),
+           latencies.front() / 1000.0, latencies[latencies.size() / 2] / 1000.0, latencies.back() / 1000.0);
+    audio_manager_reset_health();
+}
+
+int main(void) {
+    write_tone("seek_48k.wav", 48000, 2, AUDIO_WAV_PCM_16, 30);
+    write_tone("seek_44k.wav", 44100, 2, AUDIO_WAV_PCM_16, 30);
+    write_tone("seek_ima.wav", 16000, 1, AUDIO_WAV_IMA_ADPCM, 10);
+    write_tone("seek_ima_stereo.wav", 22050, 2, AUDIO_WAV_IMA_ADPCM, 5);
+    write_tone("seek_short.wav", 48000, 2, AUDIO_WAV_PCM_16, 1);
+
+    check_decoder_seeks("seek_44k.wav");
+    check_decoder_seeks("seek_ima.wav");
+    check_decoder_seeks("seek_ima_stereo.wav");
+
+    audio_manager_init();
+    audio_manager_set_volume_physical(40);
+    run_player("Host file I/O:");
+    host_sd_access_us = 500;
+    host_sd_seek_us = 2000;
+    host_sd_bytes_per_ms = 1500;
+    run_player("Modeled SD card (0.5 ms per access, 2 ms per seek, 1.5 MB/s):");
+
+    // The player's tasks never exit; leave without destroying what they use.
+    const int result = host_test_result();
+    fflush(stdout);
+    _exit(result);
+}
@@ -0,0 +1,252 @@
+// Replay harness for the microphone AGC (audio_agc.h): audio at microphone
+// level is fed through it in mic_capture's 512-frame blocks and compared with
+// the fixed 35x gain it replaced.
+//
+// Without arguments it synthesizes a speech sequence at raw microphone level:
+// voices at different distances, pauses of room noise, a shout and a hand
+// clap. It also writes that sequence as the old recorder would have saved it
+// (35x, clipped) to a fixture WAV and replays the file with the gain undone,
+// the way real recordings are replayed:
+//
+//   test_agc [--input-db <dB>] [recording.wav ...]
+//
+// --input-db shifts a file's level before the AGC; -31 undoes the 35x of a
+// recording made before the AGC. Each replayed file is written back as
+// <file>.agc.wav for listening.
+#include "controllers/audio_recorder/audio_agc.h"
+#include "controllers/mic_capture/mic_capture.h"
+#include "host_test.h"
+#include <algorithm>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#define SAMPLE_RATE REC_SAMPLE_RATE
+#define BLOCK_FRAMES MIC_CAPTURE_BLOCK_FRAMES
+#define FIXED_GAIN 35.0f
+#define FIXED_GAIN_DB 31.0 // 20 * log10(35)
+#define SETTLE_S 0.3       // Start of each segment left out of its level: the AGC settling.
+#define FIXTURE_PATH "agc_fixture_fixed35.wav"
+
+// Speech segments must end up closer together than this (dB of RMS) ...
+#define MAX_SPEECH_SPREAD_DB 16.0
+// ... and a pause must hold the gain of the speech before it within this.
+#define MAX_PAUSE_GAIN_DRIFT_DB 1.0
+
+typedef struct {
+    const char* name;
+    double peak_dbfs; // At the microphone, relative to 16-bit full scale.
+    double seconds;
+    bool speech;
+} segment_t;
+
+static const segment_t segments[] = {
+    { "room noise", -72, 1.5, false },
+    { "normal voice", -48, 3.0, true },
+    { "pause", -72, 1.5, false },
+    { "quiet voice (2 m)", -58, 3.0, true },
+    { "pause", -72, 1.5, false },
+    { "close voice", -30, 3.0, true },
+    { "pause", -72, 1.5, false },
+    { "shout", -15, 1.0, true },
+    { "normal voice", -48, 3.0, true },
+    { "hand clap", -6, 0.06, false },
+    { "normal voice", -48, 3.0, true },
+};
+
+typedef struct {
+    size_t start, end; // Frames.
+    std::string name;
+    bool speech;
+} span_t;
+
+// Approximately normal noise, deterministic.
+static double noise(uint32_t* seed) {
+    return (host_random(seed) + host_random(seed) + host_random(seed) + host_random(seed)) * 0.866;
+}
+
+// Voiced syllables (harmonics of a gliding 140 Hz pitch under a 4 Hz
+// envelope) or noise, as the INMP441's left-justified 24-bit slots.
+static std::vector<int32_t> synthesize(std::vector<span_t>* spans) {
+    std::vector<int32_t> slots;
+    uint32_t seed = 1;
+    for (const segment_t& s : segments) {
+        const size_t start = slots.size(), len = (size_t)(s.seconds * SAMPLE_RATE);
+        const double amplitude = 2147483647.0 * pow(10, s.peak_dbfs / 20);
+        const double hiss = 2147483647.0 * pow(10, -80 / 20.0);
+        for (size_t i = 0; i < len; i++) {
+            const double t = (double)i / SAMPLE_RATE;
+            double v;
+            if (s.speech) {
+                const double f0 = 140 + 20 * sin(2 * M_PI * 0.7 * t);
+                const double envelope = pow(fabs(sin(2 * M_PI * 2 * t)), 1.5);
+                double x = 0;
+                for (int h = 1; h <= 12; h++) x += sin(2 * M_PI * f0 * h * t) * ((h == 4 || h == 9) ? 1.0 : 0.35) / h;
+                v = amplitude * envelope * x / 1.4 + hiss * noise(&seed);
+            } else {
+                v = amplitude * noise(&seed) / 3.5;
+            }
+            slots.push_back((int32_t)std::max(-2147483648.0, std::min(2147483647.0, v)) & ~0xFF);
+        }
+        spans->push_back(span_t{ start, slots.size(), s.name, s.speech });
+    }
+    return slots;
+}
+
+static double peak_db(const int16_t* x, size_t n) {
+    int m = 1;
+    for (size_t i = 0; i < n; i++) m = std::max(m, abs((int)x[i]));
+    return 20 * log10(m / 32768.0);
+}
+
+static double rms_db(const int16_t* x, size_t n) {
+    double sum = 1e-9;
+    for (size_t i = 0; i < n; i++) sum += (double)x[i] * x[i];
+    return 10 * log10(sum / (n ? n : 1) / (32768.0 * 32768.0));
+}
+
+// Start of a span's level measurement: after the settling time, unless the span is too short for that.
+static size_t settled_start(const span_t& s) {
+    const size_t settle = (size_t)(SETTLE_S * SAMPLE_RATE);
+    return (s.end - s.start > 2 * settle) ? s.start + settle : s.start;
+}
+
+typedef struct {
+    std::vector<int16_t> out, fixed;
+    std::vector<float> gain_db;   // At the end of each block.
+    std::vector<double> agc_rms;  // Per span, settling left out.
+    uint32_t agc_clipped, fixed_clipped;
+} replay_t;
+
+static double gain_at(const replay_t& r, size_t frame) {
+    const size_t block = std::min(r.gain_db.size(), std::max<size_t>(frame / BLOCK_FRAMES, 1)) - 1;
+    return r.gain_db[block];
+}
+
+static replay_t replay(const char* name, const std::vector<int32_t>& slots, const std::vector<span_t>& spans) {
+    replay_t r = {};
+    r.out.resize(slots.size());
+    r.fixed.resize(slots.size());
+    static audio_agc_t agc;
+    audio_agc_init(&agc, SAMPLE_RATE, NULL);
+
+    uint64_t cycles = 0;
+    for (size_t i = 0; i < slots.size(); i += BLOCK_FRAMES) {
+        const size_t n = std::min<size_t>(BLOCK_FRAMES, slots.size() - i);
+        const uint64_t c0 = host_cycles();
+        audio_agc_process(&agc, &slots[i], &r.out[i], n, 1);
+        cycles += host_cycles() - c0;
+        r.gain_db.push_back(audio_agc_get_gain_db(&agc));
+        if (getenv("AGC_TRACE")) printf("t %.2f envelope %ld gain %.1f\n", (i + n) / (double)SAMPLE_RATE, (long)agc.envelope_q8, r.gain_db.back());
+    }
+    r.agc_clipped = agc.clipped;
+    // The stage it replaced: top 16 bits of the slot times a float 35, hard clipped.
+    for (size_t i = 0; i < slots.size(); i++) {
+        const int32_t v = (int32_t)((float)(int16_t)(slots[i] >> 16) * FIXED_GAIN);
+        if (v > 32767 || v < -32768) r.fixed_clipped++;
+        r.fixed[i] = (int16_t)std::max(-32768, std::min(32767, v));
+    }
+
+    printf("== %s (%.1f s, %llu %s per %d-frame block)\n", name, slots.size() / (double)SAMPLE_RATE,
+           (unsigned long long)(cycles / r.gain_db.size()), host_cycles_unit(), BLOCK_FRAMES);
+    printf("  %-20s %9s %9s %9s %9s %9s\n", "segment", "fixed pk", "fixed rms", "agc pk", "agc rms", "agc gain");
+    for (const span_t& s : spans) {
+        const size_t settled = settled_start(s);
+        r.agc_rms.push_back(rms_db(&r.out[settled], s.end - settled));
+        printf("  %-20s %9.1f %9.1f %9.1f %9.1f %9.1f\n", s.name.c_str(), peak_db(&r.fixed[s.start], s.end - s.start),
+               rms_db(&r.fixed[settled], s.end - settled), peak_db(&r.out[s.start], s.end - s.start), r.agc_rms.back(),
+               gain_at(r, s.end));
+    }
+    printf("  clipped samples: fixed %.0fx %lu, agc %lu\n", FIXED_GAIN, (unsigned long)r.fixed_clipped,
+           (unsigned long)r.agc_clipped);
+    return r;
+}
+
+// Levels of the synthesized sequence: no clipping, voices brought together, pauses holding the gain.
+static void check_synthesized(const replay_t& r, const std::vector<span_t>& spans, const char* what) {
+    HOST_CHECK(r.agc_clipped == 0, "%s: AGC clipped %lu samples", what, (unsigned long)r.agc_clipped);
+    double lo = 0, hi = -200, fixed_lo = 0, fixed_hi = -200;
+    for (size_t k = 0; k < spans.size(); k++) {
+        const span_t& s = spans[k];
+        if (s.speech) {
+            const size_t settled = settled_start(s);
+            const double fixed_rms = rms_db(&r.fixed[settled], s.end - settled);
+            lo = std::min(lo, r.agc_rms[k]);
+            hi = std::max(hi, r.agc_rms[k]);
+            fixed_lo = std::min(fixed_lo, fixed_rms);
+            fixed_hi = std::max(fixed_hi, fixed_rms);
+        } else if (s.name == "pause") {
+            const double drift = fabs(gain_at(r, s.end) - gain_at(r, s.start));
+            HOST_CHECK(drift <= MAX_PAUSE_GAIN_DRIFT_DB, "%s: gain moved %.1f dB over the pause at %.1f s", what, drift,
+                       s.start / (double)SAMPLE_RATE);
+        }
+    }
+    printf("  speech RMS spread: fixed %.1f dB, agc %.1f dB\n", fixed_hi - fixed_lo, hi - lo);
+    HOST_CHECK(hi - lo <= MAX_SPEECH_SPREAD_DB, "%s: speech levels spread over %.1f dB", what, hi - lo);
+    HOST_CHECK(hi - lo < fixed_hi - fixed_lo, "%s: the AGC spreads speech levels more than the fixed gain", what);
+}
+
+// Replays a 16-bit WAV, first channel, shifted by `input_db`; the result goes to <path>.agc.wav.
+static bool replay_file(const char* path, double input_db, replay_t* result) {
+    std::vector<int16_t> pcm;
+    uint32_t rate;
+    uint16_t channels;
+    if (!host_read_wav16(path, &pcm, &rate, &channels)) {
+        printf("%s: not a 16-bit PCM WAV\n", path);
+        return false;
+    }
+    if (rate != SAMPLE_RATE) printf("%s: %lu Hz, the AGC time constants assume %d Hz\n", path, (unsigned long)rate, SAMPLE_RATE);
+    const double k = pow(10, input_db / 20);
+    std::vector<int32_t> slots;
+    for (size_t i = 0; i < pcm.size(); i += channels) {
+        slots.push_back((int32_t)std::max(-2147483648.0, std::min(2147483647.0, pcm[i] * 65536.0 * k)));
+    }
+    std::vector<span_t> spans;
+    for (size_t a = 0; a < slots.size(); a += 2 * SAMPLE_RATE) {
+        const size_t s = a / SAMPLE_RATE;
+        spans.push_back(span_t{ a, std::min(slots.size(), a + 2 * SAMPLE_RATE), std::to_string(s) + "-" + std::to_string(s + 2) + " s", false });
+    }
+    *result = replay(path, slots, spans);
+    const std::string out = std::string(path) + ".agc.wav";
+    host_write_wav16(out.c_str(), result->out.data(), result->out.size(), SAMPLE_RATE, 1);
+    return true;
+}
+
+int main(int argc, char** argv) {
+    double input_db = 0;
+    std::vector<const char*> files;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--input-db") == 0 && i + 1 < argc) {
+            input_db = atof(argv[++i]);
+        } else {
+            files.push_back(argv[i]);
+        }
+    }
+    if (!files.empty()) {
+        for (const char* path : files) {
+            replay_t r;
+            if (replay_file(path, input_db, &r)) HOST_CHECK(r.agc_clipped == 0, "%s: AGC clipped %lu samples", path, (unsigned long)r.agc_clipped);
+        }
+        return host_test_result();
+    }
+
+    std::vector<span_t> spans;
+    const std::vector<int32_t> slots = synthesize(&spans);
+    const replay_t direct = replay("synthesized speech at microphone level", slots, spans);
+    check_synthesized(direct, spans, "synthesized");
+    HOST_CHECK(direct.fixed_clipped > 0, "the fixed gain was expected to clip the shout and the clap");
+
+    // The same audio as a recording made with the fixed gain, replayed from the file with the gain undone.
+    // Only the clipped shout and clap differ from the direct run.
+    HOST_CHECK(host_write_wav16(FIXTURE_PATH, direct.fixed.data(), direct.fixed.size(), SAMPLE_RATE, 1), "cannot write %s", FIXTURE_PATH);
+    replay_t from_file;
+    if (replay_file(FIXTURE_PATH, -FIXED_GAIN_DB, &from_file)) {
+        HOST_CHECK(from_file.agc_clipped == 0, "fixture: AGC clipped %lu samples", (unsigned long)from_file.agc_clipped);
+        const double a = rms_db(&direct.out[spans[1].start], spans[1].end - spans[1].start);
+        const double b = rms_db(&from_file.out[spans[1].start], spans[1].end - spans[1].start);
+        HOST_CHECK(fabs(a - b) <= 1.0, "fixture: normal voice at %.1f dB RMS, %.1f dB when synthesized", b, a);
+    }
+    return host_test_result();
+}
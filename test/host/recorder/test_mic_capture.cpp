@@ -0,0 +1,109 @@
+// Test of the shared microphone capture service (mic_capture.h) on host
+// threads: blocks reach a subscriber, the channel closes with the last
+// unsubscribe, and a capture task that cannot allocate its buffers closes the
+// channel, tells its subscribers and lets the service start again once they
+// have left.
+#include "controllers/mic_capture/mic_capture.h"
+#include "host_i2s.h"
+#include "host_test.h"
+#include <atomic>
+#include <chrono>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+
+#define RAW_BLOCK_BYTES (MIC_CAPTURE_BLOCK_SAMPLES * sizeof(int32_t))
+#define BLOCKS_TO_READ 5
+#define STOP_TIMEOUT_MS 1000
+
+// The next malloc() of the capture task's raw block buffer fails while this is set.
+static std::atomic<bool> fail_raw_alloc{ false };
+
+extern "C" void* __real_malloc(size_t size);
+extern "C" void* __wrap_malloc(size_t size) {
+    if (size == RAW_BLOCK_BYTES && fail_raw_alloc.exchange(false)) return NULL;
+    return __real_malloc(size);
+}
+
+static double elapsed_ms(std::chrono::steady_clock::time_point since) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - since).count();
+}
+
+// Waits for the capture task to close the channel.
+static bool wait_channel_closed(void) {
+    const auto start = std::chrono::steady_clock::now();
+    while (host_i2s_open_channels() > 0 || host_i2s_enabled()) {
+        if (elapsed_ms(start) > STOP_TIMEOUT_MS) return false;
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    return true;
+}
+
+// A 1 kHz tone at -40 dBFS, left-justified in 32-bit slots, 4 ms per read.
+static size_t microphone(void* dst, size_t bytes) {
+    static uint32_t n = 0;
+    int32_t* slots = (int32_t*)dst;
+    for (size_t i = 0; i < bytes / sizeof(int32_t); i++, n++) {
+        slots[i] = (int32_t)(0.01 * 2147483647.0 * sin(2 * M_PI * 1000.0 * (n / REC_NUM_CHANNELS) / REC_SAMPLE_RATE)) & ~0xFF;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(4));
+    return bytes;
+}
+
+static void check_capture(const char* what) {
+    mic_capture_subscriber_t* sub = mic_capture_subscribe("test", 8);
+    HOST_CHECK(sub != NULL, "%s: subscribe failed", what);
+    if (!sub) return;
+    int blocks = 0;
+    uint32_t expect_sequence = 0;
+    bool in_order = true;
+    for (int tries = 0; tries < 50 && blocks < BLOCKS_TO_READ; tries++) {
+        const mic_capture_block_t* block = mic_capture_peek(sub, 100);
+        if (!block) continue;
+        in_order &= block->sequence == expect_sequence++ && block->frames == MIC_CAPTURE_BLOCK_FRAMES;
+        mic_capture_release(sub);
+        blocks++;
+    }
+    printf("  %s: %d blocks\n", what, blocks);
+    HOST_CHECK(blocks == BLOCKS_TO_READ, "%s: %d of %d blocks arrived", what, blocks, BLOCKS_TO_READ);
+    HOST_CHECK(in_order, "%s: blocks out of sequence or short", what);
+    HOST_CHECK(!mic_capture_failed(sub), "%s: capture reported as failed", what);
+    mic_capture_unsubscribe(sub);
+    HOST_CHECK(wait_channel_closed(), "%s: channel still open after the last unsubscribe", what);
+}
+
+static void check_allocation_failure(void) {
+    fail_raw_alloc = true;
+    mic_capture_subscriber_t* first = mic_capture_subscribe("first", 8);
+    HOST_CHECK(first != NULL, "subscribe failed before the capture task started");
+    if (!first) return;
+
+    // The subscriber waiting for audio is woken and told, rather than left to time out.
+    const auto start = std::chrono::steady_clock::now();
+    const mic_capture_block_t* block = mic_capture_peek(first, 2000);
+    const double waited_ms = elapsed_ms(start);
+    printf("  allocation failure: peek returned after %.1f ms, failed %d\n", waited_ms, mic_capture_failed(first));
+    HOST_CHECK(block == NULL, "a block arrived from a capture without buffers");
+    HOST_CHECK(mic_capture_failed(first), "the subscriber was not told the capture failed");
+    HOST_CHECK(waited_ms < 1000, "peek waited %.0f ms for a failed capture", waited_ms);
+    HOST_CHECK(mic_capture_peek(first, 0) == NULL, "peek on a failed capture returned a block");
+
+    // The task is gone and the channel closed, with the subscription still held.
+    HOST_CHECK(wait_channel_closed(), "channel left open by the failed capture task");
+    HOST_CHECK(mic_capture_subscribe("second", 8) == NULL, "a subscription to the failed capture was accepted");
+
+    // Once its subscribers have left, the service opens the channel again.
+    mic_capture_unsubscribe(first);
+    check_capture("after the failure");
+}
+
+int main(void) {
+    host_i2s_set_rx_source(microphone);
+    mic_capture_init();
+
+    check_capture("normal capture");
+    check_allocation_failure();
+
+    return host_test_result();
+}
@@ -0,0 +1,281 @@
+// Silence trimming of the recorder (audio_vad.h) on a corpus of scenes with
+// known speech bounds: vad_corpus/*.txt, or the scene files given as
+// arguments. A scene is synthesized at microphone level (voiced syllables
+// with fricatives, over the hiss of a quiet room or the rumble of a fan), run
+// through the microphone AGC in mic_capture's 512-frame blocks, and through
+// the VAD and the pre-roll the capture task keeps (audio_recorder.cpp), with
+// trimming and the journal's auto-stop on.
+//
+// Against the scene's speech bounds the trimmed recording must keep the
+// speech, keep at most the pre-roll ahead of the first word, shorten every
+// pause to at most REC_VAD_MAX_PAUSE_MS and the tail to the hangover plus the
+// rest of a pause, leave short pauses alone, and discard a recording in which
+// nothing was said. It reports the size reduction of each scene and of the
+// corpus, and writes each trimmed recording as <scene>.trimmed.wav.
+//
+// Scene files: '#' comments, then one directive per line:
+//   room quiet|fan <RMS dBFS>   the background, for the whole scene
+//   speech <seconds> <peak dBFS>
+//   pause <seconds>
+#include "controllers/audio_recorder/audio_agc.h"
+#include "controllers/audio_recorder/audio_vad.h"
+#include "controllers/mic_capture/mic_capture.h"
+#include "host_test.h"
+#include <algorithm>
+#include <filesystem>
+#include <math.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#define SAMPLE_RATE REC_SAMPLE_RATE
+#define BLOCK_FRAMES MIC_CAPTURE_BLOCK_FRAMES
+// As in audio_recorder.cpp: REC_VAD_PREROLL_MS rounded up to whole blocks.
+#define PREROLL_BLOCKS ((REC_VAD_PREROLL_MS * SAMPLE_RATE / 1000 + BLOCK_FRAMES - 1) / BLOCK_FRAMES)
+#define MS_FRAMES(ms) ((size_t)(ms) * SAMPLE_RATE / 1000)
+
+// Speech that may be lost: the first milliseconds of a syllable rising out of the noise.
+#define MIN_SPEECH_KEPT 0.99
+// Silence kept around the speech, at most: the pre-roll ahead of the first
+// word, the longest pause, and the hangover plus the written start of a pause
+// after the last word. Each may run over by the block that ends it.
+#define MAX_LEAD_FRAMES (PREROLL_BLOCKS * BLOCK_FRAMES + BLOCK_FRAMES)
+#define MAX_PAUSE_FRAMES (MS_FRAMES(REC_VAD_MAX_PAUSE_MS) + BLOCK_FRAMES)
+#define MAX_TAIL_FRAMES (MS_FRAMES(REC_VAD_MAX_PAUSE_MS - REC_VAD_PREROLL_MS) + BLOCK_FRAMES)
+// Breath pauses, up to half the longest pause kept, must come through whole.
+// Longer ones may lose some of their middle where the VAD hears the quiet
+// edges of the words around them as silence too.
+#define UNTOUCHED_PAUSE_FRAMES MS_FRAMES(REC_VAD_MAX_PAUSE_MS / 2)
+
+typedef struct {
+    size_t start, end; // Frames.
+} span_t;
+
+typedef struct {
+    std::string name;
+    std::vector<int32_t> slots;  // INMP441 slots: 24-bit samples, left-justified.
+    std::vector<span_t> speech;
+} scene_t;
+
+// Approximately normal noise, deterministic.
+static double noise(uint32_t* seed) {
+    return (host_random(seed) + host_random(seed) + host_random(seed) + host_random(seed)) * 0.866;
+}
+
+static bool load_scene(const std::string& path, scene_t* scene) {
+    FILE* fp = fopen(path.c_str(), "r");
+    if (!fp) return false;
+    scene->name = std::filesystem::path(path).stem().string();
+    scene->slots.clear();
+    scene->speech.clear();
+
+    std::vector<double> clean; // Speech, full scale = 1.
+    bool fan = false;
+    double room_db = -75;
+    uint32_t seed = 1;
+    char line[256];
+    bool ok = true;
+    while (ok && fgets(line, sizeof(line), fp)) {
+        char word[16], kind[16];
+        double a = 0, b = 0;
+        if (line[0] == '#' || sscanf(line, "%15s", word) != 1) continue;
+        if (strcmp(word, "room") == 0) {
+            ok = sscanf(line, "%*s %15s %lf", kind, &a) == 2;
+            fan = strcmp(kind, "fan") == 0;
+            room_db = a;
+        } else if (strcmp(word, "pause") == 0 && sscanf(line, "%*s %lf", &a) == 1) {
+            clean.resize(clean.size() + (size_t)(a * SAMPLE_RATE), 0.0);
+        } else if (strcmp(word, "speech") == 0 && sscanf(line, "%*s %lf %lf", &a, &b) == 2) {
+            // Voiced syllables (harmonics of a gliding 140 Hz pitch under a 4 Hz
+            // envelope), with a 120 ms fricative hiss every second.
+            const size_t start = clean.size(), len = (size_t)(a * SAMPLE_RATE);
+            const double amplitude = pow(10, b / 20);
+            double last = 0;
+            for (size_t i = 0; i < len; i++) {
+                const double t = (double)i / SAMPLE_RATE;
+                const double in_second = fmod(t, 1.0);
+                double v;
+                if (in_second >= 0.55 && in_second < 0.67) {
+                    const double n = noise(&seed);
+                    v = amplitude * 0.25 * (n - last); // First difference: the energy sits high.
+                    last = n;
+                } else {
+                    const double f0 = 140 + 20 * sin(2 * M_PI * 0.7 * t);
+                    const double envelope = pow(fabs(sin(2 * M_PI * 2 * t)), 1.5);
+                    double x = 0;
+                    for (int h = 1; h <= 12; h++) x += sin(2 * M_PI * f0 * h * t) * ((h == 4 || h == 9) ? 1.0 : 0.35) / h;
+                    v = amplitude * envelope * x / 1.4;
+                }
+                clean.push_back(v);
+            }
+            scene->speech.push_back(span_t{ start, start + len });
+        } else {
+            ok = false;
+        }
+    }
+    fclose(fp);
+    if (!ok || clean.empty()) {
+        printf("%s: not a scene file\n", path.c_str());
+        return false;
+    }
+
+    // The background: white hiss for a quiet room, low-passed noise for a fan.
+    const double room = pow(10, room_db / 20);
+    double lp = 0;
+    for (double v : clean) {
+        double n = noise(&seed);
+        if (fan) {
+            lp += 0.05 * (n - lp);
+            n = lp * 4.4; // Back to unit RMS.
+        }
+        const double x = (v + room * n) * 2147483647.0;
+        scene->slots.push_back((int32_t)std::max(-2147483648.0, std::min(2147483647.0, x)) & ~0xFF);
+    }
+    return true;
+}
+
+typedef struct {
+    std::vector<int16_t> out;   // The trimmed recording.
+    std::vector<bool> kept;     // Per input frame.
+    bool auto_stopped, saved;
+    size_t captured_frames;
+} trim_result_t;
+
+// The capture path: AGC per block, then the VAD and the capture task's pre-roll.
+static trim_result_t record(const scene_t& scene) {
+    trim_result_t r = {};
+    r.kept.assign(scene.slots.size(), false);
+    static audio_agc_t agc;
+    static audio_vad_t vad;
+    audio_agc_init(&agc, SAMPLE_RATE, NULL);
+    audio_vad_init(&vad, SAMPLE_RATE, true);
+    const uint32_t auto_stop_frames = REC_AUTO_STOP_SILENCE_S * SAMPLE_RATE;
+
+    std::vector<size_t> preroll; // Start frames of the held-back blocks, oldest first.
+    std::vector<int16_t> pcm(scene.slots.size());
+    auto write_block = [&](size_t start) {
+        const size_t n = std::min<size_t>(BLOCK_FRAMES, pcm.size() - start);
+        r.out.insert(r.out.end(), pcm.begin() + start, pcm.begin() + start + n);
+        std::fill(r.kept.begin() + start, r.kept.begin() + start + n, true);
+    };
+    for (size_t start = 0; start < scene.slots.size(); start += BLOCK_FRAMES) {
+        const size_t n = std::min<size_t>(BLOCK_FRAMES, scene.slots.size() - start);
+        const int32_t gain_from = agc.gain_q16;
+        audio_agc_process(&agc, &scene.slots[start], &pcm[start], n, 1);
+        const int32_t gain_q16 = (int32_t)(((int64_t)gain_from + agc.gain_q16) / 2);
+        r.captured_frames += n;
+
+        const audio_vad_action_t action = audio_vad_process(&vad, &pcm[start], n, 1, gain_q16);
+        if (action == AUDIO_VAD_DEFER) {
+            if (preroll.size() == PREROLL_BLOCKS) preroll.erase(preroll.begin());
+            preroll.push_back(start);
+        } else {
+            if (action == AUDIO_VAD_FLUSH_AND_WRITE) {
+                for (size_t held : preroll) write_block(held);
+                preroll.clear();
+            }
+            write_block(start);
+        }
+        if (vad.silence_frames >= auto_stop_frames) {
+            r.auto_stopped = true;
+            break;
+        }
+    }
+    r.saved = vad.heard_speech;
+    return r;
+}
+
+typedef struct {
+    size_t in_bytes, out_bytes;
+} totals_t;
+
+static void check_scene(const scene_t& scene, totals_t* totals) {
+    const trim_result_t r = record(scene);
+    const size_t in_bytes = 44 + r.captured_frames * 2;
+    const size_t out_bytes = r.saved ? 44 + r.out.size() * 2 : 0;
+    totals->in_bytes += in_bytes;
+    totals->out_bytes += out_bytes;
+    const double seconds = r.captured_frames / (double)SAMPLE_RATE;
+
+    if (scene.speech.empty()) {
+        printf("  %-20s %5.1f s  %5zu -> %4zu KB  nothing said: %s\n", scene.name.c_str(), seconds, in_bytes / 1024,
+               out_bytes / 1024, r.saved ? "SAVED" : r.auto_stopped ? "discarded by the auto-stop" : "not stopped");
+        HOST_CHECK(!r.saved && r.auto_stopped, "%s: a recording without speech was %s", scene.name.c_str(),
+                   r.saved ? "saved" : "not auto-stopped");
+        return;
+    }
+
+    size_t speech = 0, speech_kept = 0;
+    for (const span_t& s : scene.speech) {
+        speech += s.end - s.start;
+        speech_kept += (size_t)std::count(r.kept.begin() + s.start, r.kept.begin() + s.end, true);
+    }
+    auto kept_in = [&](size_t from, size_t to) {
+        to = std::min(to, r.kept.size());
+        return from < to ? (size_t)std::count(r.kept.begin() + from, r.kept.begin() + to, true) : 0;
+    };
+    const size_t lead = kept_in(0, scene.speech.front().start);
+    const size_t tail = kept_in(scene.speech.back().end, r.kept.size());
+    size_t longest_pause = 0;
+    for (size_t k = 1; k < scene.speech.size(); k++) {
+        const size_t from = scene.speech[k - 1].end, to = scene.speech[k].start;
+        const size_t kept = kept_in(from, to);
+        longest_pause = std::max(longest_pause, kept);
+        HOST_CHECK(kept <= MAX_PAUSE_FRAMES, "%s: %.2f s kept of the %.2f s pause at %.1f s", scene.name.c_str(),
+                   kept / (double)SAMPLE_RATE, (to - from) / (double)SAMPLE_RATE, from / (double)SAMPLE_RATE);
+        if (to - from <= UNTOUCHED_PAUSE_FRAMES) {
+            HOST_CHECK(kept == to - from, "%s: the %.2f s pause at %.1f s was shortened to %.2f s", scene.name.c_str(),
+                       (to - from) / (double)SAMPLE_RATE, from / (double)SAMPLE_RATE, kept / (double)SAMPLE_RATE);
+        }
+    }
+
+    const double kept_ratio = (double)speech_kept / speech;
+    printf("  %-20s %5.1f s  %5zu -> %4zu KB (%3.0f%%)  speech kept %5.1f%%, lead %.2f s, longest pause %.2f s, "
+           "tail %.2f s%s\n",
+           scene.name.c_str(), seconds, in_bytes / 1024, out_bytes / 1024, 100.0 * out_bytes / in_bytes - 100,
+           100 * kept_ratio, lead / (double)SAMPLE_RATE, longest_pause / (double)SAMPLE_RATE,
+           tail / (double)SAMPLE_RATE, r.auto_stopped ? ", auto-stopped" : "");
+    HOST_CHECK(r.saved, "%s: the recording was discarded", scene.name.c_str());
+    HOST_CHECK(kept_ratio >= MIN_SPEECH_KEPT, "%s: %.1f%% of the speech kept", scene.name.c_str(), 100 * kept_ratio);
+    HOST_CHECK(lead <= MAX_LEAD_FRAMES, "%s: %.2f s kept ahead of the first word", scene.name.c_str(),
+               lead / (double)SAMPLE_RATE);
+    HOST_CHECK(tail <= MAX_TAIL_FRAMES, "%s: %.2f s kept after the last word", scene.name.c_str(),
+               tail / (double)SAMPLE_RATE);
+    // Which is to say: the length is the speech plus at most these margins.
+    const size_t max_out = speech + MAX_LEAD_FRAMES + (scene.speech.size() - 1) * MAX_PAUSE_FRAMES + MAX_TAIL_FRAMES;
+    HOST_CHECK(r.out.size() <= max_out && r.out.size() >= speech_kept, "%s: %.2f s trimmed recording, %.2f s of speech",
+               scene.name.c_str(), r.out.size() / (double)SAMPLE_RATE, speech / (double)SAMPLE_RATE);
+    host_write_wav16((scene.name + ".trimmed.wav").c_str(), r.out.data(), r.out.size(), SAMPLE_RATE, 1);
+}
+
+int main(int argc, char** argv) {
+    std::vector<std::string> paths;
+    for (int i = 1; i < argc; i++) {
+        if (std::filesystem::is_directory(argv[i])) {
+            for (const auto& entry : std::filesystem::directory_iterator(argv[i])) {
+                if (entry.path().extension() == ".txt") paths.push_back(entry.path().string());
+            }
+        } else {
+            paths.push_back(argv[i]);
+        }
+    }
+    std::sort(paths.begin(), paths.end());
+    HOST_CHECK(!paths.empty(), "no scenes: pass vad_corpus/ or scene files");
+
+    printf("Silence trimming, 16-bit PCM at %d Hz (pre-roll %d ms, hangover %d ms, pauses up to %d ms, auto-stop %d s):\n",
+           SAMPLE_RATE, REC_VAD_PREROLL_MS, REC_VAD_HANGOVER_MS, REC_VAD_MAX_PAUSE_MS, REC_AUTO_STOP_SILENCE_S);
+    totals_t totals = {};
+    for (const std::string& path : paths) {
+        scene_t scene;
+        if (load_scene(path, &scene)) {
+            check_scene(scene, &totals);
+        } else {
+            HOST_CHECK(false, "cannot read %s", path.c_str());
+        }
+    }
+    if (totals.in_bytes > 0) {
+        printf("  corpus: %zu -> %zu KB (%.0f%%)\n", totals.in_bytes / 1024, totals.out_bytes / 1024,
+               100.0 * totals.out_bytes / totals.in_bytes - 100);
+    }
+    return host_test_result();
+}
@@ -0,0 +1,547 @@
+// Write benchmark for recordings: the old pattern (2 KB fwrite() appends to a
+// plain "wb" file) against audio_wav_writer_t (32 KB cluster-aligned batches
+// into a file preallocated in 512 KB extents, truncated on finalize).
+//
+// It runs first on a host file, timing the calls, then on the FAT volume
+// model (support/host_fat.h) with 4, 16 and 32 KB clusters on a fresh and a
+// fragmented volume, where every call is charged the card commands FatFs
+// would issue for it. That is a model written for these tests, not FatFs on a
+// real FAT image: it replays FatFs's cluster and sector handling and prices
+// the commands with a fixed SD cost model, so its card times are estimates to
+// compare write patterns with, not measurements. The host timings only show
+// that nothing regressed.
+//
+// Then crash safety on the same model: recordings (PCM and IMA-ADPCM) are cut
+// off by a power cut before their first header checkpoint, between
+// checkpoints and after finalize, and audio_wav_writer_recover() must find
+// them EMPTY, REPAIRED to exactly the checkpointed audio, or INTACT. Last, the
+// card time a 60 s recording takes with checkpoints off and every 1 to 30 s.
+//
+// And IMA-ADPCM through the writer: 30 s of mono and stereo audio, checking
+// the header (format 0x11, block_align, samples per block, byte rate, fact),
+// the block layout and each block header, then decoding it with a reference
+// decoder written here, bit-exact against the player's and within an SNR
+// bound of the input, and reporting the encoder's time per second of audio.
+#include "controllers/audio_manager/audio_health.h"
+#include "controllers/audio_manager/audio_ima_adpcm.h"
+#include "controllers/audio_recorder/audio_wav_writer.h"
+#include "config/app_config.h"
+#include "esp_timer.h"
+#include "host_fat.h"
+#include "host_test.h"
+#include <algorithm>
+#include <math.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+#define RECORDING_BYTES (8 * 1024 * 1024) // ~4.4 min of 16 kHz mono.
+#define APPEND_BYTES 2048
+#define WAV_HEADER_BYTES 44
+
+static uint8_t chunk[APPEND_BYTES];
+
+static void write_appends(const char* path) {
+    FILE* fp = fopen(path, "wb");
+    if (!fp) {
+        HOST_CHECK(false, "cannot create %s", path);
+        return;
+    }
+    // The VFS hands writes larger than its small stdio buffer straight to FatFs.
+    setvbuf(fp, NULL, _IONBF, 0);
+    for (int w = 0; w < RECORDING_BYTES; w += APPEND_BYTES) fwrite(chunk, 1, APPEND_BYTES, fp);
+    fflush(fp);
+    fsync(fileno(fp));
+    fclose(fp);
+}
+
+static void write_recording(const char* path, audio_wav_writer_t* writer) {
+    HOST_CHECK(audio_wav_writer_open(writer, path, REC_SAMPLE_RATE, 1, AUDIO_WAV_PCM_16), "cannot create %s", path);
+    for (int w = 0; w < RECORDING_BYTES; w += APPEND_BYTES) audio_wav_writer_write(writer, chunk, APPEND_BYTES);
+    HOST_CHECK(audio_wav_writer_finalize(writer), "cannot finish %s", path);
+}
+
+// --- Host file ---
+
+static void run_host_file(void) {
+    const char* path = "wav_writer_bench.wav";
+    printf("Host file (%d MB, %d-byte writes):\n", RECORDING_BYTES >> 20, APPEND_BYTES);
+
+    audio_histogram_t appends = {};
+    FILE* fp = fopen(path, "wb");
+    int64_t start = esp_timer_get_time();
+    for (int w = 0; w < RECORDING_BYTES; w += APPEND_BYTES) {
+        const int64_t t = esp_timer_get_time();
+        fwrite(chunk, 1, APPEND_BYTES, fp);
+        audio_histogram_record(&appends, (uint32_t)(esp_timer_get_time() - t));
+    }
+    fflush(fp);
+    fsync(fileno(fp));
+    fclose(fp);
+    printf("  %-14s %5lu writes, %7.1f ms in total, p99 <= %5lu us, max %6lu us\n", "2 KB appends",
+           (unsigned long)appends.count, (esp_timer_get_time() - start) / 1000.0,
+           (unsigned long)audio_histogram_percentile(&appends, 99), (unsigned long)appends.max_us);
+
+    static audio_wav_writer_t writer;
+    start = esp_timer_get_time();
+    write_recording(path, &writer);
+    printf("  %-14s %5lu writes, %7.1f ms in total, p99 <= %5lu us, max %6lu us\n", "audio_wav_writer",
+           (unsigned long)writer.write_us.count, (esp_timer_get_time() - start) / 1000.0,
+           (unsigned long)audio_histogram_percentile(&writer.write_us, 99), (unsigned long)writer.write_us.max_us);
+
+    struct stat st;
+    HOST_CHECK(stat(path, &st) == 0 && st.st_size == WAV_HEADER_BYTES + RECORDING_BYTES,
+               "host file is %lld bytes, expected %d", (long long)st.st_size, WAV_HEADER_BYTES + RECORDING_BYTES);
+    unlink(path);
+}
+
+// --- FAT volume model ---
+
+typedef struct {
+    host_fat_stats_t stats;
+    uint32_t write_calls;
+    uint32_t write_p50_us, write_max_us;
+    uint32_t write_allocations; //!< Clusters linked inside fwrite() calls.
+    uint32_t batch_partial_reads; //!< Sectors read back inside whole-sector writes.
+} fat_run_t;
+
+static fat_run_t summarize(void) {
+    fat_run_t run = {};
+    host_fat_get_stats(&run.stats);
+    std::vector<uint32_t> write_us;
+    for (const host_fat_call_t& call : host_fat_calls()) {
+        if (call.op != 'w') continue;
+        write_us.push_back(call.card_us);
+        run.write_allocations += call.clusters_allocated;
+        if (call.bytes % 512 == 0) run.batch_partial_reads += call.partial_reads;
+    }
+    run.write_calls = (uint32_t)write_us.size();
+    if (!write_us.empty()) {
+        std::sort(write_us.begin(), write_us.end());
+        run.write_p50_us = write_us[write_us.size() / 2];
+        run.write_max_us = write_us.back();
+    }
+    return run;
+}
+
+static void print_run(const char* name, const fat_run_t& run) {
+    // Card time per second of 16 kHz mono audio, the budget the writer task has.
+    const double audio_s = RECORDING_BYTES / (double)(REC_SAMPLE_RATE * sizeof(int16_t));
+    printf("    %-16s %7.1f ms card (%5.1f ms per s of audio), %5lu fwrite: p50 %5lu / max %6lu us, "
+           "%5lu commands, %4lu random, %4lu FAT sectors, %4lu clusters linked in fwrite, %lu partial reads\n",
+           name, run.stats.card_us / 1000.0, run.stats.card_us / 1000.0 / audio_s, (unsigned long)run.write_calls,
+           (unsigned long)run.write_p50_us, (unsigned long)run.write_max_us,
+           (unsigned long)(run.stats.read_commands + run.stats.write_commands), (unsigned long)run.stats.random_writes,
+           (unsigned long)run.stats.fat_sector_writes, (unsigned long)run.write_allocations,
+           (unsigned long)run.stats.partial_reads);
+}
+
+static void run_fat(uint32_t cluster_bytes, uint32_t fragment_stride) {
+    const char* path = HOST_FAT_MOUNT "REC.WAV";
+    host_fat_config_t cfg = host_fat_default_config();
+    cfg.cluster_bytes = cluster_bytes;
+    host_fat_format(&cfg);
+    if (fragment_stride) host_fat_fragment(fragment_stride);
+    const uint32_t free_clusters = host_fat_free_clusters();
+    printf("  %2lu KB clusters, %s:\n", (unsigned long)(cluster_bytes / 1024),
+           fragment_stride ? "fragmented volume" : "fresh volume");
+
+    host_fat_reset_stats();
+    write_appends(path);
+    const fat_run_t appends = summarize();
+    print_run("2 KB appends", appends);
+    unlink(path);
+    HOST_CHECK(host_fat_free_clusters() == free_clusters, "appends: %lu clusters not freed",
+               (unsigned long)(free_clusters - host_fat_free_clusters()));
+
+    static audio_wav_writer_t writer;
+    host_fat_reset_stats();
+    write_recording(path, &writer);
+    const fat_run_t batched = summarize();
+    print_run("audio_wav_writer", batched);
+
+    const uint32_t size = WAV_HEADER_BYTES + RECORDING_BYTES;
+    std::vector<uint8_t> data;
+    HOST_CHECK(host_fat_read_file(path, &data) && data.size() == size, "recording is %zu bytes, expected %lu",
+               data.size(), (unsigned long)size);
+    if (data.size() == size) {
+        HOST_CHECK(memcmp(data.data(), "RIFF", 4) == 0 && memcmp(data.data() + 36, "data", 4) == 0, "bad WAV header");
+        bool audio_ok = true;
+        for (uint32_t i = WAV_HEADER_BYTES; i < size; i++) audio_ok &= data[i] == chunk[(i - WAV_HEADER_BYTES) % APPEND_BYTES];
+        HOST_CHECK(audio_ok, "audio in the recording differs from what was written");
+    }
+    // The preallocated tail must be handed back: exactly the clusters the file needs stay linked.
+    const uint32_t chain = host_fat_chain_length(path);
+    HOST_CHECK(chain == (size + cluster_bytes - 1) / cluster_bytes, "recording holds %lu clusters for %lu bytes",
+               (unsigned long)chain, (unsigned long)size);
+    HOST_CHECK(batched.write_allocations == 0, "audio_wav_writer linked %lu clusters inside fwrite()",
+               (unsigned long)batched.write_allocations);
+    // Only the header rewrite and the short last batch may merge into a sector; the batches are whole sectors.
+    HOST_CHECK(batched.batch_partial_reads == 0, "audio_wav_writer read back %lu sectors inside its batches",
+               (unsigned long)batched.batch_partial_reads);
+    HOST_CHECK(batched.stats.card_us < appends.stats.card_us, "audio_wav_writer takes more card time than appends");
+    unlink(path);
+    HOST_CHECK(host_fat_free_clusters() == free_clusters, "recording: %lu clusters not freed",
+               (unsigned long)(free_clusters - host_fat_free_clusters()));
+}
+
+// --- Checkpoints and recovery ---
+
+#define APPEND_FRAMES (APPEND_BYTES / sizeof(int16_t))
+#define APPEND_US ((int64_t)APPEND_FRAMES * 1000000 / REC_SAMPLE_RATE)
+#define REFERENCE_SECONDS 40.0
+
+// What the header of a WAV file says, and where its audio is.
+typedef struct {
+    uint32_t riff_size;
+    uint16_t format, block_align;
+    uint32_t fact_frames;       //!< 0 without a fact chunk.
+    uint32_t data_offset, data_size;
+} wav_view_t;
+
+static uint32_t le32(const uint8_t* p) { return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24; }
+static uint16_t le16(const uint8_t* p) { return (uint16_t)(p[0] | p[1] << 8); }
+
+static bool parse_wav(const std::vector<uint8_t>& file, wav_view_t* wav) {
+    *wav = {};
+    if (file.size() < 12 || memcmp(file.data(), "RIFF", 4) != 0 || memcmp(file.data() + 8, "WAVE", 4) != 0) return false;
+    wav->riff_size = le32(file.data() + 4);
+    for (size_t pos = 12; pos + 8 <= file.size();) {
+        const uint8_t* chunk_header = file.data() + pos;
+        const uint32_t size = le32(chunk_header + 4);
+        if (memcmp(chunk_header, "data", 4) == 0) {
+            wav->data_offset = (uint32_t)pos + 8;
+            wav->data_size = size;
+            return true;
+        }
+        if (pos + 8 + size > file.size()) return false;
+        if (memcmp(chunk_header, "fmt ", 4) == 0 && size >= 16) {
+            wav->format = le16(chunk_header + 8);
+            wav->block_align = le16(chunk_header + 20);
+        } else if (memcmp(chunk_header, "fact", 4) == 0 && size >= 4) {
+            wav->fact_frames = le32(chunk_header + 8);
+        }
+        pos += 8 + size + (size & 1);
+    }
+    return false;
+}
+
+// The microphone stand-in: a tone with some noise, the same for every run.
+static void make_audio(int16_t* pcm, uint32_t first_frame, uint32_t frames) {
+    for (uint32_t i = 0; i < frames; i++) {
+        const uint32_t n = first_frame + i;
+        uint32_t seed = n * 2654435761u + 1;
+        pcm[i] = (int16_t)lrint(6000.0 * sin(2 * M_PI * 220.0 * n / REC_SAMPLE_RATE) + 800.0 * host_random(&seed));
+    }
+}
+
+typedef struct {
+    uint32_t checkpoints;
+    uint32_t checkpointed_bytes; //!< Audio bytes the last checkpoint put in the header.
+    uint64_t card_us;            //!< Card time of the whole recording on the model.
+} recording_t;
+
+// Records `seconds` of audio with esp_timer time running `pace` times as fast as
+// the audio (0 stops it), so checkpoints land every REC_CHECKPOINT_INTERVAL_MS /
+// pace of audio. Finalizes the file, or cuts the power before it can.
+static recording_t record(const char* path, audio_wav_encoding_t encoding, double seconds, double pace, bool cut) {
+    static audio_wav_writer_t writer;
+    recording_t rec = {};
+    host_fat_reset_stats();
+    HOST_CHECK(audio_wav_writer_open(&writer, path, REC_SAMPLE_RATE, 1, encoding), "cannot create %s", path);
+    int16_t pcm[APPEND_FRAMES];
+    const uint32_t appends = (uint32_t)(seconds * REC_SAMPLE_RATE / APPEND_FRAMES);
+    for (uint32_t a = 0; a < appends; a++) {
+        make_audio(pcm, a * APPEND_FRAMES, APPEND_FRAMES);
+        host_advance_time((int64_t)(APPEND_US * pace));
+        audio_wav_writer_write(&writer, pcm, sizeof(pcm));
+        if (writer.checkpoint_us.count != rec.checkpoints) {
+            rec.checkpoints = writer.checkpoint_us.count;
+            rec.checkpointed_bytes = writer.file_pos - writer.header_bytes;
+        }
+    }
+    if (cut) {
+        host_fat_power_cut();
+        audio_wav_writer_close(&writer);
+    } else {
+        HOST_CHECK(audio_wav_writer_finalize(&writer), "cannot finish %s", path);
+    }
+    host_fat_stats_t stats;
+    host_fat_get_stats(&stats);
+    rec.card_us = stats.card_us;
+    return rec;
+}
+
+static const char* recovery_name(audio_wav_recovery_t r) {
+    switch (r) {
+    case AUDIO_WAV_INTACT: return "INTACT";
+    case AUDIO_WAV_REPAIRED: return "REPAIRED";
+    case AUDIO_WAV_EMPTY: return "EMPTY";
+    default: return "UNRECOVERABLE";
+    }
+}
+
+// Cuts a recording off after `seconds` and recovers it; the audio that is left must
+// be what the last checkpoint covered, exactly as the finished recording has it.
+static void check_cut(const char* what, audio_wav_encoding_t encoding, double seconds,
+                      const std::vector<uint8_t>& reference) {
+    const char* path = HOST_FAT_MOUNT "CUT.WAV";
+    const recording_t rec = record(path, encoding, seconds, 1.0, true);
+    const audio_wav_recovery_t result = audio_wav_writer_recover(path);
+    std::vector<uint8_t> file;
+    host_fat_read_file(path, &file);
+    wav_view_t wav, ref;
+    const bool parsed = parse_wav(file, &wav);
+    parse_wav(reference, &ref);
+    printf("  %-6s cut at %5.1f s: %u checkpoints, %-8s %7lu bytes of audio kept (%.1f s)\n", what, seconds,
+           rec.checkpoints, recovery_name(result), (unsigned long)wav.data_size,
+           (double)wav.data_size / ref.data_size * REFERENCE_SECONDS);
+
+    if (rec.checkpoints == 0) {
+        HOST_CHECK(result == AUDIO_WAV_EMPTY, "%s cut before the first checkpoint: %s", what, recovery_name(result));
+    } else {
+        HOST_CHECK(result == AUDIO_WAV_REPAIRED, "%s cut at %.1f s: %s", what, seconds, recovery_name(result));
+        HOST_CHECK(parsed && wav.data_size == rec.checkpointed_bytes, "%s: %lu bytes of audio recovered, %lu checkpointed",
+                   what, (unsigned long)wav.data_size, (unsigned long)rec.checkpointed_bytes);
+        HOST_CHECK(file.size() == wav.data_offset + wav.data_size && wav.riff_size == file.size() - 8,
+                   "%s: file of %zu bytes with RIFF size %lu and %lu bytes of audio", what, file.size(),
+                   (unsigned long)wav.riff_size, (unsigned long)wav.data_size);
+        HOST_CHECK(wav.data_size <= ref.data_size &&
+                       memcmp(file.data() + wav.data_offset, reference.data() + ref.data_offset, wav.data_size) == 0,
+                   "%s: the recovered audio is not the start of the recording", what);
+        if (encoding == AUDIO_WAV_IMA_ADPCM) {
+            // A block cut off by the checkpoint counts up to its last whole group.
+            const uint32_t frames = wav.data_size / ref.block_align * audio_ima_adpcm_frames_per_block(ref.block_align, 1) +
+                                    audio_ima_adpcm_frames_in(wav.data_size % ref.block_align, 1);
+            HOST_CHECK(wav.fact_frames == frames,
+                       "%s: fact chunk says %lu frames for %lu bytes of audio", what, (unsigned long)wav.fact_frames,
+                       (unsigned long)wav.data_size);
+        }
+        const std::vector<uint8_t> repaired = file;
+        HOST_CHECK(audio_wav_writer_recover(path) == AUDIO_WAV_INTACT, "%s: a repaired file is not INTACT", what);
+        host_fat_read_file(path, &file);
+        HOST_CHECK(file == repaired, "%s: recovering a repaired file changed it", what);
+    }
+    unlink(path);
+}
+
+static void run_recovery(void) {
+    printf("Recordings cut off by a reset, recovered (checkpoints every %d ms, FAT volume model):\n",
+           REC_CHECKPOINT_INTERVAL_MS);
+    host_fat_config_t cfg = host_fat_default_config();
+    host_fat_format(&cfg);
+    for (audio_wav_encoding_t encoding : { AUDIO_WAV_PCM_16, AUDIO_WAV_IMA_ADPCM }) {
+        const char* what = encoding == AUDIO_WAV_PCM_16 ? "PCM" : "ADPCM";
+        const char* path = HOST_FAT_MOUNT "REF.WAV";
+        record(path, encoding, REFERENCE_SECONDS, 1.0, false);
+        std::vector<uint8_t> reference;
+        host_fat_read_file(path, &reference);
+
+        // A finished recording is left alone.
+        HOST_CHECK(audio_wav_writer_recover(path) == AUDIO_WAV_INTACT, "%s: a finalized file is not INTACT", what);
+        std::vector<uint8_t> after;
+        host_fat_read_file(path, &after);
+        HOST_CHECK(after == reference, "%s: recovering a finalized file changed it", what);
+        printf("  %-6s finalized:        %-8s %7lu bytes\n", what, "INTACT", (unsigned long)reference.size());
+
+        // Before the first checkpoint, between checkpoints, just after one and well into the recording.
+        for (double seconds : { 3.0, 7.5, 12.3, 25.0, 38.9 }) check_cut(what, encoding, seconds, reference);
+        unlink(path);
+    }
+}
+
+static void run_checkpoint_cost(void) {
+    const double seconds = 60.0;
+    printf("Card time of checkpoints (%.0f s recordings, FAT volume model):\n", seconds);
+    const host_fat_config_t cfg = host_fat_default_config();
+    const char* path = HOST_FAT_MOUNT "CKPT.WAV";
+    for (audio_wav_encoding_t encoding : { AUDIO_WAV_PCM_16, AUDIO_WAV_IMA_ADPCM }) {
+        uint64_t off_us = 0;
+        for (uint32_t interval_ms : { 0, 1000, 2000, 5000, 10000, 30000 }) {
+            const double pace = interval_ms ? (double)REC_CHECKPOINT_INTERVAL_MS / interval_ms : 0.0;
+            host_fat_format(&cfg); // The same clusters every time, so only the checkpoints differ.
+            const recording_t rec = record(path, encoding, seconds, pace, false);
+            unlink(path);
+            if (interval_ms == 0) off_us = rec.card_us;
+            char interval[16];
+            if (interval_ms) snprintf(interval, sizeof(interval), "%5.0f s", interval_ms / 1000.0);
+            else snprintf(interval, sizeof(interval), "  off");
+            const double per_checkpoint_ms = rec.checkpoints ? (rec.card_us - (double)off_us) / 1000.0 / rec.checkpoints : 0;
+            printf("  %-6s every %s: %3u checkpoints, %6.1f ms card (%5.2f ms per s of audio), %5.2f ms per checkpoint\n",
+                   encoding == AUDIO_WAV_PCM_16 ? "PCM" : "ADPCM", interval, rec.checkpoints, rec.card_us / 1000.0,
+                   rec.card_us / 1000.0 / seconds, per_checkpoint_ms);
+            if (interval_ms == 0) {
+                HOST_CHECK(rec.checkpoints == 0, "%u checkpoints with the clock stopped", rec.checkpoints);
+            } else {
+                // At most one per interval; never fewer than one per batch would allow.
+                const uint32_t most = (uint32_t)(seconds * 1000 / interval_ms);
+                HOST_CHECK(rec.checkpoints >= 1 && rec.checkpoints <= most, "%u checkpoints at %lu ms, at most %lu",
+                           rec.checkpoints, (unsigned long)interval_ms, (unsigned long)most);
+                HOST_CHECK(per_checkpoint_ms > 0 && per_checkpoint_ms < 20, "a checkpoint costs %.2f ms of card time",
+                           per_checkpoint_ms);
+            }
+        }
+    }
+}
+
+// --- IMA-ADPCM recordings ---
+
+#define ADPCM_SECONDS 30.0
+#define ADPCM_MIN_SNR_DB 25.0
+
+static const int16_t IMA_STEPS[89] = {
+    7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45, 50, 55, 60, 66, 73, 80, 88, 97,
+    107, 118, 130, 143, 157, 173, 190, 209, 230, 253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658, 724, 796,
+    876, 963, 1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024, 3327, 3660, 4026, 4428, 4871,
+    5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623,
+    27086, 29794, 32767,
+};
+static const int8_t IMA_INDEX_STEPS[16] = { -1, -1, -1, -1, 2, 4, 6, 8, -1, -1, -1, -1, 2, 4, 6, 8 };
+
+// The IMA-ADPCM reference decoder (Microsoft's multimedia standards update,
+// 1992), independent of audio_ima_adpcm.cpp: one block of `channels` channels
+// into interleaved samples. Returns the frames decoded, 0 if a header is invalid.
+static uint32_t reference_decode_block(const uint8_t* block, uint32_t block_bytes, uint16_t channels, int16_t* out) {
+    int32_t predictor[2];
+    int32_t index[2];
+    for (uint16_t c = 0; c < channels; c++) {
+        predictor[c] = (int16_t)le16(block + 4 * c);
+        index[c] = block[4 * c + 2];
+        if (index[c] > 88 || block[4 * c + 3] != 0) return 0;
+        out[c] = (int16_t)predictor[c];
+    }
+    const uint32_t groups = (block_bytes - 4 * channels) / (4 * channels); // 8 frames per channel each.
+    for (uint32_t g = 0; g < groups; g++) {
+        for (uint16_t c = 0; c < channels; c++) {
+            const uint8_t* codes = block + 4 * channels + (g * channels + c) * 4;
+            for (uint32_t i = 0; i < 8; i++) {
+                const uint8_t code = (codes[i / 2] >> (4 * (i & 1))) & 0x0F;
+                const int32_t step = IMA_STEPS[index[c]];
+                int32_t diff = step >> 3;
+                if (code & 4) diff += step;
+                if (code & 2) diff += step >> 1;
+                if (code & 1) diff += step >> 2;
+                predictor[c] += (code & 8) ? -diff : diff;
+                predictor[c] = predictor[c] > 32767 ? 32767 : predictor[c] < -32768 ? -32768 : predictor[c];
+                index[c] += IMA_INDEX_STEPS[code];
+                index[c] = index[c] < 0 ? 0 : index[c] > 88 ? 88 : index[c];
+                out[(1 + g * 8 + i) * channels + c] = (int16_t)predictor[c];
+            }
+        }
+    }
+    return 1 + groups * 8;
+}
+
+static void run_adpcm(uint16_t channels) {
+    const char* path = HOST_FAT_MOUNT "ADPCM.WAV";
+    const host_fat_config_t cfg = host_fat_default_config();
+    host_fat_format(&cfg);
+
+    // The microphone stand-in on the left, a quieter tone a fifth up on the right.
+    const uint32_t frames = (uint32_t)(ADPCM_SECONDS * REC_SAMPLE_RATE) + 123; // A short last block.
+    std::vector<int16_t> pcm((size_t)frames * channels), mono(frames);
+    make_audio(mono.data(), 0, frames);
+    for (uint32_t i = 0; i < frames; i++) {
+        pcm[(size_t)i * channels] = mono[i];
+        if (channels == 2) pcm[(size_t)i * 2 + 1] = (int16_t)lrint(3000.0 * sin(2 * M_PI * 330.0 * i / REC_SAMPLE_RATE));
+    }
+
+    static audio_wav_writer_t writer;
+    HOST_CHECK(audio_wav_writer_open(&writer, path, REC_SAMPLE_RATE, channels, AUDIO_WAV_IMA_ADPCM), "cannot create %s",
+               path);
+    const double start = host_now_s();
+    for (uint32_t pos = 0; pos < frames; pos += APPEND_FRAMES / channels) {
+        const uint32_t n = std::min<uint32_t>(APPEND_FRAMES / channels, frames - pos);
+        audio_wav_writer_write(&writer, &pcm[(size_t)pos * channels], (size_t)n * channels * sizeof(int16_t));
+    }
+    const uint64_t encode_us = writer.encode_us;
+    HOST_CHECK(audio_wav_writer_finalize(&writer), "cannot finish %s", path);
+    const double write_s = host_now_s() - start;
+
+    std::vector<uint8_t> file;
+    wav_view_t wav;
+    HOST_CHECK(host_fat_read_file(path, &file) && parse_wav(file, &wav), "%s is not a WAV file", path);
+    unlink(path);
+    if (file.size() < 48 || wav.data_offset == 0) return;
+
+    // Header: format 0x11, 4 bits, block_align and samples per block as the decoders read them.
+    const uint8_t* fmt = file.data() + 20;
+    const uint16_t block_align = le16(fmt + 12);
+    const uint32_t frames_per_block = le16(fmt + 18);
+    const uint32_t expected_fpb = (REC_ADPCM_BLOCK_ALIGN - 4u * channels) * 2 / channels + 1;
+    HOST_CHECK(memcmp(file.data() + 12, "fmt ", 4) == 0 && le32(file.data() + 16) == 20, "fmt chunk of %lu bytes",
+               (unsigned long)le32(file.data() + 16));
+    HOST_CHECK(le16(fmt) == AUDIO_IMA_ADPCM_WAV_FORMAT && le16(fmt + 2) == channels && le32(fmt + 4) == REC_SAMPLE_RATE &&
+                   le16(fmt + 14) == 4 && le16(fmt + 16) == 2,
+               "fmt: format 0x%x, %u channels, %lu Hz, %u bits, extra %u", le16(fmt), le16(fmt + 2),
+               (unsigned long)le32(fmt + 4), le16(fmt + 14), le16(fmt + 16));
+    HOST_CHECK(block_align == REC_ADPCM_BLOCK_ALIGN && frames_per_block == expected_fpb,
+               "block_align %u, %lu samples per block, expected %lu", block_align, (unsigned long)frames_per_block,
+               (unsigned long)expected_fpb);
+    HOST_CHECK(le32(fmt + 8) == (uint32_t)((uint64_t)REC_SAMPLE_RATE * block_align / frames_per_block),
+               "byte rate %lu", (unsigned long)le32(fmt + 8));
+    const uint32_t full_blocks = frames / frames_per_block, last_frames = frames % frames_per_block;
+    const uint32_t last_bytes = last_frames ? 4u * channels + (last_frames - 1 + 7) / 8 * 4 * channels : 0;
+    const uint32_t expected_data = full_blocks * block_align + last_bytes;
+    HOST_CHECK(wav.fact_frames == frames && wav.data_size == expected_data &&
+                   file.size() == wav.data_offset + wav.data_size && wav.riff_size == file.size() - 8,
+               "fact %lu frames (expected %lu), %lu bytes of data (expected %lu) in a %zu-byte file",
+               (unsigned long)wav.fact_frames, (unsigned long)frames, (unsigned long)wav.data_size,
+               (unsigned long)expected_data, file.size());
+
+    // Decode every block with the reference decoder and with the player's, and compare with the input.
+    std::vector<int16_t> decoded, block_out((size_t)frames_per_block * channels), player_out(block_out.size());
+    bool headers_ok = true, player_agrees = true;
+    for (uint32_t off = 0; off < wav.data_size; off += block_align) {
+        const uint32_t bytes = std::min<uint32_t>(block_align, wav.data_size - off);
+        const uint8_t* block = file.data() + wav.data_offset + off;
+        const uint32_t n = reference_decode_block(block, bytes, channels, block_out.data());
+        headers_ok &= n > 0;
+        player_agrees &= audio_ima_adpcm_decode_block(block, bytes, channels, player_out.data()) == n &&
+                         memcmp(player_out.data(), block_out.data(), (size_t)n * channels * sizeof(int16_t)) == 0;
+        decoded.insert(decoded.end(), block_out.begin(), block_out.begin() + (size_t)n * channels);
+    }
+    HOST_CHECK(headers_ok, "a block header has a step index above 88 or a nonzero reserved byte");
+    HOST_CHECK(player_agrees, "the player's decoder and the reference decoder disagree");
+    HOST_CHECK(decoded.size() >= pcm.size(), "%zu samples decoded for %zu", decoded.size(), pcm.size());
+    for (uint16_t c = 0; c < channels && decoded.size() >= pcm.size(); c++) {
+        double signal = 0, noise = 0;
+        for (uint32_t i = 0; i < frames; i++) {
+            const double x = pcm[(size_t)i * channels + c], e = decoded[(size_t)i * channels + c] - x;
+            signal += x * x;
+            noise += e * e;
+        }
+        const double snr_db = 10 * log10(signal / (noise > 0 ? noise : 1));
+        printf("  %u ch, channel %u: SNR %.1f dB\n", channels, c, snr_db);
+        HOST_CHECK(snr_db >= ADPCM_MIN_SNR_DB, "channel %u: SNR %.1f dB, expected at least %.1f", c, snr_db,
+                   ADPCM_MIN_SNR_DB);
+    }
+
+    const double audio_s = (double)frames / REC_SAMPLE_RATE;
+    printf("  %u ch: %.0f s -> %lu bytes (%.1f%% of PCM), encoding %.0f us per s of audio (%.0fx real time), "
+           "writer %.1f ms in total on the host\n",
+           channels, audio_s, (unsigned long)file.size(), 100.0 * wav.data_size / (frames * channels * 2.0),
+           encode_us / audio_s, audio_s * 1e6 / (encode_us ? encode_us : 1), write_s * 1000);
+}
+
+int main(void) {
+    for (size_t i = 0; i < sizeof(chunk); i++) chunk[i] = (uint8_t)(i * 7 + 3);
+
+    run_host_file();
+
+    const host_fat_config_t cfg = host_fat_default_config();
+    printf("FAT volume model, not a real FAT image (%lu MB, read %lu us + write %lu us per command, +%lu us per random write, %lu bytes/ms):\n",
+           (unsigned long)cfg.volume_mb, (unsigned long)cfg.read_command_us, (unsigned long)cfg.write_command_us,
+           (unsigned long)cfg.random_write_us, (unsigned long)cfg.bytes_per_ms);
+    for (uint32_t cluster_kb : { 4, 16, 32 }) {
+        run_fat(cluster_kb * 1024, 0);
+        run_fat(cluster_kb * 1024, 3); // One cluster in three taken.
+    }
+    run_recovery();
+    run_checkpoint_cost();
+    printf("IMA-ADPCM recordings through audio_wav_writer (%.0f s, FAT volume model):\n", ADPCM_SECONDS);
+    run_adpcm(1);
+    run_adpcm(2);
+    return host_test_result();
+}
@@ -0,0 +1,50 @@
+// Host stand-in for cJSON.h, implemented by support/host_cjson.cpp: the
+// parsing half of the API, enough to read the servers' JSON answers, and the
+// few calls that build and print the small documents the firmware saves.
+#pragma once
+#include <stddef.h>
+
+#define cJSON_Invalid 0
+#define cJSON_False (1 << 0)
+#define cJSON_True (1 << 1)
+#define cJSON_NULL (1 << 2)
+#define cJSON_Number (1 << 3)
+#define cJSON_String (1 << 4)
+#define cJSON_Array (1 << 5)
+#define cJSON_Object (1 << 6)
+
+typedef struct cJSON {
+    struct cJSON* next;
+    struct cJSON* prev;
+    struct cJSON* child;
+    int type;
+    char* valuestring;
+    int valueint;
+    double valuedouble;
+    char* string;
+} cJSON;
+
+typedef int cJSON_bool;
+
+cJSON* cJSON_Parse(const char* value);
+void cJSON_Delete(cJSON* item);
+int cJSON_GetArraySize(const cJSON* array);
+cJSON* cJSON_GetArrayItem(const cJSON* array, int index);
+cJSON* cJSON_GetObjectItem(const cJSON* object, const char* string);
+cJSON* cJSON_GetObjectItemCaseSensitive(const cJSON* object, const char* string);
+cJSON_bool cJSON_IsString(const cJSON* item);
+cJSON_bool cJSON_IsNumber(const cJSON* item);
+cJSON_bool cJSON_IsArray(const cJSON* item);
+cJSON_bool cJSON_IsObject(const cJSON* item);
+
+cJSON* cJSON_ParseWithLength(const char* value, size_t buffer_length);
+cJSON* cJSON_CreateArray(void);
+cJSON* cJSON_CreateObject(void);
+cJSON_bool cJSON_AddItemToArray(cJSON* array, cJSON* item);
+cJSON* cJSON_AddStringToObject(cJSON* object, const char* name, const char* string);
+cJSON* cJSON_AddNumberToObject(cJSON* object, const char* name, double number);
+/** @brief The item as compact JSON, allocated with malloc(). */
+char* cJSON_PrintUnformatted(const cJSON* item);
+
+#define cJSON_ArrayForEach(element, array) \
+    for (element = (array) != NULL ? (array)->child : NULL; element != NULL; element = element->next)
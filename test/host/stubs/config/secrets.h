@@ -0,0 +1,8 @@
+// Host stand-in for config/secrets.h (see main/config/secrets_template.h):
+// placeholders, the host tests only talk to local servers.
+#pragma once
+#define WIFI_SSID "host-test"
+#define WIFI_PASS "host-test"
+#define STREAMING_SERVER_IP "127.0.0.1"
+#define STREAMING_SERVER_PORT 8888
+#define GROQ_API_KEY "host-test-key"
@@ -0,0 +1,5 @@
+// Host stand-in for driver/gpio.h: pin numbers only.
+#pragma once
+#include "freertos/FreeRTOS.h"
+typedef int gpio_num_t;
+enum { GPIO_NUM_NC=-1, GPIO_NUM_0=0,GPIO_NUM_1,GPIO_NUM_2,GPIO_NUM_3,GPIO_NUM_4,GPIO_NUM_5,GPIO_NUM_6,GPIO_NUM_7,GPIO_NUM_8,GPIO_NUM_9,GPIO_NUM_10,GPIO_NUM_11,GPIO_NUM_12,GPIO_NUM_13,GPIO_NUM_14,GPIO_NUM_15,GPIO_NUM_16,GPIO_NUM_17,GPIO_NUM_18, GPIO_NUM_38=38,GPIO_NUM_39,GPIO_NUM_40,GPIO_NUM_41,GPIO_NUM_42, GPIO_NUM_48=48 };
@@ -0,0 +1,36 @@
+// Host stand-in for driver/i2s_std.h: the configuration types and the
+// channel calls, which support/host_i2s.cpp implements on buffers.
+#pragma once
+#include "driver/gpio.h"
+typedef void* i2s_chan_handle_t;
+typedef enum { I2S_NUM_0, I2S_NUM_1 } i2s_port_t;
+typedef enum { I2S_ROLE_MASTER, I2S_ROLE_SLAVE } i2s_role_t;
+typedef enum { I2S_DATA_BIT_WIDTH_8BIT=8, I2S_DATA_BIT_WIDTH_16BIT=16, I2S_DATA_BIT_WIDTH_24BIT=24, I2S_DATA_BIT_WIDTH_32BIT=32 } i2s_data_bit_width_t;
+typedef enum { I2S_SLOT_BIT_WIDTH_AUTO=0, I2S_SLOT_BIT_WIDTH_16BIT=16, I2S_SLOT_BIT_WIDTH_32BIT=32 } i2s_slot_bit_width_t;
+typedef enum { I2S_SLOT_MODE_MONO=1, I2S_SLOT_MODE_STEREO=2 } i2s_slot_mode_t;
+typedef enum { I2S_STD_SLOT_LEFT=1, I2S_STD_SLOT_RIGHT=2, I2S_STD_SLOT_BOTH=3 } i2s_std_slot_mask_t;
+typedef enum { I2S_CLK_SRC_DEFAULT } i2s_clock_src_t;
+typedef enum { I2S_MCLK_MULTIPLE_256=256 } i2s_mclk_multiple_t;
+#define I2S_GPIO_UNUSED GPIO_NUM_NC
+typedef struct { i2s_port_t id; i2s_role_t role; uint32_t dma_desc_num; uint32_t dma_frame_num; bool auto_clear; bool auto_clear_before_cb; int intr_priority; } i2s_chan_config_t;
+#define I2S_CHANNEL_DEFAULT_CONFIG(i2s_num, i2s_role) { .id = i2s_num, .role = i2s_role, .dma_desc_num = 6, .dma_frame_num = 240, .auto_clear = false }
+typedef struct { uint32_t sample_rate_hz; i2s_clock_src_t clk_src; uint32_t ext_clk_freq_hz; i2s_mclk_multiple_t mclk_multiple; } i2s_std_clk_config_t;
+typedef struct { i2s_data_bit_width_t data_bit_width; i2s_slot_bit_width_t slot_bit_width; i2s_slot_mode_t slot_mode; i2s_std_slot_mask_t slot_mask; uint32_t ws_width; bool ws_pol; bool bit_shift; bool left_align; bool big_endian; bool bit_order_lsb; } i2s_std_slot_config_t;
+typedef struct { uint32_t mclk_inv:1; uint32_t bclk_inv:1; uint32_t ws_inv:1; } i2s_inv_flags_t;
+typedef struct { gpio_num_t mclk, bclk, ws, dout, din; i2s_inv_flags_t invert_flags; } i2s_std_gpio_config_t;
+typedef struct { i2s_std_clk_config_t clk_cfg; i2s_std_slot_config_t slot_cfg; i2s_std_gpio_config_t gpio_cfg; } i2s_std_config_t;
+#define I2S_STD_PHILIPS_SLOT_DEFAULT_CONFIG(bits, mode) { .data_bit_width = bits, .slot_bit_width = I2S_SLOT_BIT_WIDTH_AUTO, .slot_mode = mode, .slot_mask = I2S_STD_SLOT_BOTH, .ws_width = bits, .ws_pol = false, .bit_shift = true, .left_align = true, .big_endian = false, .bit_order_lsb = false }
+#define I2S_STD_CLK_DEFAULT_CONFIG(rate) { .sample_rate_hz = rate, .clk_src = I2S_CLK_SRC_DEFAULT, .ext_clk_freq_hz = 0, .mclk_multiple = I2S_MCLK_MULTIPLE_256 }
+esp_err_t i2s_new_channel(const i2s_chan_config_t*, i2s_chan_handle_t*, i2s_chan_handle_t*);
+esp_err_t i2s_del_channel(i2s_chan_handle_t);
+esp_err_t i2s_channel_init_std_mode(i2s_chan_handle_t, const i2s_std_config_t*);
+esp_err_t i2s_channel_reconfig_std_clock(i2s_chan_handle_t, const i2s_std_clk_config_t*);
+esp_err_t i2s_channel_reconfig_std_slot(i2s_chan_handle_t, const i2s_std_slot_config_t*);
+esp_err_t i2s_channel_enable(i2s_chan_handle_t); esp_err_t i2s_channel_disable(i2s_chan_handle_t);
+esp_err_t i2s_channel_write(i2s_chan_handle_t, const void*, size_t, size_t*, uint32_t);
+esp_err_t i2s_channel_read(i2s_chan_handle_t, void*, size_t, size_t*, uint32_t);
+esp_err_t i2s_channel_preload_data(i2s_chan_handle_t, const void*, size_t, size_t*);
+typedef struct { void* data; size_t size; } i2s_event_data_t;
+typedef bool (*i2s_isr_callback_t)(i2s_chan_handle_t, i2s_event_data_t*, void*);
+typedef struct { i2s_isr_callback_t on_recv, on_recv_q_ovf, on_sent, on_send_q_ovf; } i2s_event_callbacks_t;
+esp_err_t i2s_channel_register_event_callback(i2s_chan_handle_t, const i2s_event_callbacks_t*, void*);
@@ -0,0 +1,3 @@
+// Host stand-in for driver/spi_common.h: the host IDs app_config.h names.
+#pragma once
+enum { SPI1_HOST, SPI2_HOST, SPI3_HOST };
@@ -0,0 +1,23 @@
+// Host stand-in for esp_log.h: prints to stderr up to host_log_level
+// (0 silent, 1 errors, 2 warnings, 3 info, 4 debug).
+#pragma once
+#include <stdio.h>
+#include <stdint.h>
+#include "esp_timer.h"
+
+extern int host_log_level;
+
+#define HOST_LOG(level, letter, tag, ...)                                                    \
+    do {                                                                                     \
+        if (host_log_level >= (level)) {                                                     \
+            fprintf(stderr, "%c (%lld) %s: ", letter, (long long)(esp_timer_get_time() / 1000), tag); \
+            fprintf(stderr, __VA_ARGS__);                                                    \
+            fputc('\n', stderr);                                                             \
+        }                                                                                    \
+    } while (0)
+
+#define ESP_LOGE(tag, ...) HOST_LOG(1, 'E', tag, __VA_ARGS__)
+#define ESP_LOGW(tag, ...) HOST_LOG(2, 'W', tag, __VA_ARGS__)
+#define ESP_LOGI(tag, ...) HOST_LOG(3, 'I', tag, __VA_ARGS__)
+#define ESP_LOGD(tag, ...) HOST_LOG(4, 'D', tag, __VA_ARGS__)
+#define ESP_LOGV(tag, ...) do { (void)(tag); } while (0)
@@ -0,0 +1,47 @@
+// Host stand-in for esp_tls.h (ESP-IDF 5.4): the part of the API the HTTPS
+// client uses, implemented over OpenSSL by support/host_tls.cpp.
+#pragma once
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+#define CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS 1
+
+typedef enum {
+    ESP_TLS_INIT = 0,
+    ESP_TLS_CONNECTING,
+    ESP_TLS_HANDSHAKE,
+    ESP_TLS_FAIL,
+    ESP_TLS_DONE,
+} esp_tls_conn_state_t;
+
+typedef struct esp_tls esp_tls_t;
+typedef struct esp_tls_client_session esp_tls_client_session_t;
+
+typedef struct esp_tls_cfg {
+    union {
+        const unsigned char* cacert_buf;
+        const unsigned char* cacert_pem_buf;
+    };
+    union {
+        unsigned int cacert_bytes;
+        unsigned int cacert_pem_bytes;
+    };
+    bool non_block;
+    int timeout_ms;
+    const char* common_name;
+    bool skip_common_name;
+    esp_tls_client_session_t* client_session;
+} esp_tls_cfg_t;
+
+esp_tls_t* esp_tls_init(void);
+int esp_tls_conn_new_async(const char* hostname, int hostlen, int port, const esp_tls_cfg_t* cfg, esp_tls_t* tls);
+esp_err_t esp_tls_get_conn_state(esp_tls_t* tls, esp_tls_conn_state_t* conn_state);
+esp_err_t esp_tls_get_conn_sockfd(esp_tls_t* tls, int* sockfd);
+ssize_t esp_tls_conn_write(esp_tls_t* tls, const void* data, size_t datalen);
+ssize_t esp_tls_conn_read(esp_tls_t* tls, void* data, size_t datalen);
+ssize_t esp_tls_get_bytes_avail(esp_tls_t* tls);
+int esp_tls_conn_destroy(esp_tls_t* tls);
+esp_tls_client_session_t* esp_tls_get_client_session(esp_tls_t* tls);
+void esp_tls_free_client_session(esp_tls_client_session_t* client_session);
@@ -0,0 +1,16 @@
+// Byte buffers only (RINGBUF_TYPE_BYTEBUF), which is all the firmware uses.
+#pragma once
+#include "freertos/FreeRTOS.h"
+
+typedef void* RingbufHandle_t;
+typedef enum { RINGBUF_TYPE_NOSPLIT, RINGBUF_TYPE_ALLOWSPLIT, RINGBUF_TYPE_BYTEBUF } RingbufferType_t;
+
+RingbufHandle_t xRingbufferCreate(size_t size, RingbufferType_t type);
+RingbufHandle_t xRingbufferCreateWithCaps(size_t size, RingbufferType_t type, uint32_t caps);
+void vRingbufferDelete(RingbufHandle_t ring);
+void vRingbufferDeleteWithCaps(RingbufHandle_t ring);
+BaseType_t xRingbufferSend(RingbufHandle_t ring, const void* data, size_t size, TickType_t ticks);
+void* xRingbufferReceive(RingbufHandle_t ring, size_t* size, TickType_t ticks);
+void* xRingbufferReceiveUpTo(RingbufHandle_t ring, size_t* size, TickType_t ticks, size_t max_size);
+void vRingbufferReturnItem(RingbufHandle_t ring, void* item);
+size_t xRingbufferGetCurFreeSize(RingbufHandle_t ring);
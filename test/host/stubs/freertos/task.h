@@ -0,0 +1,22 @@
+#pragma once
+#include "freertos/FreeRTOS.h"
+
+typedef void* TaskHandle_t;
+typedef void (*TaskFunction_t)(void*);
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char* name, uint32_t stack, void* arg, UBaseType_t prio, TaskHandle_t* handle);
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char* name, uint32_t stack, void* arg, UBaseType_t prio,
+                                   TaskHandle_t* handle, BaseType_t core);
+BaseType_t xTaskCreateWithCaps(TaskFunction_t fn, const char* name, uint32_t stack, void* arg, UBaseType_t prio,
+                               TaskHandle_t* handle, uint32_t caps);
+BaseType_t xTaskCreatePinnedToCoreWithCaps(TaskFunction_t fn, const char* name, uint32_t stack, void* arg,
+                                           UBaseType_t prio, TaskHandle_t* handle, BaseType_t core, uint32_t caps);
+/** Only a task ending itself (NULL or its own handle) is supported. */
+void vTaskDelete(TaskHandle_t task);
+void vTaskDeleteWithCaps(TaskHandle_t task);
+void vTaskDelay(TickType_t ticks);
+TickType_t xTaskGetTickCount(void);
+TaskHandle_t xTaskGetCurrentTaskHandle(void);
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t ticks);
+BaseType_t xTaskNotifyGive(TaskHandle_t task);
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task);
@@ -0,0 +1,11 @@
+// Host stand-in for lvgl.h: only lv_async_call(), which the test using it defines.
+#pragma once
+
+typedef enum {
+    LV_RESULT_INVALID = 0,
+    LV_RESULT_OK,
+} lv_result_t;
+
+typedef void (*lv_async_cb_t)(void* user_data);
+
+lv_result_t lv_async_call(lv_async_cb_t async_xcb, void* user_data);
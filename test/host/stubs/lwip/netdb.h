@@ -0,0 +1,3 @@
+// Host stand-in for lwip/netdb.h: the host's resolver.
+#pragma once
+#include <netdb.h>
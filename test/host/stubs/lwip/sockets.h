@@ -0,0 +1,6 @@
+// Host stand-in for lwip/sockets.h: the host's BSD sockets.
+#pragma once
+#include <netinet/in.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <unistd.h>
@@ -0,0 +1,280 @@
+// cJSON for the host tests (see stubs/cJSON.h). Parsing: objects, arrays,
+// strings (with \u escapes of the Basic Multilingual Plane), numbers and
+// literals. Building and printing: arrays and objects of strings and numbers.
+#include "cJSON.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <string>
+
+static cJSON* new_item(int type) {
+    cJSON* item = (cJSON*)calloc(1, sizeof(cJSON));
+    item->type = type;
+    return item;
+}
+
+static const char* skip_space(const char* p) {
+    while (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n') p++;
+    return p;
+}
+
+static void append_utf8(std::string& out, unsigned code) {
+    if (code < 0x80) {
+        out += (char)code;
+    } else if (code < 0x800) {
+        out += (char)(0xC0 | code >> 6);
+        out += (char)(0x80 | (code & 0x3F));
+    } else {
+        out += (char)(0xE0 | code >> 12);
+        out += (char)(0x80 | ((code >> 6) & 0x3F));
+        out += (char)(0x80 | (code & 0x3F));
+    }
+}
+
+// Parses the string at `p` (at its opening quote); returns the position after it, or NULL.
+static const char* parse_string(const char* p, std::string& out) {
+    if (*p++ != '"') return NULL;
+    for (; *p && *p != '"'; p++) {
+        if (*p != '\\') {
+            out += *p;
+            continue;
+        }
+        switch (*++p) {
+        case 'b': out += '\b'; break;
+        case 'f': out += '\f'; break;
+        case 'n': out += '\n'; break;
+        case 'r': out += '\r'; break;
+        case 't': out += '\t'; break;
+        case 'u': {
+            char hex[5] = {};
+            for (int i = 0; i < 4; i++) {
+                if (!p[1 + i]) return NULL;
+                hex[i] = p[1 + i];
+            }
+            append_utf8(out, (unsigned)strtoul(hex, NULL, 16));
+            p += 4;
+            break;
+        }
+        case '\0': return NULL;
+        default: out += *p; break;
+        }
+    }
+    return *p == '"' ? p + 1 : NULL;
+}
+
+static const char* parse_value(const char* p, cJSON** out);
+
+// Parses the members of an object or the elements of an array into `parent`.
+static const char* parse_children(const char* p, cJSON* parent, bool object) {
+    const char close = object ? '}' : ']';
+    p = skip_space(p + 1);
+    if (*p == close) return p + 1;
+    cJSON* last = NULL;
+    for (;;) {
+        std::string key;
+        if (object) {
+            p = parse_string(skip_space(p), key);
+            if (!p) return NULL;
+            p = skip_space(p);
+            if (*p++ != ':') return NULL;
+        }
+        cJSON* child = NULL;
+        p = parse_value(p, &child);
+        if (!child) return NULL;
+        if (object) child->string = strdup(key.c_str());
+        if (last) {
+            last->next = child;
+            child->prev = last;
+        } else {
+            parent->child = child;
+        }
+        last = child;
+        if (!p) return NULL;
+        p = skip_space(p);
+        if (*p == ',') {
+            p++;
+        } else {
+            return *p == close ? p + 1 : NULL;
+        }
+    }
+}
+
+static const char* parse_value(const char* p, cJSON** out) {
+    p = skip_space(p);
+    if (*p == '{' || *p == '[') {
+        *out = new_item(*p == '{' ? cJSON_Object : cJSON_Array);
+        return parse_children(p, *out, *p == '{');
+    }
+    if (*p == '"') {
+        std::string text;
+        p = parse_string(p, text);
+        if (!p) return NULL;
+        *out = new_item(cJSON_String);
+        (*out)->valuestring = strdup(text.c_str());
+        return p;
+    }
+    if (!strncmp(p, "true", 4) || !strncmp(p, "null", 4) || !strncmp(p, "false", 5)) {
+        *out = new_item(*p == 't' ? cJSON_True : *p == 'n' ? cJSON_NULL : cJSON_False);
+        return p + (*p == 'f' ? 5 : 4);
+    }
+    char* end;
+    const double number = strtod(p, &end);
+    if (end == p) return NULL;
+    *out = new_item(cJSON_Number);
+    (*out)->valuedouble = number;
+    (*out)->valueint = number >= 2147483647.0 ? 2147483647 : number <= -2147483648.0 ? -2147483647 - 1 : (int)number;
+    return end;
+}
+
+cJSON* cJSON_Parse(const char* value) {
+    cJSON* root = NULL;
+    const char* end = value ? parse_value(value, &root) : NULL;
+    if (!end || *skip_space(end)) {
+        cJSON_Delete(root);
+        return NULL;
+    }
+    return root;
+}
+
+void cJSON_Delete(cJSON* item) {
+    while (item) {
+        cJSON* next = item->next;
+        cJSON_Delete(item->child);
+        free(item->valuestring);
+        free(item->string);
+        free(item);
+        item = next;
+    }
+}
+
+int cJSON_GetArraySize(const cJSON* array) {
+    int size = 0;
+    for (const cJSON* item = array ? array->child : NULL; item; item = item->next) size++;
+    return size;
+}
+
+cJSON* cJSON_GetArrayItem(const cJSON* array, int index) {
+    cJSON* item = array ? array->child : NULL;
+    while (item && index-- > 0) item = item->next;
+    return item;
+}
+
+cJSON* cJSON_GetObjectItem(const cJSON* object, const char* string) {
+    for (cJSON* item = object ? object->child : NULL; item; item = item->next) {
+        if (item->string && !strcasecmp(item->string, string)) return item;
+    }
+    return NULL;
+}
+
+cJSON* cJSON_GetObjectItemCaseSensitive(const cJSON* object, const char* string) {
+    for (cJSON* item = object ? object->child : NULL; item; item = item->next) {
+        if (item->string && !strcmp(item->string, string)) return item;
+    }
+    return NULL;
+}
+
+cJSON_bool cJSON_IsString(const cJSON* item) { return item && item->type == cJSON_String; }
+cJSON_bool cJSON_IsNumber(const cJSON* item) { return item && item->type == cJSON_Number; }
+cJSON_bool cJSON_IsArray(const cJSON* item) { return item && item->type == cJSON_Array; }
+cJSON_bool cJSON_IsObject(const cJSON* item) { return item && item->type == cJSON_Object; }
+
+cJSON* cJSON_ParseWithLength(const char* value, size_t buffer_length) {
+    if (!value) return NULL;
+    const std::string text(value, strnlen(value, buffer_length));
+    return cJSON_Parse(text.c_str());
+}
+
+cJSON* cJSON_CreateArray(void) { return new_item(cJSON_Array); }
+cJSON* cJSON_CreateObject(void) { return new_item(cJSON_Object); }
+
+cJSON_bool cJSON_AddItemToArray(cJSON* array, cJSON* item) {
+    if (!array || !item) return 0;
+    cJSON** last = &array->child;
+    cJSON* prev = NULL;
+    while (*last) {
+        prev = *last;
+        last = &(*last)->next;
+    }
+    item->prev = prev;
+    *last = item;
+    return 1;
+}
+
+static cJSON* add_to_object(cJSON* object, const char* name, cJSON* item) {
+    item->string = strdup(name);
+    cJSON_AddItemToArray(object, item);
+    return item;
+}
+
+cJSON* cJSON_AddStringToObject(cJSON* object, const char* name, const char* string) {
+    if (!object || !name || !string) return NULL;
+    cJSON* item = new_item(cJSON_String);
+    item->valuestring = strdup(string);
+    return add_to_object(object, name, item);
+}
+
+cJSON* cJSON_AddNumberToObject(cJSON* object, const char* name, double number) {
+    if (!object || !name) return NULL;
+    cJSON* item = new_item(cJSON_Number);
+    item->valuedouble = number;
+    item->valueint = number >= 2147483647.0 ? 2147483647 : number <= -2147483648.0 ? -2147483647 - 1 : (int)number;
+    return add_to_object(object, name, item);
+}
+
+static void print_string(std::string& out, const char* s) {
+    out += '"';
+    for (; *s; s++) {
+        const unsigned char c = (unsigned char)*s;
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += (char)c;
+        } else if (c < 0x20) {
+            char escape[8];
+            snprintf(escape, sizeof(escape), "\\u%04x", c);
+            out += escape;
+        } else {
+            out += (char)c;
+        }
+    }
+    out += '"';
+}
+
+static void print_value(std::string& out, const cJSON* item) {
+    char number[32];
+    switch (item->type) {
+    case cJSON_False: out += "false"; break;
+    case cJSON_True: out += "true"; break;
+    case cJSON_Number:
+        // Integers as integers, like cJSON; anything else with enough digits to read back.
+        if (item->valuedouble == (double)item->valueint) {
+            snprintf(number, sizeof(number), "%d", item->valueint);
+        } else {
+            snprintf(number, sizeof(number), "%1.17g", item->valuedouble);
+        }
+        out += number;
+        break;
+    case cJSON_String: print_string(out, item->valuestring ? item->valuestring : ""); break;
+    case cJSON_Array:
+    case cJSON_Object:
+        out += item->type == cJSON_Array ? '[' : '{';
+        for (const cJSON* child = item->child; child; child = child->next) {
+            if (child != item->child) out += ',';
+            if (item->type == cJSON_Object) {
+                print_string(out, child->string ? child->string : "");
+                out += ':';
+            }
+            print_value(out, child);
+        }
+        out += item->type == cJSON_Array ? ']' : '}';
+        break;
+    default: out += "null"; break;
+    }
+}
+
+char* cJSON_PrintUnformatted(const cJSON* item) {
+    if (!item) return NULL;
+    std::string out;
+    print_value(out, item);
+    return strdup(out.c_str());
+}
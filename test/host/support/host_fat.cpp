@@ -0,0 +1,566 @@
+// FAT32 volume model, see host_fat.h. The FatFs routines are mirrored by name
+// (move_window, create_chain, f_write, f_lseek, ...) so they can be checked
+// against ff.c; only the parts that cost card I/O are modelled.
+#define _GNU_SOURCE 1
+#include "host_fat.h"
+#include <errno.h>
+#include <map>
+#include <memory>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#define SECTOR 512
+#define FAT_ENTRIES_PER_SECTOR (SECTOR / 4)
+#define EOC 0x0FFFFFFFu
+#define RESERVED_SECTORS 32
+#define FSINFO_SECTOR 1
+#define FIRST_FD 1000
+
+// --- Volume ---
+
+struct fat_file {
+    std::vector<uint8_t> data; // Contents up to objsize.
+    uint32_t sclust = 0;       // First cluster, 0 if none.
+    uint32_t dir_sect = 0;     // Sector of the directory entry.
+    uint32_t synced_size = 0;  // Size in the directory entry as of the last sync.
+};
+
+static struct {
+    host_fat_config_t cfg;
+    uint32_t cluster_sectors;
+    uint32_t fat_sectors;
+    uint32_t data_start;
+    uint32_t n_fatent;          // Clusters + 2.
+    std::vector<uint32_t> fat;
+    uint32_t free_clst;
+    uint32_t last_clst;
+    bool fsi_dirty;
+    uint32_t winsect;           // Sector in the window, UINT32_MAX if none.
+    bool wflag;                 // Window dirty.
+    uint32_t last_write_end;    // Sector after the previous write, for the sequential check.
+    std::map<std::string, std::unique_ptr<fat_file>> files;
+    uint32_t next_dir_slot;
+    host_fat_stats_t stats;
+    std::vector<host_fat_call_t> calls;
+    host_fat_call_t* call;      // Call being accounted.
+} vol;
+
+struct open_file {
+    fat_file* f;
+    uint32_t fptr = 0;
+    uint32_t clust = 0;
+    uint32_t sect = 0;          // Sector in the buffer, 0 if none.
+    bool dirty = false;
+    bool modified = false;
+    bool cut = false;           // Lost to a power cut: the stream only closes.
+    FILE* stream = NULL;
+};
+static std::map<int, open_file*> open_files;
+static int next_fd = FIRST_FD;
+
+host_fat_config_t host_fat_default_config(void) {
+    host_fat_config_t cfg;
+    cfg.cluster_bytes = 32 * 1024;
+    cfg.volume_mb = 1024;
+    cfg.read_command_us = 150;
+    cfg.write_command_us = 400;
+    cfg.random_write_us = 1500;
+    cfg.bytes_per_ms = 2000; // 20 MHz SPI, ~2 MB/s of payload.
+    return cfg;
+}
+
+// --- Card ---
+
+static void charge(uint32_t us) {
+    vol.stats.card_us += us;
+    if (vol.call) vol.call->card_us += us;
+}
+
+static void disk_read(uint32_t sector, uint32_t count) {
+    (void)sector;
+    vol.stats.read_commands++;
+    vol.stats.sectors_read += count;
+    charge(vol.cfg.read_command_us + (uint32_t)((uint64_t)count * SECTOR * 1000 / vol.cfg.bytes_per_ms));
+}
+
+static void disk_write(uint32_t sector, uint32_t count) {
+    vol.stats.write_commands++;
+    vol.stats.sectors_written += count;
+    uint32_t us = vol.cfg.write_command_us + (uint32_t)((uint64_t)count * SECTOR * 1000 / vol.cfg.bytes_per_ms);
+    if (sector != vol.last_write_end) {
+        vol.stats.random_writes++;
+        us += vol.cfg.random_write_us;
+    }
+    vol.last_write_end = sector + count;
+    charge(us);
+}
+
+static bool is_fat_sector(uint32_t sector) { return sector >= RESERVED_SECTORS && sector < RESERVED_SECTORS + vol.fat_sectors; }
+
+// --- Window, FAT and chains (ff.c: sync_window, move_window, get_fat, put_fat, create_chain, remove_chain) ---
+
+static void sync_window(void) {
+    if (!vol.wflag) return;
+    disk_write(vol.winsect, 1);
+    if (is_fat_sector(vol.winsect)) {
+        disk_write(vol.winsect + vol.fat_sectors, 1); // Second FAT.
+        vol.stats.fat_sector_writes += 2;
+    }
+    vol.wflag = false;
+}
+
+static void move_window(uint32_t sector) {
+    if (sector == vol.winsect) return;
+    sync_window();
+    disk_read(sector, 1);
+    vol.winsect = sector;
+}
+
+static uint32_t get_fat(uint32_t clst) {
+    move_window(RESERVED_SECTORS + clst / FAT_ENTRIES_PER_SECTOR);
+    return vol.fat[clst];
+}
+
+static void put_fat(uint32_t clst, uint32_t value) {
+    move_window(RESERVED_SECTORS + clst / FAT_ENTRIES_PER_SECTOR);
+    vol.fat[clst] = value;
+    vol.wflag = true;
+}
+
+static uint32_t clst2sect(uint32_t clst) { return vol.data_start + (clst - 2) * vol.cluster_sectors; }
+
+// Returns the cluster after `clst`, linking a new one if it is the last; 0 if the volume is full.
+static uint32_t create_chain(uint32_t clst) {
+    uint32_t scl;
+    if (clst == 0) {
+        scl = vol.last_clst;
+        if (scl == 0 || scl >= vol.n_fatent) scl = 1;
+    } else {
+        const uint32_t cs = get_fat(clst);
+        if (cs >= 2 && cs < EOC) return cs;
+        scl = clst;
+    }
+    if (vol.free_clst == 0) return 0;
+    uint32_t ncl = scl;
+    for (;;) {
+        ncl++;
+        if (ncl >= vol.n_fatent) ncl = 2;
+        if (get_fat(ncl) == 0) break;
+        if (ncl == scl) return 0;
+    }
+    put_fat(ncl, EOC);
+    if (clst != 0) put_fat(clst, ncl);
+    vol.last_clst = ncl;
+    vol.free_clst--;
+    vol.fsi_dirty = true;
+    vol.stats.clusters_allocated++;
+    if (vol.call) vol.call->clusters_allocated++;
+    return ncl;
+}
+
+static void remove_chain(uint32_t clst, uint32_t pclst) {
+    if (pclst != 0) put_fat(pclst, EOC);
+    while (clst >= 2 && clst < EOC) {
+        const uint32_t next = get_fat(clst);
+        put_fat(clst, 0);
+        vol.free_clst++;
+        vol.fsi_dirty = true;
+        clst = next;
+    }
+}
+
+static void sync_fs(void) {
+    sync_window();
+    if (vol.fsi_dirty) {
+        disk_write(FSINFO_SECTOR, 1);
+        vol.fsi_dirty = false;
+    }
+}
+
+// --- Files (ff.c: f_open, f_write, f_lseek, f_truncate, f_sync) ---
+
+static void begin_call(char op) {
+    vol.calls.push_back(host_fat_call_t{ op, 0, 0, 0, 0 });
+    vol.call = &vol.calls.back();
+}
+
+static void end_call(void) { vol.call = NULL; }
+
+static void flush_buffer(open_file* fp) {
+    if (fp->dirty) {
+        disk_write(fp->sect, 1);
+        fp->dirty = false;
+    }
+}
+
+static void f_sync(open_file* fp) {
+    if (!fp->modified) return;
+    flush_buffer(fp);
+    move_window(fp->f->dir_sect);
+    vol.wflag = true;
+    sync_fs();
+    fp->f->synced_size = (uint32_t)fp->f->data.size();
+    fp->modified = false;
+}
+
+static void f_write(open_file* fp, const uint8_t* buf, uint32_t btw) {
+    fat_file* f = fp->f;
+    const uint32_t csize = vol.cluster_sectors;
+    while (btw > 0) {
+        uint32_t wcnt;
+        if (fp->fptr % SECTOR == 0) {
+            const uint32_t csect = (fp->fptr / SECTOR) & (csize - 1);
+            if (csect == 0) {
+                uint32_t clst;
+                if (fp->fptr == 0) {
+                    clst = f->sclust;
+                    if (clst == 0) clst = create_chain(0);
+                } else {
+                    clst = create_chain(fp->clust);
+                }
+                if (clst == 0) return; // Volume full.
+                if (f->sclust == 0) f->sclust = clst;
+                fp->clust = clst;
+            }
+            flush_buffer(fp);
+            const uint32_t sect = clst2sect(fp->clust) + csect;
+            uint32_t cc = btw / SECTOR;
+            if (cc > 0) {
+                if (csect + cc > csize) cc = csize - csect;
+                disk_write(sect, cc);
+                wcnt = SECTOR * cc;
+                goto advance;
+            }
+            if (fp->sect != sect && fp->fptr < (uint32_t)f->data.size()) {
+                disk_read(sect, 1);
+                vol.stats.partial_reads++;
+                if (vol.call) vol.call->partial_reads++;
+            }
+            fp->sect = sect;
+        }
+        wcnt = SECTOR - fp->fptr % SECTOR;
+        if (wcnt > btw) wcnt = btw;
+        fp->dirty = true;
+    advance:
+        if (f->data.size() < fp->fptr + wcnt) f->data.resize(fp->fptr + wcnt);
+        memcpy(f->data.data() + fp->fptr, buf, wcnt);
+        buf += wcnt;
+        fp->fptr += wcnt;
+        btw -= wcnt;
+        fp->modified = true;
+    }
+}
+
+static void f_lseek(open_file* fp, uint32_t ofs) {
+    fat_file* f = fp->f;
+    const uint32_t bcs = vol.cluster_sectors * SECTOR;
+    const uint32_t ifptr = fp->fptr;
+    uint32_t nsect = 0;
+    fp->fptr = 0;
+    if (ofs > 0) {
+        uint32_t clst;
+        if (ifptr > 0 && (ofs - 1) / bcs >= (ifptr - 1) / bcs) {
+            fp->fptr = (ifptr - 1) & ~(bcs - 1);
+            ofs -= fp->fptr;
+            clst = fp->clust;
+        } else {
+            clst = f->sclust;
+            if (clst == 0) {
+                clst = create_chain(0);
+                f->sclust = clst;
+            }
+            fp->clust = clst;
+        }
+        if (clst != 0) {
+            while (ofs > bcs) {
+                ofs -= bcs;
+                fp->fptr += bcs;
+                clst = create_chain(clst); // Write mode: extends the chain past the end.
+                if (clst == 0) {
+                    ofs = 0;
+                    break;
+                }
+                fp->clust = clst;
+            }
+            fp->fptr += ofs;
+            if (ofs % SECTOR) nsect = clst2sect(clst) + ofs / SECTOR;
+        }
+    }
+    if (fp->fptr > f->data.size()) {
+        f->data.resize(fp->fptr); // Never written; reads back as whatever the clusters held.
+        fp->modified = true;
+    }
+    if (fp->fptr % SECTOR && nsect != fp->sect) {
+        flush_buffer(fp);
+        disk_read(nsect, 1);
+        fp->sect = nsect;
+    }
+}
+
+static void f_truncate(open_file* fp) {
+    fat_file* f = fp->f;
+    if (fp->fptr >= f->data.size()) return;
+    f->data.resize(fp->fptr);
+    if (fp->fptr == 0) {
+        remove_chain(f->sclust, 0);
+        f->sclust = 0;
+    } else {
+        const uint32_t ncl = get_fat(fp->clust);
+        if (ncl >= 2 && ncl < EOC) remove_chain(ncl, fp->clust);
+    }
+    fp->modified = true;
+    if (fp->dirty && fp->sect >= clst2sect(fp->clust) + vol.cluster_sectors) fp->dirty = false;
+}
+
+// --- stdio glue ---
+
+static ssize_t cookie_write(void* cookie, const char* buf, size_t size) {
+    if (((open_file*)cookie)->cut) return -1;
+    begin_call('w');
+    vol.call->bytes = (uint32_t)size;
+    f_write((open_file*)cookie, (const uint8_t*)buf, (uint32_t)size);
+    end_call();
+    return (ssize_t)size;
+}
+
+static ssize_t cookie_read(void* cookie, char* buf, size_t size) {
+    open_file* fp = (open_file*)cookie;
+    if (fp->cut) return -1;
+    size_t n = fp->f->data.size() > fp->fptr ? fp->f->data.size() - fp->fptr : 0;
+    if (n > size) n = size;
+    memcpy(buf, fp->f->data.data() + fp->fptr, n);
+    fp->fptr += (uint32_t)n;
+    if (n > 0) {
+        // Like f_read, leave the cluster of the last byte read in fp->clust, where f_lseek and f_write continue from.
+        uint32_t clst = fp->f->sclust;
+        for (uint32_t i = (fp->fptr - 1) / (vol.cluster_sectors * SECTOR); i > 0 && clst >= 2 && clst < EOC; i--) {
+            clst = vol.fat[clst];
+        }
+        fp->clust = clst;
+    }
+    return (ssize_t)n;
+}
+
+static int cookie_seek(void* cookie, off64_t* pos, int whence) {
+    open_file* fp = (open_file*)cookie;
+    if (fp->cut) return -1;
+    off64_t target = *pos;
+    if (whence == SEEK_CUR) target += fp->fptr;
+    if (whence == SEEK_END) target += (off64_t)fp->f->data.size();
+    if (target < 0) return -1;
+    if ((uint32_t)target != fp->fptr) {
+        begin_call('s');
+        f_lseek(fp, (uint32_t)target);
+        end_call();
+    }
+    *pos = fp->fptr;
+    return 0;
+}
+
+static int cookie_close(void* cookie) {
+    open_file* fp = (open_file*)cookie;
+    if (!fp->cut) {
+        begin_call('y');
+        f_sync(fp);
+        end_call();
+    }
+    for (auto it = open_files.begin(); it != open_files.end(); ++it) {
+        if (it->second == fp) {
+            open_files.erase(it);
+            break;
+        }
+    }
+    delete fp;
+    return 0;
+}
+
+static bool on_volume(const char* path) { return strncmp(path, HOST_FAT_MOUNT, strlen(HOST_FAT_MOUNT)) == 0; }
+
+extern "C" FILE* __real_fopen(const char* path, const char* mode);
+extern "C" int __real_fileno(FILE* fp);
+extern "C" int __real_fsync(int fd);
+extern "C" int __real_ftruncate(int fd, off_t length);
+extern "C" int __real_unlink(const char* path);
+
+extern "C" FILE* __wrap_fopen(const char* path, const char* mode) {
+    if (!on_volume(path)) return __real_fopen(path, mode);
+    const bool write = strchr(mode, 'w') || strchr(mode, 'a') || strchr(mode, '+');
+    auto it = vol.files.find(path);
+    if (it == vol.files.end()) {
+        if (!write || mode[0] == 'r') {
+            errno = ENOENT;
+            return NULL;
+        }
+        auto f = std::make_unique<fat_file>();
+        f->dir_sect = vol.data_start + vol.next_dir_slot++ / (SECTOR / 32); // Root directory, 32-byte entries.
+        it = vol.files.emplace(path, std::move(f)).first;
+    }
+    open_file* fp = new open_file;
+    fp->f = it->second.get();
+    begin_call('o');
+    move_window(fp->f->dir_sect);
+    if (mode[0] == 'w') {
+        // FA_CREATE_ALWAYS: the old chain is freed and the entry rewritten.
+        vol.wflag = true;
+        if (fp->f->sclust) {
+            const uint32_t sc = vol.winsect;
+            remove_chain(fp->f->sclust, 0);
+            move_window(sc);
+            fp->f->sclust = 0;
+        }
+        fp->f->data.clear();
+        fp->f->synced_size = 0;
+    }
+    end_call();
+    cookie_io_functions_t io = { cookie_read, cookie_write, cookie_seek, cookie_close };
+    fp->stream = fopencookie(fp, mode, io);
+    open_files[next_fd++] = fp;
+    if (mode[0] == 'a') fseek(fp->stream, 0, SEEK_END);
+    return fp->stream;
+}
+
+static open_file* find_open(int fd) {
+    auto it = open_files.find(fd);
+    return it == open_files.end() ? NULL : it->second;
+}
+
+// Streams of the volume have no descriptor of their own (fileno() gives -1), so
+// they get one from FIRST_FD up, which fsync() and ftruncate() recognise.
+extern "C" int __wrap_fileno(FILE* stream) {
+    for (auto& entry : open_files) {
+        if (entry.second->stream == stream) return entry.first;
+    }
+    return __real_fileno(stream);
+}
+
+extern "C" int __wrap_unlink(const char* path) {
+    if (!on_volume(path)) return __real_unlink(path);
+    auto it = vol.files.find(path);
+    if (it == vol.files.end()) {
+        errno = ENOENT;
+        return -1;
+    }
+    move_window(it->second->dir_sect);
+    vol.wflag = true;
+    const uint32_t dir_sect = vol.winsect;
+    remove_chain(it->second->sclust, 0);
+    move_window(dir_sect);
+    sync_fs();
+    vol.files.erase(it);
+    return 0;
+}
+
+extern "C" int __real_fstat(int fd, struct stat* st);
+extern "C" int __wrap_fstat(int fd, struct stat* st) {
+    open_file* fp = find_open(fd);
+    if (!fp) return __real_fstat(fd, st);
+    memset(st, 0, sizeof(*st));
+    st->st_mode = S_IFREG | 0666;
+    st->st_size = (off_t)fp->f->data.size();
+    return 0;
+}
+
+extern "C" int __wrap_fsync(int fd) {
+    open_file* fp = find_open(fd);
+    if (!fp) return __real_fsync(fd);
+    if (fp->cut) {
+        errno = EIO;
+        return -1;
+    }
+    begin_call('y');
+    f_sync(fp);
+    end_call();
+    return 0;
+}
+
+extern "C" int __wrap_ftruncate(int fd, off_t length) {
+    open_file* fp = find_open(fd);
+    if (!fp) return __real_ftruncate(fd, length);
+    if (fp->cut) {
+        errno = EIO;
+        return -1;
+    }
+    begin_call('t');
+    const uint32_t pos = fp->fptr;
+    f_lseek(fp, (uint32_t)length);
+    f_truncate(fp);
+    f_lseek(fp, pos < (uint32_t)length ? pos : (uint32_t)length);
+    end_call();
+    return 0;
+}
+
+// --- Control ---
+
+void host_fat_format(const host_fat_config_t* config) {
+    vol.cfg = *config;
+    vol.cluster_sectors = config->cluster_bytes / SECTOR;
+    const uint32_t total_sectors = config->volume_mb * (1024 * 1024 / SECTOR);
+    const uint32_t clusters = (total_sectors - RESERVED_SECTORS) / vol.cluster_sectors;
+    vol.fat_sectors = (clusters + 2 + FAT_ENTRIES_PER_SECTOR - 1) / FAT_ENTRIES_PER_SECTOR;
+    vol.data_start = RESERVED_SECTORS + 2 * vol.fat_sectors;
+    vol.n_fatent = (total_sectors - vol.data_start) / vol.cluster_sectors + 2;
+    vol.fat.assign(vol.n_fatent, 0);
+    vol.fat[0] = vol.fat[1] = EOC;
+    vol.fat[2] = EOC; // Root directory.
+    vol.free_clst = vol.n_fatent - 3;
+    vol.last_clst = 2;
+    vol.fsi_dirty = false;
+    vol.winsect = UINT32_MAX;
+    vol.wflag = false;
+    vol.last_write_end = 0;
+    vol.files.clear();
+    vol.next_dir_slot = 0;
+    host_fat_reset_stats();
+}
+
+void host_fat_fragment(uint32_t stride) {
+    for (uint32_t c = 3; c < vol.n_fatent; c++) {
+        if (c % stride == 0 && vol.fat[c] == 0) {
+            vol.fat[c] = EOC;
+            vol.free_clst--;
+        }
+    }
+}
+
+void host_fat_power_cut(void) {
+    for (auto& entry : open_files) {
+        open_file* fp = entry.second;
+        if (fp->cut) continue;
+        // Bytes past the synced size are still on the card, but no longer part of the file.
+        fp->f->data.resize(fp->f->synced_size);
+        fp->cut = true;
+    }
+    vol.wflag = false;
+    vol.winsect = UINT32_MAX;
+}
+
+void host_fat_get_stats(host_fat_stats_t* stats) { *stats = vol.stats; }
+
+const std::vector<host_fat_call_t>& host_fat_calls(void) { return vol.calls; }
+
+void host_fat_reset_stats(void) {
+    memset(&vol.stats, 0, sizeof(vol.stats));
+    vol.calls.clear();
+    vol.calls.reserve(1 << 16);
+    vol.call = NULL;
+}
+
+bool host_fat_read_file(const char* path, std::vector<uint8_t>* data) {
+    auto it = vol.files.find(path);
+    if (it == vol.files.end()) return false;
+    *data = it->second->data;
+    return true;
+}
+
+uint32_t host_fat_chain_length(const char* path) {
+    auto it = vol.files.find(path);
+    if (it == vol.files.end()) return 0;
+    uint32_t n = 0;
+    for (uint32_t c = it->second->sclust; c >= 2 && c < EOC; c = vol.fat[c]) n++;
+    return n;
+}
+
+uint32_t host_fat_free_clusters(void) { return vol.free_clst; }
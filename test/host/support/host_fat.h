@@ -0,0 +1,84 @@
+/**
+ * @file host_fat.h
+ * @brief A FAT32 volume in RAM that does the sector I/O FatFs would.
+ *
+ * Files opened under HOST_FAT_MOUNT are served by this volume through the
+ * ordinary stdio calls (fopen/fwrite/fseek/fclose, plus fileno/fstat/fsync/ftruncate),
+ * so a module writes to it unchanged. Link the test with the host_fat library,
+ * which wraps those calls (see CMakeLists.txt).
+ *
+ * The file bytes are kept in memory as they are. Alongside, every call walks
+ * the cluster chain, the FAT and directory sector window and the file's sector
+ * buffer the way FatFs (R0.14, FF_FS_TINY 0, two FATs) does, and charges the
+ * resulting card commands against a simple SD card cost model. Nothing is
+ * slept: the card time is only accounted, so the results are deterministic.
+ */
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#define HOST_FAT_MOUNT "/fat/"
+
+typedef struct {
+    uint32_t cluster_bytes;      //!< Allocation unit: 4, 16 or 32 KB on SD cards.
+    uint32_t volume_mb;
+    uint32_t read_command_us;    //!< Fixed cost of a read command.
+    uint32_t write_command_us;   //!< Fixed cost of a write command (busy time included).
+    uint32_t random_write_us;    //!< Extra cost of a write that does not continue the previous one.
+    uint32_t bytes_per_ms;       //!< Transfer rate of the bus.
+} host_fat_config_t;
+
+/** @brief An SDHC card on a 20 MHz SPI bus, formatted with 32 KB clusters. */
+host_fat_config_t host_fat_default_config(void);
+
+/** @brief Formats (and mounts) an empty volume, dropping any previous one. */
+void host_fat_format(const host_fat_config_t* config);
+
+/** @brief Marks every `stride`-th cluster of the volume as used, like a card that has seen many deletes. */
+void host_fat_fragment(uint32_t stride);
+
+/**
+ * @brief Cuts the power: every open file falls back to the size its directory
+ * entry had at its last sync (0 if it was never synced), as FatFs finds it after
+ * a reset. The streams stay valid only for fclose(), which then writes nothing.
+ *
+ * Clusters linked since the last sync stay linked (on a card they may be lost
+ * instead), and the file keeps the bytes in its sector buffer (the writer
+ * under test only leaves whole sectors there).
+ */
+void host_fat_power_cut(void);
+
+/** @brief One stdio call on the volume. */
+typedef struct {
+    char op;                     //!< 'w' fwrite, 's' fseek, 'y' fsync/fclose, 't' ftruncate, 'o' fopen.
+    uint32_t bytes;              //!< Bytes written ('w').
+    uint32_t card_us;            //!< Modeled card time of the call.
+    uint32_t clusters_allocated; //!< Clusters linked by the call.
+    uint32_t partial_reads;      //!< Sectors read back to merge a partial write.
+} host_fat_call_t;
+
+typedef struct {
+    uint64_t card_us;
+    uint32_t read_commands, write_commands;
+    uint32_t sectors_read, sectors_written;
+    uint32_t random_writes;      //!< Writes that did not continue the previous one.
+    uint32_t fat_sector_writes;  //!< FAT sectors written (both copies).
+    uint32_t clusters_allocated;
+    uint32_t partial_reads;
+} host_fat_stats_t;
+
+void host_fat_get_stats(host_fat_stats_t* stats);
+/** @brief Every call since the last reset, in order. */
+const std::vector<host_fat_call_t>& host_fat_calls(void);
+void host_fat_reset_stats(void);
+
+/** @brief Contents of a file, false if there is none. */
+bool host_fat_read_file(const char* path, std::vector<uint8_t>* data);
+
+/** @brief Clusters in the chain of a file (0 if there is none). */
+uint32_t host_fat_chain_length(const char* path);
+
+/** @brief Free clusters on the volume. */
+uint32_t host_fat_free_clusters(void);
@@ -0,0 +1,115 @@
+// I2S channels on buffers, see host_i2s.h.
+#include "host_i2s.h"
+#include "driver/i2s_std.h"
+#include <chrono>
+#include <mutex>
+#include <string.h>
+#include <thread>
+
+uint32_t host_i2s_tx_rate = 48000;
+int host_i2s_speedup = 1;
+
+static std::mutex i2s_mutex;
+static std::vector<int16_t> tx_output;
+static host_i2s_rx_source_t rx_source;
+static int new_channel_failures = 0;
+static int channels_enabled = 0;
+static int channels_open = 0;
+static int next_handle = 1;
+
+void host_i2s_set_rx_source(host_i2s_rx_source_t source) {
+    std::lock_guard<std::mutex> lock(i2s_mutex);
+    rx_source = std::move(source);
+}
+
+void host_i2s_fail_new_channel(int count) {
+    std::lock_guard<std::mutex> lock(i2s_mutex);
+    new_channel_failures = count;
+}
+
+std::vector<int16_t> host_i2s_tx_output(void) {
+    std::lock_guard<std::mutex> lock(i2s_mutex);
+    return tx_output;
+}
+
+void host_i2s_clear_tx_output(void) {
+    std::lock_guard<std::mutex> lock(i2s_mutex);
+    tx_output.clear();
+}
+
+bool host_i2s_enabled(void) {
+    std::lock_guard<std::mutex> lock(i2s_mutex);
+    return channels_enabled > 0;
+}
+
+int host_i2s_open_channels(void) {
+    std::lock_guard<std::mutex> lock(i2s_mutex);
+    return channels_open;
+}
+
+esp_err_t i2s_new_channel(const i2s_chan_config_t*, i2s_chan_handle_t* tx, i2s_chan_handle_t* rx) {
+    std::lock_guard<std::mutex> lock(i2s_mutex);
+    if (new_channel_failures > 0) {
+        new_channel_failures--;
+        return ESP_ERR_NOT_FOUND;
+    }
+    if (tx) *tx = (i2s_chan_handle_t)(intptr_t)next_handle++;
+    if (rx) *rx = (i2s_chan_handle_t)(intptr_t)next_handle++;
+    channels_open += (tx != NULL) + (rx != NULL);
+    return ESP_OK;
+}
+
+esp_err_t i2s_del_channel(i2s_chan_handle_t handle) {
+    std::lock_guard<std::mutex> lock(i2s_mutex);
+    if (handle && channels_open > 0) channels_open--;
+    return ESP_OK;
+}
+esp_err_t i2s_channel_init_std_mode(i2s_chan_handle_t, const i2s_std_config_t*) { return ESP_OK; }
+esp_err_t i2s_channel_reconfig_std_clock(i2s_chan_handle_t, const i2s_std_clk_config_t*) { return ESP_OK; }
+esp_err_t i2s_channel_reconfig_std_slot(i2s_chan_handle_t, const i2s_std_slot_config_t*) { return ESP_OK; }
+esp_err_t i2s_channel_register_event_callback(i2s_chan_handle_t, const i2s_event_callbacks_t*, void*) { return ESP_OK; }
+
+esp_err_t i2s_channel_enable(i2s_chan_handle_t) {
+    std::lock_guard<std::mutex> lock(i2s_mutex);
+    channels_enabled++;
+    return ESP_OK;
+}
+
+esp_err_t i2s_channel_disable(i2s_chan_handle_t) {
+    std::lock_guard<std::mutex> lock(i2s_mutex);
+    if (channels_enabled > 0) channels_enabled--;
+    return ESP_OK;
+}
+
+esp_err_t i2s_channel_write(i2s_chan_handle_t, const void* data, size_t size, size_t* written, uint32_t) {
+    {
+        std::lock_guard<std::mutex> lock(i2s_mutex);
+        tx_output.insert(tx_output.end(), (const int16_t*)data, (const int16_t*)data + size / 2);
+    }
+    if (host_i2s_speedup > 0) {
+        std::this_thread::sleep_for(std::chrono::microseconds((int64_t)(size / 4) * 1000000 / host_i2s_tx_rate / host_i2s_speedup));
+    }
+    if (written) *written = size;
+    return ESP_OK;
+}
+
+esp_err_t i2s_channel_preload_data(i2s_chan_handle_t, const void*, size_t size, size_t* loaded) {
+    if (loaded) *loaded = size;
+    return ESP_OK;
+}
+
+esp_err_t i2s_channel_read(i2s_chan_handle_t, void* data, size_t size, size_t* read, uint32_t timeout_ms) {
+    host_i2s_rx_source_t source;
+    {
+        std::lock_guard<std::mutex> lock(i2s_mutex);
+        source = rx_source;
+    }
+    size_t n = 0;
+    if (source) {
+        n = source(data, size);
+    } else {
+        std::this_thread::sleep_for(std::chrono::milliseconds(timeout_ms < 10 ? timeout_ms : 10));
+    }
+    if (read) *read = n;
+    return n == size ? ESP_OK : ESP_ERR_TIMEOUT;
+}
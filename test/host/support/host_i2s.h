@@ -0,0 +1,33 @@
+/**
+ * @file host_i2s.h
+ * @brief Controls of the host I2S driver (support/host_i2s.cpp).
+ *
+ * TX writes are kept in memory and paced like the DMA: a write returns after
+ * the time its frames take to play at host_i2s_tx_rate, divided by
+ * host_i2s_speedup. RX reads are served by a callback.
+ */
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <functional>
+#include <vector>
+
+extern uint32_t host_i2s_tx_rate;   //!< Frame rate of the TX channel (16-bit stereo frames).
+extern int host_i2s_speedup;        //!< Pacing divisor; 0 writes without waiting.
+
+/** @brief Fills `bytes` of RX data at `dst`; returns the bytes filled (fewer means a timeout). */
+typedef std::function<size_t(void* dst, size_t bytes)> host_i2s_rx_source_t;
+void host_i2s_set_rx_source(host_i2s_rx_source_t source);
+
+/** @brief Makes the next `count` calls to i2s_new_channel() fail. */
+void host_i2s_fail_new_channel(int count);
+
+/** @brief Everything written to TX so far. */
+std::vector<int16_t> host_i2s_tx_output(void);
+void host_i2s_clear_tx_output(void);
+
+/** @brief Whether any channel is enabled. */
+bool host_i2s_enabled(void);
+
+/** @brief Channels created and not deleted yet. */
+int host_i2s_open_channels(void);
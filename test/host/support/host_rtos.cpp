@@ -0,0 +1,335 @@
+// FreeRTOS on host threads: tasks, notifications, queues, semaphores, byte
+// ring buffers and event groups, plus esp_timer one-shots. Every object waits
+// on one global condition variable, which is plenty for a handful of tasks.
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+#include "freertos/queue.h"
+#include "freertos/ringbuf.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "esp_timer.h"
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <pthread.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+static std::mutex rtos_mutex;
+static std::condition_variable rtos_changed;
+
+template <typename Pred>
+static bool wait_for(std::unique_lock<std::mutex>& lock, TickType_t ticks, Pred pred) {
+    if (ticks == portMAX_DELAY) {
+        rtos_changed.wait(lock, pred);
+        return true;
+    }
+    return rtos_changed.wait_for(lock, std::chrono::milliseconds((uint64_t)ticks * portTICK_PERIOD_MS), pred);
+}
+
+// --- Tasks ---
+
+struct host_task {
+    uint32_t notify = 0;
+};
+static thread_local host_task* current_task = nullptr;
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char*, uint32_t, void* arg, UBaseType_t, TaskHandle_t* handle) {
+    host_task* task = new host_task;
+    if (handle) *handle = task;
+    std::thread([=] {
+        current_task = task;
+        fn(arg);
+    }).detach();
+    return pdPASS;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char* name, uint32_t stack, void* arg, UBaseType_t prio,
+                                   TaskHandle_t* handle, BaseType_t) {
+    return xTaskCreate(fn, name, stack, arg, prio, handle);
+}
+
+BaseType_t xTaskCreateWithCaps(TaskFunction_t fn, const char* name, uint32_t stack, void* arg, UBaseType_t prio,
+                               TaskHandle_t* handle, uint32_t) {
+    return xTaskCreate(fn, name, stack, arg, prio, handle);
+}
+
+BaseType_t xTaskCreatePinnedToCoreWithCaps(TaskFunction_t fn, const char* name, uint32_t stack, void* arg,
+                                           UBaseType_t prio, TaskHandle_t* handle, BaseType_t, uint32_t) {
+    return xTaskCreate(fn, name, stack, arg, prio, handle);
+}
+
+void vTaskDelete(TaskHandle_t task) {
+    if (task == NULL || task == current_task) pthread_exit(NULL);
+}
+
+void vTaskDeleteWithCaps(TaskHandle_t task) { vTaskDelete(task); }
+
+void vTaskDelay(TickType_t ticks) { std::this_thread::sleep_for(std::chrono::milliseconds((uint64_t)ticks * portTICK_PERIOD_MS)); }
+
+TickType_t xTaskGetTickCount(void) { return (TickType_t)(esp_timer_get_time() / 1000 / portTICK_PERIOD_MS); }
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void) { return current_task; }
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t) { return 1024; }
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+    std::lock_guard<std::mutex> lock(rtos_mutex);
+    ((host_task*)task)->notify++;
+    rtos_changed.notify_all();
+    return pdPASS;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t ticks) {
+    std::unique_lock<std::mutex> lock(rtos_mutex);
+    host_task* self = current_task;
+    wait_for(lock, ticks, [&] { return self->notify > 0; });
+    const uint32_t value = self->notify;
+    if (value) self->notify = clear_on_exit ? 0 : value - 1;
+    return value;
+}
+
+// --- Queues ---
+
+struct host_queue {
+    size_t item_size;
+    size_t length;
+    std::deque<std::vector<uint8_t>> items;
+};
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size) { return new host_queue{ item_size, length, {} }; }
+
+static BaseType_t queue_send(QueueHandle_t handle, const void* item, TickType_t ticks, bool front) {
+    host_queue* q = (host_queue*)handle;
+    std::unique_lock<std::mutex> lock(rtos_mutex);
+    if (!wait_for(lock, ticks, [&] { return q->items.size() < q->length; })) return pdFALSE;
+    std::vector<uint8_t> copy((const uint8_t*)item, (const uint8_t*)item + q->item_size);
+    if (front) q->items.push_front(std::move(copy));
+    else q->items.push_back(std::move(copy));
+    rtos_changed.notify_all();
+    return pdTRUE;
+}
+
+BaseType_t xQueueSend(QueueHandle_t q, const void* item, TickType_t ticks) { return queue_send(q, item, ticks, false); }
+BaseType_t xQueueSendToBack(QueueHandle_t q, const void* item, TickType_t ticks) { return queue_send(q, item, ticks, false); }
+BaseType_t xQueueSendToFront(QueueHandle_t q, const void* item, TickType_t ticks) { return queue_send(q, item, ticks, true); }
+
+static BaseType_t queue_take(QueueHandle_t handle, void* item, TickType_t ticks, bool remove) {
+    host_queue* q = (host_queue*)handle;
+    std::unique_lock<std::mutex> lock(rtos_mutex);
+    if (!wait_for(lock, ticks, [&] { return !q->items.empty(); })) return pdFALSE;
+    if (item) memcpy(item, q->items.front().data(), q->item_size);
+    if (remove) {
+        q->items.pop_front();
+        rtos_changed.notify_all();
+    }
+    return pdTRUE;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t q, void* item, TickType_t ticks) { return queue_take(q, item, ticks, true); }
+BaseType_t xQueuePeek(QueueHandle_t q, void* item, TickType_t ticks) { return queue_take(q, item, ticks, false); }
+
+BaseType_t xQueueOverwrite(QueueHandle_t handle, const void* item) {
+    host_queue* q = (host_queue*)handle;
+    std::lock_guard<std::mutex> lock(rtos_mutex);
+    q->items.clear();
+    q->items.emplace_back((const uint8_t*)item, (const uint8_t*)item + q->item_size);
+    rtos_changed.notify_all();
+    return pdTRUE;
+}
+
+BaseType_t xQueueReset(QueueHandle_t handle) {
+    std::lock_guard<std::mutex> lock(rtos_mutex);
+    ((host_queue*)handle)->items.clear();
+    rtos_changed.notify_all();
+    return pdPASS;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t handle) {
+    std::lock_guard<std::mutex> lock(rtos_mutex);
+    return (UBaseType_t)((host_queue*)handle)->items.size();
+}
+
+UBaseType_t uxQueueSpacesAvailable(QueueHandle_t handle) {
+    std::lock_guard<std::mutex> lock(rtos_mutex);
+    host_queue* q = (host_queue*)handle;
+    return (UBaseType_t)(q->length - q->items.size());
+}
+
+void vQueueDelete(QueueHandle_t handle) { delete (host_queue*)handle; }
+
+// --- Semaphores (mutexes are binary semaphores given once) ---
+
+struct host_semaphore {
+    UBaseType_t count;
+    UBaseType_t max;
+};
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void) { return new host_semaphore{ 1, 1 }; }
+SemaphoreHandle_t xSemaphoreCreateBinary(void) { return new host_semaphore{ 0, 1 }; }
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t max, UBaseType_t initial) { return new host_semaphore{ initial, max }; }
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t handle, TickType_t ticks) {
+    host_semaphore* s = (host_semaphore*)handle;
+    std::unique_lock<std::mutex> lock(rtos_mutex);
+    if (!wait_for(lock, ticks, [&] { return s->count > 0; })) return pdFALSE;
+    s->count--;
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t handle) {
+    host_semaphore* s = (host_semaphore*)handle;
+    std::lock_guard<std::mutex> lock(rtos_mutex);
+    if (s->count >= s->max) return pdFALSE;
+    s->count++;
+    rtos_changed.notify_all();
+    return pdTRUE;
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t handle) { delete (host_semaphore*)handle; }
+
+// --- Byte ring buffers ---
+
+struct host_ring {
+    std::vector<uint8_t> data;
+    size_t head = 0;
+    size_t fill = 0;
+};
+
+RingbufHandle_t xRingbufferCreate(size_t size, RingbufferType_t) {
+    host_ring* r = new host_ring;
+    r->data.resize(size);
+    return r;
+}
+
+RingbufHandle_t xRingbufferCreateWithCaps(size_t size, RingbufferType_t type, uint32_t) { return xRingbufferCreate(size, type); }
+void vRingbufferDelete(RingbufHandle_t ring) { delete (host_ring*)ring; }
+void vRingbufferDeleteWithCaps(RingbufHandle_t ring) { vRingbufferDelete(ring); }
+
+BaseType_t xRingbufferSend(RingbufHandle_t handle, const void* data, size_t size, TickType_t ticks) {
+    host_ring* r = (host_ring*)handle;
+    std::unique_lock<std::mutex> lock(rtos_mutex);
+    if (!wait_for(lock, ticks, [&] { return r->data.size() - r->fill >= size; })) return pdFALSE;
+    for (size_t i = 0; i < size; i++) r->data[(r->head + r->fill + i) % r->data.size()] = ((const uint8_t*)data)[i];
+    r->fill += size;
+    rtos_changed.notify_all();
+    return pdTRUE;
+}
+
+void* xRingbufferReceiveUpTo(RingbufHandle_t handle, size_t* size, TickType_t ticks, size_t max_size) {
+    host_ring* r = (host_ring*)handle;
+    std::unique_lock<std::mutex> lock(rtos_mutex);
+    if (!wait_for(lock, ticks, [&] { return r->fill > 0; })) return NULL;
+    size_t n = (r->fill < max_size) ? r->fill : max_size;
+    // Like the IDF byte buffer, an item never spans the wrap point.
+    if (n > r->data.size() - r->head) n = r->data.size() - r->head;
+    uint8_t* item = (uint8_t*)malloc(n);
+    memcpy(item, &r->data[r->head], n);
+    r->head = (r->head + n) % r->data.size();
+    r->fill -= n;
+    *size = n;
+    rtos_changed.notify_all();
+    return item;
+}
+
+void* xRingbufferReceive(RingbufHandle_t ring, size_t* size, TickType_t ticks) {
+    return xRingbufferReceiveUpTo(ring, size, ticks, SIZE_MAX);
+}
+
+void vRingbufferReturnItem(RingbufHandle_t, void* item) { free(item); }
+
+size_t xRingbufferGetCurFreeSize(RingbufHandle_t handle) {
+    std::lock_guard<std::mutex> lock(rtos_mutex);
+    host_ring* r = (host_ring*)handle;
+    return r->data.size() - r->fill;
+}
+
+// --- Event groups ---
+
+struct host_event_group {
+    EventBits_t bits = 0;
+};
+
+EventGroupHandle_t xEventGroupCreate(void) { return new host_event_group; }
+void vEventGroupDelete(EventGroupHandle_t group) { delete (host_event_group*)group; }
+
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t handle, EventBits_t bits, BaseType_t clear_on_exit,
+                                BaseType_t wait_for_all, TickType_t ticks) {
+    host_event_group* g = (host_event_group*)handle;
+    std::unique_lock<std::mutex> lock(rtos_mutex);
+    const bool met = wait_for(lock, ticks, [&] { return wait_for_all ? (g->bits & bits) == bits : (g->bits & bits) != 0; });
+    const EventBits_t value = g->bits;
+    if (met && clear_on_exit) g->bits &= ~bits;
+    return value;
+}
+
+EventBits_t xEventGroupSetBits(EventGroupHandle_t handle, EventBits_t bits) {
+    std::lock_guard<std::mutex> lock(rtos_mutex);
+    host_event_group* g = (host_event_group*)handle;
+    g->bits |= bits;
+    rtos_changed.notify_all();
+    return g->bits;
+}
+
+EventBits_t xEventGroupClearBits(EventGroupHandle_t handle, EventBits_t bits) {
+    std::lock_guard<std::mutex> lock(rtos_mutex);
+    host_event_group* g = (host_event_group*)handle;
+    const EventBits_t before = g->bits;
+    g->bits &= ~bits;
+    return before;
+}
+
+EventBits_t xEventGroupGetBits(EventGroupHandle_t handle) {
+    std::lock_guard<std::mutex> lock(rtos_mutex);
+    return ((host_event_group*)handle)->bits;
+}
+
+// --- esp_timer one-shots ---
+
+// Each start runs a thread that waits out the timeout and calls the callback
+// unless the timer was stopped or started again meanwhile (a new generation).
+struct esp_timer {
+    esp_timer_cb_t callback;
+    void* arg;
+    uint64_t generation = 0;
+    bool armed = false;
+};
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t* args, esp_timer_handle_t* out_handle) {
+    *out_handle = new esp_timer{ args->callback, args->arg };
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us) {
+    std::lock_guard<std::mutex> lock(rtos_mutex);
+    if (timer->armed) return ESP_ERR_INVALID_STATE;
+    timer->armed = true;
+    const uint64_t generation = ++timer->generation;
+    std::thread([timer, timeout_us, generation] {
+        std::unique_lock<std::mutex> lock(rtos_mutex);
+        if (rtos_changed.wait_for(lock, std::chrono::microseconds(timeout_us), [&] { return timer->generation != generation; })) {
+            return;
+        }
+        timer->armed = false;
+        lock.unlock();
+        timer->callback(timer->arg);
+    }).detach();
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer) {
+    std::lock_guard<std::mutex> lock(rtos_mutex);
+    if (!timer->armed) return ESP_ERR_INVALID_STATE;
+    timer->armed = false;
+    timer->generation++;
+    rtos_changed.notify_all();
+    return ESP_OK;
+}
+
+// The timer itself is kept: a stopped timer's thread may not have woken yet.
+esp_err_t esp_timer_delete(esp_timer_handle_t timer) {
+    esp_timer_stop(timer);
+    return ESP_OK;
+}
@@ -0,0 +1,35 @@
+// SD card timing model, see host_sd.h. Wraps the stdio calls with the
+// linker's --wrap, so the modules under test stay unchanged.
+#include "host_sd.h"
+#include <chrono>
+#include <stdio.h>
+#include <thread>
+
+int host_sd_access_us = 0;
+int host_sd_seek_us = 0;
+int host_sd_bytes_per_ms = 0;
+
+extern "C" size_t __real_fread(void* ptr, size_t size, size_t count, FILE* fp);
+extern "C" size_t __real_fwrite(const void* ptr, size_t size, size_t count, FILE* fp);
+extern "C" int __real_fseek(FILE* fp, long offset, int whence);
+
+static void transfer(size_t bytes) {
+    if (host_sd_bytes_per_ms) {
+        std::this_thread::sleep_for(std::chrono::microseconds(host_sd_access_us + (int64_t)bytes * 1000 / host_sd_bytes_per_ms));
+    }
+}
+
+extern "C" size_t __wrap_fread(void* ptr, size_t size, size_t count, FILE* fp) {
+    transfer(size * count);
+    return __real_fread(ptr, size, count, fp);
+}
+
+extern "C" size_t __wrap_fwrite(const void* ptr, size_t size, size_t count, FILE* fp) {
+    transfer(size * count);
+    return __real_fwrite(ptr, size, count, fp);
+}
+
+extern "C" int __wrap_fseek(FILE* fp, long offset, int whence) {
+    if (host_sd_bytes_per_ms) std::this_thread::sleep_for(std::chrono::microseconds(host_sd_seek_us));
+    return __real_fseek(fp, offset, whence);
+}
@@ -0,0 +1,13 @@
+/**
+ * @file host_sd.h
+ * @brief A crude SD card model for the file-backed host tests.
+ *
+ * Link a test with HOST_SD_LINK_OPTIONS (see CMakeLists.txt) and every fread(),
+ * fwrite() and fseek() of the code under test takes the time set here on top
+ * of the host's own file I/O. All zero (the default) adds nothing.
+ */
+#pragma once
+
+extern int host_sd_access_us;     //!< Fixed cost of each read or write.
+extern int host_sd_seek_us;       //!< Cost of each seek.
+extern int host_sd_bytes_per_ms;  //!< Transfer rate; 0 disables the model.
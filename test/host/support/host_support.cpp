@@ -0,0 +1,155 @@
+// Host implementations of the ESP-IDF services the tested modules use
+// (timer, heap, logging) and of host_test.h.
+#include "host_test.h"
+#include "esp_err.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+#include <atomic>
+#include <chrono>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+int host_log_level = 1;
+int host_test_failures = 0;
+
+static std::atomic<int64_t> time_offset_us{ 0 };
+
+int64_t esp_timer_get_time(void) {
+    static const auto start = std::chrono::steady_clock::now();
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count() +
+           time_offset_us;
+}
+
+void host_advance_time(int64_t us) { time_offset_us += us; }
+
+const char* esp_err_to_name(esp_err_t err) { return err == ESP_OK ? "ESP_OK" : "ESP_FAIL"; }
+
+void* heap_caps_malloc(size_t size, uint32_t) { return malloc(size); }
+void* heap_caps_calloc(size_t n, size_t size, uint32_t) { return calloc(n, size); }
+void* heap_caps_realloc(void* ptr, size_t size, uint32_t) { return realloc(ptr, size); }
+void heap_caps_free(void* ptr) { free(ptr); }
+
+int host_test_result(void) {
+    if (host_test_failures) {
+        printf("%d check(s) FAILED\n", host_test_failures);
+        return 1;
+    }
+    printf("All checks passed\n");
+    return 0;
+}
+
+double host_now_s(void) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+uint64_t host_cycles(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+const char* host_cycles_unit(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    return "TSC cycles";
+#else
+    return "ns";
+#endif
+}
+
+double host_random(uint32_t* state) {
+    uint32_t x = *state ? *state : 1;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return (double)x / 2147483648.0 - 1.0;
+}
+
+double host_sine_fit_snr_db(const int16_t* x, size_t count, size_t stride, double freq_hz, double sample_rate_hz) {
+    // Normal equations of x ~ a*sin + b*cos + c.
+    double m[3][3] = {}, v[3] = {};
+    const double w = 2.0 * M_PI * freq_hz / sample_rate_hz;
+    for (size_t i = 0; i < count; i++) {
+        const double basis[3] = { sin(w * i), cos(w * i), 1.0 };
+        const double y = x[i * stride];
+        for (int r = 0; r < 3; r++) {
+            v[r] += basis[r] * y;
+            for (int c = 0; c < 3; c++) m[r][c] += basis[r] * basis[c];
+        }
+    }
+    // Gaussian elimination (the system is small and well conditioned).
+    for (int p = 0; p < 3; p++) {
+        for (int r = p + 1; r < 3; r++) {
+            const double f = m[r][p] / m[p][p];
+            for (int c = p; c < 3; c++) m[r][c] -= f * m[p][c];
+            v[r] -= f * v[p];
+        }
+    }
+    double k[3];
+    for (int r = 2; r >= 0; r--) {
+        double s = v[r];
+        for (int c = r + 1; c < 3; c++) s -= m[r][c] * k[c];
+        k[r] = s / m[r][r];
+    }
+    double signal = 0, noise = 0;
+    for (size_t i = 0; i < count; i++) {
+        const double fit = k[0] * sin(w * i) + k[1] * cos(w * i) + k[2];
+        signal += (fit - k[2]) * (fit - k[2]);
+        noise += (x[i * stride] - fit) * (x[i * stride] - fit);
+    }
+    return 10.0 * log10(signal / (noise > 1e-12 ? noise : 1e-12));
+}
+
+static uint32_t le32(const uint8_t* p) { return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24); }
+static uint16_t le16(const uint8_t* p) { return (uint16_t)(p[0] | (p[1] << 8)); }
+
+bool host_read_wav16(const char* path, std::vector<int16_t>* samples, uint32_t* sample_rate, uint16_t* channels) {
+    FILE* f = fopen(path, "rb");
+    if (!f) return false;
+    uint8_t riff[12];
+    bool ok = fread(riff, 1, 12, f) == 12 && memcmp(riff, "RIFF", 4) == 0 && memcmp(riff + 8, "WAVE", 4) == 0;
+    bool have_fmt = false;
+    while (ok) {
+        uint8_t chunk[8];
+        if (fread(chunk, 1, 8, f) != 8) { ok = false; break; }
+        const uint32_t size = le32(chunk + 4);
+        if (memcmp(chunk, "fmt ", 4) == 0) {
+            uint8_t fmt[16];
+            ok = size >= 16 && fread(fmt, 1, 16, f) == 16 && le16(fmt) == 1 && le16(fmt + 14) == 16;
+            *channels = le16(fmt + 2);
+            *sample_rate = le32(fmt + 4);
+            have_fmt = true;
+            fseek(f, (long)(size - 16 + (size & 1)), SEEK_CUR);
+        } else if (memcmp(chunk, "data", 4) == 0 && have_fmt) {
+            samples->resize(size / 2);
+            ok = fread(samples->data(), 2, samples->size(), f) == samples->size();
+            break;
+        } else {
+            fseek(f, (long)(size + (size & 1)), SEEK_CUR);
+        }
+    }
+    fclose(f);
+    return ok;
+}
+
+bool host_write_wav16(const char* path, const int16_t* samples, size_t frames, uint32_t sample_rate, uint16_t channels) {
+    FILE* f = fopen(path, "wb");
+    if (!f) return false;
+    const uint32_t data_size = (uint32_t)(frames * channels * 2);
+    uint8_t h[44];
+    auto put32 = [](uint8_t* p, uint32_t v) { for (int i = 0; i < 4; i++) p[i] = (uint8_t)(v >> (8 * i)); };
+    auto put16 = [](uint8_t* p, uint16_t v) { p[0] = (uint8_t)v; p[1] = (uint8_t)(v >> 8); };
+    memcpy(h, "RIFF", 4); put32(h + 4, 36 + data_size); memcpy(h + 8, "WAVEfmt ", 8);
+    put32(h + 16, 16); put16(h + 20, 1); put16(h + 22, channels); put32(h + 24, sample_rate);
+    put32(h + 28, sample_rate * channels * 2); put16(h + 32, (uint16_t)(channels * 2)); put16(h + 34, 16);
+    memcpy(h + 36, "data", 4); put32(h + 40, data_size);
+    const bool ok = fwrite(h, 1, 44, f) == 44 && fwrite(samples, 2, frames * channels, f) == frames * channels;
+    fclose(f);
+    return ok;
+}
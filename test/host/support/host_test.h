@@ -0,0 +1,58 @@
+/**
+ * @file host_test.h
+ * @brief Checks, timing and test signals shared by the host tests and benchmarks.
+ *
+ * Every test is a plain executable: HOST_CHECK() records a failure and keeps
+ * going, and main() returns host_test_result(), which CTest reads.
+ */
+#pragma once
+#include <stdint.h>
+#include <stdio.h>
+#include <stddef.h>
+#include <vector>
+
+extern int host_test_failures;
+
+#define HOST_CHECK(cond, ...)                                                  \
+    do {                                                                       \
+        if (!(cond)) {                                                         \
+            host_test_failures++;                                              \
+            fprintf(stderr, "FAILED %s:%d: %s: ", __FILE__, __LINE__, #cond);  \
+            fprintf(stderr, __VA_ARGS__);                                      \
+            fputc('\n', stderr);                                               \
+        }                                                                      \
+    } while (0)
+
+/** @brief Prints the outcome; returns the exit code for main(). */
+int host_test_result(void);
+
+/**
+ * @brief Moves esp_timer_get_time() forward by `us`, e.g. to let audio time pass
+ * without waiting for it. The FreeRTOS tick count follows; host_now_s() and
+ * timeouts that sleep do not.
+ */
+void host_advance_time(int64_t us);
+
+/** @brief Seconds of a monotonic clock. */
+double host_now_s(void);
+
+/** @brief CPU cycles (the TSC on x86-64), or nanoseconds where there is no cycle counter. */
+uint64_t host_cycles(void);
+
+/** @brief Name of the unit host_cycles() counts in, for the reports. */
+const char* host_cycles_unit(void);
+
+/** @brief Deterministic pseudo-random numbers (xorshift32), uniform in [-1, 1). */
+double host_random(uint32_t* state);
+
+/**
+ * @brief SNR (dB) of `x` against the best least-squares fit of a sine at `freq_hz`
+ * (with DC), i.e. -(THD+N). `stride` selects one channel of interleaved samples.
+ */
+double host_sine_fit_snr_db(const int16_t* x, size_t count, size_t stride, double freq_hz, double sample_rate_hz);
+
+/** @brief Reads a 16-bit PCM WAV (any channel count) into interleaved samples. */
+bool host_read_wav16(const char* path, std::vector<int16_t>* samples, uint32_t* sample_rate, uint16_t* channels);
+
+/** @brief Writes interleaved samples as a 16-bit PCM WAV. */
+bool host_write_wav16(const char* path, const int16_t* samples, size_t frames, uint32_t sample_rate, uint16_t channels);
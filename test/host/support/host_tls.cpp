@@ -0,0 +1,222 @@
+// esp-tls over OpenSSL (see host_tls.h).
+#include "host_tls.h"
+#include "esp_tls.h"
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/tcp.h>
+#include <openssl/err.h>
+#include <openssl/pem.h>
+#include <openssl/ssl.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+
+static std::mutex config_mutex;
+static host_tls_config_t config = {};
+static std::map<std::string, int> routes; // Host name -> local port.
+static std::atomic<int> full_handshakes{ 0 }, resumed_handshakes{ 0 }, open_connections{ 0 };
+
+void host_tls_set_config(const host_tls_config_t* cfg) {
+    std::lock_guard<std::mutex> lock(config_mutex);
+    config = *cfg;
+}
+
+void host_tls_get_stats(host_tls_stats_t* stats) {
+    stats->full_handshakes = full_handshakes;
+    stats->resumed_handshakes = resumed_handshakes;
+    stats->open_connections = open_connections;
+}
+
+static host_tls_config_t current_config(void) {
+    std::lock_guard<std::mutex> lock(config_mutex);
+    return config;
+}
+
+void host_tls_route(const char* host, int port) {
+    std::lock_guard<std::mutex> lock(config_mutex);
+    routes[host] = port;
+}
+
+// The local port `host` is routed to, or 0.
+static int route_port(const char* host) {
+    std::lock_guard<std::mutex> lock(config_mutex);
+    auto route = routes.find(host);
+    return route == routes.end() ? 0 : route->second;
+}
+
+extern "C" int __real_getaddrinfo(const char* node, const char* service, const struct addrinfo* hints,
+                                  struct addrinfo** res);
+extern "C" int __wrap_getaddrinfo(const char* node, const char* service, const struct addrinfo* hints,
+                                  struct addrinfo** res) {
+    return __real_getaddrinfo(node && route_port(node) ? "127.0.0.1" : node, service, hints, res);
+}
+
+struct esp_tls {
+    esp_tls_conn_state_t state = ESP_TLS_INIT;
+    int fd = -1;
+    SSL_CTX* ctx = nullptr;
+    SSL* ssl = nullptr;
+    std::chrono::steady_clock::time_point uplink_free; // When the modeled uplink has sent what was written.
+};
+
+// Like mbedTLS's, a session is a copy that outlives its connection.
+struct esp_tls_client_session {
+    SSL_SESSION* session;
+};
+
+esp_tls_t* esp_tls_init(void) { return new esp_tls; }
+
+// Starts the TCP connection to `host`:`port`, without waiting for it.
+static bool start_connect(esp_tls_t* tls, const std::string& host, int port) {
+    struct addrinfo hints = {};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    struct addrinfo* addresses = nullptr;
+    if (getaddrinfo(host.c_str(), nullptr, &hints, &addresses) != 0 || !addresses) return false;
+    struct sockaddr_in address = *(struct sockaddr_in*)addresses->ai_addr;
+    freeaddrinfo(addresses);
+    const int routed = route_port(host.c_str());
+    address.sin_port = htons(routed ? routed : port);
+
+    tls->fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (tls->fd < 0) return false;
+    int one = 1;
+    setsockopt(tls->fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one)); // lwIP sends small segments at once too.
+    fcntl(tls->fd, F_SETFL, fcntl(tls->fd, F_GETFL, 0) | O_NONBLOCK);
+    return connect(tls->fd, (struct sockaddr*)&address, sizeof(address)) == 0 || errno == EINPROGRESS;
+}
+
+// Sets up the TLS side once the TCP connection is up.
+static bool start_handshake(esp_tls_t* tls, const std::string& host, const esp_tls_cfg_t* cfg) {
+    tls->ctx = SSL_CTX_new(TLS_client_method());
+    if (!tls->ctx) return false;
+    SSL_CTX_set_max_proto_version(tls->ctx, TLS1_2_VERSION);
+    SSL_CTX_set_session_cache_mode(tls->ctx, SSL_SESS_CACHE_CLIENT);
+    // cacert_bytes counts the PEM's terminating NUL, as esp-tls requires.
+    BIO* bio = BIO_new_mem_buf(cfg->cacert_buf, (int)cfg->cacert_bytes - 1);
+    X509* ca = PEM_read_bio_X509(bio, nullptr, nullptr, nullptr);
+    BIO_free(bio);
+    if (!ca) return false;
+    X509_STORE_add_cert(SSL_CTX_get_cert_store(tls->ctx), ca);
+    X509_free(ca);
+    SSL_CTX_set_verify(tls->ctx, SSL_VERIFY_PEER, nullptr);
+
+    tls->ssl = SSL_new(tls->ctx);
+    if (!tls->ssl) return false;
+    const std::string name = cfg->common_name ? cfg->common_name : host;
+    SSL_set_tlsext_host_name(tls->ssl, name.c_str());
+    if (!cfg->skip_common_name) SSL_set1_host(tls->ssl, name.c_str());
+    SSL_set_fd(tls->ssl, tls->fd);
+    if (cfg->client_session) SSL_set_session(tls->ssl, cfg->client_session->session);
+    return true;
+}
+
+static void model_sleep_ms(uint32_t ms) {
+    if (ms) std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+int esp_tls_conn_new_async(const char* hostname, int hostlen, int port, const esp_tls_cfg_t* cfg, esp_tls_t* tls) {
+    const std::string host(hostname, hostlen);
+    if (tls->state == ESP_TLS_INIT) {
+        if (!start_connect(tls, host, port)) {
+            tls->state = ESP_TLS_FAIL;
+            return -1;
+        }
+        tls->state = ESP_TLS_CONNECTING;
+    }
+    if (tls->state == ESP_TLS_CONNECTING) {
+        fd_set writable;
+        FD_ZERO(&writable);
+        FD_SET(tls->fd, &writable);
+        struct timeval poll = { 0, 10000 };
+        if (select(tls->fd + 1, nullptr, &writable, nullptr, &poll) == 0) return 0;
+        int error = 0;
+        socklen_t len = sizeof(error);
+        getsockopt(tls->fd, SOL_SOCKET, SO_ERROR, &error, &len);
+        if (error || !start_handshake(tls, host, cfg)) {
+            tls->state = ESP_TLS_FAIL;
+            return -1;
+        }
+        tls->state = ESP_TLS_HANDSHAKE;
+    }
+    if (tls->state != ESP_TLS_HANDSHAKE) return tls->state == ESP_TLS_DONE ? 1 : -1;
+
+    const int ret = SSL_connect(tls->ssl);
+    if (ret == 1) {
+        tls->state = ESP_TLS_DONE;
+        const bool resumed = SSL_session_reused(tls->ssl);
+        (resumed ? resumed_handshakes : full_handshakes)++;
+        open_connections++;
+        const host_tls_config_t model = current_config();
+        model_sleep_ms(resumed ? model.resumed_handshake_ms : model.full_handshake_ms);
+        tls->uplink_free = std::chrono::steady_clock::now();
+        return 1;
+    }
+    const int error = SSL_get_error(tls->ssl, ret);
+    if (error == SSL_ERROR_WANT_READ || error == SSL_ERROR_WANT_WRITE) return 0;
+    ERR_print_errors_fp(stderr);
+    tls->state = ESP_TLS_FAIL;
+    return -1;
+}
+
+esp_err_t esp_tls_get_conn_state(esp_tls_t* tls, esp_tls_conn_state_t* conn_state) {
+    *conn_state = tls->state;
+    return ESP_OK;
+}
+
+esp_err_t esp_tls_get_conn_sockfd(esp_tls_t* tls, int* sockfd) {
+    *sockfd = tls->fd;
+    return tls->fd >= 0 ? ESP_OK : ESP_FAIL;
+}
+
+ssize_t esp_tls_conn_write(esp_tls_t* tls, const void* data, size_t datalen) {
+    const uint32_t kbps = current_config().uplink_kbps;
+    if (kbps) {
+        const auto now = std::chrono::steady_clock::now();
+        if (tls->uplink_free < now) tls->uplink_free = now;
+        tls->uplink_free += std::chrono::microseconds((int64_t)(datalen * 8000 / kbps));
+        std::this_thread::sleep_until(tls->uplink_free);
+    }
+    const int ret = SSL_write(tls->ssl, data, (int)datalen);
+    return ret > 0 ? ret : -1;
+}
+
+ssize_t esp_tls_conn_read(esp_tls_t* tls, void* data, size_t datalen) {
+    const int ret = SSL_read(tls->ssl, data, (int)datalen);
+    if (ret > 0) return ret;
+    // A clean close reads as 0, like mbedTLS's MBEDTLS_ERR_SSL_PEER_CLOSE_NOTIFY through esp-tls.
+    const int error = SSL_get_error(tls->ssl, ret);
+    return error == SSL_ERROR_ZERO_RETURN || (error == SSL_ERROR_SYSCALL && ERR_peek_error() == 0) ? 0 : -1;
+}
+
+ssize_t esp_tls_get_bytes_avail(esp_tls_t* tls) { return tls->ssl ? SSL_pending(tls->ssl) : -1; }
+
+int esp_tls_conn_destroy(esp_tls_t* tls) {
+    if (tls->state == ESP_TLS_DONE) open_connections--;
+    if (tls->ssl) SSL_free(tls->ssl);
+    if (tls->ctx) SSL_CTX_free(tls->ctx);
+    if (tls->fd >= 0) close(tls->fd);
+    delete tls;
+    return 0;
+}
+
+esp_tls_client_session_t* esp_tls_get_client_session(esp_tls_t* tls) {
+    // A copy: OpenSSL marks the live session unresumable when its connection is freed without a shutdown.
+    SSL_SESSION* live = tls->ssl ? SSL_get0_session(tls->ssl) : nullptr;
+    SSL_SESSION* copy = live ? SSL_SESSION_dup(live) : nullptr;
+    return copy ? new esp_tls_client_session{ copy } : nullptr;
+}
+
+void esp_tls_free_client_session(esp_tls_client_session_t* client_session) {
+    if (!client_session) return;
+    SSL_SESSION_free(client_session->session);
+    delete client_session;
+}
@@ -0,0 +1,40 @@
+/**
+ * @file host_tls.h
+ * @brief esp-tls over OpenSSL, for testing the HTTPS client against a local server.
+ *
+ * The esp-tls calls of stubs/esp_tls.h open real TLS connections with the
+ * device's limits (TLS 1.2 at most, the server verified against the CA
+ * certificate given, client sessions that can be offered again), going
+ * through the same non-blocking connection states. Link the test with the
+ * host_tls library.
+ *
+ * The library counts handshakes and open connections, and can add a simple
+ * network model on top of the loopback: handshake times and a slow uplink.
+ * A host name the firmware uses can be routed to the local server; the
+ * library wraps getaddrinfo() for that.
+ */
+#pragma once
+#include <stdint.h>
+
+typedef struct {
+    uint32_t full_handshake_ms;    //!< Added to every full handshake.
+    uint32_t resumed_handshake_ms; //!< Added to every resumed handshake.
+    uint32_t uplink_kbps;          //!< Rate writes are paced to; 0 for the loopback's own.
+} host_tls_config_t;
+
+typedef struct {
+    int full_handshakes;
+    int resumed_handshakes;
+    int open_connections;          //!< Connections handshaken and not yet destroyed.
+} host_tls_stats_t;
+
+/** @brief Sets the network model; the default adds nothing. */
+void host_tls_set_config(const host_tls_config_t* config);
+
+void host_tls_get_stats(host_tls_stats_t* stats);
+
+/**
+ * @brief Sends the connections to `host`, on any port, to the local server on
+ * `port`. The name resolves to 127.0.0.1; the server's certificate must name it.
+ */
+void host_tls_route(const char* host, int port);